@@ -12,6 +12,7 @@
 #include "stockPrograms.h"
 #include "fileLoader.h"
 #include "program.h"
+#include "programCache.h"
 #include "window.h"
 #include "fbo.h"
 #include "texture1D.h"
@@ -32,6 +33,7 @@
 #include "keyboard.h"
 #include "query.h"
 #include "glStateCache.h"
+#include "glStateTracker.h"
 #include "commandLineProcessor.h"
 #include "drawCommand.h"
 #include "texture2DBlitter.h"
@@ -39,6 +41,11 @@
 #include "pbrMaterial.h"
 #include "uboPBRMaterial.h"
 #include "picker.h"
+#include "rayPicker.h"
+#include "renderStats.h"
+#include "streamingBuffer.h"
+#include "resourceTracker.h"
+#include "fileWatcher.h"
 
 // Animacin
 #include "animationClip.h"
@@ -52,7 +59,18 @@
 #include "transform.h"
 #include "group.h"
 #include "geode.h"
+#include "instancedGeode.h"
+#include "nodePool.h"
+#include "lod.h"
+#include "meshSimplifier.h"
+#include "meshOptimizer.h"
+#include "meshProcessing.h"
+#include "geometryPool.h"
+#include "meshlets.h"
 #include "scene.h"
+#include "renderQueue.h"
 #include "nodeVisitor.h"
+#include "parallelUpdateVisitor.h"
+#include "jobPool.h"
 
 #endif
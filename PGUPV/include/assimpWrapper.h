@@ -21,6 +21,7 @@ namespace PGUPV {
   class Node;
   class Mesh;
   class Skeleton;
+  class NodePool;
 
   class AssimpWrapper {
   public:
@@ -56,6 +57,56 @@ namespace PGUPV {
 	*/
 	bool save(const std::string &path, const std::string &id, std::shared_ptr<Scene> scene);
 
+	/**
+	Establece el almacén del que se reservarán los nodos del grafo de escena de los ficheros
+	cargados a partir de ahora (nullptr para usar el operador new)
+	\param pool almacén de nodos
+	*/
+	void setNodePool(std::shared_ptr<NodePool> pool);
+
+	/**
+	Genera niveles de detalle (ver LOD y MeshSimplifier) para las mallas de triángulos grandes
+	de los ficheros cargados a partir de ahora. Los nodos con mallas grandes se sustituyen por
+	un nodo LOD con la versión original y las simplificadas. Las mallas con huesos no se
+	simplifican, y las simplificadas sólo tienen posiciones, normales y coordenadas de textura 0.
+	\param levels número de niveles simplificados (0 para no generarlos)
+	\param ratio proporción de triángulos de cada nivel respecto al anterior
+	\param minTriangles número mínimo de triángulos de una malla para simplificarla
+	\param screenSize tamaño en pantalla (fracción de la altura de la ventana) por debajo del
+	  cual se deja de usar la malla original
+	*/
+	void setLODGeneration(unsigned int levels, float ratio = 0.5f, size_t minTriangles = 10000,
+		float screenSize = 0.5f);
+
+	/**
+	Si es true, las posiciones, normales, tangentes y coordenadas de textura de las mallas de los
+	ficheros cargados a partir de ahora se guardan en un solo buffer entrelazado (ver
+	Mesh::setInterleavedVertices), en lugar de un buffer por atributo. Requiere OpenGL 4.3
+	\param interleaved true para entrelazar los atributos (por defecto, false)
+	*/
+	void setInterleavedMeshes(bool interleaved);
+
+	/**
+	Si es true, antes de crear las mallas de triángulos de los ficheros cargados a partir de
+	ahora se reordenan sus triángulos y sus vértices con MeshOptimizer (para aprovechar la
+	caché de vértices, reducir el sobredibujado y leer los vértices en orden). Se muestra el
+	ACMR y el ATVR de cada malla antes y después.
+	\param optimize true para optimizar las mallas (por defecto, false)
+	*/
+	void setMeshOptimization(bool optimize);
+
+	/**
+	Si compress es true, las mallas de los ficheros cargados a partir de ahora guardan las
+	normales y las tangentes en 32 bits (GL_INT_2_10_10_10_REV), las coordenadas de textura en
+	floats de 16 bits y, si tienen menos de 65536 vértices, usan índices de 16 bits. Los
+	shaders no tienen que cambiar.
+	\param compress true para comprimir las mallas (por defecto, false)
+	\param quantizePositions true para guardar también las posiciones en enteros de 16 bits
+	  relativos a la caja de inclusión de cada malla (ver Mesh::addQuantizedVertices). No se
+	  aplica a las mallas con huesos, ni a las mallas entrelazadas (ver setInterleavedMeshes)
+	*/
+	void setMeshCompression(bool compress, bool quantizePositions = false);
+
   private:
 	class AssimpWrapperImpl;
 	std::unique_ptr<AssimpWrapperImpl> impl;
@@ -4,6 +4,7 @@
 
 #include <GL/glew.h>
 #include <string>
+#include <cstdint>
 
 namespace PGUPV  {
 	class BindableTexture {
@@ -33,13 +34,19 @@ namespace PGUPV  {
 		//! Devuelve el nombre de la textura
 		const std::string getName() const { return _name; }
 		// Establece el nombre de la textura
-		void setName(const std::string &name) { _name = name; }
+		void setName(const std::string &name);
 	protected:
+		/**
+		Pregunta a OpenGL cunta memoria ocupa la textura (todos sus niveles) y la apunta en el
+		ResourceTracker. La textura tiene que estar vinculada en la unidad de textura activa
+		*/
+		void updateMemoryUsage();
 		GLuint _texId;
 		bool _ready;
 		GLenum _texture_type /*, _texture_type_binding*/;
 		int _textureUnitBound;
 		std::string _name;
+		uint64_t _memoryId;
 	private:
 		// No permitir la copia
 		BindableTexture(const BindableTexture &other);
@@ -99,6 +99,32 @@ namespace PGUPV {
   };
 
 
+  /*
+  Volumen de la vista (frustum) definido por sus seis planos. Los planos se extraen de una
+  matriz de proyección (Gribb y Hartmann, 2001). Si la matriz es el producto
+  projection * view * model, los planos quedan expresados en el sistema de coordenadas del
+  modelo, por lo que se pueden comprobar directamente sus volúmenes de inclusión
+  */
+  struct Frustum {
+    /**
+    Construye el frustum a partir de la matriz indicada
+    \param mvp producto de las matrices projection, view y (opcionalmente) model
+    */
+    explicit Frustum(const glm::mat4 &mvp);
+    /**
+    \return false si la esfera está completamente fuera del volumen de la vista (puede devolver
+    true para algunas esferas que están fuera, cerca de las esquinas del frustum)
+    */
+    bool intersects(const BoundingSphere &s) const;
+    /**
+    \return false si la caja está completamente fuera del volumen de la vista (puede devolver
+    true para algunas cajas que están fuera, cerca de las esquinas del frustum)
+    */
+    bool intersects(const BoundingBox &b) const;
+    // Planos izquierdo, derecho, inferior, superior, cercano y lejano (normal hacia dentro)
+    glm::vec4 planes[6];
+  };
+
   std::ostream &operator<<(std::ostream &os, const BoundingBox &s);
   std::ostream &operator<<(std::ostream &os, const BoundingSphere &s);
 
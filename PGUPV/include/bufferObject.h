@@ -69,10 +69,13 @@ namespace PGUPV {
     BufferObject& operator=(BufferObject other) = delete;
 
     std::string getName();
+    // Apunta el buffer en el ResourceTracker
+    void trackMemory();
     GLuint id;
     size_t size;
     GLenum usage;
     std::string debugLabel;
+    uint64_t memoryId;
   };
 
 };
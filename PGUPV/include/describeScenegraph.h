@@ -18,7 +18,9 @@ namespace PGUPV {
   class DescribeScenegraph : public NodeVisitor {
   public:
     DescribeScenegraph(std::ostream &os, size_t spacesPerIndent = 2) : 
-      os(os), spacesPerIndent(spacesPerIndent), currentLevel(0) {};
+      os(os), spacesPerIndent(spacesPerIndent), currentLevel(0) {
+      setNodePathMode(NodePathMode::RAW);
+    };
     void apply(Group &group) override;
     void apply(Transform &transform) override;
     void apply(Geode &geode) override;
@@ -2,6 +2,7 @@
 #define _DRAW_COMMAND_H
 
 #include <vector>
+#include <cstdint>
 #include <GL/glew.h>
 #include "common.h"
 
@@ -14,6 +15,7 @@
 namespace PGUPV {
 
   struct TriangleIndices;
+  class InstancedDrawCommand;
 
   /**
   \class DrawCommand
@@ -53,7 +55,31 @@ namespace PGUPV {
 	\return el tipo de primitiva OpenGL que se dibujará (GL_TRIANGLES, GL_LINE_LOOP...)
 	*/
 	GLenum getGLPrimitiveType() const { return mode; }
+
+    /**
+    Crea una orden que dibuja las mismas primitivas varias veces con una sola llamada
+    (ver InstancedGeode). El número de instancias se establece en la orden devuelta.
+    \return la nueva orden (hay que liberarla), o nullptr si esta orden no se puede instanciar
+    */
+    virtual InstancedDrawCommand *makeInstanced() const { return nullptr; }
+
+    /**
+    \return el número de triángulos que envía la orden a OpenGL (contando todas las instancias),
+    o 0 si no dibuja triángulos. Con reinicio de primitivas, es una cota superior
+    */
+    virtual uint64_t getNumTriangles() const { return 0; }
   protected:
+    //! \return el número de triángulos que forman count vértices con el tipo de primitiva de la orden
+    uint64_t trianglesFor(GLsizei count) const;
+    template <typename C>
+    uint64_t multiDrawTriangles(const std::vector<C> &counts) const {
+      uint64_t n = 0;
+      for (auto c : counts)
+        n += trianglesFor(static_cast<GLsizei>(c));
+      return n;
+    }
+    //! Copia a la orden indicada la configuración de patches y de reinicio de primitivas
+    void copyStateTo(DrawCommand &other) const;
     GLenum mode;
     GLint verticesPerPatch;
     bool restartPrimitive;
@@ -86,7 +112,9 @@ namespace PGUPV {
     virtual void renderFunc() override {
       glDrawArrays(mode, first, count);
     }
+    uint64_t getNumTriangles() const override { return trianglesFor(count); }
     std::vector<TriangleIndices> getTrianglesIndices(void *indicesBuffer) override;
+    InstancedDrawCommand *makeInstanced() const override;
   private:
     GLint first; GLsizei count;
   };
@@ -112,7 +140,9 @@ namespace PGUPV {
     void renderFunc() override {
       glDrawElements(mode, count, type, offset);
     }
+    uint64_t getNumTriangles() const override { return trianglesFor(count); }
     std::vector<TriangleIndices> getTrianglesIndices(void *indicesBuffer) override;
+    InstancedDrawCommand *makeInstanced() const override;
   private:
     GLsizei count; GLenum type; const void *offset;
   };
@@ -141,6 +171,7 @@ namespace PGUPV {
     virtual void renderFunc() override {
       glDrawElementsBaseVertex(mode, count, type, offset, basevertex);
     }
+    uint64_t getNumTriangles() const override { return trianglesFor(count); }
   private:
     GLsizei count; GLenum type; GLvoid *offset; GLint basevertex;
   };
@@ -171,6 +202,7 @@ namespace PGUPV {
     virtual void renderFunc() override {
       glDrawRangeElements(mode, start, end, count, type, offset);
     }
+    uint64_t getNumTriangles() const override { return trianglesFor(count); }
   private:
     GLuint start; GLuint end; GLsizei count; GLenum type; const void *offset;
   };
@@ -201,6 +233,7 @@ namespace PGUPV {
     virtual void renderFunc() override {
       glDrawRangeElementsBaseVertex(mode, start, end, count, type, offset, basevertex);
     }
+    uint64_t getNumTriangles() const override { return trianglesFor(count); }
   private:
     GLuint start; GLuint end; GLsizei count; GLenum type; GLvoid  *offset;
     GLint basevertex;
@@ -228,6 +261,7 @@ namespace PGUPV {
     virtual void renderFunc() override {
       glMultiDrawArrays(mode, &first[0], &count[0], primcount);
     }
+    uint64_t getNumTriangles() const override { return multiDrawTriangles(count); }
   private:
     GLsizei primcount;
     std::vector<GLint> first;
@@ -259,6 +293,7 @@ namespace PGUPV {
     virtual void renderFunc() override {
       glMultiDrawElements(mode, &count[0], type, &indices[0], primcount);
     }
+    uint64_t getNumTriangles() const override { return multiDrawTriangles(count); }
   private:
 
     std::vector<GLint> count;
@@ -296,6 +331,7 @@ namespace PGUPV {
     virtual void renderFunc() override {
       glMultiDrawElementsBaseVertex(mode, &count[0], type, &indices[0], primcount, &baseVertex[0]);
     }
+    uint64_t getNumTriangles() const override { return multiDrawTriangles(count); }
   private:
 
     std::vector<GLint> count;
@@ -317,6 +353,7 @@ namespace PGUPV {
     virtual void renderFunc() override {
       glDrawArraysInstanced(mode, first, count, primcount);
     }
+    uint64_t getNumTriangles() const override { return trianglesFor(count) * primcount; }
   private:
     GLint first; GLsizei count, primcount;
   };
@@ -344,10 +381,72 @@ namespace PGUPV {
     virtual void renderFunc() override {
       glDrawElementsInstanced(mode, count, type, offset, primcount);
     }
+    uint64_t getNumTriangles() const override { return trianglesFor(count) * primcount; }
   private:
     GLsizei count; GLenum type; const void *offset; GLsizei primcount;
   };
 
+  /**
+  \class InstancedDrawCommand
+
+  Orden de dibujo instanciada cuyo número de instancias (y primera instancia) se puede cambiar
+  después de crearla, p.e., cuando se añaden instancias a un InstancedGeode
+  */
+  class InstancedDrawCommand : public DrawCommand {
+  public:
+    InstancedDrawCommand(GLenum mode, GLsizei instanceCount, GLuint baseInstance) :
+      DrawCommand(mode), instanceCount(instanceCount), baseInstance(baseInstance) {};
+    void setInstanceCount(GLsizei n) { instanceCount = n; }
+    GLsizei getInstanceCount() const { return instanceCount; }
+    /**
+    Establece la primera instancia a dibujar (se suma al índice de instancia al leer los
+    atributos con divisor distinto de cero)
+    */
+    void setBaseInstance(GLuint base) { baseInstance = base; }
+    GLuint getBaseInstance() const { return baseInstance; }
+  protected:
+    GLsizei instanceCount;
+    GLuint baseInstance;
+  };
+
+  /**
+  \class DrawArraysInstancedBaseInstance
+
+  Clase envoltorio de glDrawArraysInstancedBaseInstance
+  \warning Necesita OpenGL 4.2
+  */
+  class DrawArraysInstancedBaseInstance : public InstancedDrawCommand {
+  public:
+    DrawArraysInstancedBaseInstance(GLenum mode, GLint first, GLsizei count,
+      GLsizei instanceCount, GLuint baseInstance = 0) :
+      InstancedDrawCommand(mode, instanceCount, baseInstance), first(first), count(count) {};
+    void renderFunc() override {
+      glDrawArraysInstancedBaseInstance(mode, first, count, instanceCount, baseInstance);
+    }
+    uint64_t getNumTriangles() const override { return trianglesFor(count) * instanceCount; }
+  private:
+    GLint first; GLsizei count;
+  };
+
+  /**
+  \class DrawElementsInstancedBaseInstance
+
+  Clase envoltorio de glDrawElementsInstancedBaseInstance
+  \warning Necesita OpenGL 4.2
+  */
+  class DrawElementsInstancedBaseInstance : public InstancedDrawCommand {
+  public:
+    DrawElementsInstancedBaseInstance(GLenum mode, GLsizei count, GLenum type, const void *offset,
+      GLsizei instanceCount, GLuint baseInstance = 0) :
+      InstancedDrawCommand(mode, instanceCount, baseInstance), count(count), type(type), offset(offset) {};
+    void renderFunc() override {
+      glDrawElementsInstancedBaseInstance(mode, count, type, offset, instanceCount, baseInstance);
+    }
+    uint64_t getNumTriangles() const override { return trianglesFor(count) * instanceCount; }
+  private:
+    GLsizei count; GLenum type; const void *offset;
+  };
+
 
 };
 #endif
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <memory>
+#include <functional>
+
+namespace PGUPV {
+	/**
+	\class FileWatcher
+
+	Vigila ficheros del disco y avisa cuando cambian, para recargar los recursos que se han
+	cargado desde ellos (shaders, texturas, ficheros .pgmat...) sin reiniciar la aplicación.
+
+	En Linux usa inotify. Vigila el directorio de cada fichero, y no el fichero, para detectar
+	también los editores que guardan escribiendo un fichero nuevo y renombrándolo. En el resto
+	de sistemas, o si no se puede usar inotify, consulta periódicamente la fecha de modificación
+	de los ficheros (ver setPollInterval).
+
+	Los cambios se acumulan y se notifican en processEvents (la ventana la llama una vez por
+	frame) desde el hilo que la llama. Cada vigilancia recibe, como mucho, una llamada por frame
+	con la lista de sus ficheros que han cambiado:
+
+	auto id = FileWatcher::watch({"shader.vert", "comun.glsl"},
+	  [](const std::vector<std::string> &changed) { ... });
+	...
+	FileWatcher::unwatch(id);
+	*/
+	class FileWatcher {
+	public:
+		typedef uint64_t Id;
+		//! Función a la que se llama con los ficheros (con la ruta normalizada) que han cambiado
+		typedef std::function<void(const std::vector<std::string> &changed)> Callback;
+
+		/**
+		Empieza a vigilar los ficheros indicados
+		\param files ficheros a vigilar (no hace falta que existan todavía)
+		\param callback función a llamar cuando cambie alguno de ellos
+		\param owner (opcional) objeto dueño de la vigilancia. Cuando se destruya, la vigilancia
+		  se borra automáticamente
+		\return el identificador de la vigilancia, para borrarla con unwatch
+		*/
+		static Id watch(const std::vector<std::string> &files, Callback callback,
+			std::weak_ptr<const void> owner = std::weak_ptr<const void>());
+		//! Deja de vigilar los ficheros de la vigilancia indicada (no hace nada si id es 0)
+		static void unwatch(Id id);
+
+		/**
+		Recoge los cambios pendientes y llama a las funciones de las vigilancias afectadas
+		\return el número de funciones llamadas
+		*/
+		static size_t processEvents();
+
+		/**
+		Activa o desactiva la notificación de cambios (por defecto, activada). Mientras está
+		desactivada, los cambios se descartan
+		*/
+		static void setEnabled(bool enabled);
+		static bool isEnabled();
+		//! \return true si los cambios se detectan con inotify (false si se consultan las fechas)
+		static bool isUsingInotify();
+		//! Establece cada cuántos milisegundos se consultan las fechas de los ficheros (500 por defecto)
+		static void setPollInterval(unsigned int ms);
+		//! \return la ruta absoluta y normalizada del fichero, tal y como se pasa a las funciones
+		static std::string normalize(const std::string &path);
+	};
+};
@@ -11,11 +11,12 @@ namespace PGUPV {
     void addMesh(std::shared_ptr<Mesh> m);
     void accept(NodeVisitor &visitor) override;
     Model &getModel() { return *model; }
-    void setModel(std::shared_ptr<Model> m);
+    virtual void setModel(std::shared_ptr<Model> m);
     std::shared_ptr<Geode> shared_from_this();
   protected:
     Geode();
     Geode(std::shared_ptr<Model> m) : model(m) {};
+    friend class NodePool;
     std::shared_ptr<Model> model;
     void recomputeBoundingBox() override;
     void recomputeBoundingSphere() override;
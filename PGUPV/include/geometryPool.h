@@ -0,0 +1,185 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+#include <GL/glew.h>
+#include <glm/vec2.hpp>
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+#include <glm/mat4x4.hpp>
+
+#include "common.h"
+#include "mesh.h"
+
+namespace PGUPV {
+	class BufferObject;
+	class VertexArrayObject;
+	class BaseMaterial;
+	class Node;
+
+	/**
+	\class GeometryPool
+
+	Almacena la geometría de muchas mallas estáticas en unos pocos buffers grandes (páginas)
+	compartidos, con el mismo formato de vértice (posición, normal y coordenadas de textura),
+	y las dibuja con una orden glMultiDrawElementsIndirect por página.
+
+	Cada dibujo (addDraw) tiene su propia matriz del modelo y su material, que se guardan en dos
+	shader storage buffers. El vertex shader recibe el índice del dibujo en el atributo DRAW_ID
+	(con divisor 1 y baseInstance, por lo que no necesita gl_DrawID) y con él lee sus datos:
+
+	$DrawData
+	layout (location = 0) in vec4 position;
+	layout (location = 1) in vec3 normal;
+	layout (location = 4) in vec2 texCoord;
+	layout (location = 11) in uint drawId;
+	flat out uint material;
+	...
+	gl_Position = projMatrix * viewMatrix * draws[drawId].modelMatrix * position;
+	material = draws[drawId].material; // en el fragment shader: materials[material].diffuse
+
+	Para sustituir $DrawData en los shaders:
+
+	program.replaceString("$" + GeometryPool::blockName, GeometryPool::definition);
+
+	Las matrices de los dibujos están en el sistema de coordenadas del mundo: la matriz del
+	modelo de GLMatrices no se usa.
+	\warning Sólo se guardan los triángulos, y de los materiales sólo sus colores (no las texturas)
+	\warning Necesita OpenGL 4.3
+	*/
+	class GeometryPool {
+	public:
+		enum Attributes {
+			DRAW_ID = Mesh::_LAST_
+		};
+		//! Formato de los vértices del pool
+		struct Vertex {
+			glm::vec3 position;
+			glm::vec3 normal;
+			glm::vec2 texCoord;
+		};
+		//! Lugar que ocupa una malla en el pool
+		struct MeshRange {
+			unsigned int page;
+			GLint baseVertex;
+			GLuint firstIndex;
+			GLuint indexCount;
+		};
+
+		/**
+		Construye un pool vacío. Las páginas se crean a medida que se añaden mallas
+		\param verticesPerPage número de vértices de cada página
+		\param indicesPerPage número de índices de cada página
+		*/
+		static std::shared_ptr<GeometryPool> build(size_t verticesPerPage = 1 << 20,
+			size_t indicesPerPage = 3 << 20);
+		~GeometryPool();
+
+		/**
+		Copia al pool los vértices y los triángulos de la malla (leyéndolos de la GPU). Si la
+		malla ya estaba en el pool, no se vuelve a copiar
+		\return el identificador de la malla en el pool
+		*/
+		size_t addMesh(const Mesh &m);
+		/**
+		Copia al pool una malla
+		\param vertices los vértices de la malla
+		\param indices índices de los vértices de cada triángulo (tres por triángulo)
+		\return el identificador de la malla en el pool
+		*/
+		size_t addMesh(const std::vector<Vertex> &vertices, const std::vector<uint32_t> &indices);
+		const MeshRange &getMeshRange(size_t meshId) const { return meshes[meshId]; }
+		size_t getNumMeshes() const { return meshes.size(); }
+
+		/**
+		Añade los colores de un material a la tabla de materiales. El material 0 (el que usan
+		los dibujos por defecto) es el material por defecto de Material
+		\return el identificador del material en el pool
+		*/
+		size_t addMaterial(const BaseMaterial &m);
+
+		/**
+		Añade un dibujo de una malla del pool
+		\param meshId identificador de la malla (devuelto por addMesh)
+		\param modelMatrix matriz del modelo del dibujo
+		\param materialId identificador del material (devuelto por addMaterial)
+		\return el identificador del dibujo
+		*/
+		size_t addDraw(size_t meshId, const glm::mat4 &modelMatrix, size_t materialId = 0);
+		void setDrawTransform(size_t drawId, const glm::mat4 &modelMatrix);
+		void setDrawMaterial(size_t drawId, size_t materialId);
+		//! Elimina todos los dibujos (las mallas y los materiales se conservan)
+		void clearDraws();
+		size_t getNumDraws() const { return draws.size(); }
+
+		/**
+		Añade un dibujo por cada malla de los Geode del grafo de escena, con la matriz del
+		modelo que resulta de los Transform del camino y su material. Las mallas y los materiales
+		compartidos se añaden una sola vez.
+		\warning No se añaden los InstancedGeode, ni los AnimationNode, ni los hijos inactivos de
+		los LOD
+		*/
+		void addScene(Node &root);
+
+		//! \return el número de páginas (buffers de vértices e índices) del pool
+		size_t getNumPages() const { return pages.size(); }
+
+		/**
+		Dibuja todos los dibujos del pool, con una orden glMultiDrawElementsIndirect por página.
+		Hay que activar antes un programa que use $DrawData
+		*/
+		void render();
+
+		const static std::string blockName;
+		const static Strings definition;
+	private:
+		GeometryPool(size_t verticesPerPage, size_t indicesPerPage);
+		GeometryPool(const GeometryPool &) = delete;
+		GeometryPool &operator=(const GeometryPool &) = delete;
+
+		// Deben coincidir con la definición en GLSL (std430)
+		struct DrawData {
+			glm::mat4 modelMatrix;
+			uint32_t material;
+			uint32_t pad[3];
+		};
+		struct MaterialData {
+			glm::vec4 ambient, diffuse, specular, emissive;
+			float shininess;
+			float pad[3];
+		};
+		// Formato de glMultiDrawElementsIndirect
+		struct DrawElementsIndirectCommand {
+			GLuint count;
+			GLuint instanceCount;
+			GLuint firstIndex;
+			GLint baseVertex;
+			GLuint baseInstance;
+		};
+		struct Page {
+			std::unique_ptr<VertexArrayObject> vao;
+			std::shared_ptr<BufferObject> vertices, indices;
+			size_t nVertices, nIndices;
+			// Dibujos de la página en commandBuffer
+			size_t firstCommand, nCommands;
+		};
+
+		unsigned int findPage(size_t nVertices, size_t nIndices);
+		void bindDrawIds();
+		void uploadDraws();
+		void uploadMaterials();
+
+		size_t verticesPerPage, indicesPerPage;
+		std::vector<Page> pages;
+		std::vector<MeshRange> meshes;
+		std::unordered_map<const Mesh *, size_t> meshIds;
+		std::unordered_map<const BaseMaterial *, size_t> materialIds;
+		std::vector<size_t> drawMeshes;
+		std::vector<DrawData> draws;
+		std::vector<MaterialData> materials;
+		std::shared_ptr<BufferObject> drawBuffer, materialBuffer, commandBuffer, drawIdBuffer;
+		bool drawsDirty, materialsDirty;
+	};
+};
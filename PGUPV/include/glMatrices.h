@@ -5,6 +5,7 @@
 #include <GL/glew.h>
 #include "matrixStack.h"
 #include "uniformBufferObject.h"
+#include "streamingBuffer.h"
 
 /**
 \class GLMatrices
@@ -28,6 +29,13 @@ mat4 modelviewprojMatrix;
 mat3 normalMatrix;
 };
 
+Las operaciones sobre las matrices no escriben en el UBO: sólo lo marcan como modificado.
+El contenido se sube de una vez con flush, que la librería llama antes de cada orden de dibujo
+(DrawCommand::render) y al activar un programa (Program::use). Si dibujas directamente con
+glDraw*, llama antes a flush. Mientras dibuja la ventana, cada versión de las matrices se
+escribe en el StreamingBuffer del frame y se vincula con glBindBufferRange, de forma que
+las matrices de todos los objetos del frame se suben juntas.
+
 */
 
 namespace PGUPV {
@@ -62,17 +70,39 @@ namespace PGUPV {
     const glm::mat4 &getMatrix(Matrix mat) const;
     const glm::mat3 getNormalMatrix() const;
     void reset();
+    /**
+    Si las matrices han cambiado desde la última llamada, las sube a la GPU. Además, deja
+    este objeto vinculado en UBO_GL_MATRICES_BINDING_INDEX
+    */
+    void flush();
+    //! Llama a flush del objeto GLMatrices vinculado en UBO_GL_MATRICES_BINDING_INDEX (si hay)
+    static void flushBound();
   private:
     GLMatrices();
     GLMatrices(const GLMatrices&);
 
+    // Marca la matriz como modificada (se sube en flush)
     void writeMatrix(Matrix mat);
+    // Recalcula las matrices derivadas, si hace falta
+    void updateDerived() const;
+    // Copia el contenido del UBO en dst (size() bytes)
+    void copyTo(void *dst) const;
     MatrixStack mats[PROJ_MATRIX + 1];
-    struct {
+    mutable struct {
       glm::mat4 modelview;
       glm::mat4 modelviewprojection;
       glm::mat3x4 normal; // Debido a como se almacenan las matrices con la directiva std140
     } derivedMatrices;
+    // Matrices derivadas pendientes de recalcular
+    mutable bool modelviewDirty, projDirty;
+    // El contenido ha cambiado desde el último flush
+    bool dirty;
+    // Trozo del StreamingBuffer con la última copia (no válido si se escribió en el propio UBO)
+    std::weak_ptr<StreamingBuffer> stream;
+    StreamingBuffer::Allocation streamed;
+    unsigned long streamedFrame;
+    // IndexedBindingPoint::getBindStamp tras la última vinculación
+    uint64_t bindStamp;
 
     friend std::ostream& operator<<(std::ostream &os, const GLMatrices& m);
   };
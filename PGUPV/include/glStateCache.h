@@ -4,6 +4,7 @@
 #include <GL/glew.h>
 #include <vector>
 #include "log.h"
+#include "glStateTracker.h"
 
 
 namespace PGUPV {
@@ -237,7 +238,7 @@ namespace PGUPV {
 			glGetIntegerv(GL_ACTIVE_TEXTURE, &texUnit);
 		}
 		void restore() {
-			glActiveTexture(texUnit);
+			GLStateTracker::activeTexture(texUnit);
 		}
 	private:
 		GLint texUnit;
@@ -267,7 +268,7 @@ namespace PGUPV {
 			glGetIntegerv(constant, &texId);
 		}
 		void restore() {
-			glBindTexture(Target, texId);
+			GLStateTracker::bindTexture(Target, texId);
 		}
 	private:
 		GLint texId;
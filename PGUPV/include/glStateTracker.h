@@ -0,0 +1,60 @@
+#pragma once
+
+#include <GL/glew.h>
+
+namespace PGUPV {
+	/**
+	\class GLStateTracker
+
+	Copia en la CPU del estado de vinculación de OpenGL (programa instalado, VAO, unidad de
+	textura activa, textura de cada unidad, buffers vinculados a cada punto de vinculación, rangos
+	de los puntos de vinculación indexados y valores de los atributos genéricos). La librería
+	hace todas esas vinculaciones a través de esta clase, que sólo llama a OpenGL cuando el
+	estado cambia de verdad. Cada función devuelve true si ha llamado a OpenGL.
+
+	Las llamadas realizadas se cuentan en RenderStats (ProgramBinds, VAOBinds, TextureBinds y
+	BufferBinds), y las evitadas en RenderStats::Counter::BindsElided.
+
+	La eliminación de llamadas está desactivada por defecto (ver setEnabled): si se cambia el
+	estado llamando directamente a OpenGL (glBindVertexArray, glBindTexture...), la copia deja
+	de coincidir con el estado real, y una vinculación posterior de la librería se podría
+	evitar por error. La ventana invalida la copia antes y después de llamar a cada función
+	del Renderer (setup, reshape, update, preRender, render, postRender...). Si se activa y
+	se mezclan llamadas directas a OpenGL con llamadas a la librería dentro de una misma
+	función, hay que llamar a invalidate después de las llamadas directas.
+	*/
+	class GLStateTracker {
+	public:
+		static bool useProgram(GLuint program);
+		static bool bindVertexArray(GLuint vao);
+		//! \param unit la unidad de textura (GL_TEXTURE0 + i)
+		static bool activeTexture(GLenum unit);
+		//! Vincula la textura en la unidad activa
+		static bool bindTexture(GLenum target, GLuint texture);
+		//! Vincula la textura en la unidad indicada (GL_TEXTURE0 + i), que pasa a ser la activa
+		static bool bindTextureToUnit(GLenum unit, GLenum target, GLuint texture);
+		static bool bindBuffer(GLenum target, GLuint buffer);
+		static bool bindBufferBase(GLenum target, GLuint index, GLuint buffer);
+		static bool bindBufferRange(GLenum target, GLuint index, GLuint buffer, GLintptr offset,
+			GLsizeiptr size);
+		//! Establece el valor de un atributo genérico (glVertexAttrib4fv)
+		static bool vertexAttrib4fv(GLuint index, const GLfloat *v);
+
+		/**
+		Olvidan el objeto indicado. Se llaman al borrarlo, porque OpenGL lo desvincula y puede
+		reutilizar su nombre para un objeto nuevo
+		*/
+		static void forgetTexture(GLuint texture);
+		static void forgetBuffer(GLuint buffer);
+		static void forgetVertexArray(GLuint vao);
+
+		//! Olvida todo el estado (la siguiente vinculación de cualquier tipo llamará a OpenGL)
+		static void invalidate();
+		/**
+		Activa o desactiva la eliminación de llamadas redundantes (desactivada por defecto). Si
+		está desactivada, todas las vinculaciones llaman a OpenGL
+		*/
+		static void setEnabled(bool enabled);
+		static bool isEnabled();
+	};
+};
@@ -13,7 +13,7 @@ namespace PGUPV {
     size_t getNumChildren() { return children.size(); };
     void removeChild(std::shared_ptr<Node> n);
     void removeChild(Node *n);
-    void removeChild(size_t i);
+    virtual void removeChild(size_t i);
 	void removeChildren();
 	bool containsChild(std::shared_ptr<Node> n);
     std::shared_ptr<Node> getChild(size_t i) const { return children[i]; }
@@ -22,7 +22,10 @@ namespace PGUPV {
     std::shared_ptr<Group> shared_from_this();
   protected:
     Group() {};
+    friend class NodePool;
     std::vector<std::shared_ptr<Node>> children;
+    //! Dibuja los hijos del grupo, sin comprobar la visibilidad del propio grupo
+    void renderChildren();
     void recomputeBoundingBox() override;
     void recomputeBoundingSphere() override;
   };
@@ -9,7 +9,7 @@
 namespace PGUPV {
   class IndexedBindingPoint : public BindingPoint {
   public:
-    explicit IndexedBindingPoint(GLenum GL_BP) : BindingPoint(GL_BP) {};
+    explicit IndexedBindingPoint(GLenum GL_BP) : BindingPoint(GL_BP), lastStamp(0) {};
     /** Vincula el B.O. al índice del punto de vinculación indicado. Internamente
     usa la función glBindBufferBase
     \param bo: buffer object a vincular
@@ -26,12 +26,15 @@ namespace PGUPV {
     \param index: índice del punto de vinculación
     \param offset: posición del primer byte a vincular dentro del B.O.
     \param size: tamaño de la región a vincular
+    \param boundAs: si no está vacío, getBound(index) devolverá este objeto en lugar de bo
+    (p.e., GLMatrices sube su contenido a un StreamingBuffer, pero sigue siendo el UBO
+    vinculado para el resto de la librería)
     \returns un puntero compartido (que puede estar vacío) al B.O. que estaba
     previamente vinculado a este punto
     */
     std::shared_ptr<BufferObject>
       bindBufferRange(std::shared_ptr<BufferObject> bo, GLuint index,
-      GLintptr offset, GLsizeiptr size);
+      GLintptr offset, GLsizeiptr size, std::shared_ptr<BufferObject> boundAs = nullptr);
 
     /**
     Devuelve una referencia al BufferObject vinculado en el índice indicado. Puede ser
@@ -40,8 +43,16 @@ namespace PGUPV {
     \return el buffer object, o un puntero vacío
     */
     std::shared_ptr<BufferObject> getBound(GLuint idx);
+    /**
+    Devuelve un número que cambia cada vez que se vincula algo en el índice indicado. Sirve
+    para saber si otro código ha cambiado el buffer vinculado desde la última vez
+    \param idx el índice a consultar
+    */
+    uint64_t getBindStamp(GLuint idx);
   private:
     std::map<GLuint, std::weak_ptr<BufferObject>> boundBOs;
+    std::map<GLuint, uint64_t> bindStamps;
+    uint64_t lastStamp;
 
   };
 
@@ -0,0 +1,128 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <unordered_map>
+#include <glm/mat4x4.hpp>
+
+#include "geode.h"
+#include "mesh.h"
+
+namespace PGUPV {
+  class BufferObject;
+  class DrawCommand;
+  class InstancedDrawCommand;
+
+  /**
+  \class InstancedGeode
+
+  Nodo que dibuja muchas copias de un mismo modelo con una sola orden de dibujo por malla
+  (glDrawArraysInstancedBaseInstance o glDrawElementsInstancedBaseInstance). Cada instancia tiene
+  su propia matriz del modelo (relativa al sistema de coordenadas del nodo), un color y un
+  identificador.
+
+  La matriz y el color de cada instancia llegan al shader como atributos de vértice con divisor 1,
+  en las posiciones INSTANCE_MATRIX (ocupa cuatro posiciones consecutivas) e INSTANCE_COLOR. Esas
+  cinco posiciones (de Mesh::_LAST_ a Mesh::_LAST_ + 4) quedan reservadas en las mallas del nodo;
+  si se usan para atributos propios, se pueden mover con setInstanceAttribLocation:
+
+  layout (location = 11) in mat4 instanceMatrix;
+  layout (location = 15) in vec4 instanceColor;
+  ...
+  gl_Position = modelviewprojMatrix * instanceMatrix * position;
+
+  Los volúmenes de inclusión del nodo abarcan todas las instancias. En las mallas con las
+  posiciones comprimidas (Mesh::addQuantizedVertices), instanceMatrix ya incluye la matriz de
+  descompresión de la malla.
+
+  La matriz de las normales de GLMatrices no incluye la matriz de la instancia: el shader tiene
+  que aplicarla también a las normales. Si las instancias no tienen escalados no uniformes,
+  basta con su parte 3x3 (si no, habría que usar su inversa traspuesta):
+
+  vec3 n = normalMatrix * mat3(instanceMatrix) * normal;
+  \warning Sólo se instancian las órdenes de dibujo DrawArrays y DrawElements de las mallas
+  \warning Necesita OpenGL 4.3 (glVertexAttribFormat y glBindVertexBuffer)
+  */
+  class InstancedGeode : public Geode {
+  public:
+    enum InstanceAttributes {
+      INSTANCE_MATRIX = Mesh::_LAST_,
+      INSTANCE_COLOR = INSTANCE_MATRIX + 4
+    };
+    static std::shared_ptr<InstancedGeode> build(std::shared_ptr<Model> m = nullptr);
+    ~InstancedGeode();
+
+    /**
+    Añade una instancia del modelo
+    \param xform matriz del modelo de la instancia
+    \param color color de la instancia
+    \return el índice de la nueva instancia
+    */
+    size_t addInstance(const glm::mat4 &xform, const glm::vec4 &color = glm::vec4(1.0f));
+    void setInstanceTransform(size_t i, const glm::mat4 &xform);
+    const glm::mat4 &getInstanceTransform(size_t i) const { return instances[i].transform; }
+    void setInstanceColor(size_t i, const glm::vec4 &color);
+    const glm::vec4 &getInstanceColor(size_t i) const { return instances[i].color; }
+    /**
+    Establece el identificador de la instancia, que es el que devuelven Picker y RayPicker al
+    seleccionarla. Con 0 (el valor inicial) se usa el identificador del nodo
+    */
+    void setInstanceId(size_t i, uint32_t id) { ids[i] = id; }
+    uint32_t getInstanceId(size_t i) const { return ids[i]; }
+    //! \return el identificador con el que se selecciona la instancia (el del nodo si no tiene)
+    uint32_t getInstancePickId(size_t i) const { return ids[i] ? ids[i] : getId(); }
+    //! Elimina la instancia indicada (las siguientes cambian de índice)
+    void removeInstance(size_t i);
+    void clearInstances();
+    size_t getNumInstances() const { return instances.size(); }
+    /**
+    Cambia la posición de los atributos de las instancias: la matriz ocupará las posiciones
+    first a first + 3, y el color la first + 4 (por defecto, first es INSTANCE_MATRIX)
+    */
+    void setInstanceAttribLocation(GLuint first);
+    GLuint getInstanceMatrixLocation() const { return firstAttrib; }
+    GLuint getInstanceColorLocation() const { return firstAttrib + 4; }
+
+    void render() override;
+    void setModel(std::shared_ptr<Model> m) override;
+    std::shared_ptr<InstancedGeode> shared_from_this();
+  protected:
+    explicit InstancedGeode(std::shared_ptr<Model> m);
+    void recomputeBoundingBox() override;
+    void recomputeBoundingSphere() override;
+    // Debe coincidir con la configuración de los atributos en bindInstanceAttributes
+    struct InstanceData {
+      glm::mat4 transform;
+      glm::vec4 color;
+    };
+    std::vector<InstanceData> instances;
+    std::vector<uint32_t> ids;
+    std::shared_ptr<BufferObject> instanceBuffer;
+    bool instancesDirty;
+    GLuint firstAttrib;
+
+    // Versiones instanciadas de las órdenes de dibujo de cada malla. Se guarda también un
+    // weak_ptr a la malla para saber si sigue existiendo (su dirección se puede reutilizar)
+    struct MeshCommands {
+      std::weak_ptr<Mesh> mesh;
+      std::vector<DrawCommand *> source;
+      std::vector<InstancedDrawCommand *> commands;
+      // Instancias con la matriz de descompresión de la malla (si tiene las posiciones comprimidas)
+      std::shared_ptr<BufferObject> decodedInstances;
+      glm::mat4 decodedWith;
+      bool decodedDirty = true;
+    };
+    std::unordered_map<Mesh *, MeshCommands> meshCommands;
+    MeshCommands &getInstancedCommands(const std::shared_ptr<Mesh> &m);
+    void clearInstancedCommands();
+    void dropDeadMeshes();
+
+    void instancesChanged();
+    void uploadInstances();
+    void uploadDecodedInstances(Mesh &m, MeshCommands &mc);
+    void writeInstances(std::shared_ptr<BufferObject> &buffer, const std::vector<InstanceData> &data,
+      const std::string &label);
+    void bindInstanceAttributes(const BufferObject &buffer);
+    void unbindInstanceAttributes();
+  };
+};
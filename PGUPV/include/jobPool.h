@@ -0,0 +1,98 @@
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <exception>
+#include <memory>
+
+namespace PGUPV {
+
+	/**
+	\class JobPool
+	Conjunto de hilos que ejecutan trabajos pequeños (funciones sin parámetros). Cada hilo tiene
+	su propia cola: los trabajos que lanza un hilo del conjunto se encolan en su cola, y cuando
+	un hilo se queda sin trabajo, roba trabajos del principio de la cola de otro hilo
+	(work stealing). Así, un trabajo puede lanzar subtrabajos sin pasar por una cola común.
+
+	Los trabajos se agrupan con un JobPool::Counter, que permite esperar a que terminen:
+
+	JobPool pool;
+	JobPool::Counter c;
+	pool.submit([]() { ... }, c);
+	pool.submit([]() { ... }, c);
+	pool.wait(c);
+
+	El hilo que espera ejecuta trabajos pendientes mientras tanto, así que se puede esperar desde
+	dentro de un trabajo sin bloquear el conjunto.
+	*/
+	class JobPool {
+	public:
+		/**
+		Cuenta los trabajos pendientes de un grupo. Si un trabajo lanza una excepción, se guarda
+		la primera y se relanza en JobPool::wait
+		*/
+		class Counter {
+		public:
+			Counter() : pending(0) {}
+			bool isDone() const { return pending.load(std::memory_order_acquire) == 0; }
+		private:
+			std::atomic<int> pending;
+			std::mutex errorMutex;
+			std::exception_ptr error;
+			friend class JobPool;
+		};
+
+		/**
+		Crea el conjunto de hilos.
+		\param numThreads número de hilos. Si es 0, se crea uno por cada núcleo de la máquina,
+		menos uno (el del hilo que lanza los trabajos, que también los ejecuta mientras espera)
+		*/
+		explicit JobPool(unsigned int numThreads = 0);
+		~JobPool();
+		JobPool(const JobPool &) = delete;
+		JobPool &operator=(const JobPool &) = delete;
+
+		/**
+		Lanza un trabajo.
+		\param job el trabajo
+		\param counter el contador del grupo al que pertenece el trabajo. Debe existir hasta que
+		termine la llamada a wait
+		*/
+		void submit(std::function<void()> job, Counter &counter);
+		/**
+		Espera a que terminen todos los trabajos del grupo, ejecutando trabajos pendientes
+		mientras tanto. Si no quedan trabajos por ejecutar, duerme hasta que termine el grupo o
+		se lance otro trabajo.
+		*/
+		void wait(Counter &counter);
+		//! \return el número de hilos del conjunto (sin contar los que esperan en wait)
+		unsigned int getNumThreads() const { return static_cast<unsigned int>(workers.size()); }
+	private:
+		struct Job {
+			std::function<void()> func;
+			Counter *counter;
+		};
+		struct WorkQueue {
+			std::mutex m;
+			std::deque<Job> jobs;
+		};
+
+		void workerLoop(unsigned int index);
+		bool tryGetJob(int index, Job &job);
+		void run(Job &job);
+
+		std::vector<std::thread> workers;
+		std::vector<std::unique_ptr<WorkQueue>> queues;
+		std::atomic<unsigned int> pendingJobs, nextQueue;
+		std::mutex sleepMutex;
+		std::condition_variable wakeUp;
+		// Se notifica al terminar un grupo o lanzar un trabajo (lo esperan los hilos en wait)
+		std::condition_variable waitChanged;
+		bool stopping;
+	};
+};
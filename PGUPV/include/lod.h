@@ -0,0 +1,94 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <glm/mat4x4.hpp>
+
+#include "group.h"
+#include "boundingVolumes.h"
+
+namespace PGUPV {
+  /**
+  \class LOD
+
+  Grupo con varias versiones (niveles de detalle) de un mismo objeto, de la más detallada a la
+  más simple. Sólo se dibuja uno de sus hijos, elegido según el tamaño que ocupa en pantalla la
+  esfera de inclusión del grupo (su diámetro proyectado, como fracción de la altura de la
+  ventana).
+
+  Cada nivel tiene un tamaño mínimo: se usa el primer nivel cuyo tamaño mínimo no supera el
+  tamaño en pantalla del objeto. Si el último nivel tiene un tamaño mínimo mayor que cero, el
+  objeto desaparece cuando es más pequeño. Para evitar que el nivel cambie continuamente cuando
+  el objeto está cerca de un umbral, sólo se cambia de nivel cuando el tamaño supera el umbral
+  en un margen (histéresis).
+
+  auto lod = LOD::build();
+  lod->addLevel(detailed, 0.3f);
+  lod->addLevel(simplified, 0.1f);
+  lod->addLevel(billboard, 0.0f);
+
+  Los visitantes que recorren los hijos activos (NodeVisitor::TraversalMode::TRAVERSE_ACTIVE_CHILDREN)
+  sólo visitan el último nivel elegido (o el primero, si todavía no se ha dibujado).
+  */
+  class LOD : public Group {
+  public:
+    static std::shared_ptr<LOD> build();
+    /**
+    Añade un nivel de detalle, menos detallado que los anteriores
+    \param n el nodo con la versión del objeto
+    \param minScreenSize tamaño mínimo en pantalla (fracción de la altura de la ventana) para
+      usar este nivel. Debe ser menor que el de los niveles anteriores
+    */
+    void addLevel(std::shared_ptr<Node> n, float minScreenSize);
+    //! Añade un nivel con tamaño mínimo 0 (se usa siempre que no se pueda usar uno anterior)
+    void addChild(std::shared_ptr<Node> n) override;
+    void removeChild(size_t i) override;
+    using Group::removeChild;
+    void setMinScreenSize(size_t level, float minScreenSize);
+    float getMinScreenSize(size_t level) const { return minScreenSizes[level]; }
+    /**
+    Establece el margen relativo para cambiar de nivel: se pasa a un nivel más simple cuando el
+    tamaño es menor que umbral * (1 - h), y a uno más detallado cuando es mayor que
+    umbral * (1 + h). Por defecto, 0.1
+    */
+    void setHysteresis(float h) { hysteresis = h; }
+    float getHysteresis() const { return hysteresis; }
+
+    /**
+    Elige el nivel de detalle que corresponde al tamaño en pantalla indicado, teniendo en
+    cuenta el nivel elegido la última vez
+    \return el índice del nivel, o getNumChildren() si el objeto es demasiado pequeño para
+      dibujarse
+    */
+    size_t selectLevel(float screenSize);
+    /**
+    Elige el nivel de detalle para la posición del grupo indicada
+    \param modelMatrix matriz que lleva el grupo al sistema de coordenadas del mundo
+    \param viewProj producto de las matrices de proyección y de la vista
+    */
+    size_t selectLevel(const glm::mat4 &modelMatrix, const glm::mat4 &viewProj);
+    //! \return el último nivel elegido (0 si todavía no se ha elegido ninguno)
+    size_t getActiveLevel() const { return activeLevel; }
+    //! \return el nodo del nivel activo, o nullptr si el objeto es demasiado pequeño para dibujarse
+    Node *getActiveChild() const;
+
+    /**
+    \return el diámetro proyectado de la esfera, como fracción de la altura de la ventana
+    \param worldBS la esfera, en el sistema de coordenadas del mundo
+    \param viewProj producto de las matrices de proyección y de la vista
+    */
+    static float computeScreenSize(const BoundingSphere &worldBS, const glm::mat4 &viewProj);
+
+    void render() override;
+    void traverse(NodeVisitor &visitor) override;
+    void accept(NodeVisitor &visitor) override;
+    std::shared_ptr<LOD> shared_from_this();
+  protected:
+    LOD();
+    friend class NodePool;
+    std::vector<float> minScreenSizes;
+    float hysteresis;
+    size_t activeLevel;
+    bool levelSelected;
+  };
+};
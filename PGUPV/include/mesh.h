@@ -4,7 +4,9 @@
 
 #include <memory>
 #include <vector>
+#include <cstdint>
 #include <GL/glew.h>
+#include <glm/mat4x4.hpp>
 
 #include "common.h"
 #include "boundingVolumes.h"
@@ -51,9 +53,12 @@ namespace PGUPV {
 	class UniformBufferObject;
 	class BindableTexture;
 	class DrawCommand;
+	struct TriangleIndices;
 	class BufferObject;
 	class UBOBones;
 	class Skeleton;
+	class JobPool;
+	class MeshletDrawElements;
 
 	class Mesh {
 	public:
@@ -74,6 +79,20 @@ namespace PGUPV {
 		};
 
 #define NUM_TEX_COORD 4
+
+		/**
+		Posición y formato de un atributo dentro de un buffer de vértices entrelazado (ver
+		setInterleavedVertices)
+		*/
+		struct InterleavedAttribute {
+			uint attribIndex; // índice del atributo (VERTICES, NORMALS, TEX_COORD0...)
+			GLint ncomponents; // número de componentes (1 a 4)
+			GLenum type; // tipo de cada componente (GL_FLOAT, GL_UNSIGNED_BYTE...)
+			GLuint offset; // posición del atributo desde el principio de cada vértice, en bytes
+			GLboolean normalized; // si los enteros se convierten al rango [0, 1] ([-1, 1] con signo)
+			bool integer; // si el atributo se lee como entero en el shader (glVertexAttribIFormat)
+		};
+
 		// Constructor de una malla
 		Mesh();
 		~Mesh();
@@ -217,15 +236,84 @@ namespace PGUPV {
 		// Define las binormales de cada vértice de la malla. Cada binormal está
 		// definida por 3 floats. Recibe un vector de n binormales.
 		void addTangents(const float *t, size_t n, GLenum usage = GL_STATIC_DRAW);
+		// Define las tangentes de cada vértice con el sentido de la bitangente en la w (ver
+		// computeTangents)
+		void addTangents(const glm::vec4 *t, size_t n, GLenum usage = GL_STATIC_DRAW);
+		void addTangents(const std::vector<glm::vec4> &t, GLenum usage = GL_STATIC_DRAW) {
+			addTangents(t.data(), t.size(), usage);
+		}
 		// Define la binormal que usarán *todos* los vértices
 		void setTangent(const glm::vec3 &t);
 
+		/**
+		Define las posiciones de los vértices comprimidas: cada componente se guarda como un
+		entero de 16 bits normalizado, relativo a la caja de inclusión de la malla (con la misma
+		escala en los tres ejes). Al dibujar la malla se multiplica la matriz del modelo por
+		getPositionDecodeMatrix, así que los shaders no tienen que cambiar. Ocupa 8 bytes por
+		vértice, en lugar de 12.
+		\param v las posiciones
+		\param n el número de vértices
+		\param usage el tipo de uso que se le dará al buffer object
+		\warning No se puede usar con mallas con huesos, porque sus matrices se aplicarían a las
+		posiciones sin descomprimir. La matriz normal que calcula GLMatrices
+		incluye la escala de la descompresión, así que los shaders deben normalizar la normal
+		*/
+		void addQuantizedVertices(const glm::vec3 *v, size_t n, GLenum usage = GL_STATIC_DRAW);
+		void addQuantizedVertices(const std::vector<glm::vec3> &v, GLenum usage = GL_STATIC_DRAW) {
+			addQuantizedVertices(v.data(), v.size(), usage);
+		}
+		//! \return true si las posiciones se definieron con addQuantizedVertices
+		bool hasQuantizedVertices() const { return quantizedVertices; }
+		//! \return la matriz que transforma las posiciones comprimidas a las originales
+		const glm::mat4 &getPositionDecodeMatrix() const { return positionDecode; }
+		/**
+		Si las posiciones están comprimidas, multiplica la matriz del modelo (del GLMatrices
+		activo) por getPositionDecodeMatrix. Hay que deshacerlo con popPositionDecode. render y
+		renderDrawCommands ya lo hacen.
+		*/
+		void pushPositionDecode();
+		void popPositionDecode();
+
+		/**
+		Define las normales comprimidas en 32 bits por vértice (GL_INT_2_10_10_10_REV
+		normalizado, con 10 bits por componente). El shader las recibe como vec3 o vec4 (w = 0)
+		\param nr las normales (unitarias)
+		\param n el número de normales
+		\param usage el tipo de uso que se le dará al buffer object
+		*/
+		void addPackedNormals(const glm::vec3 *nr, size_t n, GLenum usage = GL_STATIC_DRAW);
+		void addPackedNormals(const std::vector<glm::vec3> &nr, GLenum usage = GL_STATIC_DRAW) {
+			addPackedNormals(nr.data(), nr.size(), usage);
+		}
+		//! Como addPackedNormals, para las tangentes
+		void addPackedTangents(const glm::vec3 *t, size_t n, GLenum usage = GL_STATIC_DRAW);
+		void addPackedTangents(const std::vector<glm::vec3> &t, GLenum usage = GL_STATIC_DRAW) {
+			addPackedTangents(t.data(), t.size(), usage);
+		}
+		/**
+		Define las coordenadas de textura como floats de 16 bits (GL_HALF_FLOAT). Tienen 11 bits
+		de precisión, suficiente para coordenadas en [0, 1] y texturas de hasta 2048 texels
+		\param tex_unit unidad de textura a la que hacen referencia las coordenadas
+		\param t las coordenadas de textura
+		\param n el número de coordenadas de textura
+		\param usage el tipo de uso que se le dará al buffer object
+		*/
+		void addHalfTexCoord(uint tex_unit, const glm::vec2 *t, size_t n, GLenum usage = GL_STATIC_DRAW);
+		void addHalfTexCoord(uint tex_unit, const std::vector<glm::vec2> &t, GLenum usage = GL_STATIC_DRAW) {
+			addHalfTexCoord(tex_unit, t.data(), t.size(), usage);
+		}
+		//! Empaqueta un vector con componentes en [-1, 1] en formato GL_INT_2_10_10_10_REV normalizado
+		static uint32_t packSnorm1010102(const glm::vec3 &v, float w = 0.0f);
+		//! Convierte un float a float de 16 bits (formato GL_HALF_FLOAT)
+		static uint16_t packHalfFloat(float f);
+
 		void setSkeleton(std::shared_ptr<Skeleton> skel);
 		std::shared_ptr<Skeleton> getSkeleton() const;
 		/**
 		Inserta un atributo a los vértices.
 		\param attribute_index índice del atributo (usar uno mayor o
-		igual a _LAST_)
+		igual a _LAST_. Si la malla se dibuja en un InstancedGeode, las posiciones _LAST_ a
+		_LAST_ + 4 están reservadas para sus instancias)
 		\param type constante de OpenGL que define el tipo de los
 		componentes del atributo (p.e., GL_FLOAT, GL_UNSIGNED_SHORT...)
 		\param type_size tamaño de cada componente, en bytes (p.e.,
@@ -238,6 +326,37 @@ namespace PGUPV {
 		void addAttribute(uint attribute_index, GLenum type, uint type_size,
 			const void *a, uint ncomponents, size_t n,
 			GLenum usage = GL_STATIC_DRAW);
+
+		/**
+		Define varios atributos de los vértices con un único buffer, en el que los atributos de
+		cada vértice están consecutivos (p.e., posición, normal y coordenadas de textura del
+		primer vértice, luego las del segundo, etc). Al dibujar se lee un solo buffer, y los
+		atributos de un vértice están en las mismas líneas de caché. Sustituye a los buffers
+		que tuvieran los atributos indicados. Después se pueden seguir añadiendo otros atributos
+		en buffers independientes (p.e., con addBoneIds).
+
+		Los métodos get (getVertices, getNormals, getTexCoords...) siguen funcionando, siempre
+		que los atributos correspondientes sean de tipo GL_FLOAT. getBufferObject devuelve el
+		buffer entrelazado para cualquiera de sus atributos.
+		\param data los datos de los vértices (nVertices * stride bytes)
+		\param nVertices número de vértices
+		\param stride número de bytes de cada vértice
+		\param attribs la descripción de cada atributo. Debe incluir la posición (VERTICES) en
+		  formato GL_FLOAT
+		\param usage uso que se le va a dar al buffer (GL_STATIC_DRAW, GL_DYNAMIC_COPY...)
+		\warning Necesita OpenGL 4.3 (glVertexAttribFormat y glBindVertexBuffer)
+		*/
+		void setInterleavedVertices(const void *data, size_t nVertices, GLsizei stride,
+			const std::vector<InterleavedAttribute> &attribs, GLenum usage = GL_STATIC_DRAW);
+		//! \return true si el atributo indicado está en el buffer entrelazado
+		bool isInterleaved(uint attribIndex) const;
+		/**
+		\return el punto de vinculación (glBindVertexBuffer) del buffer entrelazado. Si es
+		posible, es uno mayor que cualquier índice de atributo, porque glVertexAttribPointer(i, ...)
+		vincula el atributo i al punto i. Si no, es el último, y no se puede usar un atributo
+		con ese índice en un buffer independiente de una malla entrelazada
+		*/
+		static GLuint getInterleavedBinding();
 		/**
 		Inserta un atributo de tipo entero (sin normalizar ni convertir a float) a los vértices.
 		\param attribute_index índice del atributo (usar uno mayor o igual a _LAST_)
@@ -303,6 +422,18 @@ namespace PGUPV {
 		*/
 		void render(const std::vector<DrawCommand *> &drawCommands);
 		/**
+		Prepara el estado de OpenGL necesario para dibujar la malla (VAO, valores estáticos de
+		los atributos y huesos), pero no instala el material ni dibuja. Junto con 
+		renderDrawCommands, permite dibujar varias veces seguidas la misma malla sin repetir
+		los cambios de estado (ver RenderQueue)
+		*/
+		void bindGeometry();
+		/**
+		Lanza las órdenes de dibujo de la malla
+		\warning Asume que se ha llamado antes a bindGeometry
+		*/
+		void renderDrawCommands();
+		/**
 		\return el número de vértices de la malla (cuidado! NO el número de
 		 índices)
 		*/
@@ -334,12 +465,36 @@ namespace PGUPV {
 		void clearDrawCommands();
 
 		/**
-		Calcula las normales por vértice para simular una superficie suave. Sustituye
-		las normales que hubieran definidas.
+		Calcula las normales por vértice para simular una superficie suave (ver
+		MeshProcessing::computeSmoothNormals). Sustituye las normales que hubieran definidas.
+		\param creaseAngle ángulo máximo (en grados) entre triángulos que se suavizan a través
+		  de vértices duplicados (180 para suavizarlos todos)
+		\param pool hilos con los que repartir el cálculo (opcional)
 		\warning Llama a esta función una vez que la malla esté completamente
 		configurada, es decir, con sus vértices, normales y draw commands.
 		*/
-		void computeSmoothNormals();
+		void computeSmoothNormals(float creaseAngle = 180.0f, JobPool *pool = nullptr);
+		/**
+		Calcula las tangentes de los vértices a partir de sus normales y de las coordenadas de
+		textura indicadas (ver MeshProcessing::computeTangents). Sustituye las tangentes que
+		hubieran definidas. El atributo TANGENTS tendrá cuatro componentes: la w es el sentido
+		de la bitangente (bitangente = w * cross(normal, tangente))
+		\param texCoordSet conjunto de coordenadas de textura
+		\param pool hilos con los que repartir el cálculo (opcional)
+		*/
+		void computeTangents(unsigned int texCoordSet = 0, JobPool *pool = nullptr);
+		/**
+		Divide los triángulos de la malla en meshlets (ver MeshletBuilder) y sustituye sus
+		órdenes de dibujo por una MeshletDrawElements, que en cada frame sólo dibuja los
+		meshlets que están dentro del volumen de la vista y de cara a la cámara. Pensado para
+		mallas grandes de las que sólo se ve una parte (terrenos, fotogrametría...)
+		\param maxVertices número máximo de vértices de cada meshlet
+		\param maxTriangles número máximo de triángulos de cada meshlet
+		\return la nueva orden de dibujo (la malla se encarga de liberarla)
+		\warning Todas las órdenes de dibujo de la malla tienen que ser DrawArrays o
+		  DrawElements de triángulos. Sustituye los índices de la malla
+		*/
+		MeshletDrawElements *buildMeshlets(unsigned int maxVertices = 64, unsigned int maxTriangles = 124);
 		/**
 		Da acceso a los buffer objects que contienen la información de la malla
 		\param which El buffer object deseado (VERTICES, NORMALS, etc)
@@ -369,31 +524,62 @@ namespace PGUPV {
 		/**
 		Devuelve la posición de los vértices de la malla
 		\warning No abusar de estas funciones, puesto que tienen que traer la información
-		desde la GPU
+		desde la GPU (salvo que la malla guarde una copia, ver setCPUMirror)
 		*/
 		std::vector<glm::vec3> getVertices() const;
 
 		/**
 		Devuelve las normales de los vértices de la malla
 		\warning No abusar de estas funciones, puesto que tienen que traer la información
-		desde la GPU
+		desde la GPU (salvo que la malla guarde una copia, ver setCPUMirror)
 		*/
 		std::vector<glm::vec3> getNormals() const;
 		
 		/**
 		Devuelve las coordenadas de textura de los vértices de la malla
 		\warning No abusar de estas funciones, puesto que tienen que traer la información
-		desde la GPU
+		desde la GPU (salvo que la malla guarde una copia, ver setCPUMirror)
 		*/
 		std::vector<glm::vec2> getTexCoords(unsigned int texUnit = 0) const;
 
 		/**
 		Devuelve los índices de la malla
 		\warning No abusar de estas funciones, puesto que tienen que traer la información
-		desde la GPU
+		desde la GPU (salvo que la malla guarde una copia, ver setCPUMirror)
 		*/
 		std::vector<unsigned int> getIndices() const;
 
+		/**
+		Devuelve los triángulos que dibujan las órdenes de dibujo de la malla, en el orden de las
+		órdenes. Las órdenes que no dibujan triángulos, y los triángulos que contienen el índice
+		de restart, se ignoran.
+		\warning No abusar de estas funciones, puesto que tienen que traer la información
+		desde la GPU (salvo que la malla guarde una copia, ver setCPUMirror)
+		*/
+		std::vector<TriangleIndices> getTriangles() const;
+
+		/**
+		Guarda (o descarta) una copia en memoria principal de los datos que se suban a los
+		buffers de la malla (posiciones, índices y el resto de atributos). Los métodos get
+		(getVertices, getTriangles...) leen de la copia en lugar de mapear los buffers, así que
+		se pueden llamar desde otros hilos, sin el contexto de OpenGL. Las copias no se
+		modifican nunca, y se comparten entre las mallas que comparten buffers (setAttribute con
+		el buffer de otra malla). Si se activa con la malla ya definida, se leen una vez los
+		buffers que ya tenga.
+		La memoria de las copias se apunta en ResourceTracker (CPUMirrors), pero la librería no
+		las libera aunque se supere el presupuesto de la CPU.
+		\warning Si se escribe directamente en un buffer de la malla (ver getBufferObject), la
+		copia deja de coincidir con él: hay que desactivarla antes
+		*/
+		void setCPUMirror(bool keep);
+		bool hasCPUMirror() const { return cpuMirror; }
+		//! Establece si las mallas que se creen a partir de ahora guardan la copia (por defecto, no)
+		static void setDefaultCPUMirror(bool keep);
+		//! \return los bytes que ocupan las copias en memoria principal de los buffers de la malla
+		size_t getCPUMirrorSize() const;
+		//! \return los bytes que ocupan las copias en memoria principal de todas las mallas
+		static size_t getTotalCPUMirrorSize();
+
 		const std::vector<DrawCommand *> &getDrawCommands() const { return drawCommands; }
 
 		std::shared_ptr<UBOBones> getBones() const;
@@ -417,8 +603,31 @@ namespace PGUPV {
 			glm::vec4 value;
 		};
 
+		// Dónde está cada atributo en su buffer. Si stride es 0, el buffer sólo contiene ese
+		// atributo (con sus componentes consecutivas). type es el tipo de las componentes en el
+		// buffer (los get* los convierten a float)
+		struct AttributeLayout {
+			AttributeLayout() : offset(0), stride(0), interleaved(false), type(GL_FLOAT) {}
+			GLuint offset;
+			GLsizei stride;
+			bool interleaved;
+			GLenum type;
+		};
+		std::vector<AttributeLayout> layouts;
+
+		// Copia en memoria principal del contenido de cada buffer de vbos (ver setCPUMirror)
+		typedef std::vector<unsigned char> CPUBuffer;
+		std::vector<std::shared_ptr<const CPUBuffer>> mirrors;
+		bool cpuMirror;
+		static bool defaultCPUMirror;
+		void mirrorBuffer(uint attribIndex, const void *data, size_t size);
+		std::shared_ptr<const CPUBuffer> getMirror(uint attribIndex) const;
+		void addPackedVec3(uint attribIndex, const glm::vec3 *v, size_t n, GLenum usage);
+
+		bool quantizedVertices;
+		glm::mat4 positionDecode;
+
 		float epsilonSquared; // para determinar si dos vértices son iguales
-		bool sameVertex(float *vs, uint ncomponents, uint a, uint b);
 		std::vector<StaticAttribute> staticAttrValues;
 		std::shared_ptr<BaseMaterial> material;
 		std::shared_ptr<UBOBones> bones;
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <glm/vec3.hpp>
+
+namespace PGUPV {
+
+	/**
+	\class MeshOptimizer
+	Reordenación de los triángulos y de los vértices de una malla indexada para que la GPU
+	trabaje menos al dibujarla, sin cambiar su aspecto:
+
+	- optimizeVertexCache: ordena los triángulos para aprovechar la caché de vértices ya
+	  transformados (algoritmo de Tom Forsyth, Linear-Speed Vertex Cache Optimisation, 2006),
+	  de forma que el shader de vértices se ejecute menos veces por triángulo.
+	- optimizeOverdraw: agrupa los triángulos ya ordenados en bloques que no empeoran mucho el
+	  uso de la caché, y dibuja primero los bloques que miran hacia fuera de la malla (Sander
+	  et al., Fast Triangle Reordering for Vertex Locality and Reduced Overdraw, 2007), para
+	  que se descarten más fragmentos con el test de profundidad.
+	- optimizeVertexFetch: numera los vértices en el orden en el que se usan, para que la
+	  lectura de los atributos recorra los buffers de forma secuencial.
+
+	Se deben aplicar en ese orden:
+
+	auto before = MeshOptimizer::analyzeVertexCache(indices, n);
+	indices = MeshOptimizer::optimizeVertexCache(indices, n);
+	indices = MeshOptimizer::optimizeOverdraw(indices, positions);
+	auto remap = MeshOptimizer::optimizeVertexFetch(indices, n);
+	MeshOptimizer::remapVertices(positions.data(), n, remap); // y el resto de atributos
+	auto after = MeshOptimizer::analyzeVertexCache(indices, n);
+	*/
+	class MeshOptimizer {
+	public:
+		//! Resultado de la simulación de una caché de vértices FIFO
+		struct CacheStats {
+			size_t vertexTransforms; // veces que se ejecuta el shader de vértices
+			size_t triangles;
+			size_t usedVertices; // vértices distintos usados por los triángulos
+			float acmr; // vertexTransforms por triángulo (entre 0.5 y 3, menos es mejor)
+			float atvr; // vertexTransforms por vértice usado (1 es el óptimo)
+		};
+
+		/**
+		Simula el procesamiento de los triángulos con una caché de vértices FIFO
+		\param indices índices de los vértices de cada triángulo (tres por triángulo)
+		\param nVertices número de vértices
+		\param cacheSize número de vértices que caben en la caché
+		*/
+		static CacheStats analyzeVertexCache(const std::vector<uint32_t> &indices, size_t nVertices,
+			unsigned int cacheSize = 16);
+
+		/**
+		\return los mismos triángulos, ordenados para aprovechar la caché de vértices
+		\param indices índices de los vértices de cada triángulo (tres por triángulo)
+		\param nVertices número de vértices
+		*/
+		static std::vector<uint32_t> optimizeVertexCache(const std::vector<uint32_t> &indices,
+			size_t nVertices);
+
+		/**
+		Reordena los bloques de triángulos para reducir el número de fragmentos que se
+		sobrescriben. Los índices de entrada deberían venir de optimizeVertexCache.
+		\param indices índices de los vértices de cada triángulo (tres por triángulo)
+		\param positions posición de cada vértice
+		\param threshold cuánto puede empeorar el ACMR (1.05 es un 5%) a cambio de tener más
+		  bloques que reordenar
+		\return los triángulos reordenados. Si el ACMR resultante empeora más de lo indicado,
+		  se devuelven en el orden de entrada
+		*/
+		static std::vector<uint32_t> optimizeOverdraw(const std::vector<uint32_t> &indices,
+			const std::vector<glm::vec3> &positions, float threshold = 1.05f);
+
+		/**
+		Renumera los vértices en el orden en el que los usan los triángulos y actualiza los
+		índices. Los vértices que no usa ningún triángulo quedan al final, en su orden original.
+		\param indices índices de los vértices de cada triángulo. Se modifican
+		\param nVertices número de vértices
+		\return la nueva posición de cada vértice (hay que aplicarla a todos sus atributos
+		  con remapVertices)
+		*/
+		static std::vector<uint32_t> optimizeVertexFetch(std::vector<uint32_t> &indices,
+			size_t nVertices);
+
+		/**
+		Mueve cada elemento de un vector de atributos a la posición que indica remap
+		\param data los atributos de cada vértice
+		\param nVertices número de vértices
+		\param remap la nueva posición de cada vértice (ver optimizeVertexFetch)
+		*/
+		template <typename T>
+		static void remapVertices(T *data, size_t nVertices, const std::vector<uint32_t> &remap) {
+			std::vector<T> original(data, data + nVertices);
+			for (size_t i = 0; i < nVertices; i++)
+				data[remap[i]] = original[i];
+		}
+	};
+};
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <glm/vec2.hpp>
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+
+#include "drawCommand.h"
+
+namespace PGUPV {
+	class JobPool;
+
+	/**
+	\class MeshProcessing
+	Cálculos sobre la geometría de una malla guardada en memoria principal (sin leer nada de la
+	GPU): soldadura de vértices por posición, normales suaves y tangentes.
+
+	Los métodos que reciben un JobPool reparten el trabajo entre sus hilos. Si es nullptr, se
+	ejecutan en el hilo que los llama.
+	*/
+	class MeshProcessing {
+	public:
+		/**
+		Agrupa los vértices que están a menos de epsilon de distancia, usando una rejilla
+		dispersa (tiempo lineal en el número de vértices)
+		\param positions posición de cada vértice
+		\param epsilon distancia máxima entre dos vértices para considerarlos el mismo. Si es
+		0 (o negativo), sólo se agrupan los vértices con exactamente la misma posición
+		\return para cada vértice, el índice del primer vértice de su grupo
+		*/
+		static std::vector<uint32_t> weldVertices(const std::vector<glm::vec3> &positions,
+			float epsilon = 1e-3f);
+
+		/**
+		Calcula las normales suaves de los vértices, como la media de las normales de los
+		triángulos que los usan, ponderada por el ángulo del triángulo en el vértice. Se suman
+		también los triángulos de los vértices con la misma posición (ver weldVertices), salvo
+		que formen un ángulo mayor que creaseAngle con todos los triángulos del vértice (así se
+		conservan las aristas vivas de los vértices duplicados)
+		\param positions posición de cada vértice
+		\param triangles índices de los vértices de cada triángulo
+		\param creaseAngle ángulo máximo (en grados) entre triángulos que se suavizan
+		\param weldEpsilon distancia máxima entre dos vértices con la misma posición
+		\param pool hilos con los que repartir el cálculo (opcional)
+		\return la normal unitaria de cada vértice ((0, 0, 0) si ningún triángulo lo usa)
+		*/
+		static std::vector<glm::vec3> computeSmoothNormals(const std::vector<glm::vec3> &positions,
+			const std::vector<TriangleIndices> &triangles, float creaseAngle = 180.0f,
+			float weldEpsilon = 1e-3f, JobPool *pool = nullptr);
+
+		/**
+		Calcula las tangentes de los vértices a partir de las coordenadas de textura: la
+		tangente de cada triángulo se proyecta en el plano perpendicular a la normal del
+		vértice, se normaliza y se pondera por el ángulo del triángulo en el vértice. La
+		componente w indica el sentido de la bitangente:
+		bitangente = w * cross(normal, tangente)
+		\param positions posición de cada vértice
+		\param normals normal unitaria de cada vértice
+		\param texCoords coordenadas de textura de cada vértice
+		\param triangles índices de los vértices de cada triángulo
+		\param pool hilos con los que repartir el cálculo (opcional)
+		\return la tangente unitaria (xyz) y el sentido de la bitangente (w, 1 o -1) de cada
+		vértice
+		\warning No es el algoritmo de MikkTSpace, así que los mapas de normales horneados con él
+		pueden mostrar diferencias en las costuras. En particular, no se duplican los vértices
+		cuyos triángulos tienen distinto sentido de la bitangente (p.e., en el eje de simetría
+		de una textura reflejada): sólo se usan los de la orientación con más peso
+		*/
+		static std::vector<glm::vec4> computeTangents(const std::vector<glm::vec3> &positions,
+			const std::vector<glm::vec3> &normals, const std::vector<glm::vec2> &texCoords,
+			const std::vector<TriangleIndices> &triangles, JobPool *pool = nullptr);
+	};
+};
@@ -0,0 +1,123 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <limits>
+#include <string>
+#include <glm/vec2.hpp>
+#include <glm/vec3.hpp>
+
+#include "drawCommand.h"
+
+namespace PGUPV {
+	class Mesh;
+	class BaseMaterial;
+
+	/**
+	\class MeshSimplifier
+	Simplificación de mallas de triángulos por contracción de aristas, usando la métrica del
+	error cuadrático de Garland y Heckbert (Surface Simplification Using Quadric Error Metrics,
+	1997). Cada contracción lleva un vértice a la posición de su vecino, así que los vértices
+	que quedan conservan sus atributos originales (normal y coordenadas de textura) sin
+	interpolar.
+
+	Los vértices con la misma posición y distintos atributos (las costuras de las coordenadas
+	de textura o de las normales) se tratan como un único vértice, y sólo se contraen a lo
+	largo de la costura, para que no se abran grietas. Las aristas del borde de la malla se
+	penalizan para conservar su silueta.
+
+	La simplificación es progresiva: se puede llamar varias veces a simplify con objetivos
+	cada vez menores, y construir una malla con el resultado de cada paso (ver buildChain).
+	*/
+	class MeshSimplifier {
+	public:
+		/**
+		Prepara la simplificación de una malla (sólo de sus órdenes de dibujo de triángulos)
+		\warning Tiene que leer la geometría desde la GPU (ver Mesh::getVertices). Sólo se
+		conservan las posiciones, las normales y las primeras coordenadas de textura
+		*/
+		explicit MeshSimplifier(const Mesh &mesh);
+		/**
+		Prepara la simplificación de la malla indicada
+		\param positions posición de cada vértice
+		\param triangles índices de los vértices de cada triángulo
+		\param normals normal de cada vértice (opcional)
+		\param texCoords coordenadas de textura de cada vértice (opcional)
+		*/
+		MeshSimplifier(std::vector<glm::vec3> positions, std::vector<TriangleIndices> triangles,
+			std::vector<glm::vec3> normals = std::vector<glm::vec3>(),
+			std::vector<glm::vec2> texCoords = std::vector<glm::vec2>());
+
+		/**
+		Contrae aristas hasta que la malla tenga como mucho targetTriangles triángulos, o hasta
+		que la siguiente contracción supere el error máximo
+		\param targetTriangles número de triángulos deseado
+		\param maxError distancia máxima (en el sistema de coordenadas de la malla) entre la
+		  superficie simplificada y la original
+		\return el número de triángulos que quedan
+		*/
+		size_t simplify(size_t targetTriangles, float maxError = std::numeric_limits<float>::max());
+		size_t getNumTriangles() const { return liveTriangles; }
+		//! \return el error (distancia) estimado de la malla simplificada
+		float getError() const;
+		//! \return los triángulos actuales, con índices de los vértices originales
+		std::vector<TriangleIndices> getTriangles() const;
+		/**
+		Crea una malla con el estado actual de la simplificación. Sólo contiene los vértices
+		que se siguen usando, y tiene el mismo material que la malla original (si se construyó
+		a partir de una Mesh)
+		*/
+		std::shared_ptr<Mesh> buildMesh() const;
+		/**
+		Genera una cadena de niveles de detalle. Cada nivel tiene ratio veces los triángulos
+		del anterior (empezando por la malla original, que no se incluye)
+		\param levels número de mallas simplificadas a generar
+		\param ratio proporción de triángulos entre un nivel y el anterior
+		\param maxError error máximo de cualquier nivel. Si se alcanza, la cadena es más corta
+		\return las mallas, de más a menos detallada
+		*/
+		std::vector<std::shared_ptr<Mesh>> buildChain(unsigned int levels, float ratio = 0.5f,
+			float maxError = std::numeric_limits<float>::max());
+	private:
+		// Forma cuadrática simétrica (matriz 4x4 guardada como su triángulo superior)
+		struct Quadric {
+			double a[10];
+			double weight; // suma de los pesos de los planos acumulados
+			Quadric();
+			Quadric(const glm::dvec3 &n, double d, double weight);
+			Quadric &operator+=(const Quadric &o);
+			double evaluate(const glm::vec3 &p) const;
+			// Media ponderada de las distancias al cuadrado de p a los planos
+			double error(const glm::vec3 &p) const;
+		};
+		struct Collapse {
+			double cost;
+			uint32_t from, to; // vértices soldados
+			uint32_t fromVersion, toVersion;
+			bool operator<(const Collapse &o) const { return cost > o.cost; }
+		};
+
+		void init();
+		void pushCollapses(uint32_t v);
+		bool tryCollapse(const Collapse &c);
+		void gatherTriangles(uint32_t welded, std::vector<uint32_t> &tris) const;
+
+		std::vector<glm::vec3> positions, normals;
+		std::vector<glm::vec2> texCoords;
+		std::vector<TriangleIndices> triangles;
+		std::vector<bool> triangleAlive;
+		size_t liveTriangles;
+		// Vértice soldado (por posición) de cada vértice original, y vértices de cada soldado
+		std::vector<uint32_t> welded;
+		std::vector<std::vector<uint32_t>> weldedVertices;
+		std::vector<uint32_t> version;
+		std::vector<Quadric> quadrics;
+		// Triángulos que usan cada vértice original (puede contener triángulos eliminados)
+		std::vector<std::vector<uint32_t>> vertexTriangles;
+		std::vector<Collapse> heap;
+		double maxCost;
+		std::shared_ptr<BaseMaterial> material;
+		std::string name;
+		unsigned int generatedLevels;
+	};
+};
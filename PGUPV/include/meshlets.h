@@ -0,0 +1,99 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <GL/glew.h>
+#include <glm/vec3.hpp>
+#include <glm/mat4x4.hpp>
+
+#include "drawCommand.h"
+
+namespace PGUPV {
+
+	/**
+	Grupo de triángulos consecutivos de una malla (meshlet), con los volúmenes que permiten
+	descartarlo entero al dibujar: una esfera que lo contiene y un cono con todas sus normales
+	*/
+	struct Meshlet {
+		uint32_t firstIndex; // posición del primer índice en el vector de índices
+		uint32_t triangleCount;
+		uint32_t vertexCount; // vértices distintos que usan sus triángulos
+		glm::vec3 center; // esfera de inclusión
+		float radius;
+		// Cono de normales: si la cámara está en la posición p y
+		// dot(normalize(coneApex - p), coneAxis) >= coneCutoff, todos los triángulos le dan la
+		// espalda. coneCutoff vale 1 si el cono es demasiado abierto para descartar el meshlet
+		glm::vec3 coneApex;
+		glm::vec3 coneAxis;
+		float coneCutoff;
+	};
+
+	/**
+	\class MeshletBuilder
+	Divide una malla de triángulos en meshlets de como mucho maxVertices vértices y
+	maxTriangles triángulos. Cada meshlet crece desde un triángulo añadiendo los triángulos
+	vecinos que menos vértices nuevos aportan y cuya normal se parece más a la del meshlet, para
+	que los conos de normales sean estrechos.
+	*/
+	class MeshletBuilder {
+	public:
+		/**
+		\param indices índices de los vértices de cada triángulo (tres por triángulo). Se
+		  reordenan para que los triángulos de cada meshlet estén seguidos
+		\param positions posición de cada vértice
+		\param maxVertices número máximo de vértices de cada meshlet
+		\param maxTriangles número máximo de triángulos de cada meshlet
+		\return los meshlets, en el orden en el que quedan en indices
+		*/
+		static std::vector<Meshlet> build(std::vector<uint32_t> &indices, const std::vector<glm::vec3> &positions,
+			unsigned int maxVertices = 64, unsigned int maxTriangles = 124);
+	};
+
+	/**
+	\class MeshletDrawElements
+
+	Dibuja una lista de triángulos dividida en meshlets (ver Mesh::buildMeshlets). En cada frame
+	descarta en la CPU los meshlets que quedan fuera del volumen de la vista y los que dan la
+	espalda a la cámara, y dibuja el resto con un solo glMultiDrawElements (los meshlets visibles
+	consecutivos se dibujan como un único rango). Las matrices se toman del GLMatrices activo.
+
+	Para el resto de la librería (getTrianglesIndices, instanciado...) se comporta como un
+	DrawElements de todos los triángulos.
+	\warning El descarte por el cono de normales supone que las caras delanteras son las que se
+	  ven en sentido antihorario (glFrontFace(GL_CCW)) y que las traseras no se dibujan. Desactívalo
+	  con setConeCulling(false) para materiales de dos caras
+	*/
+	class MeshletDrawElements : public DrawElements {
+	public:
+		/**
+		\param meshlets los meshlets (devueltos por MeshletBuilder::build)
+		\param type tipo de los índices (GL_UNSIGNED_SHORT o GL_UNSIGNED_INT)
+		\param offset posición (en bytes desde el comienzo del buffer de índices) del primer índice
+		\param objectFromModel matriz que lleva las coordenadas que recibe el shader (las del
+		  sistema del modelo del GLMatrices) a las de los meshlets (p.e., la inversa de
+		  Mesh::getPositionDecodeMatrix)
+		*/
+		MeshletDrawElements(const std::vector<Meshlet> &meshlets, GLenum type, const void *offset,
+			const glm::mat4 &objectFromModel = glm::mat4(1.0f));
+		void renderFunc() override;
+		//! \return el número de triángulos dibujados la última vez
+		uint64_t getNumTriangles() const override { return visibleTriangles; }
+
+		void setFrustumCulling(bool enable) { frustumCulling = enable; }
+		void setConeCulling(bool enable) { coneCulling = enable; }
+		const std::vector<Meshlet> &getMeshlets() const { return meshlets; }
+		//! \return el número de meshlets dibujados la última vez
+		size_t getNumVisibleMeshlets() const { return visibleMeshlets; }
+	private:
+		std::vector<Meshlet> meshlets;
+		GLenum type;
+		const char *base;
+		glm::mat4 objectFromModel;
+		bool frustumCulling, coneCulling;
+		// Rangos a dibujar en el frame actual
+		std::vector<GLsizei> counts;
+		std::vector<const void *> offsets;
+		uint64_t visibleTriangles;
+		size_t visibleMeshlets;
+	};
+};
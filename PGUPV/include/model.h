@@ -35,6 +35,8 @@ namespace PGUPV {
 	void clearMeshes();
     // Devuelve una referencia a la malla i-ésima
     Mesh &getMesh(size_t i);
+    // Devuelve la malla i-ésima, compartida (p.e., para guardar datos asociados a ella)
+    std::shared_ptr<Mesh> getMeshPtr(size_t i);
     /**
     Función de conveniencia para procesar todas las mallas del modelo
     \param op se invocará a la función op en cada una de las mallas del modelo
@@ -21,8 +21,11 @@ namespace PGUPV {
 	class Node;
 	class Group;
 	class NodeCallback;
+	class Transform;
 
 	typedef std::vector<std::shared_ptr<Node>> NodePath;
+	//! Camino sin propiedad sobre los nodos (ver NodeVisitor::NodePathMode::RAW)
+	typedef std::vector<Node *> RawNodePath;
 
 	class Node : public std::enable_shared_from_this<Node> {
 	public:
@@ -65,6 +68,32 @@ namespace PGUPV {
 		*/
 		void invalidateBoundingVolumes();
 
+		/**
+		\return la matriz que lleva el sistema de coordenadas en el que está definido el nodo
+		(el de su padre) al del mundo, es decir, la matriz del modelo con la que se dibujaría
+		el nodo. Usa las matrices guardadas por los nodos Transform antecesores, así que sólo
+		se recalcula lo que haya cambiado.
+		El dibujado (y su descarte de nodos), la RenderQueue y el RayPicker no la usan: recorren
+		el grafo acumulando la matriz de cada camino, porque un nodo con varios padres tiene una
+		matriz por camino. Tampoco AnimationNode, que sustituye las transformaciones de los
+		huesos por las de la animación.
+		\warning Si algún nodo del camino tiene varios padres, se sigue siempre el primero
+		*/
+		glm::mat4 getWorldMatrix();
+		/**
+		\return la caja de inclusión del nodo en coordenadas del mundo (ver getWorldMatrix)
+		*/
+		virtual BoundingBox getWorldBB();
+		/**
+		\return la esfera de inclusión del nodo en coordenadas del mundo (ver getWorldMatrix)
+		*/
+		virtual BoundingSphere getWorldBS();
+		/**
+		\return un contador que cambia cada vez que se invalidan los volúmenes de inclusión
+		del nodo
+		*/
+		uint64_t getBoundsGeneration() const { return boundsGeneration; }
+
 		void addUpdateCallback(std::shared_ptr<NodeCallback> nc);
 		void removeUpdateCallback(std::shared_ptr<NodeCallback> nc);
 		void clearUpdateCallbacks();
@@ -74,11 +103,36 @@ namespace PGUPV {
 
 		uint32_t getId() const { return nodeId; }
 
+		/**
+		Activa/desactiva el descarte durante el dibujado de los nodos cuyo volumen de inclusión
+		cae fuera del volumen de la vista (view-frustum culling). Por defecto está desactivado:
+		las mallas con esqueleto bajo un AnimationNode tienen el volumen de la pose de reposo, y
+		las partes que se salen de él al animarse desaparecerían.
+		\param enable true para descartar los nodos que no se ven
+		*/
+		static void setViewFrustumCulling(bool enable) { viewFrustumCulling = enable; }
+		//! \return true si está activado el descarte de nodos fuera de la vista
+		static bool isViewFrustumCullingEnabled() { return viewFrustumCulling; }
+
 	protected:
 		void addParent(Group* parent);
 		void removeParent(Group* parent);
 		virtual void recomputeBoundingBox() = 0;
 		virtual void recomputeBoundingSphere() = 0;
+		/**
+		Comprueba los volúmenes de inclusión del nodo con el volumen de la vista definido por las
+		matrices actuales de GLMatrices (por lo que hay que llamarla antes de aplicar la
+		transformación propia del nodo). Si el nodo queda fuera, lo cuenta en RenderStats.
+		\return true si el nodo está completamente fuera de la vista y no hay que dibujarlo
+		*/
+		bool isOutsideViewVolume();
+		/**
+		\return el primer nodo Transform en el camino hacia la raíz (siguiendo el primer padre).
+		Se guarda, y se vuelve a buscar cuando cambia el primer padre del nodo o de algún antecesor
+		*/
+		Transform *findParentTransform();
+		//! Olvida el Transform antecesor guardado en este nodo y en sus descendientes
+		void invalidateParentTransform();
 		std::vector<Group*> parents;
 		std::string name;
 		BoundingBox bb;
@@ -87,9 +141,18 @@ namespace PGUPV {
 		bool visible;
 		std::vector<std::shared_ptr<NodeCallback>> updateCallbacks;
 		uint32_t nodeId;
+		uint64_t boundsGeneration{ 0 };
+		// true si se han consultado los volúmenes desde la última invalidación
+		bool boundsQueried{ false };
+		// Primer Transform antecesor guardado (ver findParentTransform)
+		Transform *parentTransform{ nullptr };
+		bool parentTransformValid{ false };
 		friend class Group;
+		friend class InvalidateBoundingBoxes;
+		friend class InvalidateParentTransforms;
 		friend class AnimationNode;
 		static uint32_t nextNodeId;
+		static bool viewFrustumCulling;
 	};
 };
 
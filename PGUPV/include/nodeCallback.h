@@ -10,6 +10,15 @@ namespace PGUPV {
 			traverse(node, nv);
 		}
 
+		/**
+		\return true si el callback se puede ejecutar en otro hilo a la vez que los callbacks de
+		otros nodos (ver ParallelUpdateVisitor). Para ello no debe llamar a OpenGL, ni modificar
+		la estructura del grafo, ni modificar nodos o datos compartidos con otras partes de la
+		escena (p.e., cambiar un Transform invalida los volúmenes de inclusión de sus antecesores).
+		Por defecto, false.
+		*/
+		virtual bool isThreadSafe() const { return false; }
+
 		/** Call any nested callbacks and then traverse the scene graph. */
 		void traverse(Node& node, NodeVisitor& nv) {
 			nv.traverse(node);
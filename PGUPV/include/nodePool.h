@@ -0,0 +1,122 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <mutex>
+#include <new>
+#include <cstddef>
+
+namespace PGUPV {
+
+	/**
+	\class NodePool
+	Reserva de memoria para crear muchos nodos del grafo de escena (p.e., al cargar un fichero
+	grande) sin pedir memoria al sistema por cada uno. La memoria se pide en bloques grandes y se
+	reparte en trozos de unos pocos tamaños; cuando se destruye un nodo, su trozo se reutiliza para
+	el siguiente nodo del mismo tamaño. El objeto y el bloque de control del shared_ptr van juntos
+	en la reserva.
+
+	Los métodos build de Group, Transform y Geode usan la reserva activa en el hilo actual, si la hay:
+
+	auto pool = PGUPV::NodePool::build();
+	{
+		PGUPV::NodePool::Scope scope(pool);
+		auto g = Group::build(); // se crea en pool
+	}
+
+	La memoria de la reserva sólo se devuelve al sistema cuando se destruyen la reserva y todos
+	los nodos creados en ella (cada nodo mantiene viva su reserva).
+	*/
+	class NodePool : public std::enable_shared_from_this<NodePool> {
+	public:
+		/**
+		\param chunkSize tamaño en bytes de cada bloque que se pide al sistema
+		*/
+		static std::shared_ptr<NodePool> build(size_t chunkSize = 64 * 1024);
+		~NodePool();
+		NodePool(const NodePool &) = delete;
+		NodePool &operator=(const NodePool &) = delete;
+
+		void *allocate(size_t bytes);
+		void deallocate(void *p, size_t bytes);
+		//! \return el número de bytes pedidos al sistema
+		size_t getReservedBytes() const;
+		//! \return el número de bytes entregados y todavía no devueltos
+		size_t getUsedBytes() const;
+
+		/**
+		Crea un objeto en la reserva. T debe ser amigo de NodePool si su constructor no es público
+		*/
+		template <typename T, typename... Args>
+		std::shared_ptr<T> make(Args&&... args) {
+			static_assert(alignof(T) <= ALIGNMENT, "NodePool no puede alinear este tipo");
+			void *mem = allocate(sizeof(T));
+			T *obj;
+			try {
+				obj = new (mem) T(std::forward<Args>(args)...);
+			}
+			catch (...) {
+				deallocate(mem, sizeof(T));
+				throw;
+			}
+			auto self = shared_from_this();
+			return std::shared_ptr<T>(obj, Deleter<T>{ self }, Allocator<T>(self));
+		}
+
+		/**
+		Mientras exista, los métodos build de los nodos crean los nodos en la reserva indicada
+		(en el hilo actual). Se pueden anidar.
+		*/
+		class Scope {
+		public:
+			explicit Scope(std::shared_ptr<NodePool> pool);
+			~Scope();
+		private:
+			std::shared_ptr<NodePool> previous;
+		};
+		//! \return la reserva activa en el hilo actual, o nullptr si no hay ninguna
+		static NodePool *current();
+
+		static const size_t ALIGNMENT = alignof(std::max_align_t);
+
+		// Asignador para el bloque de control de los shared_ptr
+		template <typename T>
+		struct Allocator {
+			typedef T value_type;
+			explicit Allocator(std::shared_ptr<NodePool> pool) : pool(std::move(pool)) {}
+			template <typename U>
+			Allocator(const Allocator<U> &other) : pool(other.pool) {}
+			T *allocate(size_t n) { return static_cast<T *>(pool->allocate(n * sizeof(T))); }
+			void deallocate(T *p, size_t n) { pool->deallocate(p, n * sizeof(T)); }
+			template <typename U>
+			bool operator==(const Allocator<U> &other) const { return pool == other.pool; }
+			template <typename U>
+			bool operator!=(const Allocator<U> &other) const { return pool != other.pool; }
+			std::shared_ptr<NodePool> pool;
+		};
+	private:
+		explicit NodePool(size_t chunkSize);
+
+		template <typename T>
+		struct Deleter {
+			std::shared_ptr<NodePool> pool;
+			void operator()(T *p) const {
+				p->~T();
+				pool->deallocate(p, sizeof(T));
+			}
+		};
+
+		// Tamaños de los trozos: múltiplos de ALIGNMENT hasta MAX_SMALL_SIZE. Los más grandes
+		// se piden directamente al sistema
+		static const size_t MAX_SMALL_SIZE = 1024;
+		static size_t sizeClass(size_t bytes) { return (bytes + ALIGNMENT - 1) / ALIGNMENT; }
+
+		struct FreeBlock { FreeBlock *next; };
+		mutable std::mutex mutex;
+		size_t chunkSize;
+		std::vector<char *> chunks;
+		char *chunkPos, *chunkEnd;
+		std::vector<FreeBlock *> freeLists;
+		size_t reservedBytes, usedBytes;
+	};
+};
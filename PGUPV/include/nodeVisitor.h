@@ -5,6 +5,7 @@
 #include "transform.h"
 #include "geode.h"
 #include "animationNode.h"
+#include "lod.h"
 
 namespace PGUPV {
 	class NodeVisitor {
@@ -12,8 +13,17 @@ namespace PGUPV {
 		enum class TraversalMode {
 			TRAVERSE_NONE, TRAVERSE_PARENTS, TRAVERSE_ALL_CHILDREN, TRAVERSE_ACTIVE_CHILDREN
 		};
+		/**
+		Cmo se guarda el camino hasta el nodo actual:
+		SHARED: con punteros compartidos (getNodePath). Cada nodo visitado supone incrementar y
+		decrementar atmicamente su contador de referencias
+		RAW: con punteros normales (getRawNodePath), sin tocar los contadores. Los nodos siguen
+		vivos mientras se recorren, pero si se guarda el camino, hay que asegurarse de que los
+		nodos siguen existiendo cuando se use
+		*/
+		enum class NodePathMode { SHARED, RAW };
 		NodeVisitor(TraversalMode mode = TraversalMode::TRAVERSE_ACTIVE_CHILDREN) :
-			traversalMode(mode) {};
+			traversalMode(mode), nodePathMode(NodePathMode::SHARED) {};
 		virtual void apply(Node &node) {
 			traverse(node);
 		};
@@ -29,17 +39,24 @@ namespace PGUPV {
 		virtual void apply(Geode &geode) {
 			apply(static_cast<Node &>(geode));
 		}
+		virtual void apply(LOD &lod) {
+			apply(static_cast<Group &>(lod));
+		}
 		inline void setTraversalMode(TraversalMode mode) { traversalMode = mode; }
 		/** Get the traversal mode.*/
 		inline TraversalMode getTraversalMode() const { return traversalMode; }
+		inline void setNodePathMode(NodePathMode mode) { nodePathMode = mode; }
+		inline NodePathMode getNodePathMode() const { return nodePathMode; }
 
 
 		//// Este cdigo viene directamente de OSG::NodeVisitor
 		/** Method for handling traversal of a nodes.
 		If you intend to use the visitor for actively traversing
 		the scene graph then make sure the accept() methods call
-		this method unless they handle traversal directly.*/
-		inline void traverse(Node &node)
+		this method unless they handle traversal directly.
+		Es virtual para que un visitante pueda cambiar cmo se recorren los hijos (p.e.,
+		ParallelUpdateVisitor los recorre en paralelo).*/
+		virtual void traverse(Node &node)
 		{
 			if (traversalMode == TraversalMode::TRAVERSE_PARENTS) {
 				node.ascend(*this);
@@ -58,7 +75,13 @@ namespace PGUPV {
 		* Note, the user does not typically call pushNodeOnPath() as it
 		* will be called automatically by the Node::accept() method.*/
 		inline void pushOntoNodePath(Node &node) {
-			if (traversalMode != TraversalMode::TRAVERSE_PARENTS)
+			if (nodePathMode == NodePathMode::RAW) {
+				if (traversalMode != TraversalMode::TRAVERSE_PARENTS)
+					rawNodepath.push_back(&node);
+				else
+					rawNodepath.insert(rawNodepath.begin(), &node);
+			}
+			else if (traversalMode != TraversalMode::TRAVERSE_PARENTS)
 				nodepath.push_back(node.shared_from_this());
 			else
 				nodepath.insert(nodepath.begin(), node.shared_from_this());
@@ -69,19 +92,38 @@ namespace PGUPV {
 		* Note, the user does not typically call popFromNodePath() as it
 		* will be called automatically by the Node::accept() method.*/
 		inline void popFromNodePath() {
-			if (traversalMode != TraversalMode::TRAVERSE_PARENTS)
+			if (nodePathMode == NodePathMode::RAW) {
+				if (traversalMode != TraversalMode::TRAVERSE_PARENTS)
+					rawNodepath.pop_back();
+				else
+					rawNodepath.erase(rawNodepath.begin());
+			}
+			else if (traversalMode != TraversalMode::TRAVERSE_PARENTS)
 				nodepath.pop_back();
 			else
 				nodepath.erase(nodepath.begin());
 		}
 
 
+		//! \warning Est vaco si el modo del camino es NodePathMode::RAW
 		const NodePath &getNodePath() const {
 			return nodepath;
 		}
 
+		//! \warning Est vaco si el modo del camino es NodePathMode::SHARED
+		const RawNodePath &getRawNodePath() const {
+			return rawNodepath;
+		}
+
+		//! \return la longitud del camino hasta el nodo actual, en cualquier modo
+		size_t getNodePathLength() const {
+			return nodePathMode == NodePathMode::RAW ? rawNodepath.size() : nodepath.size();
+		}
+
 	protected:
 		TraversalMode traversalMode;
+		NodePathMode nodePathMode;
 		NodePath nodepath;
+		RawNodePath rawNodepath;
 	};
 };
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <vector>
+#include <unordered_set>
+
+#include "updateVisitor.h"
+
+namespace PGUPV {
+	class JobPool;
+
+	/**
+	\class ParallelUpdateVisitor
+	Versión de UpdateVisitor que reparte los hijos de los grupos entre los hilos de un JobPool,
+	de forma que los subárboles independientes se actualizan en paralelo.
+
+	Sólo se ejecutan en paralelo los nodos cuyos callbacks son todos thread-safe (ver
+	NodeCallback::isThreadSafe). Cuando se encuentra un nodo con algún callback que no lo es, se
+	aparta (junto con su subárbol) y se actualiza después en el hilo que llama a runDeferred,
+	siguiendo el orden del recorrido en profundidad, así que el orden entre esos callbacks es
+	siempre el mismo. También se apartan los nodos con varios padres, que se actualizan una sola
+	vez por recorrido (al llegar a ellos por el primer camino).
+
+	PGUPV::ParallelUpdateVisitor update(&pool);
+	root->accept(update);
+	update.runDeferred();
+	*/
+	class ParallelUpdateVisitor : public UpdateVisitor {
+	public:
+		/**
+		\param pool conjunto de hilos que actualizará la escena. Si es nullptr, se comporta como un
+		UpdateVisitor
+		\param maxParallelDepth sólo se reparten los hijos de los grupos que estén como mucho a esta
+		profundidad, para no crear trabajos demasiado pequeños
+		*/
+		explicit ParallelUpdateVisitor(JobPool *pool, unsigned int maxParallelDepth = 8);
+
+		void apply(Node &node) override;
+		void apply(Geode &node) override;
+		void traverse(Node &node) override;
+
+		/**
+		Actualiza, en el hilo actual, los nodos apartados durante el recorrido por tener callbacks
+		que no son thread-safe. Hay que llamarla después de recorrer la escena.
+		*/
+		void runDeferred();
+	private:
+		static bool callbacksAreThreadSafe(Node &node);
+		bool mustDefer(Node &node);
+		// false si el nodo tiene varios padres y ya se ha actualizado en este recorrido
+		bool firstVisit(Node &node);
+		void defer();
+		JobPool *pool;
+		unsigned int maxParallelDepth;
+		// Caminos hasta los nodos apartados, en el orden del recorrido (sólo se usa el del modo
+		// de camino del visitante)
+		struct DeferredNode {
+			NodePath path;
+			RawNodePath rawPath;
+		};
+		std::vector<DeferredNode> deferred;
+		// Nodos con varios padres ya actualizados (sólo sin pool, o al ejecutar runDeferred)
+		std::unordered_set<Node *> updatedShared;
+	};
+};
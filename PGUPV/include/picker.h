@@ -1,6 +1,7 @@
 #pragma once
 
 #include "nodeVisitor.h"
+#include "instancedGeode.h"
 
 #include <vector>
 #include <memory>
@@ -21,6 +22,12 @@ namespace PGUPV {
 	vector. En el caso de usar un grafo de escena, se puede usar la clase \sa PickerNodeVisitor para construir 
 	dicho vector.
 
+	Por defecto (Method::GPU), se dibujan los modelos en un FBO pequeo alrededor del pxel y se
+	lee el identificador. Con Method::CPU, la seleccin se calcula lanzando un rayo contra los
+	tringulos de los modelos (ver RayPicker), sin detener el pipeline de la GPU, pero no se
+	pueden seleccionar lneas ni puntos, y las mallas animadas con huesos o deformadas en el
+	shader se prueban en su posicin de reposo.
+
 	Ejemplo de uso:
 
 	Picker::PickData pick{x, y, windowWidth, windowHeight};
@@ -54,13 +61,16 @@ namespace PGUPV {
 			Model* m;	// geometra a dibujar
 			uint32_t id;  // identificador de este objeto. Cuidado! No usar el id 0 (es el fondo)
 		};
-		Picker();
+		//! Cmo se calcula el objeto seleccionado
+		enum class Method { CPU, GPU };
+		explicit Picker(Method method = Method::GPU);
 		~Picker();
 		/**
 		Calcula el objeto sobre el que ha hecho clic el usuario
 		\param pick informacin sobre la posicin del clic
 		\param viewMatrix la matriz view original de la cmara
 		\param projMatrix la matriz projection original de la cmara 
+		\param objects los modelos que se pueden seleccionar
 		\return el identificador del objeto seleccionado
 		*/
 		uint32_t pick(const PickData &pick, const glm::mat4 &viewMatrix, const glm::mat4& projMatrix, const std::vector<ModelId> &objects);
@@ -85,7 +95,9 @@ namespace PGUPV {
 	*/
 	class PickerNodeVisitor : public NodeVisitor {
 	public:
-		PickerNodeVisitor(const glm::mat4& viewproj) : viewprojMatrix{ viewproj } {};
+		PickerNodeVisitor(const glm::mat4& viewproj) : viewprojMatrix{ viewproj } {
+			setNodePathMode(NodePathMode::RAW);
+		};
 		~PickerNodeVisitor() {};
 		void apply(Group& group) override {
 			if (!group.isVisible() || !PGUPV::overlapsViewVolume(group.getBB(), viewprojMatrix * mats.getMatrix()))
@@ -101,6 +113,11 @@ namespace PGUPV {
 			mats.popMatrix();
 		};
 		void apply(Geode& geode) override {
+			if (auto ig = dynamic_cast<InstancedGeode*>(&geode)) {
+				for (size_t i = 0; i < ig->getNumInstances(); i++)
+					rendernodes.emplace_back(Picker::ModelId{ mats.getMatrix() * ig->getInstanceTransform(i), &geode.getModel(), ig->getInstancePickId(i) });
+				return;
+			}
 			rendernodes.emplace_back(Picker::ModelId{ mats.getMatrix(), &geode.getModel(), geode.getId() });
 		};
 		void reset() { mats.reset(); rendernodes.clear(); }
@@ -5,13 +5,16 @@
 #include <string>
 #include <memory>
 #include <map>
+#include <unordered_map>
 #include <iostream>
+#include <functional>
 
 #include <GL/glew.h>
 
 #include "utils.h"
 #include "uniformBufferObject.h"
 #include "shader.h"
+#include "fileWatcher.h"
 
 namespace PGUPV {
 
@@ -116,6 +119,25 @@ namespace PGUPV {
 		*/
 		bool compile();
 		/**
+		Igual que compile, pero no espera a que el driver termine de compilar y enlazar. Si la
+		implementación tiene GL_KHR_parallel_shader_compile, lo hará en otros hilos. Mientras
+		tanto, use instala un programa que dibuja en magenta (así que las llamadas a glUniform*
+		tras use no afectan a este programa). Las funciones que necesitan el programa enlazado
+		(getUniformLocation, bindBlockToBindingPoint...) esperan a que termine. Si no se llama
+		a este método (ni a ShaderLibrary::compileAllAsync), use compila el programa
+		esperando al resultado.
+		Ver también ShaderLibrary::compileAllAsync
+		*/
+		void compileAsync();
+		/**
+		Comprueba, sin bloquear, si ha terminado la compilación lanzada con compileAsync. Si
+		ha terminado, prepara el programa para usarlo
+		\return true si el programa está listo (o ha fallado y se ha sustituido por el de error)
+		*/
+		bool isReady();
+		//! \return true si se ha lanzado la compilación con compileAsync y aún no ha terminado
+		bool isCompiling() const { return compiling; }
+		/**
 		Libera todos los recursos asociados a este shader (memoria, shaders
 		compilados, etc)
 		*/
@@ -132,12 +154,54 @@ namespace PGUPV {
 
 		/**
 	  Devuelve la localización del uniform indicado en el programa. Esta localización
-	  sólo cambia al enlazar el programa
+	  sólo cambia al enlazar el programa. Se consulta en la tabla de uniforms que se construye
+	  al enlazar (no llama a OpenGL)
 	  \param uniform Nombre del uniform cuya localización se desea obtener
-	  \return Localización del uniform (para usarla en glUniform*)
+	  \return Localización del uniform (para usarla en glUniform*), o -1 si no existe
 	  */
 		int getUniformLocation(const std::string &uniform);
 
+		/**
+		Establece el valor de un uniform del programa (no hace falta que esté instalado). Si el
+		valor es igual al último establecido con setUniform, no se envía a OpenGL.
+		\warning Si cambias el uniform con glUniform*, llama a forgetUniformValues
+		\param name nombre del uniform
+		\param v valor
+		*/
+		void setUniform(const std::string &name, bool v) { setUniform(getUniformLocation(name), v); }
+		void setUniform(const std::string &name, int v) { setUniform(getUniformLocation(name), v); }
+		void setUniform(const std::string &name, uint v) { setUniform(getUniformLocation(name), v); }
+		void setUniform(const std::string &name, float v) { setUniform(getUniformLocation(name), v); }
+		void setUniform(const std::string &name, const glm::vec2 &v) { setUniform(getUniformLocation(name), v); }
+		void setUniform(const std::string &name, const glm::vec3 &v) { setUniform(getUniformLocation(name), v); }
+		void setUniform(const std::string &name, const glm::vec4 &v) { setUniform(getUniformLocation(name), v); }
+		void setUniform(const std::string &name, const glm::ivec2 &v) { setUniform(getUniformLocation(name), v); }
+		void setUniform(const std::string &name, const glm::ivec3 &v) { setUniform(getUniformLocation(name), v); }
+		void setUniform(const std::string &name, const glm::ivec4 &v) { setUniform(getUniformLocation(name), v); }
+		void setUniform(const std::string &name, const glm::mat3 &v) { setUniform(getUniformLocation(name), v); }
+		void setUniform(const std::string &name, const glm::mat4 &v) { setUniform(getUniformLocation(name), v); }
+		/**
+		Igual que las anteriores, pero con la localización del uniform (devuelta por
+		getUniformLocation). Si es -1, no hace nada
+		*/
+		void setUniform(GLint location, bool v);
+		void setUniform(GLint location, int v);
+		void setUniform(GLint location, uint v);
+		void setUniform(GLint location, float v);
+		void setUniform(GLint location, const glm::vec2 &v);
+		void setUniform(GLint location, const glm::vec3 &v);
+		void setUniform(GLint location, const glm::vec4 &v);
+		void setUniform(GLint location, const glm::ivec2 &v);
+		void setUniform(GLint location, const glm::ivec3 &v);
+		void setUniform(GLint location, const glm::ivec4 &v);
+		void setUniform(GLint location, const glm::mat3 &v);
+		void setUniform(GLint location, const glm::mat4 &v);
+		/**
+		Olvida los valores guardados por setUniform, para que la siguiente llamada los envíe
+		a OpenGL (p.e., si se han cambiado con glUniform*)
+		*/
+		void forgetUniformValues() { uniformValues.clear(); }
+
 		/**
 		Conecta el buffer object con el programa. Esta función pide al objeto bo el
 		nombre del bloque y su definición durante la compilación del shader y realiza
@@ -183,7 +247,18 @@ namespace PGUPV {
 			GLuint bindingPoint);
 
 		/**
-		Instala el shader en la GPU.
+		Conecta el bloque shader storage definido en el código al punto de vinculación dado
+		(ver gl_shader_storage_buffer)
+		\warning Llama a esta función después de haber compilado el shader. Necesita GL 4.3
+		\param blockName nombre del bloque definido en el shader
+		\param bindingPoint identificador del punto de vinculación
+		\return false si el programa no tiene un bloque con ese nombre
+		*/
+		bool bindStorageBlockToBindingPoint(const std::string &blockName,
+			GLuint bindingPoint);
+
+		/**
+		Instala el shader en la GPU. Si no está compilado, lo compila (ver compileAsync).
 		\param reconnectUBOs si true (por defecto) reconecta todos los UBO que se
 		declararon con connectUniformBlock. Si false, no reconecta los UBO (así, podrás
 		cambiar de UBO llamando a gl_uniform_buffer.bind(ubo);
@@ -199,6 +274,12 @@ namespace PGUPV {
 		*/
 		void unUse();
 
+		/**
+		\return el programa instalado por la última llamada a Program::use (o nullptr si no hay
+		ninguno, o se desinstaló con unUse)
+		*/
+		static Program *getCurrentProgram() { return prevProgram; }
+
 		/**
 		Devuelve el tamaño del bloque de uniforms, según el driver de OpenGL.
 		El shader debe haberse compilado correctamente (y enlazado en un programa)
@@ -369,6 +450,19 @@ namespace PGUPV {
 			si se ha modificado algún shader)
 		 */
 		long long getModificationTime();
+		/**
+		 Vuelve a cargar desde disco los shaders del programa cuyo fichero (o alguno de los ficheros
+		 que incluye con $include) ha cambiado, y si había alguno, vuelve a compilar el programa.
+		 Los uniforms establecidos con setUniform recuperan su valor; el resto de uniforms que no
+		 sean parte de un bloque vuelven a tomar sus valores por defecto.
+		 No hace falta llamarla: el programa vigila sus ficheros (ver FileWatcher) y se recarga
+		 solo cuando cambian.
+		 Si la versión nueva no compila, se muestra el error y se sigue usando la anterior (o el
+		 programa de error, si nunca llegó a compilar). Se siguen vigilando los ficheros de la
+		 versión que ha fallado, para volver a intentarlo cuando se corrijan
+		 \return true si se ha vuelto a compilar el programa
+		 */
+		bool reloadChangedShaders();
 	private:
 		// Prohibir la copia
 		Program(const Program &);
@@ -386,8 +480,25 @@ namespace PGUPV {
 
 		bool bindUBOs();
 		void bindAttribs();
-		bool linkProgram(const Uints &shids, std::ostream &error_output);
+		void startLink(const Uints &shids);
+		bool checkLink(std::ostream &error_output);
+		// Lanza la compilación. Devuelve false si el programa ya está listo (estaba en la caché)
+		bool startCompile();
+		// Espera a que termine la compilación lanzada por startCompile y prepara el programa
+		void finishCompile();
+		// Clave del programa en la caché de binarios (ProgramCache)
+		std::string getCacheKey() const;
+		// Vuelve a cargar los shaders indicados por la función y recompila el programa
+		bool reloadShaders(const std::function<bool(const Shader &)> &mustReload);
+		// Vigila los ficheros de los shaders actuales (y de failedShaders) para recargarlos
+		// cuando cambien
+		void updateFileWatch();
 		std::map<Shader::ShaderType, std::shared_ptr<Shader>> shaders;
+		// Últimos shaders cargados desde fichero que no han compilado (se está usando la versión
+		// anterior o el programa de error en su lugar). Vacío si compilaron
+		std::map<Shader::ShaderType, std::shared_ptr<Shader>> failedShaders;
+		// Se está compilando una versión recargada: si falla, no se sustituye por el programa de error
+		bool reloading;
 		std::vector<struct Attribute> attribs;
 		GLuint programId;
 		std::map<std::string, Strings> subStrings;
@@ -399,6 +510,43 @@ namespace PGUPV {
 		std::vector<PendingConnection> pendingConnections;
 		std::vector<std::string> transformVaryings;
 		bool transformInterleaved;
+		// Se está compilando en segundo plano (compileAsync)
+		bool compiling;
+		// Está instalado el programa de error mientras termina la compilación
+		bool usingPlaceholder;
+		// Se ha sustituido el programa por el de error (no se exige que use los UBOs conectados)
+		bool usingErrorProgram;
+		std::string cacheKey;
+		FileWatcher::Id watchId;
+
+		// Tabla de los recursos del programa, construida al enlazarlo (buildReflection)
+		struct UniformEntry {
+			GLint location;
+			GLenum type;
+			GLint size;
+		};
+		struct BlockEntry {
+			GLuint index;
+			GLint dataSize;
+			// Punto de vinculación asignado al bloque (para no volver a asignar el mismo)
+			GLint binding;
+		};
+		std::unordered_map<std::string, UniformEntry> uniforms;
+		std::unordered_map<std::string, BlockEntry> uniformBlocks, storageBlocks;
+		std::unordered_map<std::string, GLint> subroutineUniforms[Shader::NUM_SHADER_TYPES];
+		std::unordered_map<std::string, GLuint> subroutineIndices[Shader::NUM_SHADER_TYPES];
+		void buildReflection();
+		void clearReflection();
+		// Último valor establecido con setUniform en cada localización
+		struct UniformValue {
+			GLenum type;
+			unsigned char data[sizeof(glm::mat4)];
+		};
+		std::unordered_map<GLint, UniformValue> uniformValues;
+		// Devuelve true si el valor es distinto del guardado para la localización (y lo guarda)
+		bool changeUniformValue(GLint location, GLenum type, const void *data, size_t size);
+		// Vuelve a establecer un valor guardado (tras volver a enlazar el programa)
+		void restoreUniformValue(GLint location, const UniformValue &value);
 
 		static Program *prevProgram;
 	};
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <GL/glew.h>
+
+namespace PGUPV {
+	/**
+	\class ProgramCache
+
+	Caché en disco de programas enlazados (glGetProgramBinary). Program::compile calcula una
+	clave con el código fuente ya preprocesado de sus shaders, las localizaciones de los
+	atributos, las variables del transform feedback y el driver (GL_VENDOR, GL_RENDERER y
+	GL_VERSION). Si en el directorio de la caché hay un binario con esa clave, lo carga con
+	glProgramBinary en vez de compilar los shaders. Si no lo hay, o el driver lo rechaza (p.e.,
+	porque se ha actualizado), compila el programa y guarda el binario para la próxima vez.
+
+	Está activa por defecto si la implementación de OpenGL lo permite (GL 4.1 o
+	ARB_get_program_binary, con algún formato de binario disponible). La ventana lo comprueba
+	al crear su contexto (contextCreated); hasta entonces la caché no se usa.
+
+	Los binarios se guardan en un directorio del usuario ($XDG_CACHE_HOME/pgupv/program_cache o
+	~/.cache/pgupv/program_cache; en Windows, %LOCALAPPDATA%\\pgupv\\program_cache). En sistemas
+	POSIX el directorio se crea sólo accesible para el usuario, y no se usa si es de otro usuario
+	o si otros pueden escribir en él, porque se cargarían sus binarios.
+	*/
+	class ProgramCache {
+	public:
+		//! \return true si la implementación de OpenGL permite guardar y cargar programas
+		static bool isSupported();
+		//! Activa o desactiva la caché
+		static void setEnabled(bool enabled);
+		//! \return true si la caché está activa (y OpenGL lo permite)
+		static bool isEnabled();
+		//! Comprueba si el contexto de OpenGL actual permite usar la caché (la llama Window)
+		static void contextCreated();
+		/**
+		Establece el directorio donde se guardan los binarios (por defecto, el del usuario, o
+		pgupv_program_cache_<uid> en el directorio temporal si no se puede determinar)
+		*/
+		static void setDirectory(const std::string &dir);
+		static std::string getDirectory();
+		//! Borra todos los binarios guardados en el directorio de la caché
+		static void clear();
+
+		/**
+		Calcula la clave de un programa
+		\param parts todo lo que determina el binario (código fuente, atributos...). Se le
+		añade la identificación del driver
+		*/
+		static std::string computeKey(const std::vector<std::string> &parts);
+		/**
+		Intenta cargar en el programa el binario guardado con la clave indicada
+		\return true si lo ha cargado y el programa está enlazado
+		*/
+		static bool load(GLuint programId, const std::string &key);
+		/**
+		Guarda el binario del programa (que debe haberse enlazado con
+		GL_PROGRAM_BINARY_RETRIEVABLE_HINT) con la clave indicada
+		*/
+		static void store(GLuint programId, const std::string &key);
+	private:
+		static std::string path(const std::string &key);
+	};
+};
@@ -0,0 +1,171 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <unordered_map>
+#include <glm/vec3.hpp>
+#include <glm/mat4x4.hpp>
+
+#include "boundingVolumes.h"
+#include "drawCommand.h"
+#include "picker.h"
+
+namespace PGUPV {
+	class Node;
+	class Mesh;
+	class Model;
+
+	//! Rayo con origen y dirección (no tiene por qué ser unitaria)
+	struct Ray {
+		glm::vec3 origin;
+		glm::vec3 direction;
+	};
+
+	/**
+	\class TriangleBVH
+	Jerarquía de volúmenes de inclusión (cajas alineadas con los ejes) sobre los triángulos de una
+	malla, en el sistema de coordenadas de la malla. Permite calcular la intersección más cercana
+	de un rayo con la malla sin recorrer todos sus triángulos.
+	*/
+	class TriangleBVH {
+	public:
+		//! Información de la intersección de un rayo con un triángulo
+		struct Hit {
+			uint32_t triangle; // índice del triángulo (en el orden de Mesh::getTriangles)
+			glm::vec3 barycentrics; // coordenadas baricéntricas del punto en el triángulo
+			float t; // parámetro del rayo en el punto de intersección
+		};
+
+		/**
+		Construye la jerarquía a partir de los vértices y los triángulos de la malla
+		\warning Tiene que leer la geometría desde la GPU (ver Mesh::getVertices)
+		*/
+		explicit TriangleBVH(const Mesh &mesh);
+		TriangleBVH(std::vector<glm::vec3> vertices, std::vector<TriangleIndices> triangles);
+
+		/**
+		Calcula la intersección más cercana del rayo con los triángulos (por ambas caras)
+		\param ray el rayo, en el sistema de coordenadas de la malla
+		\param tMax sólo se buscan intersecciones con parámetro menor que éste
+		\param hit si hay intersección, se escribe aquí
+		\return true si el rayo corta algún triángulo antes de tMax
+		*/
+		bool intersect(const Ray &ray, float tMax, Hit &hit) const;
+		//! \return la caja de inclusión de todos los triángulos
+		BoundingBox getBB() const;
+		size_t getNumTriangles() const { return triangles.size(); }
+	private:
+		std::vector<glm::vec3> vertices;
+		std::vector<TriangleIndices> triangles;
+		// Nodos del árbol. Los triángulos de las hojas están consecutivos en order
+		struct BVHNode {
+			glm::vec3 min, max;
+			uint32_t first; // hijo izquierdo (el derecho es first+1), o primer triángulo en una hoja
+			uint32_t count; // número de triángulos (0 si es un nodo interno)
+		};
+		std::vector<BVHNode> nodes;
+		std::vector<uint32_t> order;
+		/**
+		Construye un árbol sobre un conjunto de primitivas
+		\param boxes caja de inclusión de cada primitiva
+		\param nodes nodos del árbol (el primero es la raíz)
+		\param order permutación de las primitivas según aparecen en las hojas
+		*/
+		static void buildTree(const std::vector<BoundingBox> &boxes, std::vector<BVHNode> &nodes,
+			std::vector<uint32_t> &order);
+		friend class RayPicker;
+	};
+
+	/**
+	\class RayPicker
+	Selección de objetos en la CPU lanzando rayos contra la escena. Mantiene una jerarquía de
+	volúmenes de inclusión sobre los objetos de la escena (en coordenadas del mundo), y otra por
+	cada malla sobre sus triángulos. Las jerarquías de las mallas se guardan y se reutilizan entre
+	llamadas a build, así que sólo se lee la geometría de la GPU la primera vez que aparece una malla.
+	Las de las mallas que se han destruido se descartan en la siguiente llamada a build.
+
+	PGUPV::RayPicker picker;
+	picker.build(*scene->getRoot());
+	PGUPV::RayPicker::Hit hit;
+	if (picker.pick(PGUPV::RayPicker::computeRay(pick, view, proj), hit)) {
+		// hit.node es la Geode seleccionada
+	}
+
+	\warning Las mallas animadas con huesos se prueban en su posición de reposo. Si cambia la
+	geometría de una malla, hay que llamar a invalidateMesh
+	*/
+	class RayPicker {
+	public:
+		//! Información sobre el objeto seleccionado
+		struct Hit {
+			Node *node;	// nodo seleccionado (nullptr si se construyó a partir de Picker::ModelId)
+			uint32_t id; // identificador del objeto (Node::getId, InstancedGeode::getInstancePickId o Picker::ModelId::id)
+			Mesh *mesh; // malla seleccionada
+			uint32_t instance; // índice de la instancia seleccionada de un InstancedGeode (0 en otro caso)
+			uint32_t triangle; // índice del triángulo en la malla (ver Mesh::getTriangles)
+			glm::vec3 barycentrics; // coordenadas baricéntricas del punto en el triángulo
+			float distance; // distancia desde el origen del rayo, en unidades de su dirección
+			glm::vec3 position; // punto de intersección en coordenadas del mundo
+		};
+
+		/**
+		Recorre el grafo de escena y construye la jerarquía con todas las mallas visibles
+		\param root raíz del grafo
+		*/
+		void build(Node &root);
+		/**
+		Construye la jerarquía con los objetos indicados
+		\param objects lista de modelos, con su matriz del modelo y su identificador
+		*/
+		void build(const std::vector<Picker::ModelId> &objects);
+		/**
+		Calcula el objeto más cercano que corta el rayo
+		\param ray rayo en coordenadas del mundo
+		\param hit información de la intersección, si la hay
+		\return true si el rayo corta algún objeto
+		*/
+		bool pick(const Ray &ray, Hit &hit) const;
+		//! Descarta la jerarquía guardada de la malla (p.e., porque ha cambiado su geometría)
+		void invalidateMesh(Mesh *mesh);
+		//! Descarta las jerarquías guardadas de todas las mallas
+		void clearMeshCache();
+
+		/**
+		\return el rayo en coordenadas del mundo que pasa por el centro del píxel indicado
+		\param pick información del clic (origen en la esquina superior izquierda)
+		\param viewMatrix matriz de la vista de la cámara
+		\param projMatrix matriz de proyección de la cámara
+		*/
+		static Ray computeRay(const Picker::PickData &pick, const glm::mat4 &viewMatrix,
+			const glm::mat4 &projMatrix);
+	private:
+		struct Instance {
+			glm::mat4 invModelMatrix;
+			glm::mat4 modelMatrix;
+			const TriangleBVH *bvh;
+			Mesh *mesh;
+			Node *node;
+			uint32_t id;
+			uint32_t instance;
+		};
+		void addInstance(const glm::mat4 &modelMatrix, const std::shared_ptr<Mesh> &mesh, Node *node,
+			uint32_t id, uint32_t instance);
+		void addModel(const glm::mat4 &modelMatrix, Model &model, Node *node, uint32_t id,
+			uint32_t instance = 0);
+		// Descarta las jerarquías de las mallas que ya no existen
+		void dropDeadMeshes();
+		void buildTopLevel();
+		std::vector<Instance> instances;
+		// Árbol sobre las instancias (se reutiliza la estructura de TriangleBVH)
+		std::vector<TriangleBVH::BVHNode> nodes;
+		std::vector<uint32_t> order;
+		// Jerarquía de cada malla. Se guarda también un weak_ptr a la malla para saber si sigue
+		// existiendo (su dirección se puede reutilizar para otra malla)
+		struct MeshBVH {
+			std::weak_ptr<Mesh> mesh;
+			std::unique_ptr<TriangleBVH> bvh;
+		};
+		std::unordered_map<Mesh *, MeshBVH> meshBVHs;
+		friend class RayPickerBuilder;
+	};
+};
@@ -19,7 +19,9 @@ namespace PGUPV {
 	public:
 		enum class Volume { BOX, SPHERE };
 		RenderBoundingVolumes(Volume volume = Volume::BOX) :
-			lastColor(0), volume(volume), current(1.0f) {};
+			lastColor(0), volume(volume), current(1.0f) {
+			setNodePathMode(NodePathMode::RAW);
+		};
 		void apply(Group &group) override;
 		void apply(Transform &transform) override;
 		void apply(Geode &geode) override;
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <glm/mat4x4.hpp>
+
+#include "nodeVisitor.h"
+#include "matrixStack.h"
+
+namespace PGUPV {
+	class Mesh;
+	class BaseMaterial;
+
+	/**
+	\struct DrawPacket
+
+	Una orden de dibujo de una malla, con toda la información necesaria para lanzarla sin
+	recorrer el grafo de escena. Los nodos que no se pueden aplanar en mallas (p.e., 
+	AnimationNode) se guardan en el campo node, y se dibujan llamando a su método render.
+	No guarda el programa: el grafo de escena no asocia programas a los nodos, y todas las
+	órdenes se dibujan con el programa instalado al llamar a RenderQueue::submit.
+	*/
+	struct DrawPacket {
+		glm::mat4 modelMatrix; // matriz que lleva la malla al espacio del mundo
+		Mesh *mesh;
+		BaseMaterial *material;
+		Node *node; // si no es nullptr, se dibuja con node->render() (mesh será nullptr)
+		uint64_t key; // clave de estado, calculada por RenderQueue::sort
+	};
+
+	/**
+	\class RenderQueue
+
+	Lista plana de órdenes de dibujo (DrawPacket) que se ordena por una clave de 64 bits
+	construida a partir del material y la malla de cada orden. Al dibujarla, sólo se cambia
+	el estado de OpenGL (material, VAO) cuando cambia la clave, y la
+	matriz del modelo se escribe una vez por orden, en vez de apilar y multiplicar en cada 
+	nodo Transform.
+
+	La cola se rellena con un RenderQueueBuilder. La forma más sencilla de usarla es con
+	Scene::setUseRenderQueue(true).
+
+	\warning Al ordenar las órdenes por estado se pierde el orden del grafo de escena. Si la
+	escena tiene objetos transparentes que deben dibujarse en un orden concreto, dibújalos por
+	separado.
+	*/
+	class RenderQueue {
+	public:
+		//! Vacía la cola (conserva la memoria reservada para el siguiente frame)
+		void clear() { packets.clear(); }
+		void add(const glm::mat4 &modelMatrix, Mesh *mesh);
+		void add(const glm::mat4 &modelMatrix, Node *node);
+		//! Calcula la clave de estado de cada orden y las ordena por ella
+		void sort();
+		/**
+		Dibuja todas las órdenes de la cola, en el orden actual, con el programa instalado.
+		Deja la matriz del modelo de GLMatrices como estaba.
+		*/
+		void submit();
+		size_t size() const { return packets.size(); }
+		const std::vector<DrawPacket> &getPackets() const { return packets; }
+	private:
+		std::vector<DrawPacket> packets;
+	};
+
+	/**
+	\class RenderQueueBuilder
+
+	Recorre el grafo de escena acumulando las transformaciones y descartando los nodos que
+	quedan fuera del volumen de la vista, y añade a la cola una orden por cada malla visible.
+	*/
+	class RenderQueueBuilder : public NodeVisitor {
+	public:
+		/**
+		\param queue cola donde se añadirán las órdenes de dibujo
+		\param viewProj producto de las matrices de proyección y de la vista
+		\param modelMatrix matriz del modelo inicial (la que se aplicaría a la raíz)
+		*/
+		RenderQueueBuilder(RenderQueue &queue, const glm::mat4 &viewProj, const glm::mat4 &modelMatrix);
+		void apply(Node &node) override;
+		void apply(AnimationNode &node) override;
+		void apply(Group &group) override;
+		void apply(Transform &transform) override;
+		void apply(Geode &geode) override;
+		void apply(LOD &lod) override;
+	private:
+		bool isOutsideViewVolume(Node &node);
+		RenderQueue &queue;
+		glm::mat4 viewProjMatrix;
+		MatrixStack mats;
+	};
+};
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include "utils.h"
+
+namespace PGUPV {
+	/**
+	\class RenderStats
+
+	Contadores de la actividad de la CPU al dibujar un frame (nodos del grafo de escena dibujados,
+	descartados por estar fuera del volumen de la vista, órdenes de dibujo, cambios de programa,
+	etc). Mientras que GLStats pregunta a OpenGL por el trabajo de la GPU, estos contadores los
+	incrementa la propia librería durante el recorrido de la escena. Window::draw los pone a cero
+	al empezar cada frame, y getValue devuelve el valor del último frame completo.
+
+	NodesVisited: nodos del grafo de escena que se han intentado dibujar
+	NodesCulled: nodos descartados por estar fuera del volumen de la vista
+	GeodesDrawn: Geodes dibujadas
+	MeshesDrawn: mallas dibujadas (Mesh::render, o desde una RenderQueue)
+	DrawCalls: órdenes de dibujo enviadas a OpenGL (DrawCommand::render)
+	TrianglesSubmitted: triángulos enviados en esas órdenes (contando las instancias)
+	ProgramBinds: cambios del programa activo enviados a OpenGL (glUseProgram)
+	MaterialBinds: materiales activados (Material::use, PBRMaterial::use)
+	TextureBinds: texturas vinculadas a una unidad de textura (glBindTexture)
+	VAOBinds: VAOs vinculados (glBindVertexArray)
+	BufferBinds: buffers vinculados a un punto de vinculación (glBindBuffer, glBindBufferBase,
+	  glBindBufferRange)
+	BindsElided: vinculaciones que no se han enviado a OpenGL porque no cambiaban el estado
+	  (ver GLStateTracker)
+	*/
+	class RenderStats {
+	public:
+		enum class Counter {
+			NodesVisited, NodesCulled, GeodesDrawn, MeshesDrawn, DrawCalls, TrianglesSubmitted,
+			ProgramBinds, MaterialBinds, TextureBinds, VAOBinds, BufferBinds, BindsElided
+		};
+		constexpr static unsigned int NCounters{ static_cast<unsigned int>(PGUPV::to_underlying(Counter::BindsElided)) + 1 };
+		//! Pone a cero los contadores del frame actual
+		static void beginFrame();
+		//! Guarda los contadores del frame actual para consultarlos con getValue
+		static void endFrame();
+		static void increment(Counter counter, uint64_t n = 1) {
+			current[PGUPV::to_underlying(counter)] += n;
+		}
+		//! \return el valor del contador en el último frame completo
+		static uint64_t getValue(Counter counter);
+		//! \return el nombre del contador (p.e., para la cabecera de un fichero de estadísticas)
+		static std::string getName(Counter counter);
+	private:
+		static uint64_t current[NCounters], last[NCounters];
+	};
+};
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <map>
+#include <functional>
+#include "utils.h"
+
+namespace PGUPV {
+	/**
+	\class ResourceTracker
+
+	Registro de la memoria que ocupan los recursos de la librería, para saber en qué se gasta
+	la memoria de la GPU (y de la CPU) y poner un límite. Cada recurso se apunta en una categoría:
+
+	Buffers: buffer objects (BufferObject)
+	Textures: texturas (BindableTexture, con el tamaño que informa OpenGL, incluyendo mipmaps)
+	CPUMirrors: copias en memoria principal de los buffers de las mallas (Mesh::setCPUMirror)
+
+	Además de por categoría, la memoria se agrupa por la etiqueta de cada recurso (la de
+	depuración de GL de los buffers o el nombre de las texturas) y por grupo. El grupo de un
+	recurso es el de los objetos Group que existían en su hilo al crearlo (p.e., el cargador de
+	modelos crea uno por escena, malla y material):
+
+	{
+	  ResourceTracker::Group g("Terreno");
+	  ... // los buffers y texturas creados aquí se apuntan en el grupo "Terreno"
+	}
+
+	Se puede establecer un presupuesto para la memoria de la GPU (Buffers y Textures) y otro para
+	la de la CPU (CPUMirrors). Al superarlo se muestra un aviso y, si se ha pedido, al final del
+	frame (endFrame) se llama a las funciones de desalojo registradas (addEvictor) para que
+	liberen los recursos que se pueden volver a obtener. Las copias de las mallas cuentan para
+	el presupuesto de la CPU, pero no se desalojan: otros hilos pueden estar usándolas (ver
+	Mesh::setCPUMirror).
+	*/
+	class ResourceTracker {
+	public:
+		enum class Category { Buffers, Textures, CPUMirrors };
+		constexpr static unsigned int NCategories{ static_cast<unsigned int>(PGUPV::to_underlying(Category::CPUMirrors)) + 1 };
+		//! Memoria a la que se aplica cada presupuesto
+		enum class Pool { GPU, CPU };
+		typedef uint64_t Id;
+
+		/**
+		Apunta un recurso nuevo
+		\param category la categoría del recurso
+		\param bytes la memoria que ocupa
+		\param label su etiqueta
+		\return el identificador para actualizarlo (setSize, setLabel) y borrarlo (remove)
+		*/
+		static Id add(Category category, size_t bytes, const std::string &label = "");
+		static void setSize(Id id, size_t bytes);
+		static void setLabel(Id id, const std::string &label);
+		static void remove(Id id);
+
+		//! \return la memoria que ocupan ahora los recursos de la categoría
+		static size_t getTotal(Category category);
+		//! \return la máxima memoria que han llegado a ocupar los recursos de la categoría
+		static size_t getPeak(Category category);
+		static size_t getTotal(Pool pool);
+		static size_t getPeak(Pool pool);
+		//! \return la memoria de la categoría, por etiqueta
+		static std::map<std::string, size_t> getTotalsByLabel(Category category);
+		//! \return la memoria de la categoría, por grupo ("" para los recursos sin grupo)
+		static std::map<std::string, size_t> getTotalsByGroup(Category category);
+		//! \return un informe de texto con los totales y los grupos que más ocupan
+		static std::string report(unsigned int maxGroups = 10);
+		//! \return el nombre de la categoría
+		static std::string getName(Category category);
+
+		/**
+		Establece el presupuesto de memoria
+		\param pool la memoria a la que se aplica
+		\param bytes el límite (0 para no tener límite)
+		\param evict si es true, al superarlo se llama a las funciones de desalojo en endFrame
+		*/
+		static void setBudget(Pool pool, size_t bytes, bool evict = false);
+		static size_t getBudget(Pool pool);
+
+		/**
+		Registra una función que libera recursos que se pueden volver a crear. Recibe los bytes
+		que hay que liberar y devuelve los que ha liberado
+		\return el identificador para borrarla con removeEvictor
+		*/
+		typedef std::function<size_t(size_t)> Evictor;
+		static Id addEvictor(Pool pool, Evictor evictor);
+		static void removeEvictor(Id id);
+		//! Si se ha superado algún presupuesto con desalojo, llama a las funciones de desalojo
+		static void endFrame();
+
+		/**
+		Mientras exista, los recursos creados en el hilo se apuntan en este grupo. Los grupos se
+		anidan: un Group("Malla") dentro de un Group("Escena") apunta los recursos en "Escena/Malla"
+		*/
+		class Group {
+		public:
+			explicit Group(const std::string &name);
+			~Group();
+		private:
+			Group(const Group &) = delete;
+			Group &operator=(const Group &) = delete;
+			size_t prevLength;
+		};
+	private:
+		static Pool poolOf(Category category) {
+			return category == Category::CPUMirrors ? Pool::CPU : Pool::GPU;
+		}
+		static void checkBudget(Pool pool);
+	};
+};
@@ -14,6 +14,8 @@ namespace PGUPV {
 	class AnimationClip;
 	class BaseMaterial;
 	class Mesh;
+	class RenderQueue;
+	class JobPool;
 
 	/* Una escena es un objeto compuesto por diferentes nodos. Cada nodo contien un modelo, que puede
 	estar compuesto por varios Meshes, y diferentes modelos pueden compartir un mismo
@@ -92,10 +94,32 @@ namespace PGUPV {
 		*/
 		size_t getNumAnimations() const;
 		std::shared_ptr<AnimationClip> getAnimation(size_t index) const;
+
+		/**
+		Si se activa, render recorre la escena una vez para construir una lista de órdenes de
+		dibujo ordenadas por estado (ver RenderQueue), y luego la dibuja cambiando el estado de
+		OpenGL sólo cuando es necesario. Si no (por defecto), cada nodo se dibuja recursivamente
+		con su método render.
+		\param use true para usar la cola de dibujado
+		*/
+		void setUseRenderQueue(bool use);
+		bool isUsingRenderQueue() const { return renderQueue != nullptr; }
+
+		/**
+		Si se activa, update reparte los subárboles de la escena entre varios hilos (ver
+		ParallelUpdateVisitor). Los nodos con callbacks que no son thread-safe se siguen
+		actualizando en el hilo principal.
+		\param parallel true para actualizar en paralelo
+		\param numThreads número de hilos. Si es 0, uno por núcleo
+		*/
+		void setParallelUpdate(bool parallel, unsigned int numThreads = 0);
+		bool isUsingParallelUpdate() const { return updatePool != nullptr; }
 	private:
 		std::shared_ptr<Node> sceneRoot;
 		std::vector<std::shared_ptr<BaseMaterial>> materials;
 		std::vector<std::shared_ptr<AnimationClip>> animations;
+		std::shared_ptr<RenderQueue> renderQueue;
+		std::shared_ptr<JobPool> updatePool;
 	};
 };
 #endif
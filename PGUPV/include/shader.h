@@ -4,6 +4,8 @@
 #include <string>
 #include <map>
 #include <memory>
+#include <vector>
+#include <filesystem>
 #include <GL/glew.h>
 #include "common.h"
 
@@ -66,6 +68,8 @@ namespace PGUPV {
     \return el tipo del shader
     */
     ShaderType getType() const { return type; };
+    //! \return el identificador del shader en OpenGL (0 si no está compilado)
+    GLuint getId() const { return shaderId; };
     /**
     \return el fichero desde donde se cargó (o la cadena vacía si se cargó desde memoria)
     */
@@ -90,6 +94,18 @@ namespace PGUPV {
       \return El identificador del shader compilado, o 0 si se produce algún error
       */
     GLuint compile();
+
+    /**
+      Lanza la compilación del shader sin esperar a que termine (el driver puede compilar
+      en otros hilos, ver GL_KHR_parallel_shader_compile). Hay que llamar después a
+      finishCompile para saber si ha funcionado
+      */
+    void startCompile();
+    /**
+      Espera a que termine la compilación lanzada con startCompile y comprueba el resultado
+      \return El identificador del shader compilado, o 0 si se produce algún error
+      */
+    GLuint finishCompile();
     
     /**
     En el caso de que la compilación haya fallado, se puede recuperar el error de compilación mediante esta función.
@@ -117,6 +133,44 @@ namespace PGUPV {
        el shader se cargó desde memoria
      */
       long long getModificationTime() { return modificationTime; }
+    /**
+     \return El código fuente del shader, ya preprocesado
+     */
+    const Strings &getSource() const { return src; }
+
+    /**
+     Fichero del que depende el código fuente del shader, con la fecha de modificación que
+     tenía al cargarlo. modificationTime está en segundos; para saber si ha cambiado se usan
+     lastWrite (con la resolución del sistema de ficheros) y size, porque un fichero se puede
+     guardar dos veces en el mismo segundo
+     */
+    struct Dependency {
+      std::string filename;
+      long long modificationTime;
+      std::filesystem::file_time_type lastWrite;
+      uintmax_t size;
+    };
+    /**
+     \return Los ficheros usados para construir el shader: el primero es el fichero principal, y
+       después vienen los incluidos con $include (directa o indirectamente). El índice de cada
+       fichero en este vector es el número de fuente que aparece en las directivas #line (y por
+       tanto, en los mensajes de error del compilador de GLSL). Está vacío si el shader se cargó
+       desde memoria
+     */
+    const std::vector<Dependency> &getDependencies() const { return dependencies; }
+    /**
+     \return true si alguno de los ficheros de los que depende el shader se ha modificado (o
+       borrado) desde que se cargó
+     */
+    bool isOutdated() const;
+    /**
+     Vacía la caché de ficheros incluidos con $include (se vuelven a leer del disco la próxima
+     vez que se usen). No es necesario llamarla para ver los cambios en los ficheros: la caché
+     comprueba la fecha de modificación y el tamaño de cada fichero
+     */
+    static void clearIncludeCache();
+    //! Borra de la caché de ficheros incluidos los ficheros indicados
+    static void clearIncludeCache(const std::vector<std::string> &files);
 
   private:
     Shader();	// Usar las funciones factoría para crear un shader
@@ -126,22 +180,32 @@ namespace PGUPV {
     */
     static int check_extension(const std::string &filename);
 
+    struct PreprocessState;
+    /**
+    Preprocesa (en una sola pasada) el código fuente del shader cuyo código fuente está en src,
+    que se leyó del fichero indicado. Guarda en deps los ficheros usados
+    */
+    static Strings preprocessShader(const Strings &src, const std::string &filename,
+      std::vector<Dependency> &deps);
     /**
-    Preprocesa el código fuente del shader cuyo código fuente está en src
+    Copia las líneas del fichero con el índice indicado en la salida, expandiendo
+    recursivamente las directivas $include
     */
-    static Strings preprocessShader(const Strings &src);
+    static void preprocessFile(const Strings &src, size_t fileIndex, PreprocessState &state);
     /**
-    Procesa una directiva $include, abriendo el fichero y escribiendo en contenido
-    al final del vector de cadenas indicado
+    Procesa una directiva $include, escribiendo el contenido del fichero (preprocesado) al final
+    de la salida
     */
-    static void processInclude(const std::string &line, Strings &dst);
+    static void processInclude(const std::string &line, PreprocessState &state);
 
     Strings src; // Código fuente
     std::string filename; // Nombre del fichero desde donde se cargó (vacío si se cargó desde memoria)
     ShaderType type; // Tipo de shader
     GLuint shaderId;
+    bool compiling; // Se ha llamado a startCompile, pero no a finishCompile
     long long modificationTime; // Fecha de modificación del fichero (o 0 si se cargó desde memoria)
     std::string errorMsg; // Mensajes de error generados durante la compilación
+    std::vector<Dependency> dependencies; // Ficheros de los que depende el código fuente
   };
 };
 #endif
@@ -25,6 +25,23 @@ namespace PGUPV {
     \param verbose si true, imprime más información, como por ejemplo la lista de extensiones
     */
     void printInfoShaders(std::ostream &os = std::cout, bool verbose = false);
+    /**
+    Lanza la compilación (Program::compileAsync) de todos los programas registrados que tengan
+    shaders cargados y no estén compilados. Si la implementación tiene
+    GL_KHR_parallel_shader_compile, pide al driver que use todos los hilos que pueda
+    */
+    void compileAllAsync();
+    /**
+    Prepara los programas cuya compilación ha terminado, sin esperar a los demás
+    \return el número de programas que siguen compilándose
+    */
+    uint pollAsync();
+    /**
+    Vuelve a compilar sólo los programas con algún shader cuyos ficheros han cambiado en disco
+    (ver Program::reloadChangedShaders)
+    \return el número de programas recompilados
+    */
+    uint reloadChanged();
   private:
     std::vector<Program *> library;
   };
@@ -0,0 +1,136 @@
+#ifndef _STREAMING_BUFFER_H
+#define _STREAMING_BUFFER_H
+
+/** \file streamingBuffer.h
+
+\author Paco Abad
+
+*/
+
+#include <memory>
+#include <vector>
+#include <GL/glew.h>
+
+namespace PGUPV {
+
+  class BufferObject;
+  class IndexedBindingPoint;
+
+  /**
+  \class StreamingBuffer
+
+  Buffer para los datos que cambian en cada frame (matrices de los huesos, datos por
+  objeto, etc.). Es un buffer inmutable mapeado de forma persistente (GL_MAP_PERSISTENT_BIT),
+  dividido en tantas regiones como frames puede haber en vuelo. En cada frame se reparten
+  trozos de la región actual, que se escriben directamente desde la CPU y se vinculan con
+  glBindBufferRange, sin llamadas a glBufferSubData ni a glMapBuffer.
+
+  Al terminar el frame (endFrame) se coloca un fence en la región usada y se pasa a la
+  siguiente. Antes de reutilizar una región se espera a que la GPU haya terminado de leerla.
+  Si en un frame no ha cabido todo lo que se ha pedido, endFrame sustituye el buffer por
+  otro con regiones más grandes, de forma que el tamaño inicial sólo es una estimación.
+
+  auto sb = StreamingBuffer::build(1 << 20);
+  ...
+  auto a = sb->write(&data, sizeof(data));
+  if (a.valid())
+    sb->bindRange(gl_uniform_buffer, 3, a);
+  ...
+  sb->endFrame();
+
+  \warning Necesita OpenGL 4.4 (o la extensión GL_ARB_buffer_storage)
+  */
+  class StreamingBuffer {
+  public:
+    //! Trozo de la región del frame actual
+    struct Allocation {
+      void *ptr; // dirección en la que escribir los datos (válida hasta el final del frame)
+      GLintptr offset; // desplazamiento desde el principio del buffer
+      GLsizeiptr size;
+      bool valid() const { return ptr != nullptr; }
+    };
+
+    /**
+    Construye un buffer con framesInFlight regiones de sizePerFrame bytes
+    \param sizePerFrame Tamaño (en bytes) de los datos que se pueden escribir en cada frame
+    \param framesInFlight Número de frames que la CPU puede adelantarse a la GPU
+    */
+    static std::shared_ptr<StreamingBuffer> build(size_t sizePerFrame, unsigned int framesInFlight = 3);
+    //! \return true si la implementación de OpenGL permite construir este tipo de buffers
+    static bool isSupported();
+    ~StreamingBuffer();
+
+    /**
+    Reserva un trozo de la región del frame actual
+    \param size Número de bytes a reservar
+    \param alignment Alineamiento del desplazamiento del trozo. Si es 0, se usa
+      GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT
+    \return El trozo reservado. Si no queda sitio en la región, no es válido (ver
+      Allocation::valid), y la región crecerá al terminar el frame
+    */
+    Allocation allocate(size_t size, size_t alignment = 0);
+    /**
+    Reserva un trozo de la región del frame actual y copia en él los datos
+    \param data Datos a copiar
+    \param size Número de bytes a copiar
+    \param alignment Alineamiento del trozo (ver allocate)
+    */
+    Allocation write(const void *data, size_t size, size_t alignment = 0);
+    /**
+    Vincula un trozo del buffer al índice del punto de vinculación indicado
+    \param bp Punto de vinculación (p.e., gl_uniform_buffer o gl_shader_storage_buffer)
+    \param index Índice del punto de vinculación
+    \param a Trozo devuelto por allocate o write en este frame
+    \param boundAs Objeto que devolverá bp.getBound(index) (ver IndexedBindingPoint::bindBufferRange)
+    */
+    void bindRange(IndexedBindingPoint &bp, GLuint index, const Allocation &a,
+      std::shared_ptr<BufferObject> boundAs = nullptr);
+    /**
+    Marca el final del frame: coloca un fence tras las órdenes que usan la región actual y
+    pasa a la siguiente, esperando a que la GPU termine con ella si es necesario. Si alguna
+    reserva del frame no cabía, crea un buffer nuevo con regiones más grandes (los trozos
+    reservados y el buffer devuelto por getBufferObject dejan de ser válidos)
+    */
+    void endFrame();
+
+    //! \return el número de frames terminados con endFrame
+    unsigned long getFrame() const { return frame; }
+    //! \return el tamaño de la región de cada frame
+    size_t getSizePerFrame() const { return sizePerFrame; }
+    //! \return el número de bytes reservados en el frame actual
+    size_t getUsedThisFrame() const { return head - regionStart(); }
+    std::shared_ptr<BufferObject> getBufferObject() const { return bo; }
+
+    /**
+    Establece el buffer que se usará para los datos por frame de la ventana actual
+    (la ventana lo crea y llama a endFrame al terminar de dibujar)
+    */
+    static void setCurrent(std::shared_ptr<StreamingBuffer> sb);
+    //! \return el buffer para los datos por frame de la ventana actual (puede ser nullptr)
+    static std::shared_ptr<StreamingBuffer> getCurrent();
+  private:
+    StreamingBuffer(size_t sizePerFrame, unsigned int framesInFlight);
+    StreamingBuffer(const StreamingBuffer &other) = delete;
+    StreamingBuffer &operator=(const StreamingBuffer &other) = delete;
+    size_t regionStart() const { return region * sizePerFrame; }
+    // Crea y mapea el buffer con las regiones de sizePerFrame bytes
+    void createStorage();
+    // Libera el buffer y sus fences
+    void releaseStorage();
+
+    std::shared_ptr<BufferObject> bo;
+    unsigned char *mapped;
+    size_t sizePerFrame;
+    unsigned int region;
+    size_t head;
+    unsigned long frame;
+    std::vector<GLsync> fences;
+    // Alineamiento por defecto de los trozos (GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT)
+    size_t uboAlignment;
+    // Bytes que no han cabido en la región del frame actual
+    size_t overflow;
+    bool warnedFull;
+  };
+};
+
+#endif
@@ -5,6 +5,7 @@
 #include <filesystem>
 #include "texture.h"
 #include "common.h"
+#include "fileWatcher.h"
 
 namespace PGUPV {
 
@@ -24,9 +25,10 @@ namespace PGUPV {
     Texture2DGeneric(GLenum texture_type, GLenum minfilter = GL_LINEAR,
       GLenum magfilter = GL_LINEAR, GLenum wrap_s = GL_REPEAT,
       GLenum wrap_t = GL_REPEAT);
-    virtual ~Texture2DGeneric(){};
+    virtual ~Texture2DGeneric();
     /**
-     Función para cargar en el objeto textura una imagen desde fichero:
+     Función para cargar en el objeto textura una imagen desde fichero. Mientras no se cargue
+     otra imagen, la textura se vuelve a cargar cuando cambia el fichero (ver FileWatcher):
 
      \param filename nombre y ruta (absoluta o relativa) del fichero a cargar
 	 \param internalFormat (opcional) establece el formato de los píxeles (GL_RGB, GL_RGBA...)
@@ -128,6 +130,13 @@ namespace PGUPV {
   protected:
     void setParams();
     uint _width, _height;
+  private:
+    // Vuelve a cargar la imagen desde _sourceFile
+    void reloadSourceFile();
+    std::filesystem::path _sourceFile;
+    GLenum _sourceFormat;
+    FileWatcher::Id _watchId;
+    bool _reloadingSource;
   };
 
 };
@@ -16,10 +16,41 @@ namespace PGUPV {
     void render() override;
     std::shared_ptr<Transform> shared_from_this();
     void accept(NodeVisitor &visitor) override;
+    /**
+    \return la matriz que lleva el sistema de coordenadas de los hijos de este nodo al del
+    mundo (el producto de todas las transformaciones desde la raíz, siguiendo el primer
+    padre). Se guarda y sólo se recalcula cuando cambia esta transformación o la de
+    algún antecesor (setTransform invalida las matrices guardadas en los Transform
+    descendientes).
+    */
+    const glm::mat4 &getWorldTransform();
+    /**
+    Marca como no válida la matriz del mundo de este nodo y la de los Transform descendientes.
+    Se llama automáticamente al cambiar la transformación o el primer padre de un antecesor
+    */
+    void invalidateWorldTransform();
+    /**
+    \return un contador que cambia cada vez que cambia la matriz devuelta por getWorldTransform
+    */
+    uint64_t getWorldGeneration();
+    BoundingBox getWorldBB() override;
+    BoundingSphere getWorldBS() override;
   protected:
     Transform(const glm::mat4 &xform = glm::mat4(1.0f));
+    friend class NodePool;
     Value<glm::mat4> transf;
     void recomputeBoundingBox() override;
     void recomputeBoundingSphere() override;
+    bool updateWorldBoundsStamp(uint64_t &stamp, uint64_t &boundsStamp);
+
+    // Matriz del mundo guardada, y contador que cambia cada vez que se recalcula
+    glm::mat4 worldMatrix;
+    uint64_t worldGeneration;
+    bool worldValid;
+    // Volúmenes de inclusión en coordenadas del mundo guardados
+    BoundingBox worldBB;
+    BoundingSphere worldBS;
+    uint64_t worldBBStamp, worldBBBoundsStamp, worldBSStamp, worldBSBoundsStamp;
+    static uint64_t generationCounter;
   };
 };
@@ -7,6 +7,7 @@
 #include <vector>
 #include <glm/fwd.hpp>
 #include "uniformBufferObject.h"
+#include "streamingBuffer.h"
 
 namespace PGUPV {
   /* Clase que representa el conjunto de huesos de una malla animada. Es un bloque de 
@@ -42,6 +43,15 @@ namespace PGUPV {
 	static std::shared_ptr<UBOBones> build();
 
 	const std::vector<glm::mat4> &getBones() { return bones; }
+
+	/**
+	Actualiza las matrices de los huesos para el frame actual. Si la ventana tiene un
+	StreamingBuffer, se escriben en él (y use() vinculará ese trozo hasta el final del
+	frame). Si no, se escriben en este UBO.
+	\param b Matrices de los huesos
+	\param n Número de matrices (como mucho, MAX_BONES)
+	*/
+	void update(const glm::mat4 *b, size_t n);
 	
 	//! Establece estos huesos para usarlos en las siguientes llamadas de dibujo
 	void use();
@@ -53,6 +63,10 @@ namespace PGUPV {
 	UBOBones(UBOBones &m) = delete;
 	UBOBones & operator=(const UBOBones &m) = delete;
 	std::vector<glm::mat4> bones;
+	// Trozo del streaming buffer con las matrices del frame streamedFrame
+	std::weak_ptr<StreamingBuffer> stream;
+	StreamingBuffer::Allocation streamed;
+	unsigned long streamedFrame;
   };
 };
 
@@ -41,6 +41,7 @@ namespace PGUPV {
 	class LineChartWidget;
 	class Label;
 	class LogConsole;
+	class StreamingBuffer;
 
 	class Window {
 	public:
@@ -226,8 +227,17 @@ namespace PGUPV {
 		std::shared_ptr<LineChartWidget> fpsWidget, msPerFrameWidget, samplesPassedWidget, primitivesGeneratedWidget, verticesSubmittedWidget;
 		std::shared_ptr<LineChartWidget> primitivesSubmittedWidget, fragmentShaderInvWidget, clippingInWidget, clippingOutWidget;
 		std::shared_ptr<Label> vertexShaderInvWidget, tessControlShaderInvWidget, tessEvalShaderInvWidget, computeShaderInvWidget;
+		// Una gráfica por cada contador de RenderStats
+		std::vector<std::shared_ptr<LineChartWidget>> renderStatsWidgets;
+		// Memoria de los recursos (ResourceTracker)
+		std::shared_ptr<LineChartWidget> gpuMemoryWidget;
+		std::shared_ptr<Label> gpuMemoryLabel, cpuMemoryLabel;
 
 		GLStats glstats;
+		// Datos que cambian en cada frame (se reutiliza cuando la GPU termina con ellos)
+		std::shared_ptr<StreamingBuffer> frameStream;
+		// Tamaño inicial de cada región de frameStream (crece si en un frame no cabe todo)
+		static const size_t FRAME_STREAM_SIZE = 1 << 20;
 
 		//// Gestores de eventos 
 		void onKeyboardEvent(const PGUPV::KeyboardEvent &e);
@@ -11,6 +11,7 @@
 #include "bone.h"
 #include "nodeCallback.h"
 #include "app.h"
+#include "renderStats.h"
 
 #include <glm/gtc/matrix_inverse.hpp>
 
@@ -27,6 +28,8 @@ class Updater : public PGUPV::NodeCallback {
 public:
 	Updater() {};
 	void operator()(Node &node, NodeVisitor &nv) override;
+	// Sólo avanza el tiempo del controlador de su propio nodo
+	bool isThreadSafe() const override { return true; }
 };
 
 void Updater::operator()(Node & node, NodeVisitor & nv)
@@ -61,6 +64,7 @@ public:
 		PGUPV::Skeleton &skeleton
 	) : animation(anim), boneMats(boneMatrices), skel(skeleton) {
 		matstack.setMatrix(currentWCS);
+		setNodePathMode(NodePathMode::RAW);
 	};
 
 	void apply(PGUPV::Transform &transform) override {
@@ -89,6 +93,7 @@ private:
 
 void AnimationNode::render()
 {
+	PGUPV::RenderStats::increment(PGUPV::RenderStats::Counter::NodesVisited);
 	std::vector<glm::mat4> boneMatrices(UBOBones::MAX_BONES, glm::mat4(1.0f));
 
 	auto mats = std::dynamic_pointer_cast<GLMatrices>(gl_uniform_buffer.getBound(UBO_GL_MATRICES_BINDING_INDEX));
@@ -111,8 +116,7 @@ void AnimationNode::render()
 		if (nBones == 0 || !ubobones) {
 			continue;
 		}
-		gl_uniform_buffer.bindBufferBase(ubobones, UBO_BONES_BINDING_INDEX);
-		gl_uniform_buffer.write((void *)&boneMatrices[0], nBones * sizeof(glm::mat4), 0);
+		ubobones->update(&boneMatrices[0], nBones);
 
 		mats->pushMatrix(GLMatrices::MODEL_MATRIX);
 		auto itWCS = worldMatrix.find(m);
@@ -170,6 +174,7 @@ public:
 		allMeshes.clear();
 		WCS.clear();
 		inverseWCS.clear();
+		setNodePathMode(NodePathMode::RAW);
 	};
 	void apply(PGUPV::Transform &transform) override {
 		if (!transform.getBB().isValid())
@@ -9,6 +9,7 @@
 #include "eventProcessor.h"
 #include "gamepad.h"
 #include "statsClass.h"
+#include "renderStats.h"
 #include "utils.h"
 #include "commandLineProcessor.h"
 #include "windowBuilder.h"
@@ -29,6 +30,7 @@ using PGUPV::Log;
 using PGUPV::Renderer;
 using PGUPV::Keyboard;
 using PGUPV::StatsClass;
+using PGUPV::RenderStats;
 using PGUPV::StopWatch;
 using PGUPV::CommandLineProcessor;
 using PGUPV::GLVersion;
@@ -594,7 +596,10 @@ int App::run() {
 		//for (auto w : m_windows)
 		//  w->reshaped(w->width(), w->height());
 		stats->pushValue("Frame #").pushValue("Events (us)").pushValue("Update (us)").pushValue("Client Render (us)")
-			.pushValue("GUI Render (us)").pushValue("Swap buffers (us)").pushValue("Total (us)").endFrame();
+			.pushValue("GUI Render (us)").pushValue("Swap buffers (us)").pushValue("Total (us)");
+		for (unsigned int c = 0; c < RenderStats::NCounters; c++)
+			stats->pushValue(RenderStats::getName(static_cast<RenderStats::Counter>(c)));
+		stats->endFrame();
 		auto frameStopWatch = stats->makeStopWatch();
 		while (!_appDone) {
 			FRAME("Empezando a dibujar el frame " + std::to_string(_current_frame));
@@ -616,7 +621,10 @@ int App::run() {
 				// TODO ¿qué pasa cuando hay varias ventanas?
 				m_windows[0]->saveColorBuffer(buildFrameName("frame", _current_frame));
 			}
-			stats->pushValue(std::to_string(frameStopWatch->getElapsed())).endFrame();
+			stats->pushValue(std::to_string(frameStopWatch->getElapsed()));
+			for (unsigned int c = 0; c < RenderStats::NCounters; c++)
+				stats->pushValue(std::to_string(RenderStats::getValue(static_cast<RenderStats::Counter>(c))));
+			stats->endFrame();
 			if (ftl == static_cast<int64_t>(_current_frame)) {
 				return 0;
 			}
@@ -1,6 +1,7 @@
 
 #include <fstream>
 #include <bitset>
+#include <cmath>
 
 #include <filesystem>
 
@@ -29,6 +30,11 @@
 #include "skeleton.h"
 #include "material.h"
 #include "pbrMaterial.h"
+#include "nodePool.h"
+#include "lod.h"
+#include "meshSimplifier.h"
+#include "meshOptimizer.h"
+#include "resourceTracker.h"
 
 using PGUPV::AssimpWrapper;
 using PGUPV::Node;
@@ -52,14 +58,27 @@ using std::endl;
 class AssimpWrapper::AssimpWrapperImpl {
 public:
 	AssimpWrapperImpl() :
-		scene(nullptr) {
+		scene(nullptr), lodLevels(0), lodRatio(0.5f), lodMinTriangles(0), lodScreenSize(0.5f),
+		interleavedMeshes(false), optimizeMeshes(false), compressMeshes(false), quantizePositions(false) {
 	}
 	std::shared_ptr<Scene> load(const string& filename, LoadOptions options);
 	std::vector<ExportFileFormat> listSupportedExportFormat();
 	bool save(const std::string& path, const std::string& id, std::shared_ptr<Scene> scene);
+	std::shared_ptr<PGUPV::NodePool> nodePool;
+	unsigned int lodLevels;
+	float lodRatio;
+	size_t lodMinTriangles;
+	float lodScreenSize;
+	bool interleavedMeshes;
+	bool optimizeMeshes;
+	bool compressMeshes;
+	bool quantizePositions;
 protected:
 	void loadMaterials();
 	void loadMeshes();
+	void loadInterleavedVertices(const struct aiMesh* mesh, Mesh& mymesh);
+	void optimizeMesh(struct aiMesh* mesh);
+	void loadCompressedVertices(const struct aiMesh* mesh, Mesh& mymesh);
 	void saveMeshes(aiScene* assScene, Scene& scene);
 	void loadAnimations();
 	void loadTextures(const aiMaterial* aimat, Material& pgmat);
@@ -75,6 +94,10 @@ protected:
 	static Assimp::Importer importer;
 	std::unique_ptr<Assimp::Exporter> exporter;
 	std::vector<std::shared_ptr<Mesh>> tempMeshes;
+	// Niveles de detalle generados para cada malla de tempMeshes (vacío si no se ha simplificado)
+	std::vector<std::vector<std::shared_ptr<Mesh>>> tempLODMeshes;
+	std::vector<std::shared_ptr<Mesh>> buildLODMeshes(const struct aiMesh* mesh, const Mesh& mymesh);
+	std::shared_ptr<Node> buildLODNode(const struct aiNode* nd, std::shared_ptr<Geode> geode);
 };
 
 Assimp::Importer AssimpWrapper::AssimpWrapperImpl::importer;
@@ -107,6 +130,35 @@ bool AssimpWrapper::save(const std::string& path, const std::string& id, std::sh
 	return impl->save(path, id, scene);
 }
 
+void AssimpWrapper::setNodePool(std::shared_ptr<PGUPV::NodePool> pool)
+{
+	impl->nodePool = pool;
+}
+
+void AssimpWrapper::setLODGeneration(unsigned int levels, float ratio, size_t minTriangles, float screenSize)
+{
+	impl->lodLevels = levels;
+	impl->lodRatio = ratio;
+	impl->lodMinTriangles = minTriangles;
+	impl->lodScreenSize = screenSize;
+}
+
+void AssimpWrapper::setInterleavedMeshes(bool interleaved)
+{
+	impl->interleavedMeshes = interleaved;
+}
+
+void AssimpWrapper::setMeshOptimization(bool optimize)
+{
+	impl->optimizeMeshes = optimize;
+}
+
+void AssimpWrapper::setMeshCompression(bool compress, bool quantizePositions)
+{
+	impl->compressMeshes = compress;
+	impl->quantizePositions = quantizePositions;
+}
+
 
 std::shared_ptr<Scene> AssimpWrapper::AssimpWrapperImpl::load(const string& filename, LoadOptions options)
 {
@@ -149,12 +201,20 @@ std::shared_ptr<Scene> AssimpWrapper::AssimpWrapperImpl::load(const string& file
 		INFO("El modelo " + filename + " no tiene animaciones");
 	}
 
+	// La memoria de los recursos del modelo se apunta en un grupo con el nombre del fichero
+	PGUPV::ResourceTracker::Group memoryGroup(std::filesystem::path(filename).filename().string());
 	loadMaterials();
 	loadMeshes();
 	loadAnimations();
 
-	result->setRoot(recursive_load(scene->mRootNode));
+	if (nodePool) {
+		PGUPV::NodePool::Scope poolScope(nodePool);
+		result->setRoot(recursive_load(scene->mRootNode));
+	}
+	else
+		result->setRoot(recursive_load(scene->mRootNode));
 	tempMeshes.clear();
+	tempLODMeshes.clear();
 	return result;
 }
 
@@ -188,13 +248,14 @@ std::vector<PGUPV::ExportFileFormat> AssimpWrapper::AssimpWrapperImpl::listSuppo
 std::shared_ptr<Node> AssimpWrapper::AssimpWrapperImpl::recursive_load(const struct aiNode* nd) {
 	if (nd == nullptr) return nullptr;
 
-	std::shared_ptr<Geode> geode;
+	std::shared_ptr<Node> geode;
 	if (nd->mNumMeshes > 0) {
-		geode = Geode::build();
-		geode->setName(nd->mName.C_Str());
+		auto g = Geode::build();
+		g->setName(nd->mName.C_Str());
 		// draw all meshes assigned to this node
 		for (unsigned int n = 0; n < nd->mNumMeshes; ++n)
-			geode->addMesh(tempMeshes[nd->mMeshes[n]]);
+			g->addMesh(tempMeshes[nd->mMeshes[n]]);
+		geode = buildLODNode(nd, g);
 	}
 
 	if (nd->mMetaData) {
@@ -233,6 +294,74 @@ std::shared_ptr<Node> AssimpWrapper::AssimpWrapperImpl::recursive_load(const str
 	return root;
 }
 
+std::shared_ptr<Node> AssimpWrapper::AssimpWrapperImpl::buildLODNode(const struct aiNode* nd, std::shared_ptr<Geode> geode) {
+	size_t levels = 0;
+	for (unsigned int n = 0; n < nd->mNumMeshes; ++n)
+		levels = std::max(levels, tempLODMeshes[nd->mMeshes[n]].size());
+	if (levels == 0)
+		return geode;
+
+	auto lod = PGUPV::LOD::build();
+	lod->setName(nd->mName.C_Str());
+	// Al reducir los triángulos a ratio, sus aristas se reducen a sqrt(ratio), así que sus
+	// tamaños en pantalla se mantienen si los umbrales se reducen en la misma proporción
+	auto step = std::sqrt(lodRatio);
+	auto threshold = lodScreenSize;
+	lod->addLevel(geode, threshold);
+	for (size_t l = 0; l < levels; l++) {
+		auto g = Geode::build();
+		g->setName(std::string(nd->mName.C_Str()) + "_LOD" + std::to_string(l + 1));
+		for (unsigned int n = 0; n < nd->mNumMeshes; ++n) {
+			// Las mallas con menos niveles usan el más simple que tengan
+			const auto& chain = tempLODMeshes[nd->mMeshes[n]];
+			if (chain.empty())
+				g->addMesh(tempMeshes[nd->mMeshes[n]]);
+			else
+				g->addMesh(chain[std::min(l, chain.size() - 1)]);
+		}
+		threshold *= step;
+		lod->addLevel(g, l + 1 < levels ? threshold : 0.0f);
+	}
+	return lod;
+}
+
+std::vector<std::shared_ptr<Mesh>> AssimpWrapper::AssimpWrapperImpl::buildLODMeshes(const struct aiMesh* mesh, const Mesh& mymesh) {
+	if (lodLevels == 0 || mesh->mPrimitiveTypes != aiPrimitiveType_TRIANGLE || mesh->HasBones() ||
+		mesh->mNumFaces < lodMinTriangles)
+		return std::vector<std::shared_ptr<Mesh>>();
+
+	std::vector<glm::vec3> positions(mesh->mNumVertices), normals;
+	std::vector<glm::vec2> texCoords;
+	for (unsigned int k = 0; k < mesh->mNumVertices; ++k)
+		positions[k] = glm::vec3(mesh->mVertices[k].x, mesh->mVertices[k].y, mesh->mVertices[k].z);
+	if (mesh->HasNormals()) {
+		normals.resize(mesh->mNumVertices);
+		for (unsigned int k = 0; k < mesh->mNumVertices; ++k)
+			normals[k] = glm::vec3(mesh->mNormals[k].x, mesh->mNormals[k].y, mesh->mNormals[k].z);
+	}
+	if (mesh->HasTextureCoords(0)) {
+		texCoords.resize(mesh->mNumVertices);
+		for (unsigned int k = 0; k < mesh->mNumVertices; ++k)
+			texCoords[k] = glm::vec2(mesh->mTextureCoords[0][k].x, mesh->mTextureCoords[0][k].y);
+	}
+	std::vector<PGUPV::TriangleIndices> triangles(mesh->mNumFaces);
+	for (unsigned int t = 0; t < mesh->mNumFaces; ++t) {
+		const auto& f = mesh->mFaces[t];
+		triangles[t] = PGUPV::TriangleIndices(f.mIndices[0], f.mIndices[1], f.mIndices[2]);
+	}
+
+	PGUPV::MeshSimplifier simplifier(std::move(positions), std::move(triangles), std::move(normals),
+		std::move(texCoords));
+	auto chain = simplifier.buildChain(lodLevels, lodRatio);
+	for (size_t l = 0; l < chain.size(); l++) {
+		chain[l]->setName(mymesh.getName() + "_LOD" + std::to_string(l + 1));
+		chain[l]->setMaterial(mymesh.getMaterial());
+	}
+	INFO("Generados " + std::to_string(chain.size()) + " niveles de detalle de la malla " + mymesh.getName() +
+		(chain.empty() ? "" : " (" + std::to_string(simplifier.getNumTriangles()) + " triángulos en el último)"));
+	return chain;
+}
+
 #define P(a) {a, #a}
 std::map<aiTextureType, std::string> aiTextureTypes{
   P(aiTextureType_NONE), P(aiTextureType_DIFFUSE), P(aiTextureType_SPECULAR), P(aiTextureType_AMBIENT), P(aiTextureType_EMISSIVE),
@@ -248,21 +377,31 @@ void AssimpWrapper::AssimpWrapperImpl::loadMeshes() {
 		const struct aiMesh* mesh = scene->mMeshes[n];
 
 		mymesh->setName(mesh->mName.C_Str());
+		PGUPV::ResourceTracker::Group memoryGroup(mesh->mName.length > 0 ?
+			std::string(mesh->mName.C_Str()) : "Malla " + std::to_string(n));
 
 		INFO(printMeshInfo(scene, n));
 
+		// Se reordena la malla de Assimp, para que el resto de la carga (huesos, niveles de
+		// detalle...) use el mismo orden
+		if (optimizeMeshes && mesh->mPrimitiveTypes == aiPrimitiveType_TRIANGLE)
+			optimizeMesh(scene->mMeshes[n]);
+
 		size_t numVertPerFace;
+		// Índices de 16 bits si caben
+		const bool shortIndices = compressMeshes && mesh->mNumVertices < 65536;
+		const GLenum indexType = shortIndices ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
 
 		switch (mesh->mPrimitiveTypes) {
 		case aiPrimitiveType_TRIANGLE:
 			numVertPerFace = 3;
 			mymesh->addDrawCommand(
-				new DrawElements(GL_TRIANGLES, static_cast<GLsizei>(mesh->mNumFaces * numVertPerFace), GL_UNSIGNED_INT, 0));
+				new DrawElements(GL_TRIANGLES, static_cast<GLsizei>(mesh->mNumFaces * numVertPerFace), indexType, 0));
 			break;
 		case aiPrimitiveType_LINE:
 			numVertPerFace = 2;
 			mymesh->addDrawCommand(
-				new DrawElements(GL_LINES, static_cast<GLsizei>(mesh->mNumFaces * numVertPerFace), GL_UNSIGNED_INT, 0));
+				new DrawElements(GL_LINES, static_cast<GLsizei>(mesh->mNumFaces * numVertPerFace), indexType, 0));
 			break;
 		case aiPrimitiveType_POINT:
 			numVertPerFace = 1;
@@ -282,18 +421,43 @@ void AssimpWrapper::AssimpWrapperImpl::loadMeshes() {
 				memcpy(&faceArray[faceIndex], face->mIndices, numVertPerFace * sizeof(unsigned int));
 				faceIndex += numVertPerFace;
 			}
-			mymesh->addIndices(faceArray);
+			if (shortIndices)
+				mymesh->addIndices(std::vector<GLushort>(faceArray.begin(), faceArray.end()));
+			else
+				mymesh->addIndices(faceArray);
+		}
+		if (interleavedMeshes && mesh->HasPositions()) {
+			loadInterleavedVertices(mesh, *mymesh);
 		}
-		// buffer for vertex positions
-		if (mesh->HasPositions())
-			mymesh->addVertices((GLfloat*)mesh->mVertices, 3, mesh->mNumVertices);
+		else if (compressMeshes && mesh->HasPositions()) {
+			loadCompressedVertices(mesh, *mymesh);
+		}
+		else {
+			// buffer for vertex positions
+			if (mesh->HasPositions())
+				mymesh->addVertices((GLfloat*)mesh->mVertices, 3, mesh->mNumVertices);
 
-		// buffer for vertex normals
-		if (mesh->HasNormals())
-			mymesh->addNormals((GLfloat*)mesh->mNormals, mesh->mNumVertices);
+			// buffer for vertex normals
+			if (mesh->HasNormals())
+				mymesh->addNormals((GLfloat*)mesh->mNormals, mesh->mNumVertices);
+
+			if (mesh->HasTangentsAndBitangents()) {
+				mymesh->addTangents((GLfloat*)mesh->mTangents, mesh->mNumVertices);
+			}
 
-		if (mesh->HasTangentsAndBitangents()) {
-			mymesh->addTangents((GLfloat*)mesh->mTangents, mesh->mNumVertices);
+			// buffer for vertex texture coordinates
+			for (unsigned int idx = 0; idx < NUM_TEX_COORD; ++idx) {
+				if (mesh->HasTextureCoords(idx)) {
+					std::vector<glm::vec2> texCoords(mesh->mNumVertices);
+					for (unsigned int k = 0; k < mesh->mNumVertices; ++k) {
+						texCoords[k].s = mesh->mTextureCoords[0][k].x;
+						texCoords[k].t = mesh->mTextureCoords[0][k].y;
+					}
+					mymesh->addTexCoord(idx, texCoords);
+				}
+				else
+					break;
+			}
 		}
 
 		if (mesh->HasBones()) {
@@ -302,22 +466,164 @@ void AssimpWrapper::AssimpWrapperImpl::loadMeshes() {
 			mymesh->setSkeleton(skeleton);
 		}
 
-		// buffer for vertex texture coordinates
-		for (unsigned int idx = 0; idx < NUM_TEX_COORD; ++idx) {
-			if (mesh->HasTextureCoords(idx)) {
-				std::vector<glm::vec2> texCoords(mesh->mNumVertices);
-				for (unsigned int k = 0; k < mesh->mNumVertices; ++k) {
-					texCoords[k].s = mesh->mTextureCoords[0][k].x;
-					texCoords[k].t = mesh->mTextureCoords[0][k].y;
-				}
-				mymesh->addTexCoord(idx, texCoords);
+		mymesh->setMaterial(result->getMaterial(mesh->mMaterialIndex));
+		tempMeshes.push_back(mymesh);
+		tempLODMeshes.push_back(buildLODMeshes(mesh, *mymesh));
+	}
+}
+
+// Aplica MeshOptimizer a los triángulos y a todos los atributos de los vértices de la malla
+void AssimpWrapper::AssimpWrapperImpl::optimizeMesh(struct aiMesh* mesh) {
+	using PGUPV::MeshOptimizer;
+
+	std::vector<uint32_t> indices;
+	indices.reserve(mesh->mNumFaces * 3);
+	for (unsigned int t = 0; t < mesh->mNumFaces; ++t) {
+		const auto& f = mesh->mFaces[t];
+		indices.insert(indices.end(), f.mIndices, f.mIndices + 3);
+	}
+	std::vector<glm::vec3> positions(mesh->mNumVertices);
+	for (unsigned int k = 0; k < mesh->mNumVertices; ++k)
+		positions[k] = glm::vec3(mesh->mVertices[k].x, mesh->mVertices[k].y, mesh->mVertices[k].z);
+
+	auto before = MeshOptimizer::analyzeVertexCache(indices, mesh->mNumVertices);
+	indices = MeshOptimizer::optimizeVertexCache(indices, mesh->mNumVertices);
+	indices = MeshOptimizer::optimizeOverdraw(indices, positions);
+	auto remap = MeshOptimizer::optimizeVertexFetch(indices, mesh->mNumVertices);
+	auto after = MeshOptimizer::analyzeVertexCache(indices, mesh->mNumVertices);
+
+	for (unsigned int t = 0; t < mesh->mNumFaces; ++t)
+		std::copy(indices.begin() + t * 3, indices.begin() + t * 3 + 3, mesh->mFaces[t].mIndices);
+
+	auto remapVertices = [&remap, mesh](auto* data) {
+		if (data)
+			MeshOptimizer::remapVertices(data, mesh->mNumVertices, remap);
+	};
+	remapVertices(mesh->mVertices);
+	remapVertices(mesh->mNormals);
+	remapVertices(mesh->mTangents);
+	remapVertices(mesh->mBitangents);
+	for (unsigned int i = 0; i < AI_MAX_NUMBER_OF_TEXTURECOORDS; i++)
+		remapVertices(mesh->mTextureCoords[i]);
+	for (unsigned int i = 0; i < AI_MAX_NUMBER_OF_COLOR_SETS; i++)
+		remapVertices(mesh->mColors[i]);
+	for (unsigned int a = 0; a < mesh->mNumAnimMeshes; a++) {
+		auto anim = mesh->mAnimMeshes[a];
+		remapVertices(anim->mVertices);
+		remapVertices(anim->mNormals);
+		remapVertices(anim->mTangents);
+		remapVertices(anim->mBitangents);
+		for (unsigned int i = 0; i < AI_MAX_NUMBER_OF_TEXTURECOORDS; i++)
+			remapVertices(anim->mTextureCoords[i]);
+		for (unsigned int i = 0; i < AI_MAX_NUMBER_OF_COLOR_SETS; i++)
+			remapVertices(anim->mColors[i]);
+	}
+	for (unsigned int b = 0; b < mesh->mNumBones; b++) {
+		auto bone = mesh->mBones[b];
+		for (unsigned int w = 0; w < bone->mNumWeights; w++)
+			bone->mWeights[w].mVertexId = remap[bone->mWeights[w].mVertexId];
+	}
+
+	std::ostringstream os;
+	os.precision(3);
+	os << "Malla " << mesh->mName.C_Str() << " optimizada: ACMR " << before.acmr << " -> " << after.acmr
+		<< ", ATVR " << before.atvr << " -> " << after.atvr;
+	INFO(os.str());
+}
+
+// Copia en un solo buffer la posición, la normal, la tangente y las coordenadas de textura
+// de cada vértice. Los huesos se siguen guardando en sus propios buffers (ver Mesh::setSkeleton).
+// Si compressMeshes es true, las normales y las tangentes se empaquetan en 32 bits y las
+// coordenadas de textura en floats de 16 bits
+void AssimpWrapper::AssimpWrapperImpl::loadInterleavedVertices(const struct aiMesh* mesh, Mesh& mymesh) {
+	std::vector<Mesh::InterleavedAttribute> attribs;
+	GLuint stride = 0;
+	auto addAttribute = [&attribs, &stride](uint index, GLint ncomponents, GLenum type, GLuint size,
+		GLboolean normalized) {
+		attribs.push_back(Mesh::InterleavedAttribute{ index, ncomponents, type, stride, normalized, false });
+		stride += size;
+	};
+	addAttribute(Mesh::VERTICES, 3, GL_FLOAT, 3 * sizeof(GLfloat), GL_FALSE);
+	auto addDirection = [this, &addAttribute](uint index) {
+		if (compressMeshes)
+			addAttribute(index, 4, GL_INT_2_10_10_10_REV, sizeof(uint32_t), GL_TRUE);
+		else
+			addAttribute(index, 3, GL_FLOAT, 3 * sizeof(GLfloat), GL_FALSE);
+	};
+	if (mesh->HasNormals())
+		addDirection(Mesh::NORMALS);
+	if (mesh->HasTangentsAndBitangents())
+		addDirection(Mesh::TANGENTS);
+	unsigned int numTexCoords = 0;
+	while (numTexCoords < NUM_TEX_COORD && mesh->HasTextureCoords(numTexCoords)) {
+		if (compressMeshes)
+			addAttribute(Mesh::TEX_COORD0 + numTexCoords, 2, GL_HALF_FLOAT, 2 * sizeof(uint16_t), GL_FALSE);
+		else
+			addAttribute(Mesh::TEX_COORD0 + numTexCoords, 2, GL_FLOAT, 2 * sizeof(GLfloat), GL_FALSE);
+		numTexCoords++;
+	}
+
+	std::vector<char> data(mesh->mNumVertices * stride);
+	char* dst = data.data();
+	auto write = [&dst](const void* src, size_t size) {
+		memcpy(dst, src, size);
+		dst += size;
+	};
+	auto writeDirection = [this, &write](const aiVector3D& v) {
+		if (compressMeshes) {
+			auto packed = Mesh::packSnorm1010102(glm::vec3(v.x, v.y, v.z));
+			write(&packed, sizeof(packed));
+		}
+		else {
+			GLfloat f[3] = { v.x, v.y, v.z };
+			write(f, sizeof(f));
+		}
+	};
+	for (unsigned int k = 0; k < mesh->mNumVertices; ++k) {
+		GLfloat position[3] = { mesh->mVertices[k].x, mesh->mVertices[k].y, mesh->mVertices[k].z };
+		write(position, sizeof(position));
+		if (mesh->HasNormals())
+			writeDirection(mesh->mNormals[k]);
+		if (mesh->HasTangentsAndBitangents())
+			writeDirection(mesh->mTangents[k]);
+		for (unsigned int t = 0; t < numTexCoords; t++) {
+			const auto& tc = mesh->mTextureCoords[t][k];
+			if (compressMeshes) {
+				uint16_t h[2] = { Mesh::packHalfFloat(tc.x), Mesh::packHalfFloat(tc.y) };
+				write(h, sizeof(h));
+			}
+			else {
+				GLfloat f[2] = { tc.x, tc.y };
+				write(f, sizeof(f));
 			}
-			else
-				break;
 		}
+	}
+	mymesh.setInterleavedVertices(data.data(), mesh->mNumVertices, static_cast<GLsizei>(stride), attribs);
+}
 
-		mymesh->setMaterial(result->getMaterial(mesh->mMaterialIndex));
-		tempMeshes.push_back(mymesh);
+// Versión comprimida de los atributos de los vértices, en un buffer por atributo
+void AssimpWrapper::AssimpWrapperImpl::loadCompressedVertices(const struct aiMesh* mesh, Mesh& mymesh) {
+	auto toVec3 = [mesh](const aiVector3D* src) {
+		std::vector<glm::vec3> dst(mesh->mNumVertices);
+		for (unsigned int k = 0; k < mesh->mNumVertices; ++k)
+			dst[k] = glm::vec3(src[k].x, src[k].y, src[k].z);
+		return dst;
+	};
+	// Las matrices de los huesos se aplican antes que la de descompresión
+	if (quantizePositions && !mesh->HasBones())
+		mymesh.addQuantizedVertices(toVec3(mesh->mVertices));
+	else
+		mymesh.addVertices((GLfloat*)mesh->mVertices, 3, mesh->mNumVertices);
+
+	if (mesh->HasNormals())
+		mymesh.addPackedNormals(toVec3(mesh->mNormals));
+	if (mesh->HasTangentsAndBitangents())
+		mymesh.addPackedTangents(toVec3(mesh->mTangents));
+	for (unsigned int idx = 0; idx < NUM_TEX_COORD && mesh->HasTextureCoords(idx); ++idx) {
+		std::vector<glm::vec2> texCoords(mesh->mNumVertices);
+		for (unsigned int k = 0; k < mesh->mNumVertices; ++k)
+			texCoords[k] = glm::vec2(mesh->mTextureCoords[idx][k].x, mesh->mTextureCoords[idx][k].y);
+		mymesh.addHalfTexCoord(idx, texCoords);
 	}
 }
 
@@ -542,6 +848,10 @@ void AssimpWrapper::AssimpWrapperImpl::loadMaterials() {
 	/* scan scene's materials for textures */
 	for (unsigned int i = 0; i < scene->mNumMaterials; ++i) {
 		struct aiMaterial* mtl = scene->mMaterials[i];
+		aiString mtlName;
+		mtl->Get(AI_MATKEY_NAME, mtlName);
+		PGUPV::ResourceTracker::Group memoryGroup(mtlName.length > 0 ?
+			std::string(mtlName.C_Str()) : "Material " + std::to_string(i));
 		if (isPBR(mtl)) {
 			auto mat = loadPBRMaterial(mtl);
 			loadPBRTextures(mtl, *mat);
@@ -6,15 +6,20 @@
 //  Copyright (c) 2013 Paco Abad. All rights reserved.
 //
 
+#include <algorithm>
+
 #include "log.h"
 #include "bindableTexture.h"
 #include "utils.h"
+#include "glStateTracker.h"
+#include "resourceTracker.h"
 
 using PGUPV::BindableTexture;
+using PGUPV::ResourceTracker;
 using std::string;
 
 BindableTexture::BindableTexture(GLenum texture_type)
-	: _ready(false), _texture_type(texture_type), _textureUnitBound(-1) {
+	: _ready(false), _texture_type(texture_type), _textureUnitBound(-1), _memoryId(0) {
 	glGenTextures(1, &_texId);
 #ifdef _DEBUG
 #define TARGET(b)                                                              \
@@ -45,6 +50,8 @@ BindableTexture::BindableTexture(GLenum texture_type)
 
 BindableTexture::~BindableTexture() {
     glDeleteTextures(1, &_texId);
+    PGUPV::GLStateTracker::forgetTexture(_texId);
+    ResourceTracker::remove(_memoryId);
     INFO("Textura con id " + std::to_string(_texId) + " destruída");
 }
 
@@ -53,8 +60,7 @@ void BindableTexture::bind(GLenum textureUnit) {
 		ERRT("No se puede vincular una textura no preparada. "
 		"Llama antes a loadImage y comprueba que haya funcionado");
 
-	glActiveTexture(textureUnit);
-	glBindTexture(_texture_type, _texId);
+	PGUPV::GLStateTracker::bindTextureToUnit(textureUnit, _texture_type, _texId);
 	_textureUnitBound = textureUnit;
 	FRAME("Textura " + std::to_string(_texId) +
 		" conectada en unidad de textura " +
@@ -66,13 +72,72 @@ void BindableTexture::unbind() {
 	if (!_ready || _textureUnitBound == -1)
 		ERRT("No se puede desvincular una textura no vinculada");
 
-	glActiveTexture(_textureUnitBound);
-	glBindTexture(_texture_type, 0);
+	PGUPV::GLStateTracker::bindTextureToUnit(_textureUnitBound, _texture_type, 0);
 	_textureUnitBound = -1;
 	FRAME("Textura " + std::to_string(_texId) +
 		" desconectada de la unidad de textura");
 }
 
+void BindableTexture::setName(const std::string &name) {
+	_name = name;
+	ResourceTracker::setLabel(_memoryId, _name);
+}
+
+void BindableTexture::updateMemoryUsage() {
+	GLenum target = _texture_type;
+	unsigned int faces = 1;
+	if (target == GL_TEXTURE_CUBE_MAP) {
+		// El tamaño se pregunta a cada cara
+		target = GL_TEXTURE_CUBE_MAP_POSITIVE_X;
+		faces = 6;
+	}
+	else if (target == GL_TEXTURE_BUFFER) {
+		// La memoria es la del buffer object, que ya se ha apuntado
+		return;
+	}
+
+	size_t bytes = 0;
+	for (GLint level = 0; level < 32; level++) {
+		GLint width = 0, height = 0, depth = 0;
+		glGetTexLevelParameteriv(target, level, GL_TEXTURE_WIDTH, &width);
+		if (width == 0)
+			break;
+		glGetTexLevelParameteriv(target, level, GL_TEXTURE_HEIGHT, &height);
+		glGetTexLevelParameteriv(target, level, GL_TEXTURE_DEPTH, &depth);
+
+		GLint compressed = GL_FALSE;
+		glGetTexLevelParameteriv(target, level, GL_TEXTURE_COMPRESSED, &compressed);
+		if (compressed) {
+			GLint size = 0;
+			glGetTexLevelParameteriv(target, level, GL_TEXTURE_COMPRESSED_IMAGE_SIZE, &size);
+			bytes += size;
+			continue;
+		}
+
+		static const GLenum channels[] = { GL_TEXTURE_RED_SIZE, GL_TEXTURE_GREEN_SIZE,
+			GL_TEXTURE_BLUE_SIZE, GL_TEXTURE_ALPHA_SIZE, GL_TEXTURE_DEPTH_SIZE, GL_TEXTURE_STENCIL_SIZE };
+		GLint bits = 0;
+		for (auto c : channels) {
+			GLint b = 0;
+			glGetTexLevelParameteriv(target, level, c, &b);
+			bits += b;
+		}
+		GLint samples = 0;
+		if (_texture_type == GL_TEXTURE_2D_MULTISAMPLE || _texture_type == GL_TEXTURE_2D_MULTISAMPLE_ARRAY)
+			glGetTexLevelParameteriv(target, level, GL_TEXTURE_SAMPLES, &samples);
+		bytes += static_cast<size_t>(width) * std::max(height, 1) * std::max(depth, 1) *
+			std::max(samples, 1) * ((bits + 7) / 8);
+	}
+	bytes *= faces;
+
+	if (_memoryId) {
+		ResourceTracker::setSize(_memoryId, bytes);
+		ResourceTracker::setLabel(_memoryId, _name);
+	}
+	else
+		_memoryId = ResourceTracker::add(ResourceTracker::Category::Textures, bytes, _name);
+}
+
 void BindableTexture::clear(int level, GLenum format, GLenum type, const void *data) {
 	glClearTexImage(getId(), level, format, type, data);
 }
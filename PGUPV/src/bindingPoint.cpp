@@ -2,6 +2,7 @@
 #include "utils.h"
 #include "bufferObject.h"
 #include "log.h"
+#include "glStateTracker.h"
 
 using PGUPV::BindingPoint;
 using PGUPV::BufferObject;
@@ -19,7 +20,7 @@ PGUPV::gl_dispatch_indirect_buffer(GL_DISPATCH_INDIRECT_BUFFER); // GL 4.3
 
 std::shared_ptr<BufferObject> BindingPoint::bind(std::shared_ptr<BufferObject> bo) {
 	std::shared_ptr<BufferObject> prev = bound.lock();
-	glBindBuffer(GL_bindingPoint, bo ? bo->getId() : 0);
+	PGUPV::GLStateTracker::bindBuffer(GL_bindingPoint, bo ? bo->getId() : 0);
 	bound = bo;
 	return prev;
 }
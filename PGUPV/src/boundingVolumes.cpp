@@ -18,6 +18,7 @@
 
 using PGUPV::BoundingBox;
 using PGUPV::BoundingSphere;
+using PGUPV::Frustum;
 using glm::vec3;
 
 BoundingBox PGUPV::computeBoundingBox(const std::vector<glm::vec3>& vtcs)
@@ -86,31 +87,57 @@ BoundingSphere PGUPV::computeBoundingSphere(const float *v, uint ncomponents,
 	return sphere;
 }
 
-glm::bvec3 and3(const glm::bvec3& a, const glm::bvec3& b) {
-	return glm::bvec3{
-		a.x && b.x,
-		a.y && b.y,
-		a.z && b.z
-	};
-}
-
 bool PGUPV::overlapsViewVolume(const BoundingBox& bb, const glm::mat4& mvp)
 {
 	if (!bb.isValid())
 		return false;
 
-	auto vtcs = bb.getVertices();
-	glm::bvec3 lt{ true }, gt{ true };
-	size_t i;
-	for (i = 0; i < vtcs.size(); i++) {
-		auto v4 = mvp * vtcs[i];
-		auto v3 = glm::vec3(v4 / v4.w);
-		lt = and3(lt, glm::lessThan(v3, glm::vec3(-v4.w)));
-		gt = and3(gt, glm::greaterThan(v3, glm::vec3(v4.w)));
-		if (!(glm::any(lt) || glm::any(gt)))
-			return true;
+	return Frustum(mvp).intersects(bb);
+}
+
+Frustum::Frustum(const glm::mat4 &mvp) {
+	// Las filas de la matriz (glm almacena las matrices por columnas)
+	glm::vec4 row[4];
+	for (int i = 0; i < 4; i++) {
+		row[i] = glm::vec4(mvp[0][i], mvp[1][i], mvp[2][i], mvp[3][i]);
+	}
+	planes[0] = row[3] + row[0];
+	planes[1] = row[3] - row[0];
+	planes[2] = row[3] + row[1];
+	planes[3] = row[3] - row[1];
+	planes[4] = row[3] + row[2];
+	planes[5] = row[3] - row[2];
+	// Normalizamos los planos para poder medir distancias (necesario para las esferas)
+	for (auto &p : planes) {
+		float l = glm::length(glm::vec3(p));
+		if (l > 0.0f)
+			p /= l;
+	}
+}
+
+bool Frustum::intersects(const BoundingSphere &s) const {
+	if (!s.isValid())
+		return false;
+	for (const auto &p : planes) {
+		if (glm::dot(glm::vec3(p), s.center) + p.w < -s.radius)
+			return false;
+	}
+	return true;
+}
+
+bool Frustum::intersects(const BoundingBox &b) const {
+	if (!b.isValid())
+		return false;
+	for (const auto &p : planes) {
+		// La esquina de la caja más alejada en la dirección de la normal del plano
+		glm::vec3 farthest(
+			p.x >= 0.0f ? b.max.x : b.min.x,
+			p.y >= 0.0f ? b.max.y : b.min.y,
+			p.z >= 0.0f ? b.max.z : b.min.z);
+		if (glm::dot(glm::vec3(p), farthest) + p.w < 0.0f)
+			return false;
 	}
-	return false;
+	return true;
 }
 
 BoundingBox::BoundingBox(glm::vec3 p, glm::vec3 q) {
@@ -3,11 +3,14 @@
 #include "bindingPoint.h"
 
 #include "log.h"
+#include "resourceTracker.h"
+#include "glStateTracker.h"
 
 using PGUPV::BufferObject;
+using PGUPV::ResourceTracker;
 
 BufferObject::BufferObject(size_t size, GLenum usage)
-	: size(size), usage(usage) {
+	: size(size), usage(usage), memoryId(0) {
 	glGenBuffers(1, &id);
 	if (id == 0)
 		ERRT("No se ha podido crear el buffer. Inicializa OpenGL antes");
@@ -15,6 +18,8 @@ BufferObject::BufferObject(size_t size, GLenum usage)
 
 BufferObject::~BufferObject() { 
   glDeleteBuffers(1, &id); 
+  PGUPV::GLStateTracker::forgetBuffer(id);
+  ResourceTracker::remove(memoryId);
  
   INFO(getName() + " destruído");
 }
@@ -38,6 +43,7 @@ void BufferObject::allocate(std::shared_ptr<BufferObject> bo) {
 	std::shared_ptr<BufferObject> prev = PGUPV::gl_copy_write_buffer.bind(bo);
 	glBufferData(GL_COPY_WRITE_BUFFER, bo->size, NULL, bo->usage);
 	PGUPV::gl_copy_write_buffer.bind(prev);
+	bo->trackMemory();
   INFO(bo->getName() + " ha reservado " + std::to_string(bo->size) + " bytes");
 }
 
@@ -46,6 +52,7 @@ void BufferObject::allocateImmutable(std::shared_ptr<BufferObject> bo) {
 	std::shared_ptr<BufferObject> prev = PGUPV::gl_copy_write_buffer.bind(bo);
 	glBufferStorage(GL_COPY_WRITE_BUFFER, bo->size, NULL, bo->usage);
 	PGUPV::gl_copy_write_buffer.bind(prev);
+	bo->trackMemory();
 	INFO(bo->getName() + " (Inmutable) ha reservado " + std::to_string(bo->size) + " bytes");
 }
 
@@ -54,6 +61,14 @@ void BufferObject::setGlDebugLabel(const std::string &label) {
   if (glObjectLabel) {
     glObjectLabel(GL_BUFFER, id, -1, debugLabel.c_str());
   }
+  ResourceTracker::setLabel(memoryId, debugLabel);
+}
+
+void BufferObject::trackMemory() {
+  if (memoryId)
+    ResourceTracker::setSize(memoryId, size);
+  else
+    memoryId = ResourceTracker::add(ResourceTracker::Category::Buffers, size, debugLabel);
 }
 
 
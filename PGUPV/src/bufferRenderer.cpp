@@ -7,6 +7,7 @@
 #include "colorWheel.h"
 #include "log.h"
 #include "glStateCache.h"
+#include "glStateTracker.h"
 
 using namespace PGUPV;
 
@@ -94,18 +95,18 @@ void BufferRenderer::showBuffer() {
 	// Install our program and set our texture
 	auto prevShader = _shader.use();
 	glUniform1i(_stencilOrDepthUnitLoc, App::getScratchUnitTextureNumber());
-	glActiveTexture(GL_TEXTURE0 + App::getScratchUnitTextureNumber());
+	GLStateTracker::activeTexture(GL_TEXTURE0 + App::getScratchUnitTextureNumber());
 
 	switch (_window.getShownBuffer()) {
 	case Window::STENCIL_BUFFER:
 		updateStencilTexture();
 		glUniform1i(_showStencilLoc, 1);
-		glBindTexture(stencilTexture->getTextureType(), stencilTexture->getId());
+		GLStateTracker::bindTexture(stencilTexture->getTextureType(), stencilTexture->getId());
 		break;
 	case Window::DEPTH_BUFFER:
 		updateDepthTexture();
 		glUniform1i(_showStencilLoc, 0);
-		glBindTexture(depthStencilTex->getTextureType(), depthStencilTex->getId());
+		GLStateTracker::bindTexture(depthStencilTex->getTextureType(), depthStencilTex->getId());
 		break;
 	default:
 		break;
@@ -121,7 +122,7 @@ void BufferRenderer::showBuffer() {
 	// Restore the previous state
 	if (prevShader)
 		prevShader->use();
-	glActiveTexture(prevActiveTexture);
+	GLStateTracker::activeTexture(prevActiveTexture);
 	glDrawBuffer(prevDrawBuffer);
 	glReadBuffer(prevReadBuffer);
 
@@ -161,7 +162,7 @@ void BufferRenderer::updateStencilTexture() {
 		stencilTexture->allocate(_window.width(), _window.height(), GL_RGBA);
 	}
 
-	glBindTexture(stencilTexture->getTextureType(), stencilTexture->getId());
+	GLStateTracker::bindTexture(stencilTexture->getTextureType(), stencilTexture->getId());
 
 	glTexSubImage2D(stencilTexture->getTextureType(), 0, 0, 0, _window.width(),
 		_window.height(), GL_RGBA, GL_UNSIGNED_BYTE,
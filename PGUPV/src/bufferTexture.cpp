@@ -4,9 +4,11 @@
 #include "bindingPoint.h"
 #include "utils.h"
 #include "log.h"
+#include "glStateTracker.h"
 
 using PGUPV::BufferTexture;
 using PGUPV::BufferObject;
+using PGUPV::GLStateTracker;
 
 #ifdef _DEBUG
 static const GLenum acceptedFormats[] = {
@@ -39,7 +41,7 @@ BufferTexture::BufferTexture(GLenum internalFormat, size_t size, void *data,
 #endif
 	PGUPV::gl_texture_buffer.bind(bo);
 	PGUPV::gl_texture_buffer.write(data);
-	glBindTexture(GL_TEXTURE_BUFFER, getId());
+	GLStateTracker::bindTexture(GL_TEXTURE_BUFFER, getId());
 	glTexBuffer(GL_TEXTURE_BUFFER, _internalFormat, bo->getId());
 	_ready = true;
 }
@@ -52,7 +54,7 @@ BufferTexture::BufferTexture(GLenum internalFormat,
 	checkFormatAccepted(internalFormat);
 #endif
 	PGUPV::gl_texture_buffer.bind(bo);
-	glBindTexture(GL_TEXTURE_BUFFER, getId());
+	GLStateTracker::bindTexture(GL_TEXTURE_BUFFER, getId());
 	glTexBuffer(GL_TEXTURE_BUFFER, _internalFormat, bo->getId());
 	_ready = true;
 }
@@ -157,6 +157,8 @@ void Camera::setProjMatrix(const glm::mat4 & m) {
 void Camera::render() const {
 	if (!frustum) {
 		auto mesh = std::make_shared<Mesh>();
+		// Los vertices se sobrescriben en el buffer en cada cambio de la camara
+		mesh->setCPUMirror(false);
 		mesh->addVertices(std::vector<glm::vec4>(8, glm::vec4(0.0f)));
 
 		std::vector<ushort> indices{
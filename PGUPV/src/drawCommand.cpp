@@ -3,6 +3,8 @@
 #include <cstring>
 #include "drawCommand.h"
 #include "log.h"
+#include "renderStats.h"
+#include "glMatrices.h"
 
 using PGUPV::DrawCommand;
 using PGUPV::DrawArrays;
@@ -11,8 +13,30 @@ using PGUPV::MultiDrawArrays;
 using PGUPV::MultiDrawElements;
 using PGUPV::MultiDrawElementsBaseVertex;
 using PGUPV::TriangleIndices;
+using PGUPV::InstancedDrawCommand;
+using PGUPV::DrawArraysInstancedBaseInstance;
+using PGUPV::DrawElementsInstancedBaseInstance;
 
 
+uint64_t DrawCommand::trianglesFor(GLsizei count) const {
+  if (count <= 0)
+    return 0;
+  auto n = static_cast<uint64_t>(count);
+  switch (mode) {
+  case GL_TRIANGLES:
+    return n / 3;
+  case GL_TRIANGLE_STRIP:
+  case GL_TRIANGLE_FAN:
+    return n >= 3 ? n - 2 : 0;
+  case GL_TRIANGLES_ADJACENCY:
+    return n / 6;
+  case GL_TRIANGLE_STRIP_ADJACENCY:
+    return n >= 6 ? (n - 4) / 2 : 0;
+  default:
+    return 0;
+  }
+}
+
 void DrawCommand::render() {
   if (mode == GL_PATCHES) {
     glPatchParameteri(GL_PATCH_VERTICES, verticesPerPatch);
@@ -22,7 +46,11 @@ void DrawCommand::render() {
     glPrimitiveRestartIndex(restartIndex);
   }
 
+  // Sube las matrices pendientes antes de dibujar
+  PGUPV::GLMatrices::flushBound();
   renderFunc();
+  PGUPV::RenderStats::increment(PGUPV::RenderStats::Counter::DrawCalls);
+  PGUPV::RenderStats::increment(PGUPV::RenderStats::Counter::TrianglesSubmitted, getNumTriangles());
 
   if (restartPrimitive) {
     glDisable(GL_PRIMITIVE_RESTART);
@@ -40,6 +68,24 @@ void DrawCommand::setRestartIndex(uint rindex) {
   restartIndex = rindex;
 }
 
+void DrawCommand::copyStateTo(DrawCommand &other) const {
+  other.verticesPerPatch = verticesPerPatch;
+  other.restartPrimitive = restartPrimitive;
+  other.restartIndex = restartIndex;
+}
+
+InstancedDrawCommand *DrawArrays::makeInstanced() const {
+  auto d = new DrawArraysInstancedBaseInstance(mode, first, count, 0);
+  copyStateTo(*d);
+  return d;
+}
+
+InstancedDrawCommand *DrawElements::makeInstanced() const {
+  auto d = new DrawElementsInstancedBaseInstance(mode, count, type, offset, 0);
+  copyStateTo(*d);
+  return d;
+}
+
 std::vector<TriangleIndices> DrawCommand::getTrianglesIndices(void * /*indicesBuffer*/)
 {
   ERRT("No implementado. Habla con Paco");
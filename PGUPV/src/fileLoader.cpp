@@ -13,6 +13,7 @@
 #include "texture2D.h"
 #include "material.h"
 #include "pbrMaterial.h"
+#include "fileWatcher.h"
 
 
 using PGUPV::Scene;
@@ -431,6 +432,16 @@ std::shared_ptr<Scene> FileLoader::load(const std::string& path, AssimpWrapper::
 		// Hay un fichero extra de materiales: cargarlo
 		loadPGMAT(extraMaterialProps, scene);
 	}
+	// Al modificar el fichero de materiales se vuelve a aplicar a la escena, mientras exista (las
+	// propiedades que se borren del fichero mantienen el último valor)
+	std::weak_ptr<Scene> weakScene = scene;
+	PGUPV::FileWatcher::watch({ extraMaterialProps },
+		[extraMaterialProps, weakScene](const std::vector<std::string> &) {
+		if (auto s = weakScene.lock()) {
+			INFO("Recargando " + extraMaterialProps);
+			loadPGMAT(extraMaterialProps, s);
+		}
+	}, scene);
 
 	return scene;
 }
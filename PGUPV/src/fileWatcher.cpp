@@ -0,0 +1,304 @@
+#include <mutex>
+#include <unordered_map>
+#include <set>
+#include <chrono>
+#include <filesystem>
+#include <algorithm>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#endif
+
+#include "fileWatcher.h"
+#include "log.h"
+
+using PGUPV::FileWatcher;
+
+namespace fs = std::filesystem;
+
+namespace {
+	struct Watch {
+		std::vector<std::string> files;
+		FileWatcher::Callback callback;
+		std::weak_ptr<const void> owner;
+		bool hasOwner;
+	};
+
+	struct WatchedFile {
+		unsigned int refs = 0;
+		// Se consulta su fecha de modificación (no se puede vigilar con inotify)
+		bool polled = true;
+		bool exists = false;
+		fs::file_time_type lastWrite;
+	};
+
+	// Se pueden crear vigilancias desde el hilo de carga de recursos
+	std::recursive_mutex watcherMutex;
+	std::unordered_map<FileWatcher::Id, Watch> watches;
+	std::unordered_map<std::string, WatchedFile> files;
+	std::set<std::string> changedFiles;
+	FileWatcher::Id nextId = 1;
+	bool enabled = true;
+	unsigned int pollIntervalMs = 500;
+	std::chrono::steady_clock::time_point lastPoll;
+
+#ifdef __linux__
+	int inotifyFd = -1;
+	bool inotifyFailed = false;
+	struct WatchedDir {
+		int wd;
+		unsigned int refs;
+	};
+	std::unordered_map<std::string, WatchedDir> dirs;
+	std::unordered_map<int, std::string> wdToDir;
+
+	bool initInotify() {
+		if (inotifyFd >= 0)
+			return true;
+		if (inotifyFailed)
+			return false;
+		inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+		if (inotifyFd < 0) {
+			inotifyFailed = true;
+			WARN(std::string("No se puede usar inotify (") + strerror(errno) +
+				"). Se consultarán las fechas de los ficheros");
+			return false;
+		}
+		return true;
+	}
+
+	// Vigila el directorio del fichero. Devuelve false si no es posible
+	bool addDirWatch(const std::string &file) {
+		if (!initInotify())
+			return false;
+		auto dir = fs::path(file).parent_path().string();
+		auto it = dirs.find(dir);
+		if (it != dirs.end()) {
+			it->second.refs++;
+			return true;
+		}
+		// Sólo cuando el fichero está completo (no IN_MODIFY, que llega en cada escritura)
+		int wd = inotify_add_watch(inotifyFd, dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+		if (wd < 0)
+			return false;
+		dirs[dir] = WatchedDir{ wd, 1 };
+		wdToDir[wd] = dir;
+		return true;
+	}
+
+	void removeDirWatch(const std::string &file) {
+		auto it = dirs.find(fs::path(file).parent_path().string());
+		if (it == dirs.end() || --it->second.refs > 0)
+			return;
+		inotify_rm_watch(inotifyFd, it->second.wd);
+		wdToDir.erase(it->second.wd);
+		dirs.erase(it);
+	}
+
+	void readInotify() {
+		if (inotifyFd < 0)
+			return;
+		alignas(inotify_event) char buf[4096];
+		for (;;) {
+			ssize_t len = read(inotifyFd, buf, sizeof(buf));
+			if (len <= 0)
+				break;
+			for (char *p = buf; p < buf + len;) {
+				auto ev = reinterpret_cast<const inotify_event *>(p);
+				p += sizeof(inotify_event) + ev->len;
+				if (ev->mask & IN_Q_OVERFLOW) {
+					// Se han perdido eventos: se considera que han cambiado todos
+					for (auto &f : files)
+						if (!f.second.polled) changedFiles.insert(f.first);
+					continue;
+				}
+				auto dir = wdToDir.find(ev->wd);
+				if (dir == wdToDir.end())
+					continue;
+				if (ev->mask & IN_IGNORED) {
+					// Se ha borrado el directorio: sus ficheros pasan a consultarse
+					for (auto &f : files)
+						if (fs::path(f.first).parent_path().string() == dir->second)
+							f.second.polled = true;
+					dirs.erase(dir->second);
+					wdToDir.erase(dir);
+					continue;
+				}
+				if (ev->len == 0)
+					continue;
+				auto path = (fs::path(dir->second) / ev->name).string();
+				if (files.find(path) != files.end())
+					changedFiles.insert(path);
+			}
+		}
+	}
+#endif
+
+	void updateFileTime(const std::string &path, WatchedFile &f) {
+		std::error_code ec;
+		f.lastWrite = fs::last_write_time(path, ec);
+		f.exists = !ec;
+	}
+
+	void pollFiles() {
+		auto now = std::chrono::steady_clock::now();
+		if (now - lastPoll < std::chrono::milliseconds(pollIntervalMs))
+			return;
+		lastPoll = now;
+		for (auto &f : files) {
+			if (!f.second.polled)
+				continue;
+			bool existed = f.second.exists;
+			auto lastWrite = f.second.lastWrite;
+			updateFileTime(f.first, f.second);
+			if (f.second.exists != existed || (f.second.exists && f.second.lastWrite != lastWrite))
+				changedFiles.insert(f.first);
+		}
+	}
+
+	void addFile(const std::string &path) {
+		auto &f = files[path];
+		if (f.refs++ > 0)
+			return;
+		updateFileTime(path, f);
+#ifdef __linux__
+		f.polled = !addDirWatch(path);
+#endif
+	}
+
+	void releaseFile(const std::string &path) {
+		auto it = files.find(path);
+		if (it == files.end() || --it->second.refs > 0)
+			return;
+#ifdef __linux__
+		if (!it->second.polled)
+			removeDirWatch(path);
+#endif
+		files.erase(it);
+		changedFiles.erase(path);
+	}
+
+	void removeWatch(std::unordered_map<FileWatcher::Id, Watch>::iterator it) {
+		for (auto &f : it->second.files)
+			releaseFile(f);
+		watches.erase(it);
+	}
+}
+
+std::string FileWatcher::normalize(const std::string &path) {
+	std::error_code ec;
+	auto abs = fs::absolute(path, ec);
+	if (ec)
+		return fs::path(path).lexically_normal().string();
+	auto canon = fs::weakly_canonical(abs, ec);
+	return (ec ? abs.lexically_normal() : canon).string();
+}
+
+FileWatcher::Id FileWatcher::watch(const std::vector<std::string> &paths, Callback callback,
+	std::weak_ptr<const void> owner) {
+	Watch w;
+	for (auto &p : paths) {
+		auto n = normalize(p);
+		if (std::find(w.files.begin(), w.files.end(), n) == w.files.end())
+			w.files.push_back(n);
+	}
+	w.callback = callback;
+	w.hasOwner = !owner.expired();
+	w.owner = owner;
+
+	std::lock_guard<std::recursive_mutex> lock(watcherMutex);
+	for (auto &f : w.files)
+		addFile(f);
+	Id id = nextId++;
+	watches[id] = std::move(w);
+	return id;
+}
+
+void FileWatcher::unwatch(Id id) {
+	if (id == 0)
+		return;
+	std::lock_guard<std::recursive_mutex> lock(watcherMutex);
+	auto it = watches.find(id);
+	if (it != watches.end())
+		removeWatch(it);
+}
+
+size_t FileWatcher::processEvents() {
+	std::vector<std::pair<Id, std::vector<std::string>>> pending;
+	{
+		std::lock_guard<std::recursive_mutex> lock(watcherMutex);
+#ifdef __linux__
+		readInotify();
+#endif
+		pollFiles();
+		if (!enabled)
+			changedFiles.clear();
+		if (changedFiles.empty())
+			return 0;
+
+		for (auto it = watches.begin(); it != watches.end();) {
+			if (it->second.hasOwner && it->second.owner.expired()) {
+				auto next = std::next(it);
+				removeWatch(it);
+				it = next;
+				continue;
+			}
+			std::vector<std::string> changed;
+			for (auto &f : it->second.files)
+				if (changedFiles.count(f))
+					changed.push_back(f);
+			if (!changed.empty())
+				pending.emplace_back(it->first, std::move(changed));
+			++it;
+		}
+		changedFiles.clear();
+	}
+
+	// Las funciones se llaman sin el cerrojo: pueden crear o borrar vigilancias
+	size_t called = 0;
+	for (auto &p : pending) {
+		Callback callback;
+		{
+			std::lock_guard<std::recursive_mutex> lock(watcherMutex);
+			auto it = watches.find(p.first);
+			// Una función anterior ha podido borrar esta vigilancia
+			if (it == watches.end())
+				continue;
+			callback = it->second.callback;
+		}
+		try {
+			callback(p.second);
+		}
+		catch (std::exception &e) {
+			ERR(std::string("Error recargando ") + p.second.front() + ": " + e.what());
+		}
+		called++;
+	}
+	return called;
+}
+
+void FileWatcher::setEnabled(bool e) {
+	std::lock_guard<std::recursive_mutex> lock(watcherMutex);
+	enabled = e;
+}
+
+bool FileWatcher::isEnabled() {
+	return enabled;
+}
+
+bool FileWatcher::isUsingInotify() {
+#ifdef __linux__
+	std::lock_guard<std::recursive_mutex> lock(watcherMutex);
+	return inotifyFd >= 0;
+#else
+	return false;
+#endif
+}
+
+void FileWatcher::setPollInterval(unsigned int ms) {
+	std::lock_guard<std::recursive_mutex> lock(watcherMutex);
+	pollIntervalMs = ms;
+}
@@ -5,6 +5,7 @@ using PGUPV::FindNodeByName;
 using PGUPV::Node;
 
 FindNodeByName::FindNodeByName(const std::string &str) : str(str) {
+  setNodePathMode(NodePathMode::RAW);
 }
 
 void FindNodeByName::apply(Node &node) {
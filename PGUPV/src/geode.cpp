@@ -1,5 +1,7 @@
 #include "geode.h"
 #include "nodeVisitor.h"
+#include "renderStats.h"
+#include "nodePool.h"
 
 using PGUPV::Geode;
 using PGUPV::NodeVisitor;
@@ -14,14 +16,22 @@ Geode::Geode() :
 
 std::shared_ptr<Geode> PGUPV::Geode::build(std::shared_ptr<Model> m)
 {
+  if (auto pool = PGUPV::NodePool::current()) {
+    if (m == nullptr)
+      return pool->make<Geode>();
+    return pool->make<Geode>(m);
+  }
   if (m == nullptr)
     return std::shared_ptr<Geode>(new Geode());
   return std::shared_ptr<Geode>(new Geode(m));
 }
 
 void Geode::render() {
-  if (visible)
-    model->render();
+  PGUPV::RenderStats::increment(PGUPV::RenderStats::Counter::NodesVisited);
+  if (!visible || isOutsideViewVolume())
+    return;
+  PGUPV::RenderStats::increment(PGUPV::RenderStats::Counter::GeodesDrawn);
+  model->render();
 }
 
 void Geode::recomputeBoundingBox() {
@@ -35,7 +45,7 @@ void Geode::recomputeBoundingSphere() {
 
 void Geode::setModel(std::shared_ptr<Model> m) {
   model = m;
-  bb.reset();
+  invalidateBoundingVolumes();
 }
 
 std::shared_ptr<Geode> Geode::shared_from_this()
@@ -0,0 +1,351 @@
+#include <cstddef>
+#include <algorithm>
+#include <numeric>
+
+#include "geometryPool.h"
+#include "vertexArrayObject.h"
+#include "bufferObject.h"
+#include "bindingPoint.h"
+#include "indexedBindingPoint.h"
+#include "nodeVisitor.h"
+#include "instancedGeode.h"
+#include "drawCommand.h"
+#include "material.h"
+#include "uboMaterial.h"
+#include "renderStats.h"
+#include "glMatrices.h"
+#include "utils.h"
+#include "log.h"
+
+using PGUPV::GeometryPool;
+using PGUPV::GLMatrices;
+using PGUPV::Mesh;
+using PGUPV::BufferObject;
+using PGUPV::VertexArrayObject;
+using PGUPV::BaseMaterial;
+using PGUPV::Material;
+using PGUPV::MaterialMembers;
+
+const std::string GeometryPool::blockName{ "DrawData" };
+const Strings GeometryPool::definition{
+	"struct DrawData {",
+	"  mat4 modelMatrix;",
+	"  uint material;",
+	"};",
+	"layout(std430, binding=" + std::to_string(SSBO_DRAW_DATA_BINDING_INDEX) + ") readonly buffer DrawDataBlock {",
+	"  DrawData draws[];",
+	"};",
+	"struct MaterialData {",
+	"  vec4 ambient;",
+	"  vec4 diffuse;",
+	"  vec4 specular;",
+	"  vec4 emissive;",
+	"  float shininess;",
+	"};",
+	"layout(std430, binding=" + std::to_string(SSBO_DRAW_MATERIALS_BINDING_INDEX) + ") readonly buffer MaterialDataBlock {",
+	"  MaterialData materials[];",
+	"};"
+};
+
+std::shared_ptr<GeometryPool> GeometryPool::build(size_t verticesPerPage, size_t indicesPerPage) {
+	if (verticesPerPage == 0 || indicesPerPage < 3)
+		ERRT("Las páginas del pool de geometría tienen que tener sitio para un triángulo");
+	return std::shared_ptr<GeometryPool>(new GeometryPool(verticesPerPage, indicesPerPage));
+}
+
+GeometryPool::GeometryPool(size_t verticesPerPage, size_t indicesPerPage) :
+	verticesPerPage(verticesPerPage), indicesPerPage(indicesPerPage),
+	drawsDirty(false), materialsDirty(true) {
+	MaterialMembers defaults;
+	materials.push_back(MaterialData{ defaults.ambient, defaults.diffuse, defaults.specular,
+		defaults.emissive, defaults.shininess, { 0.0f, 0.0f, 0.0f } });
+}
+
+GeometryPool::~GeometryPool() {
+}
+
+unsigned int GeometryPool::findPage(size_t nVertices, size_t nIndices) {
+	for (unsigned int i = 0; i < pages.size(); i++) {
+		if (pages[i].nVertices + nVertices <= verticesPerPage && pages[i].nIndices + nIndices <= indicesPerPage)
+			return i;
+	}
+
+	Page page;
+	// Las mallas más grandes que una página tienen su propia página
+	auto vertices = std::max(verticesPerPage, nVertices);
+	auto indices = std::max(indicesPerPage, nIndices);
+	page.vao = std::unique_ptr<VertexArrayObject>(new VertexArrayObject());
+	page.vertices = BufferObject::build(vertices * sizeof(Vertex), GL_STATIC_DRAW);
+	page.vertices->setGlDebugLabel("Vértices del pool de geometría " + std::to_string(pages.size()));
+	page.indices = BufferObject::build(indices * sizeof(uint32_t), GL_STATIC_DRAW);
+	page.indices->setGlDebugLabel("Índices del pool de geometría " + std::to_string(pages.size()));
+	page.nVertices = page.nIndices = 0;
+	page.firstCommand = page.nCommands = 0;
+
+	page.vao->bind();
+	auto prev = gl_array_buffer.bind(page.vertices);
+	glEnableVertexAttribArray(Mesh::VERTICES);
+	glVertexAttribPointer(Mesh::VERTICES, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex),
+		reinterpret_cast<const void *>(offsetof(Vertex, position)));
+	glEnableVertexAttribArray(Mesh::NORMALS);
+	glVertexAttribPointer(Mesh::NORMALS, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex),
+		reinterpret_cast<const void *>(offsetof(Vertex, normal)));
+	glEnableVertexAttribArray(Mesh::TEX_COORD0);
+	glVertexAttribPointer(Mesh::TEX_COORD0, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex),
+		reinterpret_cast<const void *>(offsetof(Vertex, texCoord)));
+	gl_array_buffer.bind(prev);
+	gl_element_array_buffer.bind(page.indices);
+	if (drawIdBuffer)
+		bindDrawIds();
+	page.vao->unbind();
+
+	INFO("Nueva página del pool de geometría: " + std::to_string(vertices) + " vértices y " +
+		std::to_string(indices) + " índices");
+	pages.push_back(std::move(page));
+	return static_cast<unsigned int>(pages.size() - 1);
+}
+
+size_t GeometryPool::addMesh(const std::vector<Vertex> &vertices, const std::vector<uint32_t> &indices) {
+	if (vertices.empty() || indices.size() % 3 != 0)
+		ERRT("Las mallas del pool de geometría tienen que tener vértices y triángulos completos");
+
+	auto p = findPage(vertices.size(), indices.size());
+	auto &page = pages[p];
+	MeshRange r{ p, static_cast<GLint>(page.nVertices), static_cast<GLuint>(page.nIndices),
+		static_cast<GLuint>(indices.size()) };
+
+	auto prev = gl_copy_write_buffer.bind(page.vertices);
+	gl_copy_write_buffer.write(vertices.data(), vertices.size() * sizeof(Vertex), page.nVertices * sizeof(Vertex));
+	if (!indices.empty()) {
+		gl_copy_write_buffer.bind(page.indices);
+		gl_copy_write_buffer.write(indices.data(), indices.size() * sizeof(uint32_t), page.nIndices * sizeof(uint32_t));
+	}
+	gl_copy_write_buffer.bind(prev);
+
+	page.nVertices += vertices.size();
+	page.nIndices += indices.size();
+	meshes.push_back(r);
+	return meshes.size() - 1;
+}
+
+size_t GeometryPool::addMesh(const Mesh &m) {
+	auto it = meshIds.find(&m);
+	if (it != meshIds.end())
+		return it->second;
+
+	auto positions = m.getVertices();
+	auto normals = m.getNormals();
+	auto texCoords = m.getTexCoords(0);
+	std::vector<Vertex> vertices(positions.size());
+	for (size_t i = 0; i < positions.size(); i++) {
+		vertices[i].position = positions[i];
+		vertices[i].normal = normals.empty() ? glm::vec3(0.0f) : normals[i];
+		vertices[i].texCoord = texCoords.empty() ? glm::vec2(0.0f) : texCoords[i];
+	}
+
+	std::vector<uint32_t> indices;
+	for (const auto &t : m.getTriangles()) {
+		indices.push_back(t.idx[0]);
+		indices.push_back(t.idx[1]);
+		indices.push_back(t.idx[2]);
+	}
+	if (indices.empty())
+		WARN("La malla " + m.getName() + " no tiene triángulos que añadir al pool de geometría");
+
+	auto id = addMesh(vertices, indices);
+	meshIds[&m] = id;
+	return id;
+}
+
+size_t GeometryPool::addMaterial(const BaseMaterial &m) {
+	auto it = materialIds.find(&m);
+	if (it != materialIds.end())
+		return it->second;
+
+	MaterialData md = materials[0];
+	auto mat = dynamic_cast<const Material *>(&m);
+	if (mat) {
+		md.ambient = mat->getAmbient();
+		md.diffuse = mat->getDiffuse();
+		md.specular = mat->getSpecular();
+		md.emissive = mat->getEmissive();
+		md.shininess = mat->getShininess();
+	}
+	else {
+		WARN("El pool de geometría sólo guarda los colores de los materiales de tipo Material (" +
+			m.getName() + ")");
+	}
+	materials.push_back(md);
+	materialsDirty = true;
+	auto id = materials.size() - 1;
+	materialIds[&m] = id;
+	return id;
+}
+
+size_t GeometryPool::addDraw(size_t meshId, const glm::mat4 &modelMatrix, size_t materialId) {
+	if (meshId >= meshes.size() || materialId >= materials.size())
+		ERRT("Malla o material del pool de geometría incorrecto");
+	drawMeshes.push_back(meshId);
+	draws.push_back(DrawData{ modelMatrix, static_cast<uint32_t>(materialId), { 0, 0, 0 } });
+	drawsDirty = true;
+	return draws.size() - 1;
+}
+
+void GeometryPool::setDrawTransform(size_t drawId, const glm::mat4 &modelMatrix) {
+	draws[drawId].modelMatrix = modelMatrix;
+	drawsDirty = true;
+}
+
+void GeometryPool::setDrawMaterial(size_t drawId, size_t materialId) {
+	if (materialId >= materials.size())
+		ERRT("Material del pool de geometría incorrecto");
+	draws[drawId].material = static_cast<uint32_t>(materialId);
+	drawsDirty = true;
+}
+
+void GeometryPool::clearDraws() {
+	drawMeshes.clear();
+	draws.clear();
+	drawsDirty = true;
+}
+
+void GeometryPool::bindDrawIds() {
+	// Se llama con el VAO de la página vinculado
+	auto prev = gl_array_buffer.bind(drawIdBuffer);
+	glEnableVertexAttribArray(DRAW_ID);
+	glVertexAttribIPointer(DRAW_ID, 1, GL_UNSIGNED_INT, 0, nullptr);
+	glVertexAttribDivisor(DRAW_ID, 1);
+	gl_array_buffer.bind(prev);
+}
+
+void GeometryPool::uploadDraws() {
+	// Los dibujos de cada página tienen que estar seguidos en el buffer de órdenes. Con
+	// baseInstance = i, el atributo DRAW_ID de la orden i vale i (su posición en drawBuffer)
+	std::vector<size_t> order(draws.size());
+	std::iota(order.begin(), order.end(), 0);
+	std::stable_sort(order.begin(), order.end(), [this](size_t a, size_t b) {
+		return meshes[drawMeshes[a]].page < meshes[drawMeshes[b]].page;
+	});
+
+	std::vector<DrawData> sortedDraws(draws.size());
+	std::vector<DrawElementsIndirectCommand> commands(draws.size());
+	for (auto &page : pages)
+		page.firstCommand = page.nCommands = 0;
+	for (size_t i = 0; i < order.size(); i++) {
+		const auto &r = meshes[drawMeshes[order[i]]];
+		sortedDraws[i] = draws[order[i]];
+		commands[i] = DrawElementsIndirectCommand{ r.indexCount, 1, r.firstIndex, r.baseVertex,
+			static_cast<GLuint>(i) };
+		auto &page = pages[r.page];
+		if (page.nCommands == 0)
+			page.firstCommand = i;
+		page.nCommands++;
+	}
+
+	auto size = draws.size();
+	if (!drawBuffer || drawBuffer->getSize() < size * sizeof(DrawData)) {
+		drawBuffer = BufferObject::build(size * sizeof(DrawData), GL_DYNAMIC_DRAW);
+		drawBuffer->setGlDebugLabel("Dibujos del pool de geometría");
+		commandBuffer = BufferObject::build(size * sizeof(DrawElementsIndirectCommand), GL_DYNAMIC_DRAW);
+		commandBuffer->setGlDebugLabel("Órdenes del pool de geometría");
+
+		std::vector<uint32_t> ids(size);
+		std::iota(ids.begin(), ids.end(), 0);
+		drawIdBuffer = BufferObject::build(size * sizeof(uint32_t), GL_STATIC_DRAW);
+		drawIdBuffer->setGlDebugLabel("Identificadores de los dibujos del pool de geometría");
+		auto prev = gl_copy_write_buffer.bind(drawIdBuffer);
+		gl_copy_write_buffer.write(ids.data(), size * sizeof(uint32_t), 0);
+		gl_copy_write_buffer.bind(prev);
+		for (auto &page : pages) {
+			page.vao->bind();
+			bindDrawIds();
+			page.vao->unbind();
+		}
+	}
+
+	auto prev = gl_copy_write_buffer.bind(drawBuffer);
+	gl_copy_write_buffer.write(sortedDraws.data(), size * sizeof(DrawData), 0);
+	gl_copy_write_buffer.bind(commandBuffer);
+	gl_copy_write_buffer.write(commands.data(), size * sizeof(DrawElementsIndirectCommand), 0);
+	gl_copy_write_buffer.bind(prev);
+	drawsDirty = false;
+}
+
+void GeometryPool::uploadMaterials() {
+	auto size = materials.size() * sizeof(MaterialData);
+	if (!materialBuffer || materialBuffer->getSize() < size) {
+		materialBuffer = BufferObject::build(size, GL_STATIC_DRAW);
+		materialBuffer->setGlDebugLabel("Materiales del pool de geometría");
+	}
+	auto prev = gl_copy_write_buffer.bind(materialBuffer);
+	gl_copy_write_buffer.write(materials.data(), size, 0);
+	gl_copy_write_buffer.bind(prev);
+	materialsDirty = false;
+}
+
+void GeometryPool::render() {
+	if (draws.empty())
+		return;
+	if (drawsDirty)
+		uploadDraws();
+	if (materialsDirty)
+		uploadMaterials();
+
+	gl_shader_storage_buffer.bindBufferBase(drawBuffer, SSBO_DRAW_DATA_BINDING_INDEX);
+	gl_shader_storage_buffer.bindBufferBase(materialBuffer, SSBO_DRAW_MATERIALS_BINDING_INDEX);
+	GLMatrices::flushBound();
+	auto prev = gl_draw_indirect_buffer.bind(commandBuffer);
+	for (auto &page : pages) {
+		if (page.nCommands == 0)
+			continue;
+		page.vao->bind();
+		glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT,
+			reinterpret_cast<const void *>(page.firstCommand * sizeof(DrawElementsIndirectCommand)),
+			static_cast<GLsizei>(page.nCommands), 0);
+		PGUPV::RenderStats::increment(PGUPV::RenderStats::Counter::DrawCalls);
+		page.vao->unbind();
+	}
+	gl_draw_indirect_buffer.bind(prev);
+	CHECK_GL();
+}
+
+namespace {
+	// Añade un dibujo por cada malla de los Geode, con la matriz acumulada de los Transform
+	class GeometryPoolBuilder : public PGUPV::NodeVisitor {
+	public:
+		explicit GeometryPoolBuilder(GeometryPool &pool) : pool(pool), matrix(1.0f) {
+			setNodePathMode(NodePathMode::RAW);
+		}
+		void apply(PGUPV::AnimationNode &) override {
+		}
+		void apply(PGUPV::Transform &transform) override {
+			auto prev = matrix;
+			matrix = matrix * transform.getTransform();
+			traverse(transform);
+			matrix = prev;
+		}
+		void apply(PGUPV::Geode &geode) override {
+			if (dynamic_cast<PGUPV::InstancedGeode *>(&geode)) {
+				WARN("El pool de geometría no admite InstancedGeode (" + geode.getName() + ")");
+				return;
+			}
+			auto &model = geode.getModel();
+			for (unsigned int i = 0; i < model.getNMeshes(); i++) {
+				auto &mesh = model.getMesh(i);
+				auto meshId = pool.addMesh(mesh);
+				size_t materialId = 0;
+				if (auto mat = mesh.getMaterial())
+					materialId = pool.addMaterial(*mat);
+				pool.addDraw(meshId, matrix, materialId);
+			}
+		}
+	private:
+		GeometryPool &pool;
+		glm::mat4 matrix;
+	};
+};
+
+void GeometryPool::addScene(Node &root) {
+	GeometryPoolBuilder builder(*this);
+	root.accept(builder);
+}
@@ -1,4 +1,6 @@
 #include <glm/glm.hpp>
+#include <cstring>
+#include <vector>
 
 #include "glMatrices.h"
 #include "log.h"
@@ -8,7 +10,8 @@
 using PGUPV::GLMatrices;
 using PGUPV::BufferObject;
 
-GLMatrices::GLMatrices() : UniformBufferObject(size()) {
+GLMatrices::GLMatrices() : UniformBufferObject(size()), modelviewDirty(false), projDirty(false),
+  dirty(true), streamed{ nullptr, 0, 0 }, streamedFrame(0), bindStamp(0) {
 	derivedMatrices.modelview = glm::mat4(1.0f);
 	derivedMatrices.modelviewprojection = glm::mat4(1.0f);
 	derivedMatrices.normal = glm::mat3x4(1.0f);
@@ -38,35 +41,81 @@ const Strings &GLMatrices::getDefinition() const {
 }
 
 void GLMatrices::writeMatrix(Matrix mat) {
-  gl_uniform_buffer.bindBufferBase(this->shared_from_this(),
-    UBO_GL_MATRICES_BINDING_INDEX);
-  gl_uniform_buffer.write((void *)&mats[mat].getMatrix(), sizeof(glm::mat4),
-    mat * sizeof(glm::mat4));
-  if (mat == MODEL_MATRIX || mat == VIEW_MATRIX) {
+  if (mat == MODEL_MATRIX || mat == VIEW_MATRIX)
+    modelviewDirty = true;
+  else if (mat == PROJ_MATRIX)
+    projDirty = true;
+  dirty = true;
+}
+
+void GLMatrices::updateDerived() const {
+  if (modelviewDirty) {
     // Compute MODELVIEW matrix
     derivedMatrices.modelview =
       mats[VIEW_MATRIX].getMatrix() * mats[MODEL_MATRIX].getMatrix();
 
-    // Compute MODELVIEWPROJ matrix
-    derivedMatrices.modelviewprojection =
-      mats[PROJ_MATRIX].getMatrix() * derivedMatrices.modelview;
-
     // Compute NORMAL matrix
     glm::mat3 nm(derivedMatrices.modelview);
     derivedMatrices.normal = glm::mat3x4(glm::transpose(glm::inverse(nm)));
-
-    // Write both into the UBO
-    gl_uniform_buffer.write((void *)&derivedMatrices, sizeof(derivedMatrices),
-      sizeof(glm::mat4) * 3);
   }
-  else if (mat == PROJ_MATRIX) {
+  if (modelviewDirty || projDirty) {
     // Compute MODELVIEWPROJ matrix
     derivedMatrices.modelviewprojection =
       mats[PROJ_MATRIX].getMatrix() * derivedMatrices.modelview;
-    // Write both into the UBO
-    gl_uniform_buffer.write((void *)&derivedMatrices, sizeof(derivedMatrices),
-      sizeof(glm::mat4) * 3);
   }
+  modelviewDirty = projDirty = false;
+}
+
+void GLMatrices::copyTo(void *dst) const {
+  updateDerived();
+  auto p = static_cast<unsigned char *>(dst);
+  for (uint i = 0; i <= PROJ_MATRIX; i++)
+    memcpy(p + i * sizeof(glm::mat4), &mats[i].getMatrix(), sizeof(glm::mat4));
+  memcpy(p + 3 * sizeof(glm::mat4), &derivedMatrices, sizeof(derivedMatrices));
+}
+
+void GLMatrices::flush() {
+  auto self = this->shared_from_this();
+  auto sb = StreamingBuffer::getCurrent();
+  // La copia del StreamingBuffer sólo vale durante el frame en que se escribió
+  bool streamValid = streamed.valid() && sb && sb == stream.lock() && sb->getFrame() == streamedFrame;
+
+  if (dirty || (streamed.valid() && !streamValid)) {
+    streamed = sb ? sb->allocate(size()) : StreamingBuffer::Allocation{ nullptr, 0, 0 };
+    if (streamed.valid()) {
+      copyTo(streamed.ptr);
+      stream = sb;
+      streamedFrame = sb->getFrame();
+      sb->bindRange(gl_uniform_buffer, UBO_GL_MATRICES_BINDING_INDEX, streamed, self);
+    }
+    else {
+      // Sin StreamingBuffer (o sin sitio en él), se escribe todo el bloque en el propio UBO
+      stream.reset();
+      std::vector<unsigned char> block(size());
+      copyTo(block.data());
+      gl_uniform_buffer.bindBufferBase(self, UBO_GL_MATRICES_BINDING_INDEX);
+      gl_uniform_buffer.write(block.data(), size(), 0);
+    }
+    dirty = false;
+  }
+  else if (bindStamp != gl_uniform_buffer.getBindStamp(UBO_GL_MATRICES_BINDING_INDEX)) {
+    // Otro código ha vinculado otro buffer (p.e., Program::use vincula el UBO con
+    // bindBufferBase): se vuelve a vincular la copia actual
+    if (streamed.valid())
+      sb->bindRange(gl_uniform_buffer, UBO_GL_MATRICES_BINDING_INDEX, streamed, self);
+    else
+      gl_uniform_buffer.bindBufferBase(self, UBO_GL_MATRICES_BINDING_INDEX);
+  }
+  else
+    return;
+  bindStamp = gl_uniform_buffer.getBindStamp(UBO_GL_MATRICES_BINDING_INDEX);
+}
+
+void GLMatrices::flushBound() {
+  auto mats = std::dynamic_pointer_cast<GLMatrices>(
+    gl_uniform_buffer.getBound(UBO_GL_MATRICES_BINDING_INDEX));
+  if (mats)
+    mats->flush();
 }
 
 void GLMatrices::loadIdentity(Matrix mat) {
@@ -132,6 +181,7 @@ const glm::mat4 &GLMatrices::getMatrix(Matrix mat) const {
     ERRT("No puedes usar getMatrix para conseguir la matriz normal. Usa "
     "getNormalMatrix");
 
+  updateDerived();
   if (mat == MODELVIEW_MATRIX)
     return derivedMatrices.modelview;
   else if (mat == MODELVIEWPROJ_MATRIX)
@@ -141,6 +191,7 @@ const glm::mat4 &GLMatrices::getMatrix(Matrix mat) const {
 }
 
 const glm::mat3 GLMatrices::getNormalMatrix() const {
+  updateDerived();
   return glm::mat3(derivedMatrices.normal);
 }
 
@@ -157,11 +208,13 @@ std::shared_ptr<GLMatrices> GLMatrices::build() {
   allocate(ubo);
   ubo->setGlDebugLabel(ubo->getBlockName());
   ubo->reset();
+  ubo->flush();
   INFO("UBO GLMatrices creado");
   return ubo;
 }
 
 std::ostream &PGUPV::operator<<(std::ostream &os, const GLMatrices &m) {
+  m.updateDerived();
   os << "Model matrix:\n";
   os << m.mats[GLMatrices::MODEL_MATRIX];
   os << "View matrix:\n";
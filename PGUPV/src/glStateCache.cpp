@@ -1,6 +1,7 @@
 #include "glStateCache.h"
 #include "hacks.h"
 #include "log.h"
+#include "glStateTracker.h"
 
 
 using PGUPV::GLStateCapturer;
@@ -64,7 +65,7 @@ GenericAttribState::GenericAttribState(const std::vector<GLint>& attribIds) {
 
 void GenericAttribState::restore() {
 	for (auto p : attribs) {
-		glVertexAttrib4fv(p.first, &p.second.x);
+		PGUPV::GLStateTracker::vertexAttrib4fv(p.first, &p.second.x);
 	}
 }
 
@@ -105,7 +106,7 @@ PGUPV::CurrentProgramState::CurrentProgramState() {
 }
 
 void PGUPV::CurrentProgramState::restore() {
-	glUseProgram(prevProgram);
+	PGUPV::GLStateTracker::useProgram(prevProgram);
 }
 
 
@@ -0,0 +1,226 @@
+#include <vector>
+#include <map>
+#include <unordered_map>
+#include <algorithm>
+#include <glm/glm.hpp>
+
+#include "glStateTracker.h"
+#include "renderStats.h"
+
+using PGUPV::GLStateTracker;
+using PGUPV::RenderStats;
+
+namespace {
+	// Valor de un estado que no se conoce (después de invalidate)
+	const GLuint UNKNOWN = 0xFFFFFFFF;
+
+	struct TextureBinding {
+		GLenum target;
+		GLuint texture;
+	};
+
+	struct BufferRange {
+		GLuint buffer;
+		GLintptr offset;
+		// -1 si se vinculó el buffer completo (glBindBufferBase)
+		GLsizeiptr size;
+	};
+
+	struct TrackerState {
+		bool enabled = false;
+		GLuint currentProgram = UNKNOWN;
+		GLuint currentVAO = UNKNOWN;
+		GLenum currentUnit = UNKNOWN;
+		// Texturas vinculadas en cada unidad (índice: unidad - GL_TEXTURE0), por destino
+		std::vector<std::vector<TextureBinding>> textures;
+		std::unordered_map<GLenum, GLuint> buffers;
+		std::map<std::pair<GLenum, GLuint>, BufferRange> ranges;
+		std::unordered_map<GLuint, glm::vec4> attribs;
+	};
+
+	// No se destruye nunca: los destructores de los objetos estáticos (p.e., BufferObject)
+	// llaman a forgetBuffer al terminar el programa
+	TrackerState &state() {
+		static TrackerState *s = new TrackerState();
+		return *s;
+	}
+
+	// Devuelve true si hay que llamar a OpenGL (y cuenta la llamada como hecha o evitada)
+	bool changed(bool differs, RenderStats::Counter counter) {
+		if (state().enabled && !differs) {
+			RenderStats::increment(RenderStats::Counter::BindsElided);
+			return false;
+		}
+		RenderStats::increment(counter);
+		return true;
+	}
+
+	GLuint &textureSlot(GLenum unit, GLenum target) {
+		auto &s = state();
+		size_t idx = unit - GL_TEXTURE0;
+		if (idx >= s.textures.size())
+			s.textures.resize(idx + 1);
+		auto &slots = s.textures[idx];
+		auto it = std::find_if(slots.begin(), slots.end(),
+			[target](const TextureBinding &b) { return b.target == target; });
+		if (it != slots.end())
+			return it->texture;
+		slots.push_back(TextureBinding{ target, UNKNOWN });
+		return slots.back().texture;
+	}
+}
+
+bool GLStateTracker::useProgram(GLuint program) {
+	auto &s = state();
+	if (!changed(program != s.currentProgram, RenderStats::Counter::ProgramBinds))
+		return false;
+	glUseProgram(program);
+	s.currentProgram = program;
+	return true;
+}
+
+bool GLStateTracker::bindVertexArray(GLuint vao) {
+	auto &s = state();
+	if (!changed(vao != s.currentVAO, RenderStats::Counter::VAOBinds))
+		return false;
+	glBindVertexArray(vao);
+	s.currentVAO = vao;
+	// El buffer de índices forma parte del estado del VAO
+	s.buffers.erase(GL_ELEMENT_ARRAY_BUFFER);
+	return true;
+}
+
+bool GLStateTracker::activeTexture(GLenum unit) {
+	auto &s = state();
+	if (s.enabled && unit == s.currentUnit)
+		return false;
+	glActiveTexture(unit);
+	s.currentUnit = unit;
+	return true;
+}
+
+bool GLStateTracker::bindTexture(GLenum target, GLuint texture) {
+	auto &s = state();
+	if (s.currentUnit == UNKNOWN) {
+		GLint unit;
+		glGetIntegerv(GL_ACTIVE_TEXTURE, &unit);
+		s.currentUnit = static_cast<GLenum>(unit);
+	}
+	auto &slot = textureSlot(s.currentUnit, target);
+	if (!changed(slot != texture, RenderStats::Counter::TextureBinds))
+		return false;
+	glBindTexture(target, texture);
+	slot = texture;
+	return true;
+}
+
+bool GLStateTracker::bindTextureToUnit(GLenum unit, GLenum target, GLuint texture) {
+	auto &s = state();
+	// Si la textura ya está en la unidad, no hace falta ni cambiar la unidad activa
+	if (s.enabled && textureSlot(unit, target) == texture) {
+		RenderStats::increment(RenderStats::Counter::BindsElided);
+		return false;
+	}
+	activeTexture(unit);
+	return bindTexture(target, texture);
+}
+
+bool GLStateTracker::bindBuffer(GLenum target, GLuint buffer) {
+	auto &s = state();
+	auto it = s.buffers.find(target);
+	if (!changed(it == s.buffers.end() || it->second != buffer, RenderStats::Counter::BufferBinds))
+		return false;
+	glBindBuffer(target, buffer);
+	s.buffers[target] = buffer;
+	return true;
+}
+
+bool GLStateTracker::bindBufferBase(GLenum target, GLuint index, GLuint buffer) {
+	auto &s = state();
+	auto it = s.ranges.find(std::make_pair(target, index));
+	bool differs = it == s.ranges.end() || it->second.buffer != buffer || it->second.size != -1;
+	if (!changed(differs, RenderStats::Counter::BufferBinds))
+		return false;
+	glBindBufferBase(target, index, buffer);
+	s.ranges[std::make_pair(target, index)] = BufferRange{ buffer, 0, -1 };
+	// También vincula el buffer al punto de vinculación general
+	s.buffers[target] = buffer;
+	return true;
+}
+
+bool GLStateTracker::bindBufferRange(GLenum target, GLuint index, GLuint buffer,
+	GLintptr offset, GLsizeiptr size) {
+	auto &s = state();
+	auto it = s.ranges.find(std::make_pair(target, index));
+	bool differs = it == s.ranges.end() || it->second.buffer != buffer ||
+		it->second.offset != offset || it->second.size != size;
+	if (!changed(differs, RenderStats::Counter::BufferBinds))
+		return false;
+	glBindBufferRange(target, index, buffer, offset, size);
+	s.ranges[std::make_pair(target, index)] = BufferRange{ buffer, offset, size };
+	s.buffers[target] = buffer;
+	return true;
+}
+
+bool GLStateTracker::vertexAttrib4fv(GLuint index, const GLfloat *v) {
+	auto &s = state();
+	glm::vec4 value(v[0], v[1], v[2], v[3]);
+	auto it = s.attribs.find(index);
+	if (s.enabled && it != s.attribs.end() && it->second == value) {
+		RenderStats::increment(RenderStats::Counter::BindsElided);
+		return false;
+	}
+	glVertexAttrib4fv(index, v);
+	s.attribs[index] = value;
+	return true;
+}
+
+void GLStateTracker::forgetTexture(GLuint texture) {
+	auto &s = state();
+	for (auto &unit : s.textures)
+		for (auto &b : unit)
+			if (b.texture == texture)
+				b.texture = UNKNOWN;
+}
+
+void GLStateTracker::forgetBuffer(GLuint buffer) {
+	auto &s = state();
+	for (auto it = s.buffers.begin(); it != s.buffers.end();) {
+		if (it->second == buffer)
+			it = s.buffers.erase(it);
+		else
+			++it;
+	}
+	for (auto it = s.ranges.begin(); it != s.ranges.end();) {
+		if (it->second.buffer == buffer)
+			it = s.ranges.erase(it);
+		else
+			++it;
+	}
+}
+
+void GLStateTracker::forgetVertexArray(GLuint vao) {
+	auto &s = state();
+	if (s.currentVAO == vao) {
+		s.currentVAO = UNKNOWN;
+		s.buffers.erase(GL_ELEMENT_ARRAY_BUFFER);
+	}
+}
+
+void GLStateTracker::invalidate() {
+	auto &s = state();
+	s.currentProgram = s.currentVAO = s.currentUnit = UNKNOWN;
+	s.textures.clear();
+	s.buffers.clear();
+	s.ranges.clear();
+	s.attribs.clear();
+}
+
+void GLStateTracker::setEnabled(bool e) {
+	state().enabled = e;
+	invalidate();
+}
+
+bool GLStateTracker::isEnabled() {
+	return state().enabled;
+}
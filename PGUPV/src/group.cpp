@@ -3,6 +3,8 @@
 #include "group.h"
 #include "nodeVisitor.h"
 #include "node.h"
+#include "nodePool.h"
+#include "renderStats.h"
 
 using PGUPV::Group;
 using PGUPV::NodeVisitor;
@@ -10,11 +12,18 @@ using PGUPV::Node;
 
 std::shared_ptr<Group> Group::build()
 {
+  if (auto pool = PGUPV::NodePool::current())
+    return pool->make<Group>();
   return std::shared_ptr<Group>(new Group());
 }
 
 void Group::render() {
-  if (!visible || !getBB().isValid()) return;
+  PGUPV::RenderStats::increment(PGUPV::RenderStats::Counter::NodesVisited);
+  if (!visible || !getBB().isValid() || isOutsideViewVolume()) return;
+  renderChildren();
+}
+
+void Group::renderChildren() {
   for (auto &c : children)
     c->render();
 }
@@ -56,9 +65,11 @@ void Group::addChild(std::shared_ptr<Node> n) {
   n->addParent(this);
 }
 void Group::removeChild(std::shared_ptr<Node> n) {
-  n->removeParent(this);
-  children.erase(std::remove(children.begin(), children.end(), n), children.end());
-  invalidateBoundingVolumes();
+  // Se quita cada aparición con removeChild(size_t), que pueden redefinir las subclases
+  for (size_t i = children.size(); i-- > 0;) {
+    if (children[i] == n)
+      removeChild(i);
+  }
 }
 
 void Group::removeChild(Node *n) {
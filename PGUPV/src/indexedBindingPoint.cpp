@@ -4,6 +4,7 @@
 #include "bufferObject.h"
 #include "indexedBindingPoint.h"
 #include "log.h"
+#include "glStateTracker.h"
 
 using PGUPV::IndexedBindingPoint;
 using PGUPV::BufferObject;
@@ -16,15 +17,17 @@ PGUPV::gl_atomic_counter_buffer(GL_ATOMIC_COUNTER_BUFFER),
 PGUPV::gl_shader_storage_buffer(GL_SHADER_STORAGE_BUFFER);
 
 
-std::shared_ptr<BufferObject> IndexedBindingPoint::bindBufferRange(std::shared_ptr<BufferObject> bo, GLuint index, GLintptr offset, GLsizeiptr size) {
+std::shared_ptr<BufferObject> IndexedBindingPoint::bindBufferRange(std::shared_ptr<BufferObject> bo, GLuint index, GLintptr offset, GLsizeiptr size,
+  std::shared_ptr<BufferObject> boundAs) {
   assert(bo);
   if (ulong(offset + size) > bo->getSize())
     ERRT("Intentando vincular una zona de memoria fuera del buffer");
   auto prev = getBound(index);
 
-  glBindBufferRange(GL_bindingPoint, index, bo->getId(), offset, size);
+  PGUPV::GLStateTracker::bindBufferRange(GL_bindingPoint, index, bo->getId(), offset, size);
 
-  boundBOs[index] = bo;
+  boundBOs[index] = boundAs ? boundAs : bo;
+  bindStamps[index] = ++lastStamp;
   bound = bo;
   return prev;
 }
@@ -32,8 +35,9 @@ std::shared_ptr<BufferObject> IndexedBindingPoint::bindBufferRange(std::shared_p
 std::shared_ptr<BufferObject> IndexedBindingPoint::bindBufferBase(std::shared_ptr<BufferObject> bo, GLuint index) {
   assert(bo);
   auto prev = getBound(index);
-  glBindBufferBase(GL_bindingPoint, index, bo->getId());
+  PGUPV::GLStateTracker::bindBufferBase(GL_bindingPoint, index, bo->getId());
   boundBOs[index] = bo;
+  bindStamps[index] = ++lastStamp;
   bound = bo;
   return prev;
 }
@@ -46,3 +50,8 @@ std::shared_ptr<BufferObject> IndexedBindingPoint::getBound(GLuint idx) {
   }
   return std::shared_ptr<BufferObject>();
 }
+
+uint64_t IndexedBindingPoint::getBindStamp(GLuint idx) {
+  auto p = bindStamps.find(idx);
+  return p == bindStamps.end() ? 0 : p->second;
+}
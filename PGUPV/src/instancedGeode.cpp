@@ -0,0 +1,255 @@
+#include <cstddef>
+
+#include "instancedGeode.h"
+#include "drawCommand.h"
+#include "bufferObject.h"
+#include "indexedBindingPoint.h"
+#include "renderStats.h"
+#include "utils.h"
+#include "log.h"
+
+using PGUPV::InstancedGeode;
+using PGUPV::InstancedDrawCommand;
+using PGUPV::BufferObject;
+using PGUPV::Model;
+using PGUPV::Mesh;
+
+std::shared_ptr<InstancedGeode> InstancedGeode::build(std::shared_ptr<Model> m) {
+  return std::shared_ptr<InstancedGeode>(new InstancedGeode(m ? m : std::make_shared<Model>()));
+}
+
+InstancedGeode::InstancedGeode(std::shared_ptr<Model> m) : Geode(m), instancesDirty(false),
+  firstAttrib(INSTANCE_MATRIX) {
+}
+
+InstancedGeode::~InstancedGeode() {
+  clearInstancedCommands();
+}
+
+std::shared_ptr<InstancedGeode> InstancedGeode::shared_from_this() {
+  return std::static_pointer_cast<InstancedGeode>(Node::shared_from_this());
+}
+
+size_t InstancedGeode::addInstance(const glm::mat4 &xform, const glm::vec4 &color) {
+  auto i = instances.size();
+  instances.push_back(InstanceData{ xform, color });
+  ids.push_back(0);
+  instancesChanged();
+  return i;
+}
+
+void InstancedGeode::setInstanceTransform(size_t i, const glm::mat4 &xform) {
+  instances[i].transform = xform;
+  instancesChanged();
+}
+
+void InstancedGeode::setInstanceColor(size_t i, const glm::vec4 &color) {
+  instances[i].color = color;
+  // El color no afecta a los volúmenes de inclusión
+  instancesDirty = true;
+}
+
+void InstancedGeode::removeInstance(size_t i) {
+  instances.erase(instances.begin() + i);
+  ids.erase(ids.begin() + i);
+  instancesChanged();
+}
+
+void InstancedGeode::clearInstances() {
+  instances.clear();
+  ids.clear();
+  instancesChanged();
+}
+
+void InstancedGeode::setInstanceAttribLocation(GLuint first) {
+  GLint ma, mb;
+  glGetIntegerv(GL_MAX_VERTEX_ATTRIBS, &ma);
+  glGetIntegerv(GL_MAX_VERTEX_ATTRIB_BINDINGS, &mb);
+  if (first + 5 > static_cast<GLuint>(ma) || first >= static_cast<GLuint>(mb))
+    ERRT("Esta maquina no soporta tantos atributos");
+  // La primera posición es también el punto de vinculación del buffer de las instancias
+  if (first == Mesh::getInterleavedBinding())
+    ERRT("Las instancias no pueden usar el punto de vinculación de los vértices entrelazados");
+  firstAttrib = first;
+}
+
+void InstancedGeode::instancesChanged() {
+  instancesDirty = true;
+  invalidateBoundingVolumes();
+}
+
+void InstancedGeode::recomputeBoundingBox() {
+  auto modelBB = model->getBB();
+  if (!modelBB.isValid())
+    return;
+  for (const auto &inst : instances) {
+    auto b = modelBB;
+    b.transform(inst.transform);
+    bb.grow(b);
+  }
+}
+
+void InstancedGeode::recomputeBoundingSphere() {
+  auto modelBS = model->getBS();
+  if (!modelBS.isValid())
+    return;
+  for (const auto &inst : instances) {
+    auto s = modelBS;
+    s.transform(inst.transform);
+    bs.grow(s);
+  }
+}
+
+void InstancedGeode::writeInstances(std::shared_ptr<BufferObject> &buffer,
+  const std::vector<InstanceData> &data, const std::string &label) {
+  auto size = data.size() * sizeof(InstanceData);
+  if (!buffer || buffer->getSize() < size) {
+    buffer = BufferObject::build(size, GL_DYNAMIC_DRAW);
+    buffer->setGlDebugLabel(label);
+  }
+  auto prev = gl_array_buffer.bind(buffer);
+  gl_array_buffer.write(data.data(), size, 0);
+  gl_array_buffer.bind(prev);
+}
+
+void InstancedGeode::uploadInstances() {
+  if (!instancesDirty)
+    return;
+  writeInstances(instanceBuffer, instances, "Instancias de " + getName());
+  for (auto &mc : meshCommands)
+    mc.second.decodedDirty = true;
+  instancesDirty = false;
+}
+
+void InstancedGeode::uploadDecodedInstances(Mesh &m, MeshCommands &mc) {
+  // La descompresión se aplica antes que la matriz de la instancia, así que no se puede
+  // hacer con la matriz del modelo como en Mesh::render
+  if (!mc.decodedDirty && mc.decodedWith == m.getPositionDecodeMatrix())
+    return;
+  mc.decodedWith = m.getPositionDecodeMatrix();
+  std::vector<InstanceData> decoded(instances);
+  for (auto &inst : decoded)
+    inst.transform = inst.transform * mc.decodedWith;
+  writeInstances(mc.decodedInstances, decoded, "Instancias de " + getName() + " (" + m.getName() + ")");
+  mc.decodedDirty = false;
+}
+
+// Los atributos de las instancias usan su propio punto de vinculación (glBindVertexBuffer),
+// el de la primera posición de la matriz, en lugar de glVertexAttribPointer, que cambiaría el
+// buffer del punto con el mismo índice que cada atributo (y uno de ellos podría ser el de los
+// vértices entrelazados de la malla)
+void InstancedGeode::bindInstanceAttributes(const BufferObject &buffer) {
+  GLuint binding = firstAttrib;
+  glBindVertexBuffer(binding, buffer.getId(), 0, sizeof(InstanceData));
+  glVertexBindingDivisor(binding, 1);
+  for (GLuint c = 0; c < 4; c++) {
+    glEnableVertexAttribArray(firstAttrib + c);
+    glVertexAttribFormat(firstAttrib + c, 4, GL_FLOAT, GL_FALSE,
+      static_cast<GLuint>(offsetof(InstanceData, transform) + c * sizeof(glm::vec4)));
+    glVertexAttribBinding(firstAttrib + c, binding);
+  }
+  glEnableVertexAttribArray(firstAttrib + 4);
+  glVertexAttribFormat(firstAttrib + 4, 4, GL_FLOAT, GL_FALSE,
+    static_cast<GLuint>(offsetof(InstanceData, color)));
+  glVertexAttribBinding(firstAttrib + 4, binding);
+}
+
+void InstancedGeode::unbindInstanceAttributes() {
+  // El VAO es de la malla, que se puede estar dibujando también sin instancias: se deja cada
+  // atributo en su punto de vinculación por defecto y el punto de las instancias sin buffer
+  for (GLuint a = firstAttrib; a <= firstAttrib + 4; a++) {
+    glDisableVertexAttribArray(a);
+    glVertexAttribBinding(a, a);
+  }
+  glVertexBindingDivisor(firstAttrib, 0);
+  glBindVertexBuffer(firstAttrib, 0, 0, sizeof(InstanceData));
+}
+
+InstancedGeode::MeshCommands &InstancedGeode::getInstancedCommands(const std::shared_ptr<Mesh> &m) {
+  auto &mc = meshCommands[m.get()];
+  // Si la malla guardada se ha destruido, ésta es otra malla en la misma dirección
+  if (mc.mesh.expired()) {
+    for (auto c : mc.commands)
+      delete c;
+    mc = MeshCommands();
+    mc.mesh = m;
+  }
+  if (mc.source != m->getDrawCommands()) {
+    for (auto c : mc.commands)
+      delete c;
+    mc.commands.clear();
+    mc.source = m->getDrawCommands();
+    for (auto d : mc.source) {
+      auto inst = d->makeInstanced();
+      if (inst)
+        mc.commands.push_back(inst);
+      else
+        WARN("La malla " + m->getName() + " tiene órdenes de dibujo que no se pueden instanciar");
+    }
+  }
+  return mc;
+}
+
+void InstancedGeode::clearInstancedCommands() {
+  for (auto &mc : meshCommands) {
+    for (auto c : mc.second.commands)
+      delete c;
+  }
+  meshCommands.clear();
+}
+
+void InstancedGeode::dropDeadMeshes() {
+  for (auto it = meshCommands.begin(); it != meshCommands.end();) {
+    if (it->second.mesh.expired()) {
+      for (auto c : it->second.commands)
+        delete c;
+      it = meshCommands.erase(it);
+    }
+    else
+      ++it;
+  }
+}
+
+void InstancedGeode::setModel(std::shared_ptr<Model> m) {
+  clearInstancedCommands();
+  Geode::setModel(m);
+}
+
+void InstancedGeode::render() {
+  PGUPV::RenderStats::increment(PGUPV::RenderStats::Counter::NodesVisited);
+  if (!visible || instances.empty() || isOutsideViewVolume())
+    return;
+  PGUPV::RenderStats::increment(PGUPV::RenderStats::Counter::GeodesDrawn);
+  uploadInstances();
+
+  // Se descartan las órdenes guardadas de mallas que ya no están en el modelo
+  dropDeadMeshes();
+  if (meshCommands.size() > model->getNMeshes())
+    clearInstancedCommands();
+
+  auto count = static_cast<GLsizei>(instances.size());
+  for (uint i = 0; i < model->getNMeshes(); i++) {
+    auto mesh = model->getMeshPtr(i);
+    auto &m = *mesh;
+    auto &mc = getInstancedCommands(mesh);
+    auto &commands = mc.commands;
+    if (commands.empty())
+      continue;
+    const BufferObject *buffer = instanceBuffer.get();
+    if (m.hasQuantizedVertices()) {
+      uploadDecodedInstances(m, mc);
+      buffer = mc.decodedInstances.get();
+    }
+    PGUPV::RenderStats::increment(PGUPV::RenderStats::Counter::MeshesDrawn);
+    m.bindGeometry();
+    bindInstanceAttributes(*buffer);
+    if (auto mat = m.getMaterial())
+      mat->use();
+    for (auto c : commands) {
+      c->setInstanceCount(count);
+      c->render();
+    }
+    unbindInstanceAttributes();
+  }
+  CHECK_GL();
+}
@@ -0,0 +1,141 @@
+#include <algorithm>
+
+#include "jobPool.h"
+
+using PGUPV::JobPool;
+
+// Conjunto e índice de la cola del hilo actual, si es uno de los hilos de un JobPool
+static thread_local JobPool *currentPool = nullptr;
+static thread_local int currentQueue = -1;
+
+JobPool::JobPool(unsigned int numThreads) : pendingJobs(0), nextQueue(0), stopping(false) {
+	if (numThreads == 0) {
+		auto hw = std::thread::hardware_concurrency();
+		numThreads = hw > 1 ? hw - 1 : 0;
+	}
+	// Siempre hay al menos una cola, para poder encolar aunque no haya hilos
+	for (unsigned int i = 0; i < std::max(numThreads, 1u); i++)
+		queues.push_back(std::unique_ptr<WorkQueue>(new WorkQueue()));
+	for (unsigned int i = 0; i < numThreads; i++)
+		workers.emplace_back(&JobPool::workerLoop, this, i);
+}
+
+JobPool::~JobPool() {
+	{
+		std::lock_guard<std::mutex> lock(sleepMutex);
+		stopping = true;
+	}
+	wakeUp.notify_all();
+	for (auto &t : workers)
+		t.join();
+}
+
+void JobPool::submit(std::function<void()> job, Counter &counter) {
+	counter.pending.fetch_add(1, std::memory_order_relaxed);
+	size_t q;
+	if (currentPool == this)
+		q = static_cast<size_t>(currentQueue);
+	else
+		q = nextQueue.fetch_add(1, std::memory_order_relaxed) % queues.size();
+	{
+		std::lock_guard<std::mutex> lock(queues[q]->m);
+		queues[q]->jobs.push_back(Job{ std::move(job), &counter });
+	}
+	pendingJobs.fetch_add(1, std::memory_order_release);
+	// Tomar el cerrojo evita que un hilo compruebe que no hay trabajos y se duerma justo
+	// después de la notificación
+	{
+		std::lock_guard<std::mutex> lock(sleepMutex);
+	}
+	wakeUp.notify_one();
+	// Los hilos que esperan en wait también pueden ejecutarlo
+	waitChanged.notify_all();
+}
+
+bool JobPool::tryGetJob(int index, Job &job) {
+	if (pendingJobs.load(std::memory_order_acquire) == 0)
+		return false;
+	// Primero la cola propia, por el final (el último trabajo encolado tiene los datos más
+	// recientes en la caché)
+	if (index >= 0) {
+		auto &own = *queues[index];
+		std::lock_guard<std::mutex> lock(own.m);
+		if (!own.jobs.empty()) {
+			job = std::move(own.jobs.back());
+			own.jobs.pop_back();
+			pendingJobs.fetch_sub(1, std::memory_order_relaxed);
+			return true;
+		}
+	}
+	// Robar del principio de las demás colas
+	auto n = queues.size();
+	auto start = static_cast<size_t>(index >= 0 ? index + 1 : 0);
+	for (size_t i = 0; i < n; i++) {
+		auto &other = *queues[(start + i) % n];
+		std::lock_guard<std::mutex> lock(other.m);
+		if (!other.jobs.empty()) {
+			job = std::move(other.jobs.front());
+			other.jobs.pop_front();
+			pendingJobs.fetch_sub(1, std::memory_order_relaxed);
+			return true;
+		}
+	}
+	return false;
+}
+
+void JobPool::run(Job &job) {
+	try {
+		job.func();
+	}
+	catch (...) {
+		std::lock_guard<std::mutex> lock(job.counter->errorMutex);
+		if (!job.counter->error)
+			job.counter->error = std::current_exception();
+	}
+	job.func = nullptr;
+	// Después de la resta, el contador puede dejar de existir
+	if (job.counter->pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+		{
+			std::lock_guard<std::mutex> lock(sleepMutex);
+		}
+		waitChanged.notify_all();
+	}
+}
+
+void JobPool::workerLoop(unsigned int index) {
+	currentPool = this;
+	currentQueue = static_cast<int>(index);
+	Job job;
+	while (true) {
+		if (tryGetJob(currentQueue, job)) {
+			run(job);
+			continue;
+		}
+		std::unique_lock<std::mutex> lock(sleepMutex);
+		wakeUp.wait(lock, [this]() {
+			return stopping || pendingJobs.load(std::memory_order_acquire) > 0; });
+		if (stopping)
+			return;
+	}
+}
+
+void JobPool::wait(Counter &counter) {
+	int index = currentPool == this ? currentQueue : -1;
+	Job job;
+	while (!counter.isDone()) {
+		if (tryGetJob(index, job)) {
+			run(job);
+			continue;
+		}
+		// No hay nada que robar: los trabajos del grupo se están ejecutando en otros hilos
+		std::unique_lock<std::mutex> lock(sleepMutex);
+		waitChanged.wait(lock, [this, &counter]() {
+			return counter.isDone() || pendingJobs.load(std::memory_order_acquire) > 0; });
+	}
+	std::lock_guard<std::mutex> lock(counter.errorMutex);
+	if (counter.error) {
+		auto e = counter.error;
+		counter.error = nullptr;
+		std::rethrow_exception(e);
+	}
+}
@@ -0,0 +1,123 @@
+#include <algorithm>
+#include <limits>
+
+#include "lod.h"
+#include "nodeVisitor.h"
+#include "glMatrices.h"
+#include "indexedBindingPoint.h"
+#include "nodePool.h"
+#include "renderStats.h"
+#include "log.h"
+
+using PGUPV::LOD;
+using PGUPV::Node;
+using PGUPV::NodeVisitor;
+using PGUPV::GLMatrices;
+using PGUPV::BoundingSphere;
+
+std::shared_ptr<LOD> LOD::build() {
+  if (auto pool = PGUPV::NodePool::current())
+    return pool->make<LOD>();
+  return std::shared_ptr<LOD>(new LOD());
+}
+
+LOD::LOD() : hysteresis(0.1f), activeLevel(0), levelSelected(false) {
+}
+
+void LOD::addLevel(std::shared_ptr<Node> n, float minScreenSize) {
+  if (!minScreenSizes.empty() && minScreenSize > minScreenSizes.back())
+    WARN("Los niveles de detalle de " + getName() + " deberían añadirse de más a menos detallado");
+  Group::addChild(n);
+  minScreenSizes.push_back(minScreenSize);
+}
+
+void LOD::addChild(std::shared_ptr<Node> n) {
+  addLevel(n, 0.0f);
+}
+
+void LOD::removeChild(size_t i) {
+  Group::removeChild(i);
+  minScreenSizes.erase(minScreenSizes.begin() + i);
+  levelSelected = false;
+  activeLevel = 0;
+}
+
+void LOD::setMinScreenSize(size_t level, float minScreenSize) {
+  minScreenSizes[level] = minScreenSize;
+  levelSelected = false;
+}
+
+size_t LOD::selectLevel(float screenSize) {
+  auto n = children.size();
+  if (!levelSelected) {
+    activeLevel = 0;
+    while (activeLevel < n && screenSize < minScreenSizes[activeLevel])
+      activeLevel++;
+    levelSelected = true;
+    return activeLevel;
+  }
+  // Hacia niveles más detallados...
+  while (activeLevel > 0 && screenSize >= minScreenSizes[activeLevel - 1] * (1.0f + hysteresis))
+    activeLevel--;
+  // ...o más simples
+  while (activeLevel < n && screenSize < minScreenSizes[activeLevel] * (1.0f - hysteresis))
+    activeLevel++;
+  return activeLevel;
+}
+
+size_t LOD::selectLevel(const glm::mat4 &modelMatrix, const glm::mat4 &viewProj) {
+  auto s = getBS();
+  if (!s.isValid())
+    return selectLevel(0.0f);
+  s.transform(modelMatrix);
+  return selectLevel(computeScreenSize(s, viewProj));
+}
+
+Node *LOD::getActiveChild() const {
+  return activeLevel < children.size() ? children[activeLevel].get() : nullptr;
+}
+
+float LOD::computeScreenSize(const BoundingSphere &worldBS, const glm::mat4 &viewProj) {
+  // La fila y de viewProj es la de la vista escalada por el factor de proyección vertical
+  // (proj[1][1]), si la vista no tiene escalado. En perspectiva, w es la profundidad del centro;
+  // en proyección paralela, w vale 1
+  auto w = viewProj[0][3] * worldBS.center.x + viewProj[1][3] * worldBS.center.y +
+    viewProj[2][3] * worldBS.center.z + viewProj[3][3];
+  auto scaleY = glm::length(glm::vec3(viewProj[0][1], viewProj[1][1], viewProj[2][1]));
+  // Dentro de la esfera (o detrás de la cámara): se considera que ocupa toda la pantalla
+  if (w <= worldBS.radius * glm::length(glm::vec3(viewProj[0][3], viewProj[1][3], viewProj[2][3])))
+    return std::numeric_limits<float>::max();
+  return worldBS.radius * scaleY / w;
+}
+
+void LOD::render() {
+  PGUPV::RenderStats::increment(PGUPV::RenderStats::Counter::NodesVisited);
+  if (!visible || !getBB().isValid() || isOutsideViewVolume()) return;
+  auto mats = std::static_pointer_cast<GLMatrices>(
+    PGUPV::gl_uniform_buffer.getBound(UBO_GL_MATRICES_BINDING_INDEX));
+  if (mats) {
+    selectLevel(mats->getMatrix(GLMatrices::MODEL_MATRIX),
+      mats->getMatrix(GLMatrices::PROJ_MATRIX) * mats->getMatrix(GLMatrices::VIEW_MATRIX));
+  }
+  if (auto c = getActiveChild())
+    c->render();
+}
+
+void LOD::traverse(NodeVisitor &visitor) {
+  if (visitor.getTraversalMode() == NodeVisitor::TraversalMode::TRAVERSE_ACTIVE_CHILDREN) {
+    if (auto c = getActiveChild())
+      c->accept(visitor);
+  }
+  else
+    Group::traverse(visitor);
+}
+
+void LOD::accept(NodeVisitor &visitor) {
+  visitor.pushOntoNodePath(*this);
+  visitor.apply(*this);
+  visitor.popFromNodePath();
+}
+
+std::shared_ptr<LOD> LOD::shared_from_this() {
+  return std::static_pointer_cast<LOD>(Node::shared_from_this());
+}
@@ -4,6 +4,7 @@
 #include "indexedBindingPoint.h"
 #include "uboMaterial.h"
 #include "bindableTexture.h"
+#include "renderStats.h"
 
 
 using PGUPV::Material;
@@ -187,6 +188,7 @@ void Material::setAmbientMapTexture(std::shared_ptr<BindableTexture> tex, unsign
 }
 
 void Material::use() {
+	PGUPV::RenderStats::increment(PGUPV::RenderStats::Counter::MaterialBinds);
 	gl_uniform_buffer.bindBufferBase(ubomaterial, UBO_MATERIALS_BINDING_INDEX);
 	for (auto t : texs) {
 		t.second->bind(GL_TEXTURE0 + t.first);
@@ -2,6 +2,11 @@
 #include <glm/glm.hpp>
 #include <algorithm>
 #include <sstream>
+#include <cstring>
+#include <cmath>
+#include <atomic>
+#include <mutex>
+#include <unordered_map>
 #include <gsl/gsl>
 
 #include "indexedBindingPoint.h"
@@ -11,6 +16,12 @@
 #include "drawCommand.h"
 #include "uboBones.h"
 #include "skeleton.h"
+#include "renderStats.h"
+#include "glMatrices.h"
+#include "meshProcessing.h"
+#include "meshlets.h"
+#include "resourceTracker.h"
+#include "glStateTracker.h"
 
 using PGUPV::Mesh;
 using PGUPV::BoundingBox;
@@ -21,12 +32,68 @@ using PGUPV::DrawCommand;
 using PGUPV::BufferObject;
 using PGUPV::UBOBones;
 using PGUPV::Skeleton;
+using PGUPV::GLMatrices;
+using PGUPV::JobPool;
+using PGUPV::ResourceTracker;
 
 using glm::vec2;
 using glm::vec3;
 using glm::vec4;
 
-Mesh::Mesh() : vbos(_LAST_), epsilonSquared(1e-6f) {
+bool Mesh::defaultCPUMirror = false;
+
+// Bytes de todas las copias en memoria principal (ver Mesh::setCPUMirror)
+static std::atomic<size_t> totalCPUMirrorBytes(0);
+
+// Copia de cada buffer, para que otras mallas que lo usen (Mesh::setAttribute) compartan su
+// copia. Las entradas se borran al liberar la copia, que puede ocurrir en otro hilo. Un hilo
+// puede mantener viva la copia después de destruirse el buffer, y otro buffer puede ocupar
+// la misma dirección, así que cada entrada guarda también una referencia débil al buffer
+struct MirrorEntry {
+	std::weak_ptr<BufferObject> buffer;
+	std::weak_ptr<const std::vector<unsigned char>> mirror;
+};
+static std::mutex mirrorRegistryMutex;
+static std::unordered_map<const BufferObject *, MirrorEntry> mirrorRegistry;
+
+static std::shared_ptr<const std::vector<unsigned char>> buildMirror(const std::shared_ptr<BufferObject> &buffer,
+	const void *data, size_t size) {
+	const BufferObject *bo = buffer.get();
+	auto bytes = static_cast<const unsigned char *>(data);
+	totalCPUMirrorBytes += size;
+	auto memoryId = ResourceTracker::add(ResourceTracker::Category::CPUMirrors, size, bo->getGlDebugLabel());
+	std::shared_ptr<const std::vector<unsigned char>> mirror(new std::vector<unsigned char>(bytes, bytes + size),
+		[bo, memoryId](const std::vector<unsigned char> *m) {
+		totalCPUMirrorBytes -= m->size();
+		ResourceTracker::remove(memoryId);
+		{
+			std::lock_guard<std::mutex> lock(mirrorRegistryMutex);
+			auto it = mirrorRegistry.find(bo);
+			if (it != mirrorRegistry.end() && it->second.mirror.expired())
+				mirrorRegistry.erase(it);
+		}
+		delete m;
+	});
+	std::lock_guard<std::mutex> lock(mirrorRegistryMutex);
+	mirrorRegistry[bo] = MirrorEntry{ buffer, mirror };
+	return mirror;
+}
+
+static std::shared_ptr<const std::vector<unsigned char>> findMirror(const std::shared_ptr<BufferObject> &buffer) {
+	std::lock_guard<std::mutex> lock(mirrorRegistryMutex);
+	auto it = mirrorRegistry.find(buffer.get());
+	if (it == mirrorRegistry.end())
+		return nullptr;
+	// La entrada es de un buffer ya destruido que estaba en la misma dirección
+	if (it->second.buffer.lock() != buffer) {
+		mirrorRegistry.erase(it);
+		return nullptr;
+	}
+	return it->second.mirror.lock();
+}
+
+Mesh::Mesh() : vbos(_LAST_), layouts(_LAST_), mirrors(_LAST_), cpuMirror(defaultCPUMirror),
+	quantizedVertices(false), positionDecode(1.0f), epsilonSquared(1e-6f) {
 	indices_type = 0;
 	n_indices = 0;
 	n_vertices = 0;
@@ -88,6 +155,7 @@ void Mesh::createBufferAndCopy(uint attribIndex, size_t size, GLenum usage,
 		label = "Atributo Indeterminado";
 	}
 	vbos[attribIndex]->setGlDebugLabel(label);
+	mirrorBuffer(attribIndex, data, size);
 
 	if (attribIndex == INDICES) {
 		gl_element_array_buffer.bind(vbos[attribIndex]);
@@ -129,143 +197,23 @@ void Mesh::addVertices(const float *v, uint ncomponents, size_t nVertices,
 	bs = computeBoundingSphere(v, ncomponents, nVertices);
 }
 
-static glm::vec3 getVec3FromMemory(float *cs, uint ncomponents, uint which) {
-	ulong off = ncomponents * which;
-	if (ncomponents == 3 || ncomponents == 4) return glm::vec3(cs[off], cs[off + 1], cs[off + 2]);
-	else if (ncomponents == 2) return glm::vec3(cs[off], cs[off + 1], 0.0f);
-	else return glm::vec3(cs[off], 0.0f, 0.0f);
-}
-
-
-
-bool Mesh::sameVertex(float *vs, uint ncomponents, uint a, uint b) {
-	float distance = 0.0;
-	for (uint i = 0; i < ncomponents; i++) {
-		float t = vs[ncomponents*  a + i] - vs[ncomponents*  b + i];
-		distance += t * t;
-	}
-	return distance < epsilonSquared;
-}
-
-void Mesh::computeSmoothNormals() {
+void Mesh::computeSmoothNormals(float creaseAngle, JobPool *pool) {
 
 	if (drawCommands.empty()) {
 		ERRT("Llama a Mesh::computeSmoothNormals *después* de haber definido "
 			"completamente la malla, con sus vértices, índices y drawCommands");
 	}
-	vao.bind();
-
-	void *indices;
-	if (n_indices == 0) {
-		indices = nullptr;
-	}
-	else {
-		auto idx = getBufferObject(INDICES);
-		gl_copy_write_buffer.bind(idx);
-		indices = gl_copy_write_buffer.map(GL_READ_ONLY);
-	}
-
-	// Conseguir los vértices
-	auto vtx = getBufferObject(VERTICES);
-	gl_copy_read_buffer.bind(vtx);
-	GLfloat *vs = static_cast<GLfloat *>(gl_copy_read_buffer.map(GL_READ_ONLY));
-
-	// Preguntar por su formato
-	GLint ncomponents;
-	GLint vtxFormat;
-	glGetVertexAttribiv(VERTICES, GL_VERTEX_ATTRIB_ARRAY_SIZE, &ncomponents);
-	glGetVertexAttribiv(VERTICES, GL_VERTEX_ATTRIB_ARRAY_TYPE, &vtxFormat);
-
-	assert(vtxFormat == GL_FLOAT);
-
-	std::vector<glm::vec3> smoothNormals(n_vertices, glm::vec3(0.0f, 0.0f, 0.0f));
-	std::vector<uint> count(n_vertices, 0);
-
-	// Para cada DrawCommand...
-	for (auto drawCommand : drawCommands) {
-		auto ids = drawCommand->getTrianglesIndices(indices);
-		for (auto t : ids) {
-			assert(t.idx[0] < n_vertices && t.idx[1] < n_vertices && t.idx[2] < n_vertices);
-			auto a = getVec3FromMemory(vs, ncomponents, t.idx[0]);
-			auto b = getVec3FromMemory(vs, ncomponents, t.idx[1]);
-			auto c = getVec3FromMemory(vs, ncomponents, t.idx[2]);
-
-			// Normal geométrica al triángulo
-			glm::vec3 un = glm::cross(b - a, c - a);
-			float module = glm::length(un);
-			if (module < 1e-5) {
-				// Triángulo degenerado: descartar
-				continue;
-			}
-
-			auto n = un / module;
-
-			// Acumulamos la normal a sus vértices, ponderada por el ángulo del vértice en cuestión
-			float ang[3] = {
-				acosf(glm::dot(glm::normalize(b - a), glm::normalize(c - a))),
-				acosf(glm::dot(glm::normalize(c - b), glm::normalize(a - b))),
-				acosf(glm::dot(glm::normalize(a - c), glm::normalize(b - c))) };
-
-			for (int i = 0; i < 3; i++) {
-				smoothNormals[t.idx[i]] += n * ang[i];
-				count[t.idx[i]]++;
-			}
-		}
-	}
-
-	// Segunda vuelta para buscar vértices que geométricamente sean iguales, pero no semánticamente
-	std::vector<GLuint> findDups(n_vertices);
-	for (uint i = 0; i < n_vertices; i++) {
-		findDups[i] = i;
-	}
-
-	std::sort(findDups.begin(), findDups.end(),
-		[vs, ncomponents](GLuint a, GLuint b) {  // ordenar primero por la x, luego por la y, y luego por la z
-		for (int i = 0; i < ncomponents; i++) {
-			float va = vs[ncomponents * a + i];
-			float vb = vs[ncomponents * b + i];
-			if (va < vb) return true;
-			if (va > vb) return false;
-		}
-		// son iguales: los dejamos como están
-		return false;
-	});
-
-	// Ahora buscamos vértices que sean iguales (sus índices estarán correlativos en el vector findDups)
-	uint firstInRun = 0;
-	for (uint i = 1; i < findDups.size(); i++) {
-		uint lastInRun = firstInRun;
-		while (i < findDups.size() && sameVertex(vs, ncomponents, findDups[i - 1], findDups[i])) {
-			lastInRun = i;
-			i++;
-		}
-		if (lastInRun - firstInRun >= 1) {
-			// Sumar todas las normales y asignarle el resultado a todos los vértices
-			glm::vec3 normalSum(0.0f);
-			for (uint j = firstInRun; j <= lastInRun; j++) {
-				normalSum += smoothNormals[findDups[j]];
-			}
-			for (uint j = firstInRun; j <= lastInRun; j++) {
-				smoothNormals[findDups[j]] = normalSum;
-			}
-		}
-		firstInRun = i;
-	}
-
-
-	// Renormalizar
-	for (uint i = 0; i < smoothNormals.size(); i++) {
-		smoothNormals[i] = glm::normalize(smoothNormals[i]);
-	}
-
-	if (n_indices > 0) {
-		gl_copy_write_buffer.unmap();
-		gl_copy_write_buffer.unbind();
-	}
-	gl_copy_read_buffer.unmap();
-	gl_copy_read_buffer.unbind();
+	auto normals = PGUPV::MeshProcessing::computeSmoothNormals(getVertices(), getTriangles(), creaseAngle,
+		std::sqrt(epsilonSquared), pool);
+	addNormals(normals);
+}
 
-	addNormals(smoothNormals);
+void Mesh::computeTangents(unsigned int texCoordSet, JobPool *pool) {
+	if (!vbos[NORMALS] || !vbos[TEX_COORD0 + texCoordSet])
+		ERRT("Para calcular las tangentes de la malla " + name + " hacen falta sus normales y sus coordenadas de textura");
+	auto tangents = PGUPV::MeshProcessing::computeTangents(getVertices(), getNormals(),
+		getTexCoords(texCoordSet), getTriangles(), pool);
+	addTangents(tangents);
 }
 
 void Mesh::addIndices(const GLubyte *i, size_t n, GLenum usage) {
@@ -349,10 +297,177 @@ void Mesh::addTangents(const float *t, size_t n, GLenum usage) {
 	glVertexAttribPointer(TANGENTS, 3, GL_FLOAT, GL_FALSE, 0, 0);
 }
 
+void Mesh::addTangents(const glm::vec4 *t, size_t n, GLenum usage) {
+	prepareNewVBO(TANGENTS);
+
+	if (n == 0)
+		return;
+
+	createBufferAndCopy(TANGENTS, sizeof(glm::vec4) * n, usage, t);
+	glEnableVertexAttribArray(TANGENTS);
+	glVertexAttribPointer(TANGENTS, 4, GL_FLOAT, GL_FALSE, 0, 0);
+}
+
 void Mesh::setTangent(const glm::vec3 &t) {
 	setAttribute(TANGENTS, t);
 }
 
+// Conversión a IEEE 754 binary16, redondeando al más cercano
+uint16_t Mesh::packHalfFloat(float f) {
+	uint32_t x;
+	std::memcpy(&x, &f, sizeof(x));
+	uint16_t sign = static_cast<uint16_t>((x >> 16) & 0x8000);
+	int32_t biasedExp = static_cast<int32_t>((x >> 23) & 0xff);
+	uint32_t mantissa = x & 0x7fffff;
+	if (biasedExp == 0xff) // infinito o NaN
+		return sign | 0x7c00 | (mantissa ? 0x200 : 0);
+	int32_t exp = biasedExp - 127 + 15;
+	if (exp >= 31)
+		return sign | 0x7c00;
+	if (exp <= 0) {
+		// Desnormalizado (o cero)
+		if (exp < -10)
+			return sign;
+		mantissa |= 0x800000;
+		uint32_t shift = static_cast<uint32_t>(14 - exp);
+		uint32_t h = mantissa >> shift;
+		if ((mantissa >> (shift - 1)) & 1)
+			h++;
+		return static_cast<uint16_t>(sign | h);
+	}
+	uint32_t h = (static_cast<uint32_t>(exp) << 10) | (mantissa >> 13);
+	// Si el redondeo desborda la mantisa, incrementa el exponente, que es lo correcto
+	if (mantissa & 0x1000)
+		h++;
+	return static_cast<uint16_t>(sign | h);
+}
+
+static float halfToFloat(uint16_t h) {
+	uint32_t sign = static_cast<uint32_t>(h & 0x8000) << 16;
+	uint32_t exp = (h >> 10) & 0x1f;
+	uint32_t mantissa = h & 0x3ff;
+	if (exp == 0) {
+		float f = std::ldexp(static_cast<float>(mantissa), -24);
+		return sign ? -f : f;
+	}
+	uint32_t x = exp == 31 ? (sign | 0x7f800000 | (mantissa << 13)) : (sign | ((exp + 112) << 23) | (mantissa << 13));
+	float f;
+	std::memcpy(&f, &x, sizeof(f));
+	return f;
+}
+
+// x va en los bits menos significativos
+uint32_t Mesh::packSnorm1010102(const glm::vec3 &v, float w) {
+	auto quantize = [](float f, float maxValue) {
+		return static_cast<uint32_t>(static_cast<int32_t>(std::round(glm::clamp(f, -1.0f, 1.0f) * maxValue)));
+	};
+	return (quantize(v.x, 511.0f) & 0x3ff) | ((quantize(v.y, 511.0f) & 0x3ff) << 10) |
+		((quantize(v.z, 511.0f) & 0x3ff) << 20) | ((quantize(w, 1.0f) & 0x3) << 30);
+}
+
+static float unpackSnorm10(uint32_t packed, int shift) {
+	// Extensión del signo de los 10 bits
+	auto value = static_cast<int32_t>(packed << (22 - shift)) >> 22;
+	return std::max(value / 511.0f, -1.0f);
+}
+
+void Mesh::addQuantizedVertices(const glm::vec3 *v, size_t n, GLenum usage) {
+	prepareNewVBO(VERTICES);
+
+	n_vertices = n;
+	if (n == 0)
+		return;
+	n_components_per_vertex = 3;
+
+	bb = computeBoundingBox(&v[0].x, 3, n);
+	bs = computeBoundingSphere(&v[0].x, 3, n);
+
+	// La misma escala en los tres ejes, para que la matriz de descompresión no deforme las normales
+	auto extent = bb.max - bb.min;
+	float scale = std::max(std::max(extent.x, extent.y), extent.z);
+	if (scale <= 0.0f)
+		scale = 1.0f;
+	std::vector<glm::u16vec4> quantized(n);
+	for (size_t i = 0; i < n; i++) {
+		auto q = glm::clamp(glm::round((v[i] - bb.min) / scale * 65535.0f), 0.0f, 65535.0f);
+		quantized[i] = glm::u16vec4(static_cast<uint16_t>(q.x), static_cast<uint16_t>(q.y),
+			static_cast<uint16_t>(q.z), 65535);
+	}
+	createBufferAndCopy(VERTICES, sizeof(glm::u16vec4) * n, usage, quantized.data());
+	glEnableVertexAttribArray(VERTICES);
+	glVertexAttribPointer(VERTICES, 4, GL_UNSIGNED_SHORT, GL_TRUE, 0, 0);
+	layouts[VERTICES].type = GL_UNSIGNED_SHORT;
+	layouts[VERTICES].stride = sizeof(glm::u16vec4);
+
+	quantizedVertices = true;
+	positionDecode = glm::mat4(scale);
+	positionDecode[3] = glm::vec4(bb.min, 1.0f);
+}
+
+void Mesh::pushPositionDecode() {
+	if (!quantizedVertices)
+		return;
+	auto mats = std::static_pointer_cast<GLMatrices>(
+		PGUPV::gl_uniform_buffer.getBound(UBO_GL_MATRICES_BINDING_INDEX));
+	if (!mats) {
+		WARN("No hay un GLMatrices activo para descomprimir las posiciones de la malla " + name);
+		return;
+	}
+	mats->pushMatrix(GLMatrices::MODEL_MATRIX);
+	mats->multMatrix(GLMatrices::MODEL_MATRIX, positionDecode);
+}
+
+void Mesh::popPositionDecode() {
+	if (!quantizedVertices)
+		return;
+	auto mats = std::static_pointer_cast<GLMatrices>(
+		PGUPV::gl_uniform_buffer.getBound(UBO_GL_MATRICES_BINDING_INDEX));
+	if (mats)
+		mats->popMatrix(GLMatrices::MODEL_MATRIX);
+}
+
+void Mesh::addPackedVec3(uint attribIndex, const glm::vec3 *v, size_t n, GLenum usage) {
+	prepareNewVBO(attribIndex);
+
+	if (n == 0)
+		return;
+
+	std::vector<uint32_t> packed(n);
+	for (size_t i = 0; i < n; i++)
+		packed[i] = packSnorm1010102(v[i], 0.0f);
+	createBufferAndCopy(attribIndex, sizeof(uint32_t) * n, usage, packed.data());
+	glEnableVertexAttribArray(attribIndex);
+	glVertexAttribPointer(attribIndex, 4, GL_INT_2_10_10_10_REV, GL_TRUE, 0, 0);
+	layouts[attribIndex].type = GL_INT_2_10_10_10_REV;
+	layouts[attribIndex].stride = sizeof(uint32_t);
+}
+
+void Mesh::addPackedNormals(const glm::vec3 *nr, size_t n, GLenum usage) {
+	addPackedVec3(NORMALS, nr, n, usage);
+}
+
+void Mesh::addPackedTangents(const glm::vec3 *t, size_t n, GLenum usage) {
+	addPackedVec3(TANGENTS, t, n, usage);
+}
+
+void Mesh::addHalfTexCoord(uint tex_unit, const glm::vec2 *t, size_t n, GLenum usage) {
+	prepareNewVBO(TEX_COORD0 + tex_unit);
+
+	if (n == 0)
+		return;
+
+	std::vector<uint16_t> halfs(n * 2);
+	for (size_t i = 0; i < n; i++) {
+		halfs[i * 2] = packHalfFloat(t[i].x);
+		halfs[i * 2 + 1] = packHalfFloat(t[i].y);
+	}
+	createBufferAndCopy(TEX_COORD0 + tex_unit, sizeof(uint16_t) * halfs.size(), usage, halfs.data());
+	glEnableVertexAttribArray(TEX_COORD0 + tex_unit);
+	glVertexAttribPointer(TEX_COORD0 + tex_unit, 2, GL_HALF_FLOAT, GL_FALSE, 0, 0);
+	layouts[TEX_COORD0 + tex_unit].type = GL_HALF_FLOAT;
+	layouts[TEX_COORD0 + tex_unit].stride = 2 * sizeof(uint16_t);
+}
+
 
 void Mesh::setSkeleton(std::shared_ptr<Skeleton> skel)
 {
@@ -444,6 +559,94 @@ void Mesh::addBoneWeights(const std::vector<glm::vec4> &boneWeights, GLenum usag
 	glVertexAttribPointer(BONE_WEIGHTS, 4, GL_FLOAT, 0, 0, 0);
 }
 
+GLuint Mesh::getInterleavedBinding() {
+	static GLint binding = -1;
+	if (binding < 0) {
+		GLint maxBindings, maxAttribs;
+		glGetIntegerv(GL_MAX_VERTEX_ATTRIB_BINDINGS, &maxBindings);
+		glGetIntegerv(GL_MAX_VERTEX_ATTRIBS, &maxAttribs);
+		binding = maxBindings > maxAttribs ? maxAttribs : maxBindings - 1;
+	}
+	return static_cast<GLuint>(binding);
+}
+
+void Mesh::setInterleavedVertices(const void *data, size_t nVertices, GLsizei stride,
+	const std::vector<InterleavedAttribute> &attribs, GLenum usage) {
+	const InterleavedAttribute *position = nullptr;
+	for (const auto &a : attribs) {
+		if (a.attribIndex == INDICES)
+			ERRT("Los índices no pueden estar en el buffer de vértices entrelazado");
+		if (a.attribIndex == VERTICES)
+			position = &a;
+	}
+	if (position == nullptr || position->type != GL_FLOAT || position->ncomponents < 2)
+		ERRT("El buffer entrelazado tiene que contener la posición de los vértices, de tipo GL_FLOAT");
+
+	auto binding = getInterleavedBinding();
+	if (binding < vbos.size() && vbos[binding] && !layouts[binding].interleaved)
+		ERRT("El atributo " + std::to_string(binding) + " no se puede usar en una malla con vértices entrelazados");
+
+	// Los atributos del buffer entrelazado anterior que no estén en el nuevo se quedan sin buffer
+	vao.bind();
+	for (uint i = 0; i < layouts.size(); i++) {
+		if (!layouts[i].interleaved)
+			continue;
+		glDisableVertexAttribArray(i);
+		vbos[i].reset();
+		mirrors[i].reset();
+		layouts[i] = AttributeLayout();
+	}
+	for (const auto &a : attribs) {
+		prepareNewVBO(a.attribIndex);
+		vbos[a.attribIndex].reset();
+	}
+
+	n_vertices = nVertices;
+	n_components_per_vertex = position->ncomponents;
+	if (nVertices == 0)
+		return;
+
+	auto bo = BufferObject::build(nVertices * stride, usage);
+	bo->setGlDebugLabel("Vértices entrelazados");
+	gl_array_buffer.bind(bo);
+	gl_array_buffer.write(data);
+
+	std::shared_ptr<const CPUBuffer> mirror;
+	if (cpuMirror)
+		mirror = buildMirror(bo, data, nVertices * stride);
+
+	glBindVertexBuffer(binding, bo->getId(), 0, stride);
+	for (const auto &a : attribs) {
+		glEnableVertexAttribArray(a.attribIndex);
+		if (a.integer)
+			glVertexAttribIFormat(a.attribIndex, a.ncomponents, a.type, a.offset);
+		else
+			glVertexAttribFormat(a.attribIndex, a.ncomponents, a.type, a.normalized, a.offset);
+		glVertexAttribBinding(a.attribIndex, binding);
+		vbos[a.attribIndex] = bo;
+		mirrors[a.attribIndex] = mirror;
+		layouts[a.attribIndex].offset = a.offset;
+		layouts[a.attribIndex].stride = stride;
+		layouts[a.attribIndex].interleaved = true;
+		layouts[a.attribIndex].type = a.type;
+	}
+
+	// Los volúmenes de inclusión se calculan con las posiciones desentrelazadas
+	std::vector<float> positions(nVertices * position->ncomponents);
+	auto src = static_cast<const char *>(data) + position->offset;
+	for (size_t i = 0; i < nVertices; i++) {
+		std::memcpy(&positions[i * position->ncomponents], src + i * stride,
+			sizeof(float) * position->ncomponents);
+	}
+	bb = computeBoundingBox(positions.data(), position->ncomponents, nVertices);
+	bs = computeBoundingSphere(positions.data(), position->ncomponents, nVertices);
+	CHECK_GL();
+}
+
+bool Mesh::isInterleaved(uint attribIndex) const {
+	return attribIndex < layouts.size() && layouts[attribIndex].interleaved;
+}
+
 void Mesh::addAttributeSetup(uint attribute_index, uint type_size,
 	const void *a, uint ncomponents, size_t n, GLenum usage) {
 	if (attribute_index < _LAST_)
@@ -452,6 +655,10 @@ void Mesh::addAttributeSetup(uint attribute_index, uint type_size,
 	glGetIntegerv(GL_MAX_VERTEX_ATTRIBS, &ma);
 	if (attribute_index >= (uint)ma)
 		ERRT("Esta maquina no soporta tantos atributos");
+	// glVertexAttribPointer cambiaría el buffer del punto de vinculación de los entrelazados
+	if (attribute_index == getInterleavedBinding() &&
+		std::any_of(layouts.begin(), layouts.end(), [](const AttributeLayout &l) { return l.interleaved; }))
+		ERRT("El atributo " + std::to_string(attribute_index) + " no se puede usar en una malla con vértices entrelazados");
 
 	prepareNewVBO(attribute_index);
 
@@ -490,6 +697,8 @@ void Mesh::setAttributeSetup(uint attribute_index, std::shared_ptr<BufferObject>
 	prepareNewVBO(attribute_index);
 
 	vbos[attribute_index] = bo;
+	if (cpuMirror)
+		mirrors[attribute_index] = findMirror(bo);
 	gl_array_buffer.bind(vbos[attribute_index]);
 
 	glEnableVertexAttribArray(attribute_index);
@@ -564,13 +773,10 @@ void Mesh::render() {
 
 void Mesh::render(const std::vector<DrawCommand*>& commands)
 {
-	vao.bind();
+	PGUPV::RenderStats::increment(PGUPV::RenderStats::Counter::MeshesDrawn);
+	bindGeometry();
 	if (material) material->use();
-	if (bones) bones->use();
-
-	for (std::vector<StaticAttribute>::iterator i = staticAttrValues.begin();
-		i != staticAttrValues.end(); ++i)
-		glVertexAttrib4fv(i->attrIndex, &i->value.x);
+	pushPositionDecode();
 
 #ifdef _DEBUG
 	if (commands.empty()) {
@@ -579,6 +785,25 @@ void Mesh::render(const std::vector<DrawCommand*>& commands)
 #endif
 	for (auto d : commands)
 		d->render();
+	popPositionDecode();
+	CHECK_GL();
+}
+
+void Mesh::bindGeometry() {
+	vao.bind();
+	if (bones) bones->use();
+
+	for (std::vector<StaticAttribute>::iterator i = staticAttrValues.begin();
+		i != staticAttrValues.end(); ++i)
+		PGUPV::GLStateTracker::vertexAttrib4fv(i->attrIndex, &i->value.x);
+}
+
+void Mesh::renderDrawCommands() {
+	PGUPV::RenderStats::increment(PGUPV::RenderStats::Counter::MeshesDrawn);
+	pushPositionDecode();
+	for (auto d : drawCommands)
+		d->render();
+	popPositionDecode();
 	CHECK_GL();
 }
 
@@ -633,11 +858,80 @@ std::ostream &PGUPV::operator<<(std::ostream &os, const BoundingSphere &s) {
 	return os;
 }
 
+void Mesh::mirrorBuffer(uint attribIndex, const void *data, size_t size) {
+	if (cpuMirror)
+		mirrors[attribIndex] = buildMirror(vbos[attribIndex], data, size);
+}
+
+std::shared_ptr<const Mesh::CPUBuffer> Mesh::getMirror(uint attribIndex) const {
+	return attribIndex < mirrors.size() ? mirrors[attribIndex] : nullptr;
+}
+
+void Mesh::setCPUMirror(bool keep) {
+	cpuMirror = keep;
+	if (!keep) {
+		for (auto &m : mirrors)
+			m.reset();
+		return;
+	}
+	// Se copian los buffers que ya tuviera la malla (los compartidos, una sola vez)
+	for (uint i = 0; i < vbos.size(); i++) {
+		if (!vbos[i] || mirrors[i])
+			continue;
+		mirrors[i] = findMirror(vbos[i]);
+		if (mirrors[i])
+			continue;
+		auto prev = PGUPV::gl_copy_read_buffer.bind(vbos[i]);
+		auto data = PGUPV::gl_copy_read_buffer.map(GL_READ_ONLY);
+		assert(data != nullptr);
+		mirrors[i] = buildMirror(vbos[i], data, vbos[i]->getSize());
+		PGUPV::gl_copy_read_buffer.unmap();
+		PGUPV::gl_copy_read_buffer.bind(prev);
+	}
+}
+
+void Mesh::setDefaultCPUMirror(bool keep) {
+	defaultCPUMirror = keep;
+}
+
+size_t Mesh::getCPUMirrorSize() const {
+	size_t total = 0;
+	for (uint i = 0; i < mirrors.size(); i++) {
+		if (!mirrors[i])
+			continue;
+		// Los atributos entrelazados comparten la copia
+		bool counted = false;
+		for (uint j = 0; j < i && !counted; j++)
+			counted = mirrors[j] == mirrors[i];
+		if (!counted)
+			total += mirrors[i]->size();
+	}
+	return total;
+}
+
+size_t Mesh::getTotalCPUMirrorSize() {
+	return totalCPUMirrorBytes;
+}
+
 void Mesh::prepareNewVBO(uint attribIndex) {
 	vao.bind();
 	if (attribIndex >= vbos.size()) {
 		vbos.resize(attribIndex + 1);
 	}
+	if (attribIndex >= layouts.size()) {
+		layouts.resize(attribIndex + 1);
+	}
+	if (attribIndex >= mirrors.size()) {
+		mirrors.resize(attribIndex + 1);
+	}
+	mirrors[attribIndex].reset();
+	// Si estaba en un buffer entrelazado, el nuevo buffer lo sustituye (glVertexAttribPointer
+	// lo vuelve a vincular a su propio punto de vinculación)
+	layouts[attribIndex] = AttributeLayout();
+	if (attribIndex == VERTICES) {
+		quantizedVertices = false;
+		positionDecode = glm::mat4(1.0f);
+	}
 	if (removeStaticAttributeValue(attribIndex))
 		WARN("Sustituyendo un valor estático asociado al atributo " +
 			std::to_string(attribIndex) +
@@ -670,45 +964,174 @@ const std::string Mesh::to_string() const {
 	return os.str();
 }
 
+// Lee la componente c de un atributo guardado con el tipo indicado (ver Mesh::AttributeLayout)
+static float decodeComponent(const char *src, GLenum type, int c) {
+	switch (type) {
+	case GL_HALF_FLOAT: {
+		uint16_t h;
+		std::memcpy(&h, src + c * sizeof(h), sizeof(h));
+		return halfToFloat(h);
+	}
+	case GL_UNSIGNED_SHORT: {
+		uint16_t s;
+		std::memcpy(&s, src + c * sizeof(s), sizeof(s));
+		return s / 65535.0f;
+	}
+	case GL_INT_2_10_10_10_REV: {
+		uint32_t packed;
+		std::memcpy(&packed, src, sizeof(packed));
+		return unpackSnorm10(packed, c * 10);
+	}
+	default: {
+		float f;
+		std::memcpy(&f, src + c * sizeof(f), sizeof(f));
+		return f;
+	}
+	}
+}
+
+namespace {
+	// Da acceso al contenido de un buffer de la malla: desde su copia en memoria principal, si
+	// la tiene, o mapeando el buffer (sólo en el hilo del contexto de OpenGL)
+	class BufferReader {
+	public:
+		BufferReader(std::shared_ptr<BufferObject> bo, std::shared_ptr<const std::vector<unsigned char>> mirror)
+			: mirror(mirror) {
+			if (mirror) {
+				data = reinterpret_cast<const char *>(mirror->data());
+			}
+			else {
+				prev = PGUPV::gl_copy_read_buffer.bind(bo);
+				data = static_cast<const char *>(PGUPV::gl_copy_read_buffer.map(GL_READ_ONLY));
+				assert(data != nullptr);
+			}
+		}
+		~BufferReader() {
+			if (!mirror) {
+				PGUPV::gl_copy_read_buffer.unmap();
+				PGUPV::gl_copy_read_buffer.bind(prev);
+			}
+		}
+		const char *get() const { return data; }
+	private:
+		std::shared_ptr<const std::vector<unsigned char>> mirror;
+		std::shared_ptr<BufferObject> prev;
+		const char *data;
+	};
+};
+
+// offset y stride (en bytes) indican dónde está el atributo si el buffer es entrelazado, y
+// type el tipo con el que se guardaron sus componentes
 template <typename V>
-std::vector<V> copyFromPFloatToVectorVec(std::shared_ptr<BufferObject> vbo, size_t count, int n_components = 3) {
-	auto prev = PGUPV::gl_copy_read_buffer.bind(vbo);
-	float *vb = static_cast<float *>(PGUPV::gl_copy_read_buffer.map(GL_READ_ONLY));
-	assert(vb != nullptr);
+std::vector<V> copyFromPFloatToVectorVec(const BufferReader &src, size_t count, int n_components = 3,
+	size_t offset = 0, size_t stride = 0, GLenum type = GL_FLOAT) {
+	if (stride == 0)
+		stride = n_components * sizeof(float);
+	auto base = src.get();
 
 	std::vector<V> dst;
+	dst.reserve(count);
 	for (size_t i = 0; i < count; i++) {
+		auto vb = base + offset + i * stride;
 		V v;
 		for (typename V::length_type c = 0; c < V::length(); c++) {
 			if (c < n_components) {
-				v[c] = vb[c];
+				v[c] = decodeComponent(vb, type, c);
 			}
 			else {
 				v[c] = 0.0f;
 			}
 		}
 		dst.push_back(v);
-		vb += n_components;
 	}
-	PGUPV::gl_copy_read_buffer.unmap();
-	PGUPV::gl_copy_read_buffer.bind(prev);
 	return dst;
 }
 
+static bool isTrianglePrimitive(GLenum mode) {
+	return mode == GL_TRIANGLES || mode == GL_TRIANGLE_STRIP || mode == GL_TRIANGLE_FAN;
+}
+
+// Sólo estas órdenes implementan DrawCommand::getTrianglesIndices
+static bool canListTriangles(DrawCommand *d) {
+	return dynamic_cast<PGUPV::DrawArrays *>(d) || dynamic_cast<PGUPV::DrawElements *>(d);
+}
+
+std::vector<PGUPV::TriangleIndices> Mesh::getTriangles() const
+{
+	std::vector<PGUPV::TriangleIndices> dst;
+
+	std::unique_ptr<BufferReader> reader;
+	void *indices = nullptr;
+	if (n_indices > 0) {
+		reader.reset(new BufferReader(vbos[INDICES], getMirror(INDICES)));
+		indices = const_cast<char *>(reader->get());
+	}
+
+	for (auto d : drawCommands) {
+		if (!isTrianglePrimitive(d->getGLPrimitiveType()))
+			continue;
+		if (!canListTriangles(d)) {
+			WARN("No se pueden obtener los triángulos de una orden de dibujo de la malla " + name);
+			continue;
+		}
+		for (const auto &t : d->getTrianglesIndices(indices)) {
+			if (t.idx[0] < n_vertices && t.idx[1] < n_vertices && t.idx[2] < n_vertices)
+				dst.push_back(t);
+		}
+	}
+	return dst;
+}
+
+PGUPV::MeshletDrawElements *Mesh::buildMeshlets(unsigned int maxVertices, unsigned int maxTriangles) {
+	for (auto d : drawCommands) {
+		if (!isTrianglePrimitive(d->getGLPrimitiveType()) || !canListTriangles(d))
+			ERRT("Sólo se pueden dividir en meshlets las mallas que dibujan triángulos con DrawArrays o DrawElements (" +
+				name + ")");
+	}
+
+	std::vector<uint32_t> indices;
+	for (const auto &t : getTriangles()) {
+		indices.push_back(t.idx[0]);
+		indices.push_back(t.idx[1]);
+		indices.push_back(t.idx[2]);
+	}
+	auto meshlets = PGUPV::MeshletBuilder::build(indices, getVertices(), maxVertices, maxTriangles);
+
+	if (n_vertices < 65536)
+		addIndices(std::vector<GLushort>(indices.begin(), indices.end()));
+	else
+		addIndices(indices);
+	clearDrawCommands();
+	auto draw = new PGUPV::MeshletDrawElements(meshlets, indices_type, nullptr, glm::inverse(positionDecode));
+	addDrawCommand(draw);
+	INFO("Malla " + name + " dividida en " + std::to_string(meshlets.size()) + " meshlets");
+	return draw;
+}
+
 
 std::vector<glm::vec3> Mesh::getVertices() const {
-	auto dst = copyFromPFloatToVectorVec<glm::vec3>(vbos[VERTICES], n_vertices, n_components_per_vertex);
+	const auto &l = layouts[VERTICES];
+	auto dst = copyFromPFloatToVectorVec<glm::vec3>(BufferReader(vbos[VERTICES], getMirror(VERTICES)), n_vertices,
+		n_components_per_vertex, l.offset, l.stride, l.type);
+	if (quantizedVertices) {
+		for (auto &v : dst)
+			v = glm::vec3(positionDecode * glm::vec4(v, 1.0f));
+	}
 	return dst;
 }
 
 std::vector<glm::vec3> Mesh::getNormals() const {
 	if (!vbos[NORMALS]) return std::vector<glm::vec3>();
-	return copyFromPFloatToVectorVec<glm::vec3>(vbos[NORMALS], n_vertices);
+	const auto &l = layouts[NORMALS];
+	return copyFromPFloatToVectorVec<glm::vec3>(BufferReader(vbos[NORMALS], getMirror(NORMALS)), n_vertices, 3,
+		l.offset, l.stride, l.type);
 }
 
 std::vector<glm::vec2> Mesh::getTexCoords(unsigned int texCoordSet) const {
 	if (!vbos[TEX_COORD0 + texCoordSet]) return std::vector<glm::vec2>();
-	return copyFromPFloatToVectorVec<glm::vec2>(vbos[TEX_COORD0 + texCoordSet], n_vertices, 2);
+	const auto &l = layouts[TEX_COORD0 + texCoordSet];
+	return copyFromPFloatToVectorVec<glm::vec2>(BufferReader(vbos[TEX_COORD0 + texCoordSet],
+		getMirror(TEX_COORD0 + texCoordSet)), n_vertices, 2, l.offset, l.stride, l.type);
 }
 
 template <typename T>
@@ -723,32 +1146,18 @@ std::vector<unsigned int> fromPToTToVectorUint(const T *data, size_t count) {
 std::vector<unsigned int> Mesh::getIndices() const
 {
 	std::vector<unsigned int> dst;
-	auto prev = PGUPV::gl_copy_read_buffer.bind(vbos[INDICES]);
+	BufferReader reader(vbos[INDICES], getMirror(INDICES));
 
 	switch (indices_type) {
 	case GL_UNSIGNED_BYTE:
-	{
-		GLubyte *ids = static_cast<GLubyte *>(PGUPV::gl_copy_read_buffer.map(GL_READ_ONLY));
-		assert(ids != nullptr);
-		dst = fromPToTToVectorUint(ids, n_indices);
-	}
-	break;
+		dst = fromPToTToVectorUint(reinterpret_cast<const GLubyte *>(reader.get()), n_indices);
+		break;
 	case GL_UNSIGNED_SHORT:
-	{
-		GLushort *ids = static_cast<GLushort *>(PGUPV::gl_copy_read_buffer.map(GL_READ_ONLY));
-		assert(ids != nullptr);
-		dst = fromPToTToVectorUint(ids, n_indices);
-	}
-	break;
+		dst = fromPToTToVectorUint(reinterpret_cast<const GLushort *>(reader.get()), n_indices);
+		break;
 	case GL_UNSIGNED_INT:
-	{
-		GLuint *ids = static_cast<GLuint *>(PGUPV::gl_copy_read_buffer.map(GL_READ_ONLY));
-		assert(ids != nullptr);
-		dst = fromPToTToVectorUint(ids, n_indices);
-	}
-	break;
+		dst = fromPToTToVectorUint(reinterpret_cast<const GLuint *>(reader.get()), n_indices);
+		break;
 	}
-	PGUPV::gl_copy_read_buffer.unmap();
-	PGUPV::gl_copy_read_buffer.bind(prev);
 	return dst;
 }
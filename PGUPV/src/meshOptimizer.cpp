@@ -0,0 +1,297 @@
+#include <algorithm>
+#include <numeric>
+#include <cmath>
+
+#include <glm/glm.hpp>
+
+#include "meshOptimizer.h"
+#include "log.h"
+
+using PGUPV::MeshOptimizer;
+
+// Tamaño de la caché que se supone al puntuar los vértices en optimizeVertexCache
+static const int FORSYTH_CACHE_SIZE = 32;
+// Tamaño de la caché que se usa para dividir la malla en bloques en optimizeOverdraw
+static const unsigned int OVERDRAW_CACHE_SIZE = 16;
+
+// Puntuación de un vértice según su posición en la caché (-1 si no está) y el número de
+// triángulos que quedan por emitir que lo usan (los vértices con pocos triángulos pendientes
+// tienen prioridad, para no dejar triángulos sueltos)
+static float vertexScore(int cachePosition, uint32_t liveTriangles) {
+	if (liveTriangles == 0)
+		return -1.0f;
+	float score = 0.0f;
+	if (cachePosition >= 0) {
+		// Los tres vértices del último triángulo tienen una puntuación fija, para que no
+		// se prefiera volver a usarlos todos a la vez
+		if (cachePosition < 3)
+			score = 0.75f;
+		else
+			score = std::pow(1.0f - (cachePosition - 3) / float(FORSYTH_CACHE_SIZE - 3), 1.5f);
+	}
+	return score + 2.0f / std::sqrt(static_cast<float>(liveTriangles));
+}
+
+MeshOptimizer::CacheStats MeshOptimizer::analyzeVertexCache(const std::vector<uint32_t> &indices,
+	size_t nVertices, unsigned int cacheSize) {
+	CacheStats stats{ 0, indices.size() / 3, 0, 0.0f, 0.0f };
+	// Un vértice está en la caché si han entrado menos de cacheSize vértices después que él
+	std::vector<size_t> timestamps(nVertices, 0);
+	std::vector<bool> used(nVertices, false);
+	size_t timestamp = cacheSize + 1;
+	for (auto v : indices) {
+		if (timestamp - timestamps[v] > cacheSize) {
+			timestamps[v] = timestamp++;
+			stats.vertexTransforms++;
+		}
+		if (!used[v]) {
+			used[v] = true;
+			stats.usedVertices++;
+		}
+	}
+	if (stats.triangles > 0)
+		stats.acmr = static_cast<float>(stats.vertexTransforms) / stats.triangles;
+	if (stats.usedVertices > 0)
+		stats.atvr = static_cast<float>(stats.vertexTransforms) / stats.usedVertices;
+	return stats;
+}
+
+std::vector<uint32_t> MeshOptimizer::optimizeVertexCache(const std::vector<uint32_t> &indices,
+	size_t nVertices) {
+	const size_t nTriangles = indices.size() / 3;
+	std::vector<uint32_t> result;
+	result.reserve(nTriangles * 3);
+
+	// Triángulos pendientes de cada vértice: los primeros liveTriangles[v] elementos a partir
+	// de firstTriangle[v] en adjacency
+	std::vector<uint32_t> liveTriangles(nVertices, 0);
+	for (size_t i = 0; i < nTriangles * 3; i++)
+		liveTriangles[indices[i]]++;
+	std::vector<uint32_t> firstTriangle(nVertices + 1, 0);
+	for (size_t v = 0; v < nVertices; v++)
+		firstTriangle[v + 1] = firstTriangle[v] + liveTriangles[v];
+	std::vector<uint32_t> adjacency(nTriangles * 3);
+	{
+		std::vector<uint32_t> fill(firstTriangle.begin(), firstTriangle.end() - 1);
+		for (size_t i = 0; i < nTriangles * 3; i++)
+			adjacency[fill[indices[i]]++] = static_cast<uint32_t>(i / 3);
+	}
+
+	std::vector<int> cachePosition(nVertices, -1);
+	std::vector<float> score(nVertices);
+	for (size_t v = 0; v < nVertices; v++)
+		score[v] = vertexScore(-1, liveTriangles[v]);
+	std::vector<bool> emitted(nTriangles, false);
+
+	std::vector<uint32_t> cache, newCache;
+	cache.reserve(FORSYTH_CACHE_SIZE + 3);
+	newCache.reserve(FORSYTH_CACHE_SIZE + 3);
+	size_t nextUnemitted = 0;
+	long long best = -1;
+	for (size_t out = 0; out < nTriangles; out++) {
+		// Si ningún vértice de la caché tiene triángulos pendientes, se sigue por el primer
+		// triángulo que no se haya emitido
+		if (best < 0) {
+			while (emitted[nextUnemitted])
+				nextUnemitted++;
+			best = static_cast<long long>(nextUnemitted);
+		}
+		auto t = static_cast<size_t>(best);
+		emitted[t] = true;
+		const uint32_t *tri = &indices[t * 3];
+		for (int k = 0; k < 3; k++) {
+			auto v = tri[k];
+			result.push_back(v);
+			// Quitar el triángulo de los pendientes del vértice
+			auto begin = adjacency.begin() + firstTriangle[v];
+			auto end = begin + liveTriangles[v];
+			auto it = std::find(begin, end, static_cast<uint32_t>(t));
+			if (it != end) {
+				std::iter_swap(it, end - 1);
+				liveTriangles[v]--;
+			}
+		}
+
+		// Los vértices del triángulo pasan al principio de la caché
+		newCache.clear();
+		for (int k = 0; k < 3; k++) {
+			if (std::find(newCache.begin(), newCache.end(), tri[k]) == newCache.end())
+				newCache.push_back(tri[k]);
+		}
+		for (auto v : cache) {
+			if (std::find(newCache.begin(), newCache.end(), v) == newCache.end())
+				newCache.push_back(v);
+		}
+		for (size_t i = 0; i < newCache.size(); i++) {
+			auto v = newCache[i];
+			cachePosition[v] = i < static_cast<size_t>(FORSYTH_CACHE_SIZE) ? static_cast<int>(i) : -1;
+			score[v] = vertexScore(cachePosition[v], liveTriangles[v]);
+		}
+		if (newCache.size() > static_cast<size_t>(FORSYTH_CACHE_SIZE))
+			newCache.resize(FORSYTH_CACHE_SIZE);
+		std::swap(cache, newCache);
+
+		// El siguiente triángulo es el de mayor puntuación entre los que usan algún vértice de
+		// la caché
+		best = -1;
+		float bestScore = -1.0f;
+		for (auto v : cache) {
+			for (uint32_t a = 0; a < liveTriangles[v]; a++) {
+				auto candidate = adjacency[firstTriangle[v] + a];
+				const uint32_t *ct = &indices[candidate * 3];
+				float s = score[ct[0]] + score[ct[1]] + score[ct[2]];
+				if (s > bestScore) {
+					bestScore = s;
+					best = candidate;
+				}
+			}
+		}
+	}
+	// Índices sobrantes (si indices.size() no es múltiplo de 3)
+	result.insert(result.end(), indices.begin() + nTriangles * 3, indices.end());
+	return result;
+}
+
+std::vector<uint32_t> MeshOptimizer::optimizeOverdraw(const std::vector<uint32_t> &indices,
+	const std::vector<glm::vec3> &positions, float threshold) {
+	const size_t nTriangles = indices.size() / 3;
+	if (nTriangles < 2)
+		return indices;
+
+	// Cada vez que un triángulo no encuentra ninguno de sus vértices en la caché empieza un
+	// bloque nuevo (se podría dibujar en otro orden sin perder nada)
+	std::vector<size_t> hardBoundaries;
+	{
+		std::vector<size_t> timestamps(positions.size(), 0);
+		size_t timestamp = OVERDRAW_CACHE_SIZE + 1;
+		for (size_t t = 0; t < nTriangles; t++) {
+			int misses = 0;
+			for (int k = 0; k < 3; k++) {
+				auto v = indices[t * 3 + k];
+				if (timestamp - timestamps[v] > OVERDRAW_CACHE_SIZE) {
+					timestamps[v] = timestamp++;
+					misses++;
+				}
+			}
+			if (t == 0 || misses == 3)
+				hardBoundaries.push_back(t);
+		}
+		hardBoundaries.push_back(nTriangles);
+	}
+
+	// Cada bloque se divide otra vez en cuanto su ACMR (empezando con la caché vacía) baja
+	// de threshold veces el del bloque completo
+	std::vector<size_t> clusters;
+	{
+		std::vector<size_t> timestamps(positions.size(), 0);
+		size_t timestamp = OVERDRAW_CACHE_SIZE + 1;
+		auto simulate = [&](size_t t) {
+			int misses = 0;
+			for (int k = 0; k < 3; k++) {
+				auto v = indices[t * 3 + k];
+				if (timestamp - timestamps[v] > OVERDRAW_CACHE_SIZE) {
+					timestamps[v] = timestamp++;
+					misses++;
+				}
+			}
+			return misses;
+		};
+		// Vaciar la caché
+		auto flush = [&]() { timestamp += OVERDRAW_CACHE_SIZE + 1; };
+
+		for (size_t h = 0; h + 1 < hardBoundaries.size(); h++) {
+			auto begin = hardBoundaries[h], end = hardBoundaries[h + 1];
+			flush();
+			size_t clusterMisses = 0;
+			for (size_t t = begin; t < end; t++)
+				clusterMisses += simulate(t);
+			float clusterACMR = static_cast<float>(clusterMisses) / (end - begin);
+
+			flush();
+			clusters.push_back(begin);
+			size_t misses = 0, start = begin;
+			for (size_t t = begin; t < end; t++) {
+				misses += simulate(t);
+				float acmr = static_cast<float>(misses) / (t - start + 1);
+				if (t + 1 < end && acmr <= clusterACMR * threshold) {
+					clusters.push_back(t + 1);
+					start = t + 1;
+					misses = 0;
+					flush();
+				}
+			}
+		}
+		clusters.push_back(nTriangles);
+	}
+
+	// Centro y normal (ponderados por el área) de la malla y de cada bloque
+	struct Cluster {
+		size_t begin, end;
+		float sortKey;
+	};
+	auto nClusters = clusters.size() - 1;
+	std::vector<glm::vec3> centroids(nClusters), normals(nClusters);
+	glm::vec3 meshCentroid(0.0f);
+	float meshArea = 0.0f;
+	for (size_t c = 0; c < nClusters; c++) {
+		glm::vec3 centroid(0.0f), normal(0.0f);
+		float area = 0.0f;
+		for (size_t t = clusters[c]; t < clusters[c + 1]; t++) {
+			const auto &a = positions[indices[t * 3]];
+			const auto &b = positions[indices[t * 3 + 1]];
+			const auto &d = positions[indices[t * 3 + 2]];
+			auto n = glm::cross(b - a, d - a);
+			float triArea = glm::length(n);
+			centroid += (a + b + d) * (triArea / 3.0f);
+			normal += n;
+			area += triArea;
+		}
+		meshCentroid += centroid;
+		meshArea += area;
+		centroids[c] = area > 0.0f ? centroid / area : positions[indices[clusters[c] * 3]];
+		float len = glm::length(normal);
+		normals[c] = len > 0.0f ? normal / len : glm::vec3(0.0f);
+	}
+	if (meshArea > 0.0f)
+		meshCentroid /= meshArea;
+
+	// Primero los bloques más alejados del centro en la dirección de su normal, que son los
+	// que más probablemente tapan al resto
+	std::vector<Cluster> order(nClusters);
+	for (size_t c = 0; c < nClusters; c++)
+		order[c] = Cluster{ clusters[c], clusters[c + 1], glm::dot(centroids[c] - meshCentroid, normals[c]) };
+	std::stable_sort(order.begin(), order.end(),
+		[](const Cluster &a, const Cluster &b) { return a.sortKey > b.sortKey; });
+
+	std::vector<uint32_t> result;
+	result.reserve(indices.size());
+	for (const auto &c : order)
+		result.insert(result.end(), indices.begin() + c.begin * 3, indices.begin() + c.end * 3);
+	result.insert(result.end(), indices.begin() + nTriangles * 3, indices.end());
+
+	auto before = analyzeVertexCache(indices, positions.size(), OVERDRAW_CACHE_SIZE);
+	auto after = analyzeVertexCache(result, positions.size(), OVERDRAW_CACHE_SIZE);
+	if (after.acmr > before.acmr * threshold) {
+		INFO("La reordenación por sobredibujado empeora demasiado el ACMR (" + std::to_string(before.acmr) +
+			" -> " + std::to_string(after.acmr) + "). Se descarta");
+		return indices;
+	}
+	return result;
+}
+
+std::vector<uint32_t> MeshOptimizer::optimizeVertexFetch(std::vector<uint32_t> &indices,
+	size_t nVertices) {
+	const uint32_t unassigned = ~0u;
+	std::vector<uint32_t> remap(nVertices, unassigned);
+	uint32_t next = 0;
+	for (auto &v : indices) {
+		if (remap[v] == unassigned)
+			remap[v] = next++;
+		v = remap[v];
+	}
+	for (auto &r : remap) {
+		if (r == unassigned)
+			r = next++;
+	}
+	return remap;
+}
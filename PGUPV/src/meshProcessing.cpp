@@ -0,0 +1,337 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include <glm/glm.hpp>
+
+#include "meshProcessing.h"
+#include "jobPool.h"
+#include "log.h"
+
+using PGUPV::MeshProcessing;
+using PGUPV::TriangleIndices;
+using PGUPV::JobPool;
+
+// Número de elementos que procesa cada trabajo en parallelFor
+static const size_t PARALLEL_CHUNK = 4096;
+
+// Llama a f(begin, end) sobre trozos de [0, n), repartidos entre los hilos del conjunto
+template <typename F>
+static void parallelFor(JobPool *pool, size_t n, F f) {
+	if (pool == nullptr || n <= PARALLEL_CHUNK) {
+		f(size_t(0), n);
+		return;
+	}
+	JobPool::Counter counter;
+	for (size_t begin = 0; begin < n; begin += PARALLEL_CHUNK) {
+		auto end = std::min(n, begin + PARALLEL_CHUNK);
+		pool->submit([&f, begin, end]() { f(begin, end); }, counter);
+	}
+	pool->wait(counter);
+}
+
+// Ángulo entre dos vectores (no tienen por qué ser unitarios)
+static float angleBetween(const glm::vec3 &a, const glm::vec3 &b) {
+	auto la = glm::length(a), lb = glm::length(b);
+	if (la == 0.0f || lb == 0.0f)
+		return 0.0f;
+	return std::acos(glm::clamp(glm::dot(a, b) / (la * lb), -1.0f, 1.0f));
+}
+
+// Normal unitaria de cada triángulo ((0, 0, 0) si es degenerado) y ángulo en cada esquina
+static void computeFaceData(const std::vector<glm::vec3> &positions,
+	const std::vector<TriangleIndices> &triangles, std::vector<glm::vec3> &faceNormals,
+	std::vector<float> &cornerAngles, JobPool *pool) {
+	faceNormals.resize(triangles.size());
+	cornerAngles.resize(triangles.size() * 3);
+	parallelFor(pool, triangles.size(), [&](size_t begin, size_t end) {
+		for (size_t t = begin; t < end; t++) {
+			const auto &a = positions[triangles[t].idx[0]];
+			const auto &b = positions[triangles[t].idx[1]];
+			const auto &c = positions[triangles[t].idx[2]];
+			auto n = glm::cross(b - a, c - a);
+			auto len = glm::length(n);
+			faceNormals[t] = len > 0.0f ? n / len : glm::vec3(0.0f);
+			cornerAngles[t * 3] = angleBetween(b - a, c - a);
+			cornerAngles[t * 3 + 1] = angleBetween(c - b, a - b);
+			cornerAngles[t * 3 + 2] = angleBetween(a - c, b - c);
+		}
+	});
+}
+
+// Listas de esquinas (triángulo * 3 + esquina) agrupadas por la clave de su vértice:
+// las esquinas de la clave k están en corners[first[k]..first[k+1])
+static void buildCornerLists(const std::vector<TriangleIndices> &triangles,
+	const std::vector<uint32_t> &vertexKey, size_t nKeys, std::vector<uint32_t> &first,
+	std::vector<uint32_t> &corners) {
+	first.assign(nKeys + 1, 0);
+	for (const auto &t : triangles) {
+		for (int k = 0; k < 3; k++)
+			first[vertexKey[t.idx[k]] + 1]++;
+	}
+	for (size_t k = 0; k < nKeys; k++)
+		first[k + 1] += first[k];
+	corners.resize(triangles.size() * 3);
+	std::vector<uint32_t> fill(first.begin(), first.end() - 1);
+	for (size_t t = 0; t < triangles.size(); t++) {
+		for (int k = 0; k < 3; k++)
+			corners[fill[vertexKey[triangles[t].idx[k]]]++] = static_cast<uint32_t>(t * 3 + k);
+	}
+}
+
+// Agrupa los vértices con exactamente la misma posición, usando como clave de la tabla hash
+// los bits de sus coordenadas
+static std::vector<uint32_t> weldExact(const std::vector<glm::vec3> &positions) {
+	std::vector<uint32_t> welded(positions.size());
+	// Sumar 0 convierte -0 en +0, para que tengan los mismos bits
+	auto canonical = [](const glm::vec3 &p) { return p + glm::vec3(0.0f); };
+	auto positionKey = [](const glm::vec3 &p) {
+		uint32_t b[3];
+		std::memcpy(b, &p[0], sizeof(b));
+		auto k = (b[0] * 0x9E3779B97F4A7C15ull) ^ (b[1] * 0xC2B2AE3D27D4EB4Full) ^
+			(b[2] * 0x165667B19E3779F9ull);
+		// Las claves usan 63 bits, así que emptyKey no puede ser una clave
+		return k & 0x7FFFFFFFFFFFFFFFull;
+	};
+
+	// Tabla hash con direccionamiento abierto: clave -> primer vértice de su lista (enlazada a
+	// través de next). Dos posiciones distintas pueden compartir clave, así que se comparan
+	const uint64_t emptyKey = ~0ull;
+	const uint32_t none = ~0u;
+	int bits = 1;
+	while ((size_t(1) << bits) < positions.size() * 2)
+		bits++;
+	const size_t mask = (size_t(1) << bits) - 1;
+	std::vector<uint64_t> keys(mask + 1, emptyKey);
+	std::vector<uint32_t> heads(mask + 1, none);
+	std::vector<uint32_t> next(positions.size(), none);
+
+	for (uint32_t i = 0; i < positions.size(); i++) {
+		auto p = canonical(positions[i]);
+		auto key = positionKey(p);
+		auto h = static_cast<size_t>((key * 0x9E3779B97F4A7C15ull) >> (64 - bits));
+		while (keys[h] != emptyKey && keys[h] != key)
+			h = (h + 1) & mask;
+		welded[i] = i;
+		for (auto j = heads[h]; j != none; j = next[j]) {
+			if (canonical(positions[j]) == p) {
+				welded[i] = welded[j];
+				break;
+			}
+		}
+		// Sólo se guardan en la tabla los representantes de cada grupo
+		if (welded[i] == i) {
+			keys[h] = key;
+			next[i] = heads[h];
+			heads[h] = i;
+		}
+	}
+	return welded;
+}
+
+std::vector<uint32_t> MeshProcessing::weldVertices(const std::vector<glm::vec3> &positions,
+	float epsilon) {
+	// Sólo se sueldan las posiciones idénticas
+	if (epsilon <= 0.0f)
+		return weldExact(positions);
+
+	std::vector<uint32_t> welded(positions.size());
+	const float epsilonSquared = epsilon * epsilon;
+	// Rejilla de celdas de CELL_SCALE * epsilon de lado. Sólo hay que buscar en las celdas
+	// vecinas cuando el vértice está a menos de epsilon del borde de la suya
+	const float CELL_SCALE = 8.0f;
+	const float invCell = 1.0f / (epsilon * CELL_SCALE);
+	const float border = 1.0f / CELL_SCALE;
+	auto cellKey = [](const glm::ivec3 &c) {
+		return (static_cast<uint64_t>(static_cast<uint32_t>(c.x) & 0x1FFFFF) << 42) |
+			(static_cast<uint64_t>(static_cast<uint32_t>(c.y) & 0x1FFFFF) << 21) |
+			static_cast<uint64_t>(static_cast<uint32_t>(c.z) & 0x1FFFFF);
+	};
+
+	// Tabla hash con direccionamiento abierto: celda -> primer vértice de su lista (enlazada a
+	// través de next). Las claves usan 63 bits, así que emptyKey no puede ser una celda
+	const uint64_t emptyKey = ~0ull;
+	const uint32_t none = ~0u;
+	int bits = 1;
+	while ((size_t(1) << bits) < positions.size() * 2)
+		bits++;
+	const size_t mask = (size_t(1) << bits) - 1;
+	std::vector<uint64_t> keys(mask + 1, emptyKey);
+	std::vector<uint32_t> heads(mask + 1, none);
+	auto findSlot = [&keys, mask, bits](uint64_t key) {
+		auto h = static_cast<size_t>((key * 0x9E3779B97F4A7C15ull) >> (64 - bits));
+		while (keys[h] != emptyKey && keys[h] != key)
+			h = (h + 1) & mask;
+		return h;
+	};
+	std::vector<uint32_t> next(positions.size(), none);
+
+	for (uint32_t i = 0; i < positions.size(); i++) {
+		const auto &p = positions[i];
+		auto scaled = p * invCell;
+		auto cellF = glm::floor(scaled);
+		auto local = scaled - cellF;
+		// Con epsilon muy pequeño o posiciones muy lejanas, la celda no cabría en un int. Las
+		// celdas de los extremos se llenan, pero la búsqueda sigue siendo correcta
+		const float maxCell = 1073741824.0f;
+		glm::ivec3 cell(glm::clamp(cellF, glm::vec3(-maxCell), glm::vec3(maxCell)));
+		glm::ivec3 from, to;
+		for (int a = 0; a < 3; a++) {
+			from[a] = local[a] < border ? -1 : 0;
+			to[a] = local[a] > 1.0f - border ? 1 : 0;
+		}
+		welded[i] = i;
+		bool found = false;
+		for (int dx = from.x; dx <= to.x && !found; dx++) {
+			for (int dy = from.y; dy <= to.y && !found; dy++) {
+				for (int dz = from.z; dz <= to.z && !found; dz++) {
+					auto slot = findSlot(cellKey(cell + glm::ivec3(dx, dy, dz)));
+					for (auto j = heads[slot]; j != none; j = next[j]) {
+						auto d = positions[j] - p;
+						if (glm::dot(d, d) <= epsilonSquared) {
+							welded[i] = welded[j];
+							found = true;
+							break;
+						}
+					}
+				}
+			}
+		}
+		// Sólo se guardan en la rejilla los representantes de cada grupo
+		if (!found) {
+			auto key = cellKey(cell);
+			auto slot = findSlot(key);
+			keys[slot] = key;
+			next[i] = heads[slot];
+			heads[slot] = i;
+		}
+	}
+	return welded;
+}
+
+std::vector<glm::vec3> MeshProcessing::computeSmoothNormals(const std::vector<glm::vec3> &positions,
+	const std::vector<TriangleIndices> &triangles, float creaseAngle, float weldEpsilon, JobPool *pool) {
+	std::vector<glm::vec3> faceNormals;
+	std::vector<float> cornerAngles;
+	computeFaceData(positions, triangles, faceNormals, cornerAngles, pool);
+
+	auto welded = weldVertices(positions, weldEpsilon);
+	std::vector<uint32_t> first, corners;
+	buildCornerLists(triangles, welded, positions.size(), first, corners);
+
+	const bool smoothAll = creaseAngle >= 180.0f;
+	const float cosCrease = std::cos(glm::radians(creaseAngle));
+	std::vector<glm::vec3> normals(positions.size());
+	parallelFor(pool, positions.size(), [&](size_t begin, size_t end) {
+		std::vector<uint32_t> ownFaces;
+		for (size_t v = begin; v < end; v++) {
+			auto group = welded[v];
+			if (!smoothAll) {
+				ownFaces.clear();
+				for (auto i = first[group]; i < first[group + 1]; i++) {
+					auto corner = corners[i];
+					if (triangles[corner / 3].idx[corner % 3] == v)
+						ownFaces.push_back(corner / 3);
+				}
+			}
+			glm::vec3 sum(0.0f);
+			for (auto i = first[group]; i < first[group + 1]; i++) {
+				auto corner = corners[i];
+				const auto &n = faceNormals[corner / 3];
+				bool include = smoothAll;
+				// Se incluye el triángulo si está cerca de alguno de los del propio vértice
+				for (size_t j = 0; j < ownFaces.size() && !include; j++)
+					include = glm::dot(n, faceNormals[ownFaces[j]]) >= cosCrease;
+				if (include)
+					sum += n * cornerAngles[corner];
+			}
+			auto len = glm::length(sum);
+			normals[v] = len > 0.0f ? sum / len : glm::vec3(0.0f);
+		}
+	});
+	return normals;
+}
+
+// Un vector unitario perpendicular a n (el eje X si n es nulo)
+static glm::vec3 anyPerpendicular(const glm::vec3 &n) {
+	auto axis = std::fabs(n.x) < 0.9f ? glm::vec3(1.0f, 0.0f, 0.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+	auto p = glm::cross(n, axis);
+	auto len = glm::length(p);
+	return len > 0.0f ? p / len : glm::vec3(1.0f, 0.0f, 0.0f);
+}
+
+std::vector<glm::vec4> MeshProcessing::computeTangents(const std::vector<glm::vec3> &positions,
+	const std::vector<glm::vec3> &normals, const std::vector<glm::vec2> &texCoords,
+	const std::vector<TriangleIndices> &triangles, JobPool *pool) {
+	if (normals.size() != positions.size() || texCoords.size() != positions.size())
+		ERRT("Para calcular las tangentes hacen falta las normales y las coordenadas de textura de todos los vértices");
+
+	std::vector<glm::vec3> faceNormals;
+	std::vector<float> cornerAngles;
+	computeFaceData(positions, triangles, faceNormals, cornerAngles, pool);
+
+	// Dirección en el espacio del objeto de los ejes s y t de la textura, en cada triángulo, y
+	// orientación de la textura en él (1, -1 si está reflejada, o 0 si es degenerada)
+	std::vector<glm::vec3> faceS(triangles.size()), faceT(triangles.size());
+	std::vector<float> faceSign(triangles.size());
+	parallelFor(pool, triangles.size(), [&](size_t begin, size_t end) {
+		for (size_t t = begin; t < end; t++) {
+			const auto &tri = triangles[t];
+			auto e1 = positions[tri.idx[1]] - positions[tri.idx[0]];
+			auto e2 = positions[tri.idx[2]] - positions[tri.idx[0]];
+			auto d1 = texCoords[tri.idx[1]] - texCoords[tri.idx[0]];
+			auto d2 = texCoords[tri.idx[2]] - texCoords[tri.idx[0]];
+			float det = d1.x * d2.y - d2.x * d1.y;
+			// Con las coordenadas de textura degeneradas, el triángulo no aporta nada
+			if (std::fabs(det) < 1e-20f) {
+				faceS[t] = faceT[t] = glm::vec3(0.0f);
+				faceSign[t] = 0.0f;
+				continue;
+			}
+			// Sólo importa la dirección (y el signo de det, que da el sentido de la bitangente)
+			float sign = det > 0.0f ? 1.0f : -1.0f;
+			faceS[t] = (e1 * d2.y - e2 * d1.y) * sign;
+			faceT[t] = (e2 * d1.x - e1 * d2.x) * sign;
+			faceSign[t] = sign;
+		}
+	});
+
+	std::vector<uint32_t> identity(positions.size());
+	for (uint32_t v = 0; v < identity.size(); v++)
+		identity[v] = v;
+	std::vector<uint32_t> first, corners;
+	buildCornerLists(triangles, identity, positions.size(), first, corners);
+
+	std::vector<glm::vec4> tangents(positions.size());
+	parallelFor(pool, positions.size(), [&](size_t begin, size_t end) {
+		for (size_t v = begin; v < end; v++) {
+			const auto &n = normals[v];
+			// En un vértice compartido por triángulos con la textura reflejada y sin reflejar, sus
+			// tangentes se anularían al sumarlas: se usan sólo los de la orientación con más peso
+			float orientation = 0.0f;
+			for (auto i = first[v]; i < first[v + 1]; i++)
+				orientation += faceSign[corners[i] / 3] * cornerAngles[corners[i]];
+			float dominant = orientation < 0.0f ? -1.0f : 1.0f;
+			glm::vec3 tangent(0.0f), bitangent(0.0f);
+			for (auto i = first[v]; i < first[v + 1]; i++) {
+				auto corner = corners[i];
+				auto t = corner / 3;
+				if (faceSign[t] != dominant)
+					continue;
+				// Proyección en el plano tangente del vértice, normalizada
+				auto s = faceS[t] - n * glm::dot(n, faceS[t]);
+				auto b = faceT[t] - n * glm::dot(n, faceT[t]);
+				auto ls = glm::length(s), lb = glm::length(b);
+				if (ls > 0.0f)
+					tangent += s * (cornerAngles[corner] / ls);
+				if (lb > 0.0f)
+					bitangent += b * (cornerAngles[corner] / lb);
+			}
+			auto len = glm::length(tangent);
+			glm::vec3 tu = len > 1e-12f ? tangent / len : anyPerpendicular(n);
+			float w = glm::dot(glm::cross(n, tu), bitangent) < 0.0f ? -1.0f : 1.0f;
+			tangents[v] = glm::vec4(tu, w);
+		}
+	});
+	return tangents;
+}
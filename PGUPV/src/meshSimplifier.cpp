@@ -0,0 +1,379 @@
+#include <algorithm>
+#include <unordered_map>
+#include <cstring>
+#include <cmath>
+
+#include <glm/glm.hpp>
+
+#include "meshSimplifier.h"
+#include "mesh.h"
+#include "drawCommand.h"
+#include "log.h"
+
+using PGUPV::MeshSimplifier;
+using PGUPV::Mesh;
+using PGUPV::TriangleIndices;
+using PGUPV::DrawElements;
+
+// Peso de los planos que se añaden en las aristas del borde, respecto a los de las caras
+static const double BORDER_WEIGHT = 10.0;
+
+MeshSimplifier::Quadric::Quadric() : weight(0.0) {
+	std::fill(a, a + 10, 0.0);
+}
+
+MeshSimplifier::Quadric::Quadric(const glm::dvec3 &n, double d, double weight) : weight(weight) {
+	a[0] = n.x * n.x; a[1] = n.x * n.y; a[2] = n.x * n.z; a[3] = n.x * d;
+	a[4] = n.y * n.y; a[5] = n.y * n.z; a[6] = n.y * d;
+	a[7] = n.z * n.z; a[8] = n.z * d;
+	a[9] = d * d;
+	for (auto &v : a)
+		v *= weight;
+}
+
+MeshSimplifier::Quadric &MeshSimplifier::Quadric::operator+=(const Quadric &o) {
+	for (int i = 0; i < 10; i++)
+		a[i] += o.a[i];
+	weight += o.weight;
+	return *this;
+}
+
+double MeshSimplifier::Quadric::evaluate(const glm::vec3 &p) const {
+	double x = p.x, y = p.y, z = p.z;
+	return a[0] * x * x + 2 * a[1] * x * y + 2 * a[2] * x * z + 2 * a[3] * x +
+		a[4] * y * y + 2 * a[5] * y * z + 2 * a[6] * y +
+		a[7] * z * z + 2 * a[8] * z + a[9];
+}
+
+double MeshSimplifier::Quadric::error(const glm::vec3 &p) const {
+	// Los planos están ponderados por área: se divide por el peso total para que el error
+	// sea una distancia al cuadrado, comparable con maxError
+	if (weight <= 0.0)
+		return 0.0;
+	return std::max(0.0, evaluate(p) / weight);
+}
+
+MeshSimplifier::MeshSimplifier(const Mesh &mesh) :
+	MeshSimplifier(mesh.getVertices(), mesh.getTriangles(), mesh.getNormals(), mesh.getTexCoords(0)) {
+	material = mesh.getMaterial();
+	name = mesh.getName();
+}
+
+MeshSimplifier::MeshSimplifier(std::vector<glm::vec3> positions, std::vector<TriangleIndices> triangles,
+	std::vector<glm::vec3> normals, std::vector<glm::vec2> texCoords) :
+	positions(std::move(positions)), normals(std::move(normals)), texCoords(std::move(texCoords)),
+	triangles(std::move(triangles)), maxCost(0.0), generatedLevels(0) {
+	if (!this->normals.empty() && this->normals.size() != this->positions.size()) {
+		WARN("El número de normales no coincide con el de vértices. Se descartan");
+		this->normals.clear();
+	}
+	if (!this->texCoords.empty() && this->texCoords.size() != this->positions.size()) {
+		WARN("El número de coordenadas de textura no coincide con el de vértices. Se descartan");
+		this->texCoords.clear();
+	}
+	init();
+}
+
+// Clave de una arista entre dos vértices soldados, independiente del orden
+static uint64_t edgeKey(uint32_t a, uint32_t b) {
+	if (a > b)
+		std::swap(a, b);
+	return (static_cast<uint64_t>(a) << 32) | b;
+}
+
+void MeshSimplifier::init() {
+	auto nv = positions.size();
+
+	// Soldar los vértices con la misma posición (exactamente)
+	struct PosHash {
+		size_t operator()(const glm::vec3 &p) const {
+			uint32_t h[3];
+			std::memcpy(h, &p, sizeof(h));
+			return (h[0] * 73856093u) ^ (h[1] * 19349663u) ^ (h[2] * 83492791u);
+		}
+	};
+	std::unordered_map<glm::vec3, uint32_t, PosHash> weldMap;
+	welded.resize(nv);
+	for (size_t i = 0; i < nv; i++) {
+		auto it = weldMap.emplace(positions[i], static_cast<uint32_t>(weldedVertices.size()));
+		if (it.second)
+			weldedVertices.push_back(std::vector<uint32_t>());
+		welded[i] = it.first->second;
+		weldedVertices[it.first->second].push_back(static_cast<uint32_t>(i));
+	}
+	auto nw = weldedVertices.size();
+	version.assign(nw, 0);
+	quadrics.assign(nw, Quadric());
+
+	// Se descartan los triángulos degenerados y los que usan vértices que no existen
+	triangleAlive.assign(triangles.size(), false);
+	vertexTriangles.resize(nv);
+	liveTriangles = 0;
+	std::unordered_map<uint64_t, uint32_t> edgeCount;
+	for (size_t t = 0; t < triangles.size(); t++) {
+		auto &tri = triangles[t];
+		if (tri.idx[0] >= nv || tri.idx[1] >= nv || tri.idx[2] >= nv)
+			continue;
+		uint32_t w[3] = { welded[tri.idx[0]], welded[tri.idx[1]], welded[tri.idx[2]] };
+		if (w[0] == w[1] || w[1] == w[2] || w[0] == w[2])
+			continue;
+		triangleAlive[t] = true;
+		liveTriangles++;
+		for (int c = 0; c < 3; c++) {
+			vertexTriangles[tri.idx[c]].push_back(static_cast<uint32_t>(t));
+			edgeCount[edgeKey(w[c], w[(c + 1) % 3])]++;
+		}
+
+		// Plano del triángulo, ponderado por su área
+		glm::dvec3 p0(positions[tri.idx[0]]), p1(positions[tri.idx[1]]), p2(positions[tri.idx[2]]);
+		auto n = glm::cross(p1 - p0, p2 - p0);
+		auto len = glm::length(n);
+		if (len <= 0.0)
+			continue;
+		n /= len;
+		Quadric q(n, -glm::dot(n, p0), len * 0.5);
+		for (int c = 0; c < 3; c++)
+			quadrics[w[c]] += q;
+	}
+
+	// Planos perpendiculares a los triángulos en las aristas del borde
+	for (size_t t = 0; t < triangles.size(); t++) {
+		if (!triangleAlive[t])
+			continue;
+		auto &tri = triangles[t];
+		glm::dvec3 p[3] = { glm::dvec3(positions[tri.idx[0]]), glm::dvec3(positions[tri.idx[1]]),
+			glm::dvec3(positions[tri.idx[2]]) };
+		auto faceNormal = glm::cross(p[1] - p[0], p[2] - p[0]);
+		for (int c = 0; c < 3; c++) {
+			auto a = welded[tri.idx[c]], b = welded[tri.idx[(c + 1) % 3]];
+			if (edgeCount[edgeKey(a, b)] != 1)
+				continue;
+			auto e = p[(c + 1) % 3] - p[c];
+			auto n = glm::cross(e, faceNormal);
+			auto len = glm::length(n);
+			if (len <= 0.0)
+				continue;
+			n /= len;
+			Quadric q(n, -glm::dot(n, p[c]), BORDER_WEIGHT * glm::dot(e, e));
+			quadrics[a] += q;
+			quadrics[b] += q;
+		}
+	}
+
+	for (uint32_t w = 0; w < nw; w++)
+		pushCollapses(w);
+}
+
+void MeshSimplifier::gatherTriangles(uint32_t w, std::vector<uint32_t> &tris) const {
+	tris.clear();
+	for (auto v : weldedVertices[w]) {
+		for (auto t : vertexTriangles[v]) {
+			if (triangleAlive[t])
+				tris.push_back(t);
+		}
+	}
+	std::sort(tris.begin(), tris.end());
+	tris.erase(std::unique(tris.begin(), tris.end()), tris.end());
+}
+
+void MeshSimplifier::pushCollapses(uint32_t w) {
+	std::vector<uint32_t> tris;
+	gatherTriangles(w, tris);
+	std::vector<uint32_t> neighbours;
+	for (auto t : tris) {
+		for (int c = 0; c < 3; c++) {
+			auto n = welded[triangles[t].idx[c]];
+			if (n != w)
+				neighbours.push_back(n);
+		}
+	}
+	std::sort(neighbours.begin(), neighbours.end());
+	neighbours.erase(std::unique(neighbours.begin(), neighbours.end()), neighbours.end());
+
+	for (auto n : neighbours) {
+		auto q = quadrics[w];
+		q += quadrics[n];
+		auto p = positions[weldedVertices[n].front()];
+		auto cost = q.error(p);
+		heap.push_back(Collapse{ cost, w, n, version[w], version[n] });
+		std::push_heap(heap.begin(), heap.end());
+		// Y en sentido contrario (la posición final es distinta)
+		p = positions[weldedVertices[w].front()];
+		cost = q.error(p);
+		heap.push_back(Collapse{ cost, n, w, version[n], version[w] });
+		std::push_heap(heap.begin(), heap.end());
+	}
+}
+
+bool MeshSimplifier::tryCollapse(const Collapse &c) {
+	std::vector<uint32_t> tris;
+	gatherTriangles(c.from, tris);
+
+	// Cada vértice de from tiene que pasar a un vértice de to con el que comparta un triángulo
+	// (así los atributos siguen siendo continuos a ambos lados de las costuras)
+	std::vector<std::pair<uint32_t, uint32_t>> remap;
+	for (auto v : weldedVertices[c.from]) {
+		uint32_t target = UINT32_MAX;
+		for (auto t : vertexTriangles[v]) {
+			if (!triangleAlive[t])
+				continue;
+			for (auto u : triangles[t].idx) {
+				if (welded[u] == c.to)
+					target = u;
+			}
+			if (target != UINT32_MAX)
+				break;
+		}
+		if (target == UINT32_MAX)
+			return false;
+		remap.push_back(std::make_pair(v, target));
+	}
+
+	// Ningún triángulo puede darse la vuelta al mover el vértice
+	auto newPos = positions[weldedVertices[c.to].front()];
+	for (auto t : tris) {
+		auto &tri = triangles[t];
+		int corner = -1;
+		bool hasTo = false;
+		for (int k = 0; k < 3; k++) {
+			auto w = welded[tri.idx[k]];
+			if (w == c.from)
+				corner = k;
+			else if (w == c.to)
+				hasTo = true;
+		}
+		if (hasTo)
+			continue;
+		glm::vec3 p[3] = { positions[tri.idx[0]], positions[tri.idx[1]], positions[tri.idx[2]] };
+		auto before = glm::cross(p[1] - p[0], p[2] - p[0]);
+		p[corner] = newPos;
+		auto after = glm::cross(p[1] - p[0], p[2] - p[0]);
+		if (glm::dot(before, after) <= 0.0f)
+			return false;
+	}
+
+	for (auto t : tris) {
+		auto &tri = triangles[t];
+		bool degenerate = false;
+		for (auto &idx : tri.idx) {
+			if (welded[idx] == c.to)
+				degenerate = true;
+		}
+		for (auto &idx : tri.idx) {
+			for (auto &r : remap) {
+				if (r.first == idx) {
+					idx = r.second;
+					break;
+				}
+			}
+		}
+		if (degenerate) {
+			triangleAlive[t] = false;
+			liveTriangles--;
+		}
+		else {
+			for (auto idx : tri.idx) {
+				if (welded[idx] == c.to)
+					vertexTriangles[idx].push_back(t);
+			}
+		}
+	}
+	for (auto v : weldedVertices[c.from])
+		vertexTriangles[v].clear();
+	weldedVertices[c.from].clear();
+
+	quadrics[c.to] += quadrics[c.from];
+	version[c.from]++;
+	version[c.to]++;
+	maxCost = std::max(maxCost, c.cost);
+	pushCollapses(c.to);
+	return true;
+}
+
+size_t MeshSimplifier::simplify(size_t targetTriangles, float maxError) {
+	auto maxErrorCost = static_cast<double>(maxError) * maxError;
+	while (liveTriangles > targetTriangles && !heap.empty()) {
+		auto c = heap.front();
+		if (c.cost > maxErrorCost)
+			break;
+		std::pop_heap(heap.begin(), heap.end());
+		heap.pop_back();
+		// Las entradas de vértices que han cambiado desde que se calcularon están obsoletas
+		if (weldedVertices[c.from].empty() || weldedVertices[c.to].empty() ||
+			version[c.from] != c.fromVersion || version[c.to] != c.toVersion)
+			continue;
+		tryCollapse(c);
+	}
+	return liveTriangles;
+}
+
+float MeshSimplifier::getError() const {
+	return static_cast<float>(std::sqrt(maxCost));
+}
+
+std::vector<TriangleIndices> MeshSimplifier::getTriangles() const {
+	std::vector<TriangleIndices> result;
+	result.reserve(liveTriangles);
+	for (size_t t = 0; t < triangles.size(); t++) {
+		if (triangleAlive[t])
+			result.push_back(triangles[t]);
+	}
+	return result;
+}
+
+std::shared_ptr<Mesh> MeshSimplifier::buildMesh() const {
+	// Sólo se copian los vértices que se usan, en el orden en que aparecen
+	std::vector<uint32_t> newIndex(positions.size(), UINT32_MAX);
+	std::vector<glm::vec3> outPositions, outNormals;
+	std::vector<glm::vec2> outTexCoords;
+	std::vector<GLuint> indices;
+	indices.reserve(liveTriangles * 3);
+	for (size_t t = 0; t < triangles.size(); t++) {
+		if (!triangleAlive[t])
+			continue;
+		for (auto v : triangles[t].idx) {
+			if (newIndex[v] == UINT32_MAX) {
+				newIndex[v] = static_cast<uint32_t>(outPositions.size());
+				outPositions.push_back(positions[v]);
+				if (!normals.empty())
+					outNormals.push_back(normals[v]);
+				if (!texCoords.empty())
+					outTexCoords.push_back(texCoords[v]);
+			}
+			indices.push_back(newIndex[v]);
+		}
+	}
+
+	auto mesh = std::make_shared<Mesh>();
+	if (!name.empty())
+		mesh->setName(name + "_LOD" + std::to_string(generatedLevels));
+	if (indices.empty())
+		return mesh;
+	mesh->addVertices(outPositions);
+	if (!outNormals.empty())
+		mesh->addNormals(outNormals);
+	if (!outTexCoords.empty())
+		mesh->addTexCoord(0, outTexCoords);
+	mesh->addIndices(indices);
+	mesh->addDrawCommand(new DrawElements(GL_TRIANGLES, static_cast<GLsizei>(indices.size()), GL_UNSIGNED_INT, 0));
+	if (material)
+		mesh->setMaterial(material);
+	return mesh;
+}
+
+std::vector<std::shared_ptr<Mesh>> MeshSimplifier::buildChain(unsigned int levels, float ratio,
+	float maxError) {
+	std::vector<std::shared_ptr<Mesh>> chain;
+	auto target = static_cast<double>(liveTriangles);
+	for (unsigned int i = 0; i < levels; i++) {
+		target *= ratio;
+		auto before = liveTriangles;
+		simplify(static_cast<size_t>(target), maxError);
+		// Si no se ha podido simplificar más, los siguientes niveles serían iguales
+		if (liveTriangles == before || liveTriangles == 0)
+			break;
+		generatedLevels++;
+		chain.push_back(buildMesh());
+	}
+	return chain;
+}
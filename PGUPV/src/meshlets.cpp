@@ -0,0 +1,260 @@
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <limits>
+#include <glm/glm.hpp>
+
+#include "meshlets.h"
+#include "glMatrices.h"
+#include "boundingVolumes.h"
+#include "indexedBindingPoint.h"
+#include "log.h"
+
+using PGUPV::Meshlet;
+using PGUPV::MeshletBuilder;
+using PGUPV::MeshletDrawElements;
+using PGUPV::GLMatrices;
+
+// Calcula la esfera y el cono de normales de un meshlet cuyos triángulos ya están en tris
+static void computeBounds(Meshlet &m, const uint32_t *tris, const std::vector<glm::vec3> &positions) {
+	glm::vec3 minP(std::numeric_limits<float>::max()), maxP(-std::numeric_limits<float>::max());
+	for (uint32_t i = 0; i < m.triangleCount * 3; i++) {
+		minP = glm::min(minP, positions[tris[i]]);
+		maxP = glm::max(maxP, positions[tris[i]]);
+	}
+	m.center = (minP + maxP) * 0.5f;
+	m.radius = 0.0f;
+	for (uint32_t i = 0; i < m.triangleCount * 3; i++)
+		m.radius = std::max(m.radius, glm::length(positions[tris[i]] - m.center));
+
+	std::vector<glm::vec3> normals;
+	std::vector<glm::vec3> corners;
+	glm::vec3 axis(0.0f);
+	for (uint32_t t = 0; t < m.triangleCount; t++) {
+		const auto &a = positions[tris[t * 3]];
+		auto n = glm::cross(positions[tris[t * 3 + 1]] - a, positions[tris[t * 3 + 2]] - a);
+		auto len = glm::length(n);
+		// Los triángulos degenerados no se ven desde ningún sitio
+		if (len == 0.0f)
+			continue;
+		normals.push_back(n / len);
+		corners.push_back(a);
+		axis += n;
+	}
+
+	m.coneApex = m.center;
+	m.coneAxis = glm::vec3(0.0f, 0.0f, 1.0f);
+	m.coneCutoff = 1.0f;
+	auto axisLen = glm::length(axis);
+	if (normals.empty() || axisLen == 0.0f)
+		return;
+	axis /= axisLen;
+
+	float minDot = 1.0f;
+	for (const auto &n : normals)
+		minDot = std::min(minDot, glm::dot(n, axis));
+	// Si alguna normal forma más de 90 grados con el eje, siempre hay algún triángulo de cara
+	if (minDot <= 0.0f)
+		return;
+
+	// El vértice del cono está sobre el eje, detrás de los planos de todos los triángulos
+	float maxT = 0.0f;
+	for (size_t i = 0; i < normals.size(); i++) {
+		auto t = glm::dot(m.center - corners[i], normals[i]) / glm::dot(axis, normals[i]);
+		maxT = std::max(maxT, t);
+	}
+	m.coneApex = m.center - axis * maxT;
+	m.coneAxis = axis;
+	m.coneCutoff = std::sqrt(1.0f - minDot * minDot);
+}
+
+std::vector<Meshlet> MeshletBuilder::build(std::vector<uint32_t> &indices, const std::vector<glm::vec3> &positions,
+	unsigned int maxVertices, unsigned int maxTriangles) {
+	if (indices.size() % 3 != 0)
+		ERRT("MeshletBuilder necesita una lista de triángulos");
+	if (maxVertices < 3 || maxTriangles == 0)
+		ERRT("Los meshlets tienen que poder contener al menos un triángulo");
+
+	auto nTriangles = indices.size() / 3;
+	auto nVertices = positions.size();
+
+	// Triángulos que usan cada vértice (en formato CSR)
+	std::vector<uint32_t> firstTri(nVertices + 1, 0);
+	for (auto i : indices)
+		firstTri[i + 1]++;
+	std::partial_sum(firstTri.begin(), firstTri.end(), firstTri.begin());
+	std::vector<uint32_t> vertexTris(indices.size());
+	{
+		auto fill = firstTri;
+		for (size_t i = 0; i < indices.size(); i++)
+			vertexTris[fill[indices[i]]++] = static_cast<uint32_t>(i / 3);
+	}
+
+	std::vector<glm::vec3> triNormals(nTriangles);
+	for (size_t t = 0; t < nTriangles; t++) {
+		const auto &a = positions[indices[t * 3]];
+		auto n = glm::cross(positions[indices[t * 3 + 1]] - a, positions[indices[t * 3 + 2]] - a);
+		auto len = glm::length(n);
+		triNormals[t] = len > 0.0f ? n / len : glm::vec3(0.0f);
+	}
+
+	std::vector<bool> assigned(nTriangles, false);
+	// Meshlet (más uno) en el que está cada vértice, para saber si un triángulo añade vértices
+	std::vector<uint32_t> vertexMeshlet(nVertices, 0);
+	std::vector<uint32_t> result;
+	result.reserve(indices.size());
+	std::vector<Meshlet> meshlets;
+	std::vector<uint32_t> candidates, nextSeeds;
+	size_t scan = 0;
+
+	while (true) {
+		// Se empieza junto al meshlet anterior, si queda algún vecino libre
+		uint32_t seed = static_cast<uint32_t>(nTriangles);
+		for (auto c : nextSeeds) {
+			if (!assigned[c]) {
+				seed = c;
+				break;
+			}
+		}
+		if (seed == nTriangles) {
+			while (scan < nTriangles && assigned[scan])
+				scan++;
+			if (scan == nTriangles)
+				break;
+			seed = static_cast<uint32_t>(scan);
+		}
+
+		Meshlet m{};
+		m.firstIndex = static_cast<uint32_t>(result.size());
+		auto id = static_cast<uint32_t>(meshlets.size() + 1);
+		glm::vec3 normalSum(0.0f);
+		candidates.clear();
+
+		auto addTriangle = [&](uint32_t t) {
+			assigned[t] = true;
+			for (int c = 0; c < 3; c++) {
+				auto v = indices[t * 3 + c];
+				result.push_back(v);
+				if (vertexMeshlet[v] == id)
+					continue;
+				vertexMeshlet[v] = id;
+				m.vertexCount++;
+				for (auto i = firstTri[v]; i < firstTri[v + 1]; i++) {
+					if (!assigned[vertexTris[i]])
+						candidates.push_back(vertexTris[i]);
+				}
+			}
+			m.triangleCount++;
+			normalSum += triNormals[t];
+		};
+		addTriangle(seed);
+
+		while (m.triangleCount < maxTriangles) {
+			auto axisLen = glm::length(normalSum);
+			auto axis = axisLen > 0.0f ? normalSum / axisLen : glm::vec3(0.0f);
+			float bestScore = std::numeric_limits<float>::max();
+			auto best = std::numeric_limits<size_t>::max();
+			size_t live = 0;
+			for (size_t i = 0; i < candidates.size(); i++) {
+				auto t = candidates[i];
+				if (assigned[t])
+					continue;
+				candidates[live] = t;
+				unsigned int newVertices = 0;
+				for (int c = 0; c < 3; c++)
+					newVertices += vertexMeshlet[indices[t * 3 + c]] != id;
+				if (m.vertexCount + newVertices <= maxVertices) {
+					// Pocos vértices nuevos y una normal parecida a la del meshlet
+					auto score = newVertices + (1.0f - glm::dot(axis, triNormals[t]));
+					if (score < bestScore) {
+						bestScore = score;
+						best = live;
+					}
+				}
+				live++;
+			}
+			candidates.resize(live);
+			if (best == std::numeric_limits<size_t>::max())
+				break;
+			auto t = candidates[best];
+			candidates[best] = candidates.back();
+			candidates.pop_back();
+			addTriangle(t);
+		}
+
+		nextSeeds.swap(candidates);
+		computeBounds(m, result.data() + m.firstIndex, positions);
+		meshlets.push_back(m);
+	}
+
+	indices.swap(result);
+	return meshlets;
+}
+
+static uint32_t totalIndices(const std::vector<Meshlet> &meshlets) {
+	uint32_t n = 0;
+	for (const auto &m : meshlets)
+		n += m.triangleCount * 3;
+	return n;
+}
+
+MeshletDrawElements::MeshletDrawElements(const std::vector<Meshlet> &meshlets, GLenum type, const void *offset,
+	const glm::mat4 &objectFromModel) :
+	DrawElements(GL_TRIANGLES, static_cast<GLsizei>(totalIndices(meshlets)), type, offset),
+	meshlets(meshlets), type(type), base(static_cast<const char *>(offset)), objectFromModel(objectFromModel),
+	frustumCulling(true), coneCulling(true), visibleTriangles(0), visibleMeshlets(0) {
+	if (type != GL_UNSIGNED_SHORT && type != GL_UNSIGNED_INT)
+		ERRT("Los índices de los meshlets tienen que ser GL_UNSIGNED_SHORT o GL_UNSIGNED_INT");
+}
+
+void MeshletDrawElements::renderFunc() {
+	auto mats = std::static_pointer_cast<GLMatrices>(
+		PGUPV::gl_uniform_buffer.getBound(UBO_GL_MATRICES_BINDING_INDEX));
+
+	// Sin matrices no se puede descartar nada
+	bool cull = mats && (frustumCulling || coneCulling);
+	glm::mat4 mvp(1.0f), modelViewInv(1.0f);
+	bool ortho = false;
+	if (cull) {
+		mvp = mats->getMatrix(GLMatrices::MODELVIEWPROJ_MATRIX) * objectFromModel;
+		modelViewInv = glm::inverse(mats->getMatrix(GLMatrices::MODELVIEW_MATRIX) * objectFromModel);
+		ortho = mats->getMatrix(GLMatrices::PROJ_MATRIX)[3][3] == 1.0f;
+	}
+	PGUPV::Frustum frustum(mvp);
+	// Posición de la cámara (o dirección de la vista, en proyección paralela) en el sistema de
+	// los meshlets
+	auto eye = glm::vec3(modelViewInv * glm::vec4(0.0f, 0.0f, 0.0f, 1.0f));
+	auto viewDir = glm::normalize(glm::vec3(modelViewInv * glm::vec4(0.0f, 0.0f, -1.0f, 0.0f)));
+
+	auto indexSize = type == GL_UNSIGNED_SHORT ? sizeof(GLushort) : sizeof(GLuint);
+	counts.clear();
+	offsets.clear();
+	visibleTriangles = 0;
+	visibleMeshlets = 0;
+	uint32_t runEnd = 0;
+	for (const auto &m : meshlets) {
+		if (cull) {
+			if (frustumCulling && !frustum.intersects(PGUPV::BoundingSphere(m.center, m.radius)))
+				continue;
+			if (coneCulling && m.coneCutoff < 1.0f) {
+				auto dir = ortho ? viewDir : m.coneApex - eye;
+				auto len = glm::length(dir);
+				if (len > 0.0f && glm::dot(dir / len, m.coneAxis) >= m.coneCutoff)
+					continue;
+			}
+		}
+		// Si el meshlet va justo detrás del anterior visible, se alarga su rango
+		if (!counts.empty() && runEnd == m.firstIndex)
+			counts.back() += static_cast<GLsizei>(m.triangleCount * 3);
+		else {
+			counts.push_back(static_cast<GLsizei>(m.triangleCount * 3));
+			offsets.push_back(base + m.firstIndex * indexSize);
+		}
+		runEnd = m.firstIndex + m.triangleCount * 3;
+		visibleTriangles += m.triangleCount;
+		visibleMeshlets++;
+	}
+
+	if (!counts.empty())
+		glMultiDrawElements(mode, counts.data(), type, offsets.data(), static_cast<GLsizei>(counts.size()));
+}
@@ -35,6 +35,12 @@ Mesh &Model::getMesh(size_t i) {
 	return *(meshes[i]);
 }
 
+std::shared_ptr<Mesh> Model::getMeshPtr(size_t i) {
+	if (i >= meshes.size())
+		ERRT("Esa malla no existe");
+	return meshes[i];
+}
+
 void Model::accept(std::function<void(Mesh&)> op) {
 	for (auto m : meshes) {
 		op(*m);
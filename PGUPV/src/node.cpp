@@ -7,6 +7,9 @@
 #include "node.h"
 #include "nodeVisitor.h"
 #include "nodeCallback.h"
+#include "indexedBindingPoint.h"
+#include "renderStats.h"
+#include "transform.h"
 
 using PGUPV::Node;
 using PGUPV::GLMatrices;
@@ -18,14 +21,17 @@ using PGUPV::NodeCallback;
 using PGUPV::Group;
 
 uint32_t Node::nextNodeId{ 1 };
+bool Node::viewFrustumCulling{ false };
 
 BoundingBox Node::getBB() {
+  boundsQueried = true;
   if (!bb.isValid())
     recomputeBoundingBox();
   return bb;
 }
 
 BoundingSphere Node::getBS() {
+  boundsQueried = true;
   if (!bs.isValid())
     recomputeBoundingSphere();
   return bs;
@@ -33,10 +39,43 @@ BoundingSphere Node::getBS() {
 
 void Node::resetBB() {
   bb.reset();
+  boundsGeneration++;
 }
 
 void Node::resetBS() {
   bs.reset();
+  boundsGeneration++;
+}
+
+PGUPV::Transform *Node::findParentTransform() {
+  if (!parentTransformValid) {
+    parentTransform = nullptr;
+    if (!parents.empty()) {
+      Group *p = parents[0];
+      auto t = dynamic_cast<PGUPV::Transform *>(p);
+      parentTransform = t ? t : p->findParentTransform();
+    }
+    parentTransformValid = true;
+  }
+  return parentTransform;
+}
+
+glm::mat4 Node::getWorldMatrix() {
+  auto t = findParentTransform();
+  return t ? t->getWorldTransform() : glm::mat4(1.0f);
+}
+
+BoundingBox Node::getWorldBB() {
+  auto b = getBB();
+  b.transform(getWorldMatrix());
+  return b;
+}
+
+BoundingSphere Node::getWorldBS() {
+  auto s = getBS();
+  if (s.isValid())
+    s.transform(getWorldMatrix());
+  return s;
 }
 
 Node *Node::getParent(unsigned int i) const
@@ -44,6 +83,24 @@ Node *Node::getParent(unsigned int i) const
   return parents[i];
 }
 
+bool Node::isOutsideViewVolume() {
+  // Sin volumen de inclusión no podemos saber si se ve
+  if (!viewFrustumCulling || !getBB().isValid())
+    return false;
+  auto mats = std::static_pointer_cast<GLMatrices>(
+    PGUPV::gl_uniform_buffer.getBound(UBO_GL_MATRICES_BINDING_INDEX));
+  if (!mats)
+    return false;
+
+  PGUPV::Frustum frustum(mats->getMatrix(GLMatrices::MODELVIEWPROJ_MATRIX));
+  // La esfera es más barata de comprobar, pero la caja se ajusta mejor
+  auto sphere = getBS();
+  if ((!sphere.isValid() || frustum.intersects(sphere)) && frustum.intersects(getBB()))
+    return false;
+  PGUPV::RenderStats::increment(PGUPV::RenderStats::Counter::NodesCulled);
+  return true;
+}
+
 void Node::ascend(NodeVisitor & visitor) {
   for (auto n : parents) {
     n->accept(visitor);
@@ -57,23 +114,58 @@ void Node::remove() {
   parents.clear();
 }
 
+namespace PGUPV {
 class InvalidateBoundingBoxes : public NodeVisitor {
 public:
   InvalidateBoundingBoxes() {
     setTraversalMode(NodeVisitor::TraversalMode::TRAVERSE_PARENTS);
+    setNodePathMode(NodeVisitor::NodePathMode::RAW);
   }
   void apply(Node &node) override {
+    // Si nadie ha consultado los volúmenes del nodo desde la última vez que se invalidaron,
+    // los antecesores no han podido recalcular los suyos: siguen invalidados
+    if (!node.boundsQueried)
+      return;
+    node.boundsQueried = false;
     node.resetBB();
     node.resetBS();
     node.ascend(*this);
   }
 };
 
+}
+
 void Node::invalidateBoundingVolumes() {
-  InvalidateBoundingBoxes ibb;
+  PGUPV::InvalidateBoundingBoxes ibb;
   accept(ibb);
 }
 
+namespace PGUPV {
+class InvalidateParentTransforms : public NodeVisitor {
+public:
+  InvalidateParentTransforms() {
+    setTraversalMode(NodeVisitor::TraversalMode::TRAVERSE_ALL_CHILDREN);
+    setNodePathMode(NodeVisitor::NodePathMode::RAW);
+  }
+  void apply(Node &node) override {
+    node.parentTransformValid = false;
+    traverse(node);
+  }
+  void apply(Transform &transform) override {
+    // Los descendientes guardan este Transform (o uno inferior), que no cambia. Sólo cambia
+    // su matriz del mundo
+    transform.parentTransformValid = false;
+    transform.invalidateWorldTransform();
+  }
+};
+
+}
+
+void Node::invalidateParentTransform() {
+  PGUPV::InvalidateParentTransforms ipt;
+  accept(ipt);
+}
+
 void Node::addUpdateCallback(std::shared_ptr<NodeCallback> nc)
 {
 	auto it = std::find(updateCallbacks.begin(), updateCallbacks.end(), nc);
@@ -97,9 +189,14 @@ void Node::clearUpdateCallbacks()
 void Node::addParent(Group *parent) {
   assert(parent != this);
   parents.push_back(parent);
+  if (parents.size() == 1)
+    invalidateParentTransform();
 }
 
 
 void Node::removeParent(Group *parent) {
+  bool wasFirst = !parents.empty() && parents[0] == parent;
   parents.erase(std::remove(parents.begin(), parents.end(), parent), parents.end());
+  if (wasFirst)
+    invalidateParentTransform();
 }
@@ -0,0 +1,86 @@
+#include "nodePool.h"
+
+using PGUPV::NodePool;
+
+// Reserva activa en cada hilo (ver NodePool::Scope)
+static thread_local std::shared_ptr<NodePool> currentPool;
+
+std::shared_ptr<NodePool> NodePool::build(size_t chunkSize) {
+	return std::shared_ptr<NodePool>(new NodePool(chunkSize));
+}
+
+NodePool::NodePool(size_t chunkSize) :
+	chunkSize(chunkSize < MAX_SMALL_SIZE ? MAX_SMALL_SIZE : chunkSize),
+	chunkPos(nullptr), chunkEnd(nullptr),
+	freeLists(sizeClass(MAX_SMALL_SIZE) + 1, nullptr),
+	reservedBytes(0), usedBytes(0) {
+}
+
+NodePool::~NodePool() {
+	for (auto c : chunks)
+		::operator delete(c);
+}
+
+void *NodePool::allocate(size_t bytes) {
+	if (bytes > MAX_SMALL_SIZE) {
+		std::lock_guard<std::mutex> lock(mutex);
+		usedBytes += bytes;
+		return ::operator new(bytes);
+	}
+
+	auto cls = sizeClass(bytes);
+	std::lock_guard<std::mutex> lock(mutex);
+	usedBytes += cls * ALIGNMENT;
+	if (auto b = freeLists[cls]) {
+		freeLists[cls] = b->next;
+		return b;
+	}
+	auto size = cls * ALIGNMENT;
+	if (chunkPos == nullptr || static_cast<size_t>(chunkEnd - chunkPos) < size) {
+		// El resto del bloque anterior se pierde (es menor que MAX_SMALL_SIZE)
+		chunkPos = static_cast<char *>(::operator new(chunkSize));
+		chunkEnd = chunkPos + chunkSize;
+		chunks.push_back(chunkPos);
+		reservedBytes += chunkSize;
+	}
+	auto p = chunkPos;
+	chunkPos += size;
+	return p;
+}
+
+void NodePool::deallocate(void *p, size_t bytes) {
+	if (bytes > MAX_SMALL_SIZE) {
+		std::lock_guard<std::mutex> lock(mutex);
+		usedBytes -= bytes;
+		::operator delete(p);
+		return;
+	}
+	auto cls = sizeClass(bytes);
+	auto b = static_cast<FreeBlock *>(p);
+	std::lock_guard<std::mutex> lock(mutex);
+	usedBytes -= cls * ALIGNMENT;
+	b->next = freeLists[cls];
+	freeLists[cls] = b;
+}
+
+size_t NodePool::getReservedBytes() const {
+	std::lock_guard<std::mutex> lock(mutex);
+	return reservedBytes;
+}
+
+size_t NodePool::getUsedBytes() const {
+	std::lock_guard<std::mutex> lock(mutex);
+	return usedBytes;
+}
+
+NodePool::Scope::Scope(std::shared_ptr<NodePool> pool) : previous(currentPool) {
+	currentPool = pool;
+}
+
+NodePool::Scope::~Scope() {
+	currentPool = previous;
+}
+
+NodePool *NodePool::current() {
+	return currentPool.get();
+}
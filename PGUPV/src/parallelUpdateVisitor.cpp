@@ -0,0 +1,98 @@
+#include "parallelUpdateVisitor.h"
+#include "jobPool.h"
+
+using PGUPV::ParallelUpdateVisitor;
+using PGUPV::JobPool;
+using PGUPV::Node;
+using PGUPV::Group;
+using PGUPV::Geode;
+
+ParallelUpdateVisitor::ParallelUpdateVisitor(JobPool *pool, unsigned int maxParallelDepth) :
+	pool(pool), maxParallelDepth(maxParallelDepth) {
+}
+
+bool ParallelUpdateVisitor::callbacksAreThreadSafe(Node &node) {
+	for (const auto &c : node.getUpdateCallbacks()) {
+		if (!c->isThreadSafe())
+			return false;
+	}
+	return true;
+}
+
+bool ParallelUpdateVisitor::mustDefer(Node &node) {
+	// Aunque este nodo se esté visitando en el hilo principal, puede haber otros hilos
+	// actualizando subárboles hermanos, así que se aparta igualmente. Los nodos con varios
+	// padres se apartan siempre: se llegaría a ellos desde varios hilos a la vez
+	return pool && (node.getNumParents() > 1 || !callbacksAreThreadSafe(node));
+}
+
+bool ParallelUpdateVisitor::firstVisit(Node &node) {
+	return node.getNumParents() <= 1 || updatedShared.insert(&node).second;
+}
+
+void ParallelUpdateVisitor::apply(Node &node) {
+	if (mustDefer(node))
+		defer();
+	else if (firstVisit(node))
+		handle_callbacks_and_traverse(node);
+}
+
+void ParallelUpdateVisitor::apply(Geode &node) {
+	if (mustDefer(node))
+		defer();
+	else if (firstVisit(node))
+		handle_geode_callbacks(node);
+}
+
+void ParallelUpdateVisitor::defer() {
+	deferred.push_back(DeferredNode{ nodepath, rawNodepath });
+}
+
+void ParallelUpdateVisitor::traverse(Node &node) {
+	auto group = dynamic_cast<Group *>(&node);
+	if (!pool || !group || group->getNumChildren() < 2 || getNodePathLength() > maxParallelDepth ||
+		traversalMode != TraversalMode::TRAVERSE_ALL_CHILDREN) {
+		UpdateVisitor::traverse(node);
+		return;
+	}
+
+	// Cada hijo se recorre en un trabajo con su propio visitante (este hilo también ejecuta
+	// trabajos mientras espera). Cada visitante guarda sus nodos apartados, que luego se
+	// concatenan en el orden de los hijos
+	auto n = group->getNumChildren();
+	std::vector<ParallelUpdateVisitor> subvisitors(n, ParallelUpdateVisitor(pool, maxParallelDepth));
+	JobPool::Counter counter;
+	for (size_t i = 0; i < n; i++) {
+		auto &sv = subvisitors[i];
+		sv.nodePathMode = nodePathMode;
+		sv.nodepath = nodepath;
+		sv.rawNodepath = rawNodepath;
+		auto child = group->getChild(i);
+		pool->submit([&sv, child]() { child->accept(sv); }, counter);
+	}
+	pool->wait(counter);
+
+	for (auto &sv : subvisitors) {
+		deferred.insert(deferred.end(), sv.deferred.begin(), sv.deferred.end());
+	}
+}
+
+void ParallelUpdateVisitor::runDeferred() {
+	auto pending = std::move(deferred);
+	deferred.clear();
+	// Un único visitante, para que los nodos con varios padres se actualicen sólo una vez
+	ParallelUpdateVisitor serial(nullptr);
+	serial.nodePathMode = nodePathMode;
+	for (auto &d : pending) {
+		serial.nodepath = std::move(d.path);
+		serial.rawNodepath = std::move(d.rawPath);
+		auto node = nodePathMode == NodePathMode::RAW ? serial.rawNodepath.back() :
+			serial.nodepath.back().get();
+		if (!serial.firstVisit(*node))
+			continue;
+		if (auto geode = dynamic_cast<Geode *>(node))
+			serial.handle_geode_callbacks(*geode);
+		else
+			serial.handle_callbacks_and_traverse(*node);
+	}
+}
@@ -4,6 +4,7 @@
 #include "indexedBindingPoint.h"
 #include "uboPBRMaterial.h"
 #include "bindableTexture.h"
+#include "renderStats.h"
 
 
 using PGUPV::PBRMaterial;
@@ -126,6 +127,7 @@ void PBRMaterial::setAmbientOcTexture(std::shared_ptr<BindableTexture> tex, unsi
 }
 
 void PBRMaterial::use() {
+	PGUPV::RenderStats::increment(PGUPV::RenderStats::Counter::MaterialBinds);
 	gl_uniform_buffer.bindBufferBase(uboPBRMaterial, UBO_PBR_MATERIALS_BINDING_INDEX);
 	for (auto t : texs) {
 		t.second->bind(GL_TEXTURE0 + t.first);
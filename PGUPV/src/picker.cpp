@@ -1,4 +1,5 @@
 #include "picker.h"
+#include "rayPicker.h"
 #include <fbo.h>
 #include <texture2D.h>
 #include <glStateCache.h>
@@ -13,24 +14,30 @@ using PGUPV::Picker;
 using PGUPV::Texture2D;
 using PGUPV::GLMatrices;
 using PGUPV::Model;
+using PGUPV::RayPicker;
 
 
 class Picker::PickerImpl {
 public:
-	PickerImpl();
+	explicit PickerImpl(Method method);
 	~PickerImpl() {};
 	uint32_t pick(const PickData& pick, const glm::mat4& viewMatrix, const glm::mat4& projMatrix, const std::vector<ModelId>& objects);
 	static glm::mat4 adjustProjMatrix(const PickData& pick, const glm::mat4& projMatrix);
 protected:
-	void prepareFBO();
-	FBO fbo;
+	uint32_t pickGPU(const PickData& pick, const glm::mat4& viewMatrix, const glm::mat4& projMatrix, const std::vector<ModelId>& objects);
+	void prepareGPU();
+	Method method;
+	// Sólo se usa con Method::CPU. Guarda las jerarquías de las mallas entre llamadas
+	RayPicker rayPicker;
+	// Sólo se crean con Method::GPU
+	std::unique_ptr<FBO> fbo;
 	static const int selectionWindowSemiWidth = 2;
-	Program prog;
+	std::unique_ptr<Program> prog;
 	GLint idLoc, mvpLoc;
 };
 
 
-Picker::Picker() : pimpl(new Picker::PickerImpl())
+Picker::Picker(Method method) : pimpl(new Picker::PickerImpl(method))
 {
 }
 
@@ -67,22 +74,30 @@ static const std::vector<std::string> pickerFrag{
 };
 
 
-Picker::PickerImpl::PickerImpl()
+Picker::PickerImpl::PickerImpl(Method method) : method(method), idLoc(-1), mvpLoc(-1)
 {
-	prog.addAttributeLocation(PGUPV::Mesh::VERTICES, "position");
-	prog.loadStrings(pickerVert, pickerFrag);
-	prog.compile();
-	idLoc = prog.getUniformLocation("id");
-	mvpLoc = prog.getUniformLocation("mvp");
-	prepareFBO();
+	if (method == Method::GPU)
+		prepareGPU();
 }
 
 uint32_t Picker::PickerImpl::pick(const Picker::PickData &pick, const glm::mat4& viewMatrix, const glm::mat4& projMatrix, const std::vector<ModelId>& objects)
+{
+	if (method == Method::GPU)
+		return pickGPU(pick, viewMatrix, projMatrix, objects);
+
+	rayPicker.build(objects);
+	RayPicker::Hit hit;
+	if (!rayPicker.pick(RayPicker::computeRay(pick, viewMatrix, projMatrix), hit))
+		return 0;
+	return hit.id;
+}
+
+uint32_t Picker::PickerImpl::pickGPU(const Picker::PickData &pick, const glm::mat4& viewMatrix, const glm::mat4& projMatrix, const std::vector<ModelId>& objects)
 {
 	PGUPV::GLStateCapturer<PGUPV::FrameBufferObjectState<GL_DRAW_BUFFER>> currentFBO;
 	PGUPV::CurrentProgramState currentProgram;
 
-	fbo.bind();
+	fbo->bind();
 
 	GLuint backgroundId[]{ 0, 0, 0, 0 };
 	glClearBufferuiv(GL_COLOR, 0, backgroundId);
@@ -92,7 +107,7 @@ uint32_t Picker::PickerImpl::pick(const Picker::PickData &pick, const glm::mat4&
 	auto adjustedProjMatrix = adjustProjMatrix(pick, projMatrix);
 	auto vp = adjustedProjMatrix * viewMatrix;
 
-	prog.use();
+	prog->use();
 
 	glm::mat4 mvp;
 	for (const auto &m : objects) {
@@ -105,28 +120,32 @@ uint32_t Picker::PickerImpl::pick(const Picker::PickData &pick, const glm::mat4&
 	int selectionWindowSide = selectionWindowSemiWidth * 2 + 1;
 	std::vector<GLuint> ids;
 	ids.resize(selectionWindowSide * selectionWindowSide);
-	glGetTextureImage(fbo.getAttachedTexture(GL_COLOR_ATTACHMENT0)->getId(),
+	glGetTextureImage(fbo->getAttachedTexture(GL_COLOR_ATTACHMENT0)->getId(),
 		0,
 		GL_RED_INTEGER,
 		GL_UNSIGNED_INT,
 		selectionWindowSide * selectionWindowSide * sizeof(GLuint),
 		&ids[0]);
 
-	for (int i = 0; i < selectionWindowSide * selectionWindowSide; i++) {
-		INFO(std::to_string(ids[i]));
-	}
-
 	return ids[selectionWindowSemiWidth * selectionWindowSide + selectionWindowSemiWidth];
 }
 
-void Picker::PickerImpl::prepareFBO()
+void Picker::PickerImpl::prepareGPU()
 {
+	prog.reset(new Program());
+	prog->addAttributeLocation(PGUPV::Mesh::VERTICES, "position");
+	prog->loadStrings(pickerVert, pickerFrag);
+	prog->compile();
+	idLoc = prog->getUniformLocation("id");
+	mvpLoc = prog->getUniformLocation("mvp");
+
+	fbo.reset(new FBO());
 	auto tex = std::make_shared<Texture2D>(GL_NEAREST, GL_NEAREST, GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE);
 	auto selectionWindowSide = 2 * selectionWindowSemiWidth + 1;
 	tex->allocate(selectionWindowSide, selectionWindowSide, GL_R32UI);
-	fbo.attach(GL_COLOR_ATTACHMENT0, tex);
-	fbo.createAndAttach(GL_DEPTH_ATTACHMENT, selectionWindowSide, selectionWindowSide);
-	assert(fbo.isComplete());
+	fbo->attach(GL_COLOR_ATTACHMENT0, tex);
+	fbo->createAndAttach(GL_DEPTH_ATTACHMENT, selectionWindowSide, selectionWindowSide);
+	assert(fbo->isComplete());
 }
 
 glm::mat4 Picker::PickerImpl::adjustProjMatrix(const PickData& pick, const glm::mat4& projMatrix)
@@ -1,5 +1,6 @@
 
 #include <fstream>
+#include <cstring>
 
 #include <sstream>
 
@@ -17,6 +18,9 @@
 #include "indexedBindingPoint.h"
 #include "glslInfo.h"
 #include "material.h"
+#include "glMatrices.h"
+#include "programCache.h"
+#include "glStateTracker.h"
 
 using std::cout;
 using std::cerr;
@@ -31,6 +35,7 @@ using PGUPV::ShaderLibrary;
 using PGUPV::Shader;
 using PGUPV::UniformInfo;
 using PGUPV::UniformInfoBlocks;
+using PGUPV::ProgramCache;
 
 Program* Program::prevProgram = nullptr;
 
@@ -40,7 +45,8 @@ void declareVarTU(const std::string& base, uint texUnitBase, Program& m) {
 		m.replaceString(base + std::to_string(i), std::to_string(texUnitBase + i - 1));
 }
 
-Program::Program() : programId(0) {
+Program::Program() : reloading(false), programId(0), transformInterleaved(false), compiling(false),
+	usingPlaceholder(false), usingErrorProgram(false), watchId(0) {
 	App::getInstance().getShaderLibrary().add(this);
 
 	declareVarTU("$TEXDIFF", PGUPV::Material::DIFFUSE_TUNIT, *this);
@@ -52,6 +58,7 @@ Program::Program() : programId(0) {
 
 Program::~Program() {
 	App::getInstance().getShaderLibrary().remove(this);
+	FileWatcher::unwatch(watchId);
 	release();
 };
 
@@ -60,6 +67,12 @@ void Program::release() {
 		glDeleteProgram(programId);
 		programId = 0;
 	}
+	// El siguiente use tiene que instalar el programa nuevo
+	if (prevProgram == this)
+		prevProgram = nullptr;
+	compiling = false;
+	usingErrorProgram = false;
+	clearReflection();
 }
 
 int Program::loadFiles(const std::string& name) {
@@ -210,9 +223,16 @@ static std::vector<std::string> errorProgramFrag{
 };
 
 bool Program::compile() {
-	Uints tolink;
-	std::stringstream compilationResult;
+	if (startCompile())
+		finishCompile();
+	return true;
+}
 
+void Program::compileAsync() {
+	startCompile();
+}
+
+bool Program::startCompile() {
 	CHECK_GL();
 
 	if (shaders.empty())
@@ -222,70 +242,352 @@ bool Program::compile() {
 		glDeleteProgram(programId);
 		programId = 0;
 	}
+	clearReflection();
+	compiling = false;
+
+	// Si el mismo programa se enlazó en otra ejecución, se carga su binario
+	cacheKey.clear();
+	if (ProgramCache::isEnabled()) {
+		cacheKey = getCacheKey();
+		programId = glCreateProgram();
+		if (ProgramCache::load(programId, cacheKey)) {
+			buildReflection();
+			bindUBOs();
+			return false;
+		}
+		glDeleteProgram(programId);
+		programId = 0;
+	}
 
-	for (std::map<Shader::ShaderType, std::shared_ptr<Shader>>::iterator i =
-		shaders.begin();
-		i != shaders.end(); ++i) {
-		GLuint sid = (i->second)->compile();
-		if (sid == 0) {
-			compilationResult << (i->second)->getErrorMessage() << std::endl;
-			(i->second)->printSrc(compilationResult);
-			// No seguimos compilando
+	// Se lanzan todas las compilaciones y el enlace sin consultar su estado, para que el
+	// driver pueda trabajar en paralelo
+	Uints tolink;
+	for (auto &s : shaders) {
+		s.second->startCompile();
+		tolink.push_back(s.second->getId());
+	}
+	startLink(tolink);
+	compiling = true;
+	return true;
+}
+
+bool Program::isReady() {
+	if (!compiling)
+		return programId != 0;
+	if (GLEW_KHR_parallel_shader_compile || GLEW_ARB_parallel_shader_compile) {
+		GLint done = GL_FALSE;
+		glGetProgramiv(programId, GL_COMPLETION_STATUS_KHR, &done);
+		if (!done)
+			return false;
+	}
+	finishCompile();
+	return true;
+}
+
+void Program::finishCompile() {
+	if (!compiling)
+		return;
+	compiling = false;
+
+	std::stringstream compilationResult;
+	bool compiled = true;
+	for (auto &s : shaders) {
+		if (s.second->finishCompile() == 0) {
+			compilationResult << s.second->getErrorMessage() << std::endl;
+			s.second->printSrc(compilationResult);
+			compiled = false;
 			break;
 		}
-		else {
-			tolink.push_back(sid);
-		}
 	}
 
-	if (tolink.size() == shaders.size())
-		linkProgram(tolink, compilationResult);
+	if (compiled) {
+		checkLink(compilationResult);
+		if (programId && !cacheKey.empty())
+			ProgramCache::store(programId, cacheKey);
+	}
+	else {
+		glDeleteProgram(programId);
+		programId = 0;
+	}
+
+	if (!programId && reloading) {
+		// reloadShaders vuelve a la versión anterior
+		if (compiled)
+			printSrcs(compilationResult);
+		ERR(compilationResult.str());
+		return;
+	}
 
 	if (!programId) {
 		// Ha fallado algo...
-		if (tolink.size() == shaders.size()) {
+		if (compiled) {
 			// Ha fallado el enlace: imprimir todos los shaders
 			printSrcs(compilationResult);
 		}
-		pendingConnections.erase(
-			std::remove_if(
-				pendingConnections.begin(),
-				pendingConnections.end(),
-				[](const PendingConnection& pc) {
-					return pc.bindingPoint != UBO_GL_MATRICES_BINDING_INDEX;
-				}), pendingConnections.end());
+		// Se mantienen las conexiones de los UBOs para cuando se corrijan los shaders
+		bool withGLMatrices = std::any_of(pendingConnections.begin(), pendingConnections.end(),
+			[](const PendingConnection& pc) {
+				return pc.bindingPoint == UBO_GL_MATRICES_BINDING_INDEX;
+			});
+		// Se siguen vigilando los ficheros, para compilarlos otra vez cuando se corrijan
+		for (auto &s : shaders)
+			if (!s.second->getFilename().empty()) {
+				failedShaders = shaders;
+				break;
+			}
 		shaders.clear();
-		if (pendingConnections.empty()) {
+		if (!withGLMatrices) {
 			loadStrings(errorProgramVertNoGLMatrices, errorProgramFrag);
 		}
 		else {
 			loadStrings(errorProgramVert, errorProgramFrag);
 		}
+		usingErrorProgram = true;
 		compile();
 		ERR(compilationResult.str());
-		return true;
+		return;
 	}
 
+	if (!failedShaders.empty() && !reloading) {
+		failedShaders.clear();
+		updateFileWatch();
+	}
+	buildReflection();
 	bindUBOs();
-	return true;
+}
+
+// Programa que se instala en lugar de los que se están compilando
+static Program &placeholderProgram(bool withGLMatrices) {
+	static Program *placeholders[2] = { nullptr, nullptr };
+	auto &p = placeholders[withGLMatrices ? 1 : 0];
+	if (!p) {
+		p = new Program();
+		if (withGLMatrices) {
+			p->replaceString("$" + PGUPV::GLMatrices::blockName, PGUPV::GLMatrices::definition);
+			p->loadStrings(errorProgramVert, errorProgramFrag);
+		}
+		else
+			p->loadStrings(errorProgramVertNoGLMatrices, errorProgramFrag);
+		p->compile();
+	}
+	return *p;
+}
+
+void Program::clearReflection() {
+	uniforms.clear();
+	uniformBlocks.clear();
+	storageBlocks.clear();
+	for (int i = 0; i < Shader::NUM_SHADER_TYPES; i++) {
+		subroutineUniforms[i].clear();
+		subroutineIndices[i].clear();
+	}
+	uniformValues.clear();
+}
+
+void Program::buildReflection() {
+	clearReflection();
+	std::vector<char> name;
+	GLint maxLength, n;
+
+	// Uniforms del bloque por defecto (los de los bloques tienen localización -1)
+	glGetProgramiv(programId, GL_ACTIVE_UNIFORMS, &n);
+	glGetProgramiv(programId, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+	name.resize(std::max(maxLength, 1));
+	for (GLint i = 0; i < n; i++) {
+		UniformEntry e;
+		glGetActiveUniform(programId, i, maxLength, nullptr, &e.size, &e.type, name.data());
+		e.location = glGetUniformLocation(programId, name.data());
+		std::string uname(name.data());
+		uniforms[uname] = e;
+		// Los arrays aparecen como "nombre[0]": se añade "nombre" y el resto de elementos
+		auto bracket = uname.rfind("[0]");
+		if (bracket != std::string::npos && bracket + 3 == uname.size()) {
+			auto base = uname.substr(0, bracket);
+			uniforms[base] = e;
+			for (GLint j = 1; j < e.size; j++) {
+				auto elem = base + "[" + std::to_string(j) + "]";
+				uniforms[elem] = UniformEntry{ glGetUniformLocation(programId, elem.c_str()), e.type, 1 };
+			}
+		}
+	}
+
+	glGetProgramiv(programId, GL_ACTIVE_UNIFORM_BLOCKS, &n);
+	glGetProgramiv(programId, GL_ACTIVE_UNIFORM_BLOCK_MAX_NAME_LENGTH, &maxLength);
+	name.resize(std::max(maxLength, 1));
+	for (GLint i = 0; i < n; i++) {
+		BlockEntry e{ static_cast<GLuint>(i), 0, 0 };
+		glGetActiveUniformBlockName(programId, i, maxLength, nullptr, name.data());
+		glGetActiveUniformBlockiv(programId, i, GL_UNIFORM_BLOCK_DATA_SIZE, &e.dataSize);
+		glGetActiveUniformBlockiv(programId, i, GL_UNIFORM_BLOCK_BINDING, &e.binding);
+		uniformBlocks[name.data()] = e;
+	}
+
+	if (GLEW_VERSION_4_3 || GLEW_ARB_program_interface_query) {
+		glGetProgramInterfaceiv(programId, GL_SHADER_STORAGE_BLOCK, GL_ACTIVE_RESOURCES, &n);
+		glGetProgramInterfaceiv(programId, GL_SHADER_STORAGE_BLOCK, GL_MAX_NAME_LENGTH, &maxLength);
+		name.resize(std::max(maxLength, 1));
+		for (GLint i = 0; i < n; i++) {
+			BlockEntry e{ static_cast<GLuint>(i), 0, 0 };
+			glGetProgramResourceName(programId, GL_SHADER_STORAGE_BLOCK, i, maxLength, nullptr, name.data());
+			GLenum props[] = { GL_BUFFER_DATA_SIZE, GL_BUFFER_BINDING };
+			GLint values[2];
+			glGetProgramResourceiv(programId, GL_SHADER_STORAGE_BLOCK, i, 2, props, 2, nullptr, values);
+			e.dataSize = values[0];
+			e.binding = values[1];
+			storageBlocks[name.data()] = e;
+		}
+	}
+
+	if (GLEW_VERSION_4_0 || GLEW_ARB_shader_subroutine) {
+		for (auto &s : shaders) {
+			auto stage = Shader::toGLType(s.first);
+			glGetProgramStageiv(programId, stage, GL_ACTIVE_SUBROUTINE_UNIFORMS, &n);
+			glGetProgramStageiv(programId, stage, GL_ACTIVE_SUBROUTINE_UNIFORM_MAX_LENGTH, &maxLength);
+			name.resize(std::max(maxLength, 1));
+			for (GLint i = 0; i < n; i++) {
+				glGetActiveSubroutineUniformName(programId, stage, i, maxLength, nullptr, name.data());
+				subroutineUniforms[s.first][name.data()] = glGetSubroutineUniformLocation(programId, stage, name.data());
+			}
+			glGetProgramStageiv(programId, stage, GL_ACTIVE_SUBROUTINES, &n);
+			glGetProgramStageiv(programId, stage, GL_ACTIVE_SUBROUTINE_MAX_LENGTH, &maxLength);
+			name.resize(std::max(maxLength, 1));
+			for (GLint i = 0; i < n; i++) {
+				glGetActiveSubroutineName(programId, stage, i, maxLength, nullptr, name.data());
+				subroutineIndices[s.first][name.data()] = static_cast<GLuint>(i);
+			}
+		}
+	}
+	CHECK_GL2("Error consultando los recursos del programa");
 }
 
 int Program::getUniformLocation(const std::string& uniform) {
+	finishCompile();
 	if (programId == 0)
 		ERRT("No se puede pedir la posición de un uniform si el shader no está "
 			"enlazado");
 
-	CHECK_GL();
+	auto it = uniforms.find(uniform);
+	if (it != uniforms.end())
+		return it->second.location;
 
+	// Nombres que no aparecen tal cual en la tabla (p.e., "s.campo[2]"). El resultado se
+	// guarda, para que los fallos no se vuelvan a consultar ni a avisar
 	GLint loc = glGetUniformLocation(programId, uniform.c_str());
 	if (loc == -1)
 		ERR("¡Cuidado! No se encuentra la variable uniform " + uniform +
 			". Asegúrate de que el programa donde"
 			" se encuentra el uniform está enlazado y la variable no ha sido "
 			"eliminada por el compilador");
+	uniforms[uniform] = UniformEntry{ loc, GL_NONE, 0 };
 	return loc;
 }
 
+bool Program::changeUniformValue(GLint location, GLenum type, const void *data, size_t size) {
+	auto &v = uniformValues[location];
+	if (v.type == type && memcmp(v.data, data, size) == 0)
+		return false;
+	v.type = type;
+	memcpy(v.data, data, size);
+	return true;
+}
+
+void Program::restoreUniformValue(GLint location, const UniformValue &value) {
+	auto get = [&value](auto v) {
+		memcpy(&v, value.data, sizeof(v));
+		return v;
+	};
+	switch (value.type) {
+	case GL_INT: setUniform(location, get(int())); break;
+	case GL_UNSIGNED_INT: setUniform(location, get(uint())); break;
+	case GL_FLOAT: setUniform(location, get(float())); break;
+	case GL_FLOAT_VEC2: setUniform(location, get(glm::vec2())); break;
+	case GL_FLOAT_VEC3: setUniform(location, get(glm::vec3())); break;
+	case GL_FLOAT_VEC4: setUniform(location, get(glm::vec4())); break;
+	case GL_INT_VEC2: setUniform(location, get(glm::ivec2())); break;
+	case GL_INT_VEC3: setUniform(location, get(glm::ivec3())); break;
+	case GL_INT_VEC4: setUniform(location, get(glm::ivec4())); break;
+	case GL_FLOAT_MAT3: setUniform(location, get(glm::mat3())); break;
+	case GL_FLOAT_MAT4: setUniform(location, get(glm::mat4())); break;
+	}
+}
+
+void Program::setUniform(GLint location, bool v) {
+	setUniform(location, v ? 1 : 0);
+}
+
+void Program::setUniform(GLint location, int v) {
+	if (location != -1 && changeUniformValue(location, GL_INT, &v, sizeof(v)))
+		glProgramUniform1i(programId, location, v);
+}
+
+void Program::setUniform(GLint location, uint v) {
+	if (location != -1 && changeUniformValue(location, GL_UNSIGNED_INT, &v, sizeof(v)))
+		glProgramUniform1ui(programId, location, v);
+}
+
+void Program::setUniform(GLint location, float v) {
+	if (location != -1 && changeUniformValue(location, GL_FLOAT, &v, sizeof(v)))
+		glProgramUniform1f(programId, location, v);
+}
+
+void Program::setUniform(GLint location, const glm::vec2 &v) {
+	if (location != -1 && changeUniformValue(location, GL_FLOAT_VEC2, &v, sizeof(v)))
+		glProgramUniform2fv(programId, location, 1, &v.x);
+}
+
+void Program::setUniform(GLint location, const glm::vec3 &v) {
+	if (location != -1 && changeUniformValue(location, GL_FLOAT_VEC3, &v, sizeof(v)))
+		glProgramUniform3fv(programId, location, 1, &v.x);
+}
+
+void Program::setUniform(GLint location, const glm::vec4 &v) {
+	if (location != -1 && changeUniformValue(location, GL_FLOAT_VEC4, &v, sizeof(v)))
+		glProgramUniform4fv(programId, location, 1, &v.x);
+}
+
+void Program::setUniform(GLint location, const glm::ivec2 &v) {
+	if (location != -1 && changeUniformValue(location, GL_INT_VEC2, &v, sizeof(v)))
+		glProgramUniform2iv(programId, location, 1, &v.x);
+}
+
+void Program::setUniform(GLint location, const glm::ivec3 &v) {
+	if (location != -1 && changeUniformValue(location, GL_INT_VEC3, &v, sizeof(v)))
+		glProgramUniform3iv(programId, location, 1, &v.x);
+}
+
+void Program::setUniform(GLint location, const glm::ivec4 &v) {
+	if (location != -1 && changeUniformValue(location, GL_INT_VEC4, &v, sizeof(v)))
+		glProgramUniform4iv(programId, location, 1, &v.x);
+}
+
+void Program::setUniform(GLint location, const glm::mat3 &v) {
+	if (location != -1 && changeUniformValue(location, GL_FLOAT_MAT3, &v, sizeof(v)))
+		glProgramUniformMatrix3fv(programId, location, 1, GL_FALSE, &v[0][0]);
+}
+
+void Program::setUniform(GLint location, const glm::mat4 &v) {
+	if (location != -1 && changeUniformValue(location, GL_FLOAT_MAT4, &v, sizeof(v)))
+		glProgramUniformMatrix4fv(programId, location, 1, GL_FALSE, &v[0][0]);
+}
+
+std::string Program::getCacheKey() const {
+	std::vector<std::string> parts;
+	for (auto &s : shaders) {
+		std::string src = std::to_string(s.first) + ":";
+		for (auto &line : s.second->getSource()) {
+			src += line;
+			src += '\n';
+		}
+		parts.push_back(src);
+	}
+	for (auto &a : attribs)
+		parts.push_back("attrib " + std::to_string(a.loc) + " " + a.name);
+	for (auto &v : transformVaryings)
+		parts.push_back("varying " + v);
+	parts.push_back(transformInterleaved ? "interleaved" : "separate");
+	return ProgramCache::computeKey(parts);
+}
+
 void Program::bindAttribs() {
 	for (uint i = 0; i < attribs.size(); i++)
 		glBindAttribLocation(programId, attribs[i].loc, attribs[i].name.c_str());
@@ -301,16 +603,13 @@ void Program::addAttributeLocation(unsigned int loc, const std::string& name) {
 
 /*
 
-Enlaza un programa compuesto por uno o más shaders.
-Devuelve el identificador de programa, o 0 si se produce algún error.
+Lanza el enlace de un programa compuesto por uno o más shaders (el resultado se comprueba
+con checkLink).
 Parámetros de entrada:
 -un std::vector de GLuint, con los identificadores de shader a enlazar.
 
 */
-bool Program::linkProgram(const PGUPV::Uints& shids,
-	std::ostream& error_output) {
-	GLint linked;
-
+void Program::startLink(const PGUPV::Uints& shids) {
 	programId = glCreateProgram();
 	for (unsigned int i = 0; i < shids.size(); i++)
 		glAttachShader(programId, shids[i]);
@@ -327,9 +626,18 @@ bool Program::linkProgram(const PGUPV::Uints& shids,
 		delete[] vars;
 	}
 
+	if (ProgramCache::isEnabled())
+		glProgramParameteri(programId, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
 	glLinkProgram(programId);
 	CHECK_GL();
+}
 
+/*
+Comprueba el resultado del enlace. Si ha fallado, escribe el error en error_output, borra el
+programa y devuelve false
+*/
+bool Program::checkLink(std::ostream& error_output) {
+	GLint linked;
 	glGetProgramiv(programId, GL_LINK_STATUS, &linked);
 
 	if (linked == GL_FALSE) {
@@ -351,20 +659,39 @@ bool Program::linkProgram(const PGUPV::Uints& shids,
 Program* Program::use(bool reconnectUBOs) {
 	// Si es el mismo programa que hay instalado y no hay que recompilarlo, 
 	// terminar
-	if (this == prevProgram && programId != 0)
+	if (this == prevProgram && programId != 0 && !usingPlaceholder)
 		return this;
 
+	// Sin compilar, se compila esperando al resultado: el código que llama a use suele
+	// escribir uniforms a continuación. Sólo los programas lanzados con compileAsync (p.e.,
+	// desde ShaderLibrary::compileAllAsync) dibujan con el programa de error mientras tanto
 	if (!programId) {
 		compile();
 	}
+	if (compiling && !isReady()) {
+		// Mientras se compila, se dibuja con el programa de error
+		for (auto &pc : pendingConnections)
+			PGUPV::gl_uniform_buffer.bindBufferBase(pc.bo, pc.bindingPoint);
+		bool withGLMatrices = std::any_of(pendingConnections.begin(), pendingConnections.end(),
+			[](const PendingConnection& pc) { return pc.bindingPoint == UBO_GL_MATRICES_BINDING_INDEX; });
+		PGUPV::GLStateTracker::useProgram(placeholderProgram(withGLMatrices).getId());
+		PGUPV::GLMatrices::flushBound();
+		usingPlaceholder = true;
+		Program* prev = prevProgram;
+		prevProgram = this;
+		return prev;
+	}
+	usingPlaceholder = false;
 	// Otro programa puede haber cambiado los UBO vinculados. Revincular
 	if (reconnectUBOs && !bindUBOs())
 		ERRT("Error intentando vincular los bloques uniform");
 
 	if (programId)
-		glUseProgram(programId);
+		PGUPV::GLStateTracker::useProgram(programId);
 	else
 		ERRT("Intentando activar un programa inexistente");
+	// bindUBOs puede haber vinculado el propio UBO de GLMatrices, que puede no estar al día
+	PGUPV::GLMatrices::flushBound();
 
 	refreshRoutineUniforms();
 	Program* prev = prevProgram;
@@ -375,19 +702,42 @@ Program* Program::use(bool reconnectUBOs) {
 void Program::unUse()
 {
 	prevProgram = nullptr;
-	glUseProgram(0);
+	PGUPV::GLStateTracker::useProgram(0);
 }
 
 bool Program::bindBlockToBindingPoint(const std::string& blockName,
 	GLuint bindingPoint) {
+	finishCompile();
 	if (programId == 0)
 		ERRT("Antes de llamar a Program::bindBlockToBindingPoint debes compilar el programa");
 
-	GLuint idx = glGetUniformBlockIndex(programId, blockName.c_str());
-	if (idx == GL_INVALID_INDEX)
+	auto it = uniformBlocks.find(blockName);
+	if (it == uniformBlocks.end())
 		return false;
 
-	glUniformBlockBinding(programId, idx, bindingPoint);
+	// La asignación es parte del estado del programa: sólo hay que hacerla si cambia
+	if (it->second.binding != static_cast<GLint>(bindingPoint)) {
+		glUniformBlockBinding(programId, it->second.index, bindingPoint);
+		it->second.binding = bindingPoint;
+	}
+
+	return true;
+}
+
+bool Program::bindStorageBlockToBindingPoint(const std::string& blockName,
+	GLuint bindingPoint) {
+	finishCompile();
+	if (programId == 0)
+		ERRT("Antes de llamar a Program::bindStorageBlockToBindingPoint debes compilar el programa");
+
+	auto it = storageBlocks.find(blockName);
+	if (it == storageBlocks.end())
+		return false;
+
+	if (it->second.binding != static_cast<GLint>(bindingPoint)) {
+		glShaderStorageBlockBinding(programId, it->second.index, bindingPoint);
+		it->second.binding = bindingPoint;
+	}
 
 	return true;
 }
@@ -429,6 +779,9 @@ bool Program::bindUBOs() {
 	for (uint i = 0; i < pendingConnections.size(); i++) {
 		PendingConnection& pc = pendingConnections[i];
 		if (!bindBlockToBindingPoint(pc.blockName, pc.bindingPoint)) {
+			// El programa de error sólo usa GLMatrices
+			if (usingErrorProgram)
+				continue;
 			std::ostringstream os;
 			os << "No se puede vincular el UBO \"" << pc.blockName;
 			os << "\" asegúrate de que se usa en alguno de los fuentes del shader:"
@@ -443,16 +796,15 @@ bool Program::bindUBOs() {
 }
 
 uint Program::getUniformBlockSize(const std::string& blockName) {
+	finishCompile();
 
 	if (programId == 0)
 		return 0;
 
-	GLuint idx = glGetUniformBlockIndex(programId, blockName.c_str());
-	if (idx == GL_INVALID_INDEX)
+	auto it = uniformBlocks.find(blockName);
+	if (it == uniformBlocks.end())
 		return 0;
-	GLint size;
-	glGetActiveUniformBlockiv(programId, idx, GL_UNIFORM_BLOCK_DATA_SIZE, &size);
-	return size;
+	return it->second.dataSize;
 }
 
 int Program::getUniformBlockMemberOffset(const std::string& blockName,
@@ -462,6 +814,7 @@ int Program::getUniformBlockMemberOffset(const std::string& blockName,
 }
 
 int Program::getUniformBlockMemberOffset(const std::string& member) {
+	finishCompile();
 	if (programId == 0)
 		return -1;
 
@@ -868,7 +1221,7 @@ void Program::printInfo(std::ostream& os) const {
 			os << " No hay un buffer object vinculado. Esto no debería pasar\n";
 			continue;
 		}
-		glBindBuffer(GL_COPY_READ_BUFFER, boId);
+		PGUPV::GLStateTracker::bindBuffer(GL_COPY_READ_BUFFER, boId);
 		void* boContent = glMapBuffer(GL_COPY_READ_BUFFER, GL_READ_ONLY);
 		if (boContent == nullptr) {
 			os << " [Buffer object vacío]\n";
@@ -1068,6 +1421,7 @@ void Program::addShader(std::shared_ptr<Shader> shader) {
 			"de shader");
 #endif
 	release();
+	updateFileWatch();
 }
 
 /**
@@ -1078,6 +1432,7 @@ programas
 void Program::removeShader(Shader::ShaderType type) {
 	shaders.erase(type);
 	release();
+	updateFileWatch();
 }
 
 // Devuelve la localización del uniform de tipo subrutina indicado en el
@@ -1085,12 +1440,13 @@ void Program::removeShader(Shader::ShaderType type) {
 // de tipo indicado
 uint Program::getSubroutineUniformLocation(Shader::ShaderType type,
 	std::string name) {
+	finishCompile();
 	if (programId == 0)
 		ERRT("No se puede pedir la posición de un uniform si el shader no está "
 			"enlazado");
 
-	GLint loc = glGetSubroutineUniformLocation(programId, Shader::toGLType(type),
-		name.c_str());
+	auto it = subroutineUniforms[type].find(name);
+	GLint loc = it == subroutineUniforms[type].end() ? -1 : it->second;
 	if (loc < 0) {
 		ERRT("No se encuentra el uniform de subrutina " + name + " en el " +
 			Shader::toFriendlyName(type));
@@ -1101,12 +1457,13 @@ uint Program::getSubroutineUniformLocation(Shader::ShaderType type,
 
 // Devuelve el índice de la subrutina indicada
 GLuint Program::getSubroutineIndex(Shader::ShaderType type, std::string name) {
+	finishCompile();
 	if (programId == 0)
 		ERRT("No se puede pedir la posición de un uniform si el shader no está "
 			"enlazado");
 
-	GLuint loc =
-		glGetSubroutineIndex(programId, Shader::toGLType(type), name.c_str());
+	auto it = subroutineIndices[type].find(name);
+	GLuint loc = it == subroutineIndices[type].end() ? GL_INVALID_INDEX : it->second;
 	if (loc == GL_INVALID_INDEX) {
 		ERRT("La subrutina " + name + " no se encuentra en el " +
 			Shader::toFriendlyName(type));
@@ -1167,6 +1524,104 @@ void Program::setTransformFeedbackVaryings(std::vector<std::string> vars, bool i
 	release();
 }
 
+bool Program::reloadChangedShaders() {
+	return reloadShaders([](const Shader &s) { return s.isOutdated(); });
+}
+
+bool Program::reloadShaders(const std::function<bool(const Shader &)> &mustReload) {
+	// Se parte de la última versión que se intentó compilar
+	auto attempt = failedShaders.empty() ? shaders : failedShaders;
+	std::vector<std::shared_ptr<Shader>> changed;
+	for (auto &s : attempt) {
+		if (s.second->getFilename().empty() || !mustReload(*s.second))
+			continue;
+		// Los ficheros incluidos se vuelven a leer aunque su fecha parezca no haber cambiado
+		std::vector<std::string> files;
+		for (auto &d : s.second->getDependencies())
+			files.push_back(d.filename);
+		Shader::clearIncludeCache(files);
+		try {
+			changed.push_back(Shader::loadFromFile(s.second->getFilename(), s.first, subStrings));
+		}
+		catch (std::exception &e) {
+			// Se mantiene la versión anterior (p.e., el fichero se está guardando)
+			ERR(e.what());
+			return false;
+		}
+	}
+	if (changed.empty())
+		return false;
+
+	bool wasCompiled = programId != 0 || compiling;
+	// Valores de los uniforms por nombre, porque al enlazar pueden cambiar las localizaciones
+	std::vector<std::pair<std::string, UniformValue>> values;
+	for (auto &u : uniforms) {
+		auto v = uniformValues.find(u.second.location);
+		if (v != uniformValues.end())
+			values.emplace_back(u.first, v->second);
+	}
+	for (auto &s : changed) {
+		INFO("Recargando " + s->getFilename());
+		attempt[s->getType()] = s;
+	}
+	auto previous = shaders;
+	bool previousWasError = usingErrorProgram;
+	shaders = attempt;
+	release();
+	bool ok = true;
+	if (wasCompiled) {
+		reloading = true;
+		try {
+			compile();
+		}
+		catch (...) {
+			reloading = false;
+			throw;
+		}
+		reloading = false;
+		if (!programId) {
+			// No compila: se vuelve a la versión anterior, y se guarda la nueva para vigilar sus
+			// ficheros
+			WARN("Se sigue usando la versión anterior del programa");
+			shaders = previous;
+			usingErrorProgram = previousWasError;
+			compile();
+			failedShaders = attempt;
+			ok = false;
+		}
+		for (auto &v : values) {
+			auto u = uniforms.find(v.first);
+			// Los enteros pueden ser también booleanos o samplers
+			if (u != uniforms.end() && (u->second.type == v.second.type || v.second.type == GL_INT))
+				restoreUniformValue(u->second.location, v.second);
+		}
+	}
+	if (ok)
+		failedShaders.clear();
+	updateFileWatch();
+	return ok;
+}
+
+void Program::updateFileWatch() {
+	FileWatcher::unwatch(watchId);
+	watchId = 0;
+	std::vector<std::string> files;
+	for (auto *set : { &shaders, &failedShaders })
+		for (auto &s : *set)
+			for (auto &d : s.second->getDependencies())
+				files.push_back(d.filename);
+	if (files.empty())
+		return;
+	watchId = FileWatcher::watch(files, [this](const std::vector<std::string> &changed) {
+		reloadShaders([&changed](const Shader &s) {
+			for (auto &d : s.getDependencies())
+				if (std::find(changed.begin(), changed.end(), FileWatcher::normalize(d.filename)) != changed.end())
+					return true;
+			return false;
+		});
+	});
+}
+
 long long Program::getModificationTime() {
 	long long newest = 0;
 	for (auto s : shaders) {
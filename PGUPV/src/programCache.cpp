@@ -0,0 +1,294 @@
+#include <fstream>
+#include <filesystem>
+#include <system_error>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <atomic>
+
+#ifdef _WIN32
+#include <io.h>
+#include <share.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#else
+#include <sys/stat.h>
+#include <unistd.h>
+#include <fcntl.h>
+#endif
+
+#include "programCache.h"
+#include "log.h"
+
+using PGUPV::ProgramCache;
+
+namespace fs = std::filesystem;
+
+namespace {
+	const uint32_t MAGIC = 0x42504750; // "PGPB"
+	bool enabled = true;
+	// Si el contexto actual permite usar binarios (-1: todavía no se ha creado ningún contexto)
+	std::atomic<int> supported(-1);
+	std::string directory;
+	// Último directorio que se ha comprobado (ver checkDirectory), y si es seguro
+	std::string checkedDirectory;
+	bool checkedDirectoryOk = false;
+
+	uint64_t fnv1a(const std::string &s, uint64_t h) {
+		for (unsigned char c : s) {
+			h ^= c;
+			h *= 0x100000001b3ULL;
+		}
+		return h;
+	}
+
+	std::string toHex(uint64_t v) {
+		static const char digits[] = "0123456789abcdef";
+		std::string r(16, '0');
+		for (int i = 15; i >= 0; i--, v >>= 4)
+			r[i] = digits[v & 0xF];
+		return r;
+	}
+
+	std::string glString(GLenum name) {
+		auto s = glGetString(name);
+		return s ? reinterpret_cast<const char *>(s) : "";
+	}
+
+	std::string getEnv(const char *name) {
+		auto v = std::getenv(name);
+		return v ? v : "";
+	}
+
+	// Directorio de caché del usuario: %LOCALAPPDATA% en Windows, y $XDG_CACHE_HOME o
+	// $HOME/.cache en el resto
+	fs::path userCacheDirectory() {
+#ifdef _WIN32
+		auto base = getEnv("LOCALAPPDATA");
+		if (!base.empty())
+			return fs::path(base) / "pgupv" / "program_cache";
+#else
+		auto base = getEnv("XDG_CACHE_HOME");
+		if (!base.empty() && fs::path(base).is_absolute())
+			return fs::path(base) / "pgupv" / "program_cache";
+		base = getEnv("HOME");
+		if (!base.empty())
+			return fs::path(base) / ".cache" / "pgupv" / "program_cache";
+#endif
+		return fs::path();
+	}
+
+	/*
+	Crea el directorio de la caché si no existe. Como se cargan con glProgramBinary los ficheros
+	que contiene, no se usa si otro usuario puede escribir en él: en sistemas POSIX tiene que ser
+	un directorio (no un enlace) del usuario actual, sin permiso de escritura para los demás
+	*/
+	bool checkDirectory(const std::string &dir) {
+		if (dir == checkedDirectory)
+			return checkedDirectoryOk;
+		checkedDirectory = dir;
+		checkedDirectoryOk = false;
+		std::error_code ec;
+		bool created = fs::create_directories(dir, ec);
+#ifndef _WIN32
+		// El directorio nuevo sólo es accesible para el usuario
+		if (created)
+			chmod(dir.c_str(), S_IRWXU);
+		struct stat st;
+		if (lstat(dir.c_str(), &st) != 0 || !S_ISDIR(st.st_mode) || st.st_uid != geteuid() ||
+			(st.st_mode & (S_IWGRP | S_IWOTH))) {
+			WARN("El directorio de la caché de programas no es seguro (tiene que ser del usuario "
+				"y otros usuarios no deben poder escribir en él). No se usa: " + dir);
+			return false;
+		}
+#else
+		(void)created;
+		if (!fs::is_directory(dir, ec))
+			return false;
+#endif
+		checkedDirectoryOk = true;
+		return true;
+	}
+
+	// Crea en dir un fichero temporal con nombre único, sin seguir enlaces ni reutilizar uno
+	// que ya exista
+	FILE *createTempFile(const std::string &dir, std::string &name) {
+#ifndef _WIN32
+		name = (fs::path(dir) / "XXXXXX.tmp").string();
+		std::vector<char> tmpl(name.begin(), name.end());
+		tmpl.push_back('\0');
+		int fd = mkstemps(tmpl.data(), 4);
+		if (fd < 0)
+			return nullptr;
+		name = tmpl.data();
+		auto f = fdopen(fd, "wb");
+		if (!f)
+			close(fd);
+		return f;
+#else
+		static std::random_device rd;
+		for (int attempt = 0; attempt < 16; attempt++) {
+			name = (fs::path(dir) / (toHex((static_cast<uint64_t>(rd()) << 32) | rd()) + ".tmp")).string();
+			int fd;
+			if (_sopen_s(&fd, name.c_str(), _O_CREAT | _O_EXCL | _O_WRONLY | _O_BINARY, _SH_DENYRW,
+				_S_IREAD | _S_IWRITE) != 0)
+				continue;
+			auto f = _fdopen(fd, "wb");
+			if (!f)
+				_close(fd);
+			return f;
+		}
+		return nullptr;
+#endif
+	}
+
+	// Cabecera de cada fichero de la caché
+	struct Header {
+		uint32_t magic;
+		uint32_t format;
+		uint64_t check; // Segundo hash de la clave, para detectar colisiones del nombre
+		uint64_t size;
+	};
+};
+
+bool ProgramCache::isSupported() {
+	if (!GLEW_VERSION_4_1 && !GLEW_ARB_get_program_binary)
+		return false;
+	GLint formats = 0;
+	glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+	return formats > 0;
+}
+
+void ProgramCache::setEnabled(bool e) {
+	enabled = e;
+}
+
+void ProgramCache::contextCreated() {
+	supported = isSupported() ? 1 : 0;
+}
+
+bool ProgramCache::isEnabled() {
+	return enabled && supported > 0;
+}
+
+void ProgramCache::setDirectory(const std::string &dir) {
+	directory = dir;
+}
+
+std::string ProgramCache::getDirectory() {
+	if (directory.empty()) {
+		auto dir = userCacheDirectory();
+		if (dir.empty()) {
+			// Sin directorio del usuario: uno propio en el temporal (checkDirectory comprueba
+			// que no lo haya creado otro usuario)
+			std::error_code ec;
+			auto tmp = fs::temp_directory_path(ec);
+			std::string suffix;
+#ifndef _WIN32
+			suffix = "_" + std::to_string(geteuid());
+#endif
+			dir = (ec ? fs::path(".") : tmp) / ("pgupv_program_cache" + suffix);
+		}
+		directory = dir.string();
+	}
+	return directory;
+}
+
+void ProgramCache::clear() {
+	std::error_code ec;
+	for (auto &entry : fs::directory_iterator(getDirectory(), ec)) {
+		if (entry.path().extension() == ".bin")
+			fs::remove(entry.path(), ec);
+	}
+}
+
+std::string ProgramCache::computeKey(const std::vector<std::string> &parts) {
+	std::string key = glString(GL_VENDOR) + '\0' + glString(GL_RENDERER) + '\0' + glString(GL_VERSION);
+	for (auto &p : parts) {
+		key += '\0';
+		key += p;
+	}
+	return key;
+}
+
+std::string ProgramCache::path(const std::string &key) {
+	return (fs::path(getDirectory()) / (toHex(fnv1a(key, 0xcbf29ce484222325ULL)) + ".bin")).string();
+}
+
+bool ProgramCache::load(GLuint programId, const std::string &key) {
+	if (!checkDirectory(getDirectory()))
+		return false;
+	auto filename = path(key);
+	std::error_code sizeError;
+	auto fileSize = fs::file_size(filename, sizeError);
+	std::ifstream in(filename, std::ios::binary);
+	if (!in || sizeError)
+		return false;
+
+	Header h;
+	std::vector<char> blob;
+	// El tamaño del binario tiene que coincidir con el del fichero, para no reservar memoria
+	// a partir de una cabecera corrupta
+	if (in.read(reinterpret_cast<char *>(&h), sizeof(h)) && h.magic == MAGIC &&
+		h.check == fnv1a(key, 0x84222325cbf29ce4ULL) && fileSize >= sizeof(h) &&
+		h.size == fileSize - sizeof(h)) {
+		blob.resize(h.size);
+		in.read(blob.data(), blob.size());
+	}
+	if (blob.empty() || !in) {
+		in.close();
+		std::error_code ec;
+		fs::remove(filename, ec);
+		return false;
+	}
+
+	glProgramBinary(programId, h.format, blob.data(), static_cast<GLsizei>(blob.size()));
+	GLint linked = GL_FALSE;
+	glGetProgramiv(programId, GL_LINK_STATUS, &linked);
+	if (linked == GL_FALSE) {
+		// El driver no acepta el binario (p.e., se ha actualizado): se compilará desde el fuente
+		INFO("Binario de programa descartado: " + filename);
+		in.close();
+		std::error_code ec;
+		fs::remove(filename, ec);
+		return false;
+	}
+	INFO("Programa cargado desde la caché: " + filename);
+	return true;
+}
+
+void ProgramCache::store(GLuint programId, const std::string &key) {
+	GLint length = 0;
+	glGetProgramiv(programId, GL_PROGRAM_BINARY_LENGTH, &length);
+	if (length <= 0)
+		return;
+
+	std::vector<char> blob(length);
+	GLenum format;
+	glGetProgramBinary(programId, length, &length, &format, blob.data());
+
+	std::error_code ec;
+	auto dir = getDirectory();
+	if (!checkDirectory(dir))
+		return;
+	auto filename = path(key);
+	// Se escribe en un fichero temporal y se renombra, para que otro proceso no lea un fichero a medias
+	std::string tmpname;
+	auto out = createTempFile(dir, tmpname);
+	if (!out) {
+		WARN("No se ha podido guardar el programa en la caché: " + filename);
+		return;
+	}
+	Header h{ MAGIC, format, fnv1a(key, 0x84222325cbf29ce4ULL), static_cast<uint64_t>(length) };
+	bool ok = fwrite(&h, sizeof(h), 1, out) == 1 &&
+		fwrite(blob.data(), 1, length, out) == static_cast<size_t>(length);
+	ok = fclose(out) == 0 && ok;
+	if (!ok) {
+		WARN("No se ha podido guardar el programa en la caché: " + filename);
+		fs::remove(tmpname, ec);
+		return;
+	}
+	fs::rename(tmpname, filename, ec);
+	if (ec)
+		fs::remove(tmpname, ec);
+}
@@ -0,0 +1,328 @@
+#include <algorithm>
+#include <numeric>
+#include <cmath>
+#include <limits>
+
+#include <glm/gtc/matrix_inverse.hpp>
+
+#include "rayPicker.h"
+#include "mesh.h"
+#include "model.h"
+#include "nodeVisitor.h"
+#include "matrixStack.h"
+#include "instancedGeode.h"
+
+using PGUPV::TriangleBVH;
+using PGUPV::RayPicker;
+using PGUPV::Ray;
+using PGUPV::BoundingBox;
+using PGUPV::TriangleIndices;
+using PGUPV::Mesh;
+using PGUPV::Node;
+using PGUPV::Picker;
+
+// Número máximo de primitivas en una hoja del árbol
+static const uint32_t MAX_LEAF_SIZE = 4;
+
+TriangleBVH::TriangleBVH(const Mesh &mesh) :
+	TriangleBVH(mesh.getVertices(), mesh.getTriangles()) {
+}
+
+TriangleBVH::TriangleBVH(std::vector<glm::vec3> vertices, std::vector<TriangleIndices> triangles) :
+	vertices(std::move(vertices)), triangles(std::move(triangles)) {
+	std::vector<BoundingBox> boxes;
+	boxes.reserve(this->triangles.size());
+	for (const auto &t : this->triangles) {
+		BoundingBox b(this->vertices[t.idx[0]], this->vertices[t.idx[1]]);
+		b.grow(BoundingBox(this->vertices[t.idx[2]], this->vertices[t.idx[2]]));
+		boxes.push_back(b);
+	}
+	buildTree(boxes, nodes, order);
+}
+
+void TriangleBVH::buildTree(const std::vector<BoundingBox> &boxes, std::vector<BVHNode> &nodes,
+	std::vector<uint32_t> &order) {
+	auto n = static_cast<uint32_t>(boxes.size());
+	nodes.clear();
+	order.resize(n);
+	std::iota(order.begin(), order.end(), 0);
+	if (n == 0)
+		return;
+
+	std::vector<glm::vec3> centroids;
+	centroids.reserve(n);
+	for (const auto &b : boxes)
+		centroids.push_back(b.getCenter());
+
+	// Se divide cada nodo por la mediana de los centroides en el eje más largo. Los dos hijos
+	// de un nodo interno se guardan consecutivos
+	struct Task { uint32_t node, begin, end; };
+	std::vector<Task> pending{ Task{ 0, 0, n } };
+	nodes.reserve(2 * n / MAX_LEAF_SIZE + 1);
+	nodes.push_back(BVHNode());
+	while (!pending.empty()) {
+		auto task = pending.back();
+		pending.pop_back();
+
+		BoundingBox bounds, centroidBounds;
+		for (uint32_t i = task.begin; i < task.end; i++) {
+			bounds.grow(boxes[order[i]]);
+			auto &c = centroids[order[i]];
+			centroidBounds.grow(BoundingBox(c, c));
+		}
+		nodes[task.node].min = bounds.min;
+		nodes[task.node].max = bounds.max;
+
+		auto count = task.end - task.begin;
+		auto extent = centroidBounds.max - centroidBounds.min;
+		int axis = extent.x > extent.y ? (extent.x > extent.z ? 0 : 2) : (extent.y > extent.z ? 1 : 2);
+		if (count <= MAX_LEAF_SIZE || extent[axis] <= 0.0f) {
+			nodes[task.node].first = task.begin;
+			nodes[task.node].count = count;
+			continue;
+		}
+
+		auto mid = task.begin + count / 2;
+		std::nth_element(order.begin() + task.begin, order.begin() + mid, order.begin() + task.end,
+			[&centroids, axis](uint32_t a, uint32_t b) { return centroids[a][axis] < centroids[b][axis]; });
+
+		auto left = static_cast<uint32_t>(nodes.size());
+		nodes.push_back(BVHNode());
+		nodes.push_back(BVHNode());
+		nodes[task.node].first = left;
+		nodes[task.node].count = 0;
+		pending.push_back(Task{ left, task.begin, mid });
+		pending.push_back(Task{ left + 1, mid, task.end });
+	}
+}
+
+// Test del rayo contra una caja (método de las placas). invDir es 1/dirección
+static bool intersectsBox(const glm::vec3 &bmin, const glm::vec3 &bmax, const Ray &ray,
+	const glm::vec3 &invDir, float tMax) {
+	auto t1 = (bmin - ray.origin) * invDir;
+	auto t2 = (bmax - ray.origin) * invDir;
+	auto tNear = glm::compMax(glm::min(t1, t2));
+	auto tFar = glm::compMin(glm::max(t1, t2));
+	return tNear <= tFar && tFar >= 0.0f && tNear < tMax;
+}
+
+// Recorre el árbol llamando a leafTest(primitiva, tMax) para cada primitiva de las hojas que
+// corta el rayo. leafTest debe reducir tMax cuando encuentra una intersección más cercana
+template <typename NodeT, typename LeafTest>
+static void traverseTree(const std::vector<NodeT> &nodes, const std::vector<uint32_t> &order,
+	const Ray &ray, float &tMax, LeafTest leafTest) {
+	if (nodes.empty())
+		return;
+	auto invDir = 1.0f / ray.direction;
+	// Los árboles se dividen por la mediana, así que su profundidad es logarítmica
+	uint32_t stack[64];
+	int sp = 0;
+	stack[sp++] = 0;
+	while (sp > 0) {
+		const auto &n = nodes[stack[--sp]];
+		if (!intersectsBox(n.min, n.max, ray, invDir, tMax))
+			continue;
+		if (n.count > 0) {
+			for (uint32_t i = 0; i < n.count; i++)
+				leafTest(order[n.first + i], tMax);
+		}
+		else {
+			stack[sp++] = n.first + 1;
+			stack[sp++] = n.first;
+		}
+	}
+}
+
+// Möller-Trumbore, sin descartar los triángulos vistos por detrás
+static bool intersectsTriangle(const Ray &ray, const glm::vec3 &a, const glm::vec3 &b,
+	const glm::vec3 &c, float tMax, float &t, float &u, float &v) {
+	auto e1 = b - a;
+	auto e2 = c - a;
+	auto p = glm::cross(ray.direction, e2);
+	auto det = glm::dot(e1, p);
+	if (std::fabs(det) < 1e-12f)
+		return false;
+	auto invDet = 1.0f / det;
+	auto s = ray.origin - a;
+	u = glm::dot(s, p) * invDet;
+	if (u < 0.0f || u > 1.0f)
+		return false;
+	auto q = glm::cross(s, e1);
+	v = glm::dot(ray.direction, q) * invDet;
+	if (v < 0.0f || u + v > 1.0f)
+		return false;
+	t = glm::dot(e2, q) * invDet;
+	return t > 0.0f && t < tMax;
+}
+
+bool TriangleBVH::intersect(const Ray &ray, float tMax, Hit &hit) const {
+	bool found = false;
+	traverseTree(nodes, order, ray, tMax, [&](uint32_t tri, float &tCurrent) {
+		const auto &ti = triangles[tri];
+		float t, u, v;
+		if (intersectsTriangle(ray, vertices[ti.idx[0]], vertices[ti.idx[1]], vertices[ti.idx[2]],
+			tCurrent, t, u, v)) {
+			tCurrent = t;
+			hit.triangle = tri;
+			hit.barycentrics = glm::vec3(1.0f - u - v, u, v);
+			hit.t = t;
+			found = true;
+		}
+	});
+	return found;
+}
+
+BoundingBox TriangleBVH::getBB() const {
+	if (nodes.empty())
+		return BoundingBox();
+	return BoundingBox(nodes[0].min, nodes[0].max);
+}
+
+namespace PGUPV {
+	// Recoge las mallas visibles de la escena con su matriz del modelo
+	class RayPickerBuilder : public NodeVisitor {
+	public:
+		explicit RayPickerBuilder(RayPicker &picker) : picker(picker) {
+			setNodePathMode(NodePathMode::RAW);
+		}
+		void apply(Group &group) override {
+			if (!group.isVisible())
+				return;
+			traverse(group);
+		}
+		void apply(Transform &transform) override {
+			if (!transform.isVisible())
+				return;
+			mats.pushMatrix();
+			mats.multMatrix(transform.getTransform());
+			traverse(transform);
+			mats.popMatrix();
+		}
+		void apply(Geode &geode) override {
+			if (!geode.isVisible())
+				return;
+			if (auto ig = dynamic_cast<InstancedGeode *>(&geode)) {
+				for (size_t i = 0; i < ig->getNumInstances(); i++) {
+					auto m = mats.getMatrix() * ig->getInstanceTransform(i);
+					auto id = ig->getInstancePickId(i);
+					picker.addModel(m, geode.getModel(), &geode, id, static_cast<uint32_t>(i));
+				}
+				return;
+			}
+			picker.addModel(mats.getMatrix(), geode.getModel(), &geode, geode.getId());
+		}
+	private:
+		RayPicker &picker;
+		MatrixStack mats;
+	};
+};
+
+void RayPicker::addInstance(const glm::mat4 &modelMatrix, const std::shared_ptr<Mesh> &mesh,
+	Node *node, uint32_t id, uint32_t instance) {
+	auto &cached = meshBVHs[mesh.get()];
+	// Si la malla guardada se ha destruido, ésta es otra malla en la misma dirección
+	if (!cached.bvh || cached.mesh.expired()) {
+		cached.mesh = mesh;
+		cached.bvh.reset(new TriangleBVH(*mesh));
+	}
+	if (cached.bvh->getNumTriangles() == 0)
+		return;
+	instances.push_back(Instance{ glm::inverse(modelMatrix), modelMatrix, cached.bvh.get(),
+		mesh.get(), node, id, instance });
+}
+
+void RayPicker::addModel(const glm::mat4 &modelMatrix, Model &model, Node *node, uint32_t id,
+	uint32_t instance) {
+	for (uint i = 0; i < model.getNMeshes(); i++)
+		addInstance(modelMatrix, model.getMeshPtr(i), node, id, instance);
+}
+
+void RayPicker::dropDeadMeshes() {
+	for (auto it = meshBVHs.begin(); it != meshBVHs.end();) {
+		if (it->second.mesh.expired())
+			it = meshBVHs.erase(it);
+		else
+			++it;
+	}
+}
+
+void RayPicker::buildTopLevel() {
+	std::vector<BoundingBox> boxes;
+	boxes.reserve(instances.size());
+	for (const auto &i : instances) {
+		auto b = i.bvh->getBB();
+		b.transform(i.modelMatrix);
+		boxes.push_back(b);
+	}
+	TriangleBVH::buildTree(boxes, nodes, order);
+}
+
+void RayPicker::build(Node &root) {
+	instances.clear();
+	dropDeadMeshes();
+	RayPickerBuilder builder(*this);
+	root.accept(builder);
+	buildTopLevel();
+}
+
+void RayPicker::build(const std::vector<Picker::ModelId> &objects) {
+	instances.clear();
+	dropDeadMeshes();
+	for (const auto &o : objects)
+		addModel(o.modelMatrix, *o.m, nullptr, o.id);
+	buildTopLevel();
+}
+
+bool RayPicker::pick(const Ray &ray, Hit &hit) const {
+	float tMax = std::numeric_limits<float>::max();
+	bool found = false;
+	traverseTree(nodes, order, ray, tMax, [&](uint32_t which, float &tCurrent) {
+		const auto &inst = instances[which];
+		// Al ser afín la transformación, el parámetro del rayo es el mismo en ambos sistemas
+		Ray local{ glm::vec3(inst.invModelMatrix * glm::vec4(ray.origin, 1.0f)),
+			glm::vec3(inst.invModelMatrix * glm::vec4(ray.direction, 0.0f)) };
+		TriangleBVH::Hit th;
+		if (inst.bvh->intersect(local, tCurrent, th)) {
+			tCurrent = th.t;
+			hit.node = inst.node;
+			hit.id = inst.id;
+			hit.mesh = inst.mesh;
+			hit.instance = inst.instance;
+			hit.triangle = th.triangle;
+			hit.barycentrics = th.barycentrics;
+			found = true;
+		}
+	});
+	if (found) {
+		hit.distance = tMax * glm::length(ray.direction);
+		hit.position = ray.origin + tMax * ray.direction;
+	}
+	return found;
+}
+
+void RayPicker::invalidateMesh(Mesh *mesh) {
+	meshBVHs.erase(mesh);
+	// Las instancias apuntan a las jerarquías de las mallas: hay que volver a llamar a build
+	instances.clear();
+	nodes.clear();
+	order.clear();
+}
+
+void RayPicker::clearMeshCache() {
+	meshBVHs.clear();
+	instances.clear();
+	nodes.clear();
+	order.clear();
+}
+
+Ray RayPicker::computeRay(const Picker::PickData &pick, const glm::mat4 &viewMatrix,
+	const glm::mat4 &projMatrix) {
+	float x = 2.0f * (pick.x + 0.5f) / pick.width - 1.0f;
+	float y = 1.0f - 2.0f * (pick.y + 0.5f) / pick.height;
+	auto inv = glm::inverse(projMatrix * viewMatrix);
+	auto nearPoint = inv * glm::vec4(x, y, -1.0f, 1.0f);
+	auto farPoint = inv * glm::vec4(x, y, 1.0f, 1.0f);
+	nearPoint /= nearPoint.w;
+	farPoint /= farPoint.w;
+	return Ray{ glm::vec3(nearPoint), glm::normalize(glm::vec3(farPoint - nearPoint)) };
+}
@@ -84,7 +84,11 @@ void RenderBoundingVolumes::renderBBox(const BoundingBox &bb, bool highlight, co
   mats->setMatrix(GLMatrices::MODEL_MATRIX, current);
   auto prevprog = PGUPV::ConstantIllumProgram::use();
 
-  if (!box) box = std::unique_ptr<WireBox>(new WireBox());
+  if (!box) {
+    box = std::unique_ptr<WireBox>(new WireBox());
+    // Los vertices se sobrescriben en el buffer con cada caja
+    box->getMesh(0).setCPUMirror(false);
+  }
   Mesh &m = box->getMesh(0);
   m.setColor(color);
   auto vbo = m.getBufferObject(Mesh::VERTICES);
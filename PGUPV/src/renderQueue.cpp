@@ -0,0 +1,166 @@
+#include <algorithm>
+#include <unordered_map>
+
+#include "renderQueue.h"
+#include "indexedBindingPoint.h"
+#include "glMatrices.h"
+#include "program.h"
+#include "renderStats.h"
+#include "instancedGeode.h"
+
+using PGUPV::RenderQueue;
+using PGUPV::RenderQueueBuilder;
+using PGUPV::DrawPacket;
+using PGUPV::Node;
+using PGUPV::Mesh;
+using PGUPV::Program;
+using PGUPV::GLMatrices;
+using PGUPV::RenderStats;
+
+void RenderQueue::add(const glm::mat4 &modelMatrix, Mesh *mesh) {
+	packets.push_back(DrawPacket{ modelMatrix, mesh, mesh->getMaterial().get(), nullptr, 0 });
+}
+
+void RenderQueue::add(const glm::mat4 &modelMatrix, Node *node) {
+	packets.push_back(DrawPacket{ modelMatrix, nullptr, nullptr, node, 0 });
+}
+
+// Asigna a cada objeto distinto un número consecutivo, por orden de aparición
+template <typename T>
+static uint64_t denseIndex(std::unordered_map<const T *, uint64_t> &ids, const T *p) {
+	auto it = ids.find(p);
+	if (it != ids.end())
+		return it->second;
+	uint64_t id = ids.size();
+	ids[p] = id;
+	return id;
+}
+
+void RenderQueue::sort() {
+	// Clave: | material (32 bits) | malla (32 bits) |
+	// Primero se agrupa por material y luego por malla (VAO)
+	std::unordered_map<const PGUPV::BaseMaterial *, uint64_t> materialIds;
+	std::unordered_map<const void *, uint64_t> meshIds;
+	for (auto &p : packets) {
+		const void *geometry = p.mesh ? static_cast<const void *>(p.mesh) : static_cast<const void *>(p.node);
+		p.key = ((denseIndex(materialIds, p.material) & 0xFFFFFFFF) << 32) |
+			(denseIndex(meshIds, geometry) & 0xFFFFFFFF);
+	}
+	std::stable_sort(packets.begin(), packets.end(), [](const DrawPacket &a, const DrawPacket &b) {
+		return a.key < b.key;
+	});
+}
+
+void RenderQueue::submit() {
+	if (packets.empty())
+		return;
+	auto mats = std::static_pointer_cast<GLMatrices>(
+		PGUPV::gl_uniform_buffer.getBound(UBO_GL_MATRICES_BINDING_INDEX));
+	if (!mats)
+		ERRT("No hay un objeto GLMatrices vinculado");
+
+	mats->pushMatrix(GLMatrices::MODEL_MATRIX);
+
+	Program *program = Program::getCurrentProgram();
+	PGUPV::BaseMaterial *currentMaterial = nullptr;
+	Mesh *currentMesh = nullptr;
+	bool first = true;
+	glm::mat4 currentModel;
+	for (const auto &p : packets) {
+		if (first || p.modelMatrix != currentModel) {
+			mats->setMatrix(GLMatrices::MODEL_MATRIX, p.modelMatrix);
+			currentModel = p.modelMatrix;
+			first = false;
+		}
+		if (p.node) {
+			// No sabemos qué estado cambiará el nodo
+			p.node->render();
+			if (program && Program::getCurrentProgram() != program)
+				program->use();
+			currentMaterial = nullptr;
+			currentMesh = nullptr;
+			continue;
+		}
+		if (p.material && p.material != currentMaterial) {
+			p.material->use();
+			currentMaterial = p.material;
+		}
+		if (p.mesh != currentMesh) {
+			p.mesh->bindGeometry();
+			currentMesh = p.mesh;
+		}
+		p.mesh->renderDrawCommands();
+	}
+
+	mats->popMatrix(GLMatrices::MODEL_MATRIX);
+}
+
+RenderQueueBuilder::RenderQueueBuilder(RenderQueue &queue, const glm::mat4 &viewProj, const glm::mat4 &modelMatrix) :
+	NodeVisitor(NodeVisitor::TraversalMode::TRAVERSE_ACTIVE_CHILDREN),
+	queue(queue), viewProjMatrix(viewProj) {
+	mats.setMatrix(modelMatrix);
+	setNodePathMode(NodePathMode::RAW);
+}
+
+bool RenderQueueBuilder::isOutsideViewVolume(Node &node) {
+	if (!Node::isViewFrustumCullingEnabled() || !node.getBB().isValid())
+		return false;
+	PGUPV::Frustum frustum(viewProjMatrix * mats.getMatrix());
+	auto sphere = node.getBS();
+	if ((!sphere.isValid() || frustum.intersects(sphere)) && frustum.intersects(node.getBB()))
+		return false;
+	RenderStats::increment(RenderStats::Counter::NodesCulled);
+	return true;
+}
+
+void RenderQueueBuilder::apply(Node &node) {
+	// Un tipo de nodo que no sabemos aplanar: se dibujará con su método render
+	if (!node.isVisible() || isOutsideViewVolume(node))
+		return;
+	queue.add(mats.getMatrix(), &node);
+}
+
+void RenderQueueBuilder::apply(AnimationNode &node) {
+	apply(static_cast<Node &>(node));
+}
+
+void RenderQueueBuilder::apply(Group &group) {
+	RenderStats::increment(RenderStats::Counter::NodesVisited);
+	if (!group.isVisible() || !group.getBB().isValid() || isOutsideViewVolume(group))
+		return;
+	traverse(group);
+}
+
+void RenderQueueBuilder::apply(LOD &lod) {
+	RenderStats::increment(RenderStats::Counter::NodesVisited);
+	if (!lod.isVisible() || !lod.getBB().isValid() || isOutsideViewVolume(lod))
+		return;
+	lod.selectLevel(mats.getMatrix(), viewProjMatrix);
+	if (auto c = lod.getActiveChild())
+		c->accept(*this);
+}
+
+void RenderQueueBuilder::apply(Transform &transform) {
+	RenderStats::increment(RenderStats::Counter::NodesVisited);
+	if (!transform.isVisible() || !transform.getBB().isValid() || isOutsideViewVolume(transform))
+		return;
+	mats.pushMatrix();
+	mats.multMatrix(transform.getTransform());
+	traverse(transform);
+	mats.popMatrix();
+}
+
+void RenderQueueBuilder::apply(Geode &geode) {
+	// Las instancias se dibujan con su propio render (que ya cuenta la Geode visitada y dibujada)
+	if (dynamic_cast<InstancedGeode *>(&geode)) {
+		apply(static_cast<Node &>(geode));
+		return;
+	}
+	RenderStats::increment(RenderStats::Counter::NodesVisited);
+	if (!geode.isVisible() || isOutsideViewVolume(geode))
+		return;
+	RenderStats::increment(RenderStats::Counter::GeodesDrawn);
+	geode.getModel().accept([this](Mesh &m) {
+		queue.add(mats.getMatrix(), &m);
+	});
+}
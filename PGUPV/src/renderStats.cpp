@@ -0,0 +1,29 @@
+#include <algorithm>
+
+#include "renderStats.h"
+
+using PGUPV::RenderStats;
+
+uint64_t RenderStats::current[RenderStats::NCounters]{};
+uint64_t RenderStats::last[RenderStats::NCounters]{};
+
+void RenderStats::beginFrame() {
+	std::fill(current, current + NCounters, 0);
+}
+
+void RenderStats::endFrame() {
+	std::copy(current, current + NCounters, last);
+}
+
+uint64_t RenderStats::getValue(Counter counter) {
+	return last[PGUPV::to_underlying(counter)];
+}
+
+std::string RenderStats::getName(Counter counter) {
+	static const char *names[NCounters] = {
+		"Nodes visited", "Nodes culled", "Geodes drawn", "Meshes drawn", "Draw calls",
+		"Triangles submitted", "Program binds", "Material binds", "Texture binds", "VAO binds",
+		"Buffer binds", "Binds elided"
+	};
+	return names[PGUPV::to_underlying(counter)];
+}
@@ -0,0 +1,270 @@
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#include <algorithm>
+#include <sstream>
+#include <iomanip>
+
+#include "resourceTracker.h"
+#include "log.h"
+
+using PGUPV::ResourceTracker;
+
+namespace {
+	struct Resource {
+		ResourceTracker::Category category;
+		size_t bytes;
+		std::string label, group;
+	};
+
+	struct EvictorEntry {
+		ResourceTracker::Id id;
+		ResourceTracker::Pool pool;
+		ResourceTracker::Evictor evictor;
+	};
+
+	struct Budget {
+		size_t bytes = 0;
+		bool evict = false;
+		bool warned = false;
+	};
+
+	struct TrackerState {
+		// Se accede desde el hilo de carga de recursos y desde el de dibujo
+		std::recursive_mutex mutex;
+		std::unordered_map<ResourceTracker::Id, Resource> resources;
+		ResourceTracker::Id nextId = 1;
+		size_t totals[ResourceTracker::NCategories]{}, peaks[ResourceTracker::NCategories]{};
+		size_t poolPeaks[2]{};
+		Budget budgets[2];
+		std::vector<EvictorEntry> evictors;
+		bool evicting = false;
+	};
+
+	// No se destruye nunca: los recursos estáticos (p.e., las mallas de RenderBoundingVolumes)
+	// se borran al salir del programa, cuando las variables globales ya pueden no existir
+	TrackerState &state() {
+		static TrackerState *s = new TrackerState();
+		return *s;
+	}
+
+	// Ruta del grupo actual del hilo ("Escena/Malla")
+	thread_local std::string currentGroup;
+
+	unsigned int idx(ResourceTracker::Category c) {
+		return static_cast<unsigned int>(PGUPV::to_underlying(c));
+	}
+
+	unsigned int idx(ResourceTracker::Pool p) {
+		return static_cast<unsigned int>(PGUPV::to_underlying(p));
+	}
+
+	std::string toMB(size_t bytes) {
+		std::ostringstream os;
+		if (bytes < 1024 * 1024)
+			os << std::fixed << std::setprecision(1) << bytes / 1024.0 << " KB";
+		else
+			os << std::fixed << std::setprecision(2) << bytes / (1024.0 * 1024.0) << " MB";
+		return os.str();
+	}
+};
+
+ResourceTracker::Id ResourceTracker::add(Category category, size_t bytes, const std::string &label) {
+	auto &s = state();
+	std::lock_guard<std::recursive_mutex> lock(s.mutex);
+	Id id = s.nextId++;
+	s.resources[id] = Resource{ category, 0, label, currentGroup };
+	setSize(id, bytes);
+	return id;
+}
+
+void ResourceTracker::setSize(Id id, size_t bytes) {
+	auto &s = state();
+	std::lock_guard<std::recursive_mutex> lock(s.mutex);
+	auto it = s.resources.find(id);
+	if (it == s.resources.end())
+		return;
+	auto c = idx(it->second.category);
+	s.totals[c] = s.totals[c] - it->second.bytes + bytes;
+	it->second.bytes = bytes;
+	s.peaks[c] = std::max(s.peaks[c], s.totals[c]);
+	auto pool = poolOf(it->second.category);
+	s.poolPeaks[idx(pool)] = std::max(s.poolPeaks[idx(pool)], getTotal(pool));
+	checkBudget(pool);
+}
+
+void ResourceTracker::setLabel(Id id, const std::string &label) {
+	auto &s = state();
+	std::lock_guard<std::recursive_mutex> lock(s.mutex);
+	auto it = s.resources.find(id);
+	if (it != s.resources.end())
+		it->second.label = label;
+}
+
+void ResourceTracker::remove(Id id) {
+	auto &s = state();
+	std::lock_guard<std::recursive_mutex> lock(s.mutex);
+	auto it = s.resources.find(id);
+	if (it == s.resources.end())
+		return;
+	auto pool = poolOf(it->second.category);
+	s.totals[idx(it->second.category)] -= it->second.bytes;
+	s.resources.erase(it);
+	checkBudget(pool);
+}
+
+size_t ResourceTracker::getTotal(Category category) {
+	auto &s = state();
+	std::lock_guard<std::recursive_mutex> lock(s.mutex);
+	return s.totals[idx(category)];
+}
+
+size_t ResourceTracker::getPeak(Category category) {
+	auto &s = state();
+	std::lock_guard<std::recursive_mutex> lock(s.mutex);
+	return s.peaks[idx(category)];
+}
+
+size_t ResourceTracker::getTotal(Pool pool) {
+	auto &s = state();
+	std::lock_guard<std::recursive_mutex> lock(s.mutex);
+	if (pool == Pool::CPU)
+		return s.totals[idx(Category::CPUMirrors)];
+	return s.totals[idx(Category::Buffers)] + s.totals[idx(Category::Textures)];
+}
+
+size_t ResourceTracker::getPeak(Pool pool) {
+	auto &s = state();
+	std::lock_guard<std::recursive_mutex> lock(s.mutex);
+	return s.poolPeaks[idx(pool)];
+}
+
+std::map<std::string, size_t> ResourceTracker::getTotalsByLabel(Category category) {
+	auto &s = state();
+	std::lock_guard<std::recursive_mutex> lock(s.mutex);
+	std::map<std::string, size_t> result;
+	for (auto &r : s.resources)
+		if (r.second.category == category)
+			result[r.second.label] += r.second.bytes;
+	return result;
+}
+
+std::map<std::string, size_t> ResourceTracker::getTotalsByGroup(Category category) {
+	auto &s = state();
+	std::lock_guard<std::recursive_mutex> lock(s.mutex);
+	std::map<std::string, size_t> result;
+	for (auto &r : s.resources)
+		if (r.second.category == category)
+			result[r.second.group] += r.second.bytes;
+	return result;
+}
+
+std::string ResourceTracker::report(unsigned int maxGroups) {
+	auto &s = state();
+	std::lock_guard<std::recursive_mutex> lock(s.mutex);
+	std::ostringstream os;
+	for (unsigned int i = 0; i < NCategories; i++) {
+		auto c = static_cast<Category>(i);
+		os << getName(c) << ": " << toMB(s.totals[i]) << " (pico: " << toMB(s.peaks[i]) << ")\n";
+		auto groups = getTotalsByGroup(c);
+		std::vector<std::pair<std::string, size_t>> sorted(groups.begin(), groups.end());
+		std::sort(sorted.begin(), sorted.end(), [](const std::pair<std::string, size_t> &a,
+			const std::pair<std::string, size_t> &b) { return a.second > b.second; });
+		if (sorted.size() > maxGroups)
+			sorted.resize(maxGroups);
+		for (auto &g : sorted)
+			os << "  " << (g.first.empty() ? "(sin grupo)" : g.first) << ": " << toMB(g.second) << "\n";
+	}
+	for (auto pool : { Pool::GPU, Pool::CPU }) {
+		if (s.budgets[idx(pool)].bytes)
+			os << (pool == Pool::GPU ? "GPU" : "CPU") << ": " << toMB(getTotal(pool)) << " de "
+			<< toMB(s.budgets[idx(pool)].bytes) << "\n";
+	}
+	return os.str();
+}
+
+std::string ResourceTracker::getName(Category category) {
+	static const char *names[NCategories] = { "Buffers", "Textures", "CPU mirrors" };
+	return names[idx(category)];
+}
+
+void ResourceTracker::setBudget(Pool pool, size_t bytes, bool evict) {
+	auto &s = state();
+	std::lock_guard<std::recursive_mutex> lock(s.mutex);
+	s.budgets[idx(pool)] = Budget{ bytes, evict, false };
+	checkBudget(pool);
+}
+
+size_t ResourceTracker::getBudget(Pool pool) {
+	auto &s = state();
+	std::lock_guard<std::recursive_mutex> lock(s.mutex);
+	return s.budgets[idx(pool)].bytes;
+}
+
+void ResourceTracker::checkBudget(Pool pool) {
+	auto &s = state();
+	auto &b = s.budgets[idx(pool)];
+	if (b.bytes == 0)
+		return;
+	auto total = getTotal(pool);
+	if (total <= b.bytes) {
+		b.warned = false;
+	}
+	else if (!b.warned) {
+		b.warned = true;
+		WARN(std::string("Se ha superado el presupuesto de memoria de la ") + (pool == Pool::GPU ? "GPU" : "CPU")
+			+ ": " + toMB(total) + " de " + toMB(b.bytes));
+	}
+}
+
+ResourceTracker::Id ResourceTracker::addEvictor(Pool pool, Evictor evictor) {
+	auto &s = state();
+	std::lock_guard<std::recursive_mutex> lock(s.mutex);
+	Id id = s.nextId++;
+	s.evictors.push_back(EvictorEntry{ id, pool, evictor });
+	return id;
+}
+
+void ResourceTracker::removeEvictor(Id id) {
+	auto &s = state();
+	std::lock_guard<std::recursive_mutex> lock(s.mutex);
+	s.evictors.erase(std::remove_if(s.evictors.begin(), s.evictors.end(),
+		[id](const EvictorEntry &e) { return e.id == id; }), s.evictors.end());
+}
+
+void ResourceTracker::endFrame() {
+	auto &s = state();
+	std::lock_guard<std::recursive_mutex> lock(s.mutex);
+	// Las funciones de desalojo liberan recursos y llaman a remove: no deben volver a entrar aquí
+	if (s.evicting)
+		return;
+	s.evicting = true;
+	for (auto pool : { Pool::GPU, Pool::CPU }) {
+		auto &b = s.budgets[idx(pool)];
+		if (!b.evict || b.bytes == 0)
+			continue;
+		// Copia, por si alguna función de desalojo se borra al ejecutarse
+		auto candidates = s.evictors;
+		for (auto &e : candidates) {
+			auto total = getTotal(pool);
+			if (total <= b.bytes)
+				break;
+			if (e.pool != pool)
+				continue;
+			size_t freed = e.evictor(total - b.bytes);
+			if (freed)
+				INFO("Desalojados " + toMB(freed) + " para cumplir el presupuesto de memoria");
+		}
+	}
+	s.evicting = false;
+}
+
+ResourceTracker::Group::Group(const std::string &name) : prevLength(currentGroup.size()) {
+	if (!currentGroup.empty())
+		currentGroup += "/";
+	currentGroup += name;
+}
+
+ResourceTracker::Group::~Group() {
+	currentGroup.resize(prevLength);
+}
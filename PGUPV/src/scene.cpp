@@ -5,7 +5,11 @@
 #include "findNodeByName.h"
 #include "animationClip.h"
 #include "updateVisitor.h"
+#include "parallelUpdateVisitor.h"
+#include "jobPool.h"
 #include "baseMaterial.h"
+#include "renderQueue.h"
+#include "indexedBindingPoint.h"
 
 using PGUPV::Node;
 using PGUPV::Scene;
@@ -15,6 +19,8 @@ using PGUPV::BoundingSphere;
 using PGUPV::Mesh;
 using PGUPV::AnimationClip;
 using PGUPV::BaseMaterial;
+using PGUPV::RenderQueue;
+using PGUPV::JobPool;
 
 
 Scene::Scene() {
@@ -25,8 +31,37 @@ void Scene::setRoot(std::shared_ptr<Node> root) {
 }
 
 void Scene::render() {
-	if (sceneRoot)
+	if (!sceneRoot)
+		return;
+
+	auto mats = std::static_pointer_cast<GLMatrices>(
+		PGUPV::gl_uniform_buffer.getBound(UBO_GL_MATRICES_BINDING_INDEX));
+	if (!renderQueue || !mats) {
 		sceneRoot->render();
+		return;
+	}
+
+	renderQueue->clear();
+	PGUPV::RenderQueueBuilder builder(*renderQueue,
+		mats->getMatrix(GLMatrices::PROJ_MATRIX) * mats->getMatrix(GLMatrices::VIEW_MATRIX),
+		mats->getMatrix(GLMatrices::MODEL_MATRIX));
+	sceneRoot->accept(builder);
+	renderQueue->sort();
+	renderQueue->submit();
+}
+
+void Scene::setUseRenderQueue(bool use) {
+	if (!use)
+		renderQueue.reset();
+	else if (!renderQueue)
+		renderQueue = std::make_shared<RenderQueue>();
+}
+
+void Scene::setParallelUpdate(bool parallel, unsigned int numThreads) {
+	if (!parallel)
+		updatePool.reset();
+	else if (!updatePool || (numThreads != 0 && updatePool->getNumThreads() != numThreads))
+		updatePool = std::make_shared<JobPool>(numThreads);
 }
 
 BoundingBox Scene::getBB() {
@@ -59,9 +94,17 @@ void Scene::print(std::ostream & os) {
 
 void Scene::update(unsigned int )
 {
-	PGUPV::UpdateVisitor update;
-	if (sceneRoot)
+	if (!sceneRoot)
+		return;
+	if (updatePool) {
+		PGUPV::ParallelUpdateVisitor update(updatePool.get());
 		sceneRoot->accept(update);
+		update.runDeferred();
+	}
+	else {
+		PGUPV::UpdateVisitor update;
+		sceneRoot->accept(update);
+	}
 }
 
 
@@ -118,7 +161,7 @@ void Scene::removeSelectedNodes() {
 void Scene::processMeshes(std::function<void(Mesh &)> op) {
   class TraverseMeshes : public NodeVisitor {
   public:
-    TraverseMeshes(std::function<void(Mesh &)> op) : op(op) {};
+    TraverseMeshes(std::function<void(Mesh &)> op) : op(op) { setNodePathMode(NodePathMode::RAW); };
     void apply(Node &n) override { if (n.getBB().isValid()) traverse(n); }
     void apply(Geode &g) override { g.getModel().accept(op); }
   private:
@@ -1,4 +1,7 @@
 #include <iomanip>
+#include <algorithm>
+#include <filesystem>
+#include <unordered_map>
 
 #include "shader.h"
 #include "utils.h"
@@ -51,6 +54,7 @@ Shader::Shader() {
 	assert(sizeof(glShaderTypeConstants) / sizeof(glShaderTypeConstants[0]) == NUM_SHADER_TYPES);
 
   shaderId = 0;
+  compiling = false;
   type = CHECK_EXTENSION;
 }
 
@@ -70,12 +74,14 @@ Shader::loadFromFile(const string &name, ShaderType shader_type,
 
   Strings ss;
   if (loadTextFile(name, ss)) {
-    Strings preprocessed = preprocessShader(ss);
+    std::vector<Dependency> deps;
+    Strings preprocessed = preprocessShader(ss, name, deps);
     std::shared_ptr<Shader> result =
         loadFromMemory(preprocessed, shader_type, transTable);
     result->filename = name;
-    result->modificationTime = PGUPV::getFileModificationTime(name);
-      
+    result->modificationTime = deps.front().modificationTime;
+    result->dependencies = std::move(deps);
+
     return result;
   } else
     ERRT("No se ha podido cargar el fichero " + name);
@@ -103,44 +109,143 @@ int Shader::check_extension(const string &filename) {
   return -1;
 }
 
-// Preprocesa el código fuente del shader cuyo código fuente está en src
-Strings Shader::preprocessShader(const Strings &src) {
-  Strings input = src;
+// Estado del preprocesador mientras se procesa un shader
+struct Shader::PreprocessState {
   Strings output;
-  for (uint include_level = 0; include_level < MAX_INCLUDE_LEVELS;
-       include_level++) {
-    bool any_include = false;
-    output.clear();
-    for (Strings::const_iterator i = input.begin(); i != input.end(); ++i) {
-      if (PGUPV::starts_with(*i, INCLUDE_STRING)) {
-        processInclude(*i, output);
-        any_include = true;
-      } else
-        output.push_back(*i);
+  std::vector<Dependency> &deps;
+  // Índices (en deps) de los ficheros que se están procesando, para detectar ciclos
+  std::vector<size_t> stack;
+  // Las directivas #line sólo pueden aparecer después de #version
+  bool versionSeen;
+  PreprocessState(std::vector<Dependency> &deps) : deps(deps), versionSeen(false) {}
+};
+
+namespace {
+// Ficheros incluidos con $include ya leídos, por su ruta normalizada. Se vuelven a leer
+// cuando cambia su fecha de modificación o su tamaño
+struct CachedInclude {
+  std::shared_ptr<const Strings> lines;
+  Shader::Dependency stamp;
+};
+std::unordered_map<std::string, CachedInclude> includeCache;
+
+std::string cacheKey(const std::string &filename) {
+  std::error_code ec;
+  auto p = std::filesystem::weakly_canonical(std::filesystem::absolute(filename, ec), ec);
+  return ec ? filename : p.string();
+}
+
+// Fecha de modificación (en segundos y con la resolución del sistema de ficheros) y tamaño
+Shader::Dependency stampOf(const std::string &filename) {
+  std::error_code ec;
+  Shader::Dependency d{filename, PGUPV::getFileModificationTime(filename),
+                       std::filesystem::last_write_time(filename, ec), 0};
+  d.size = std::filesystem::file_size(filename, ec);
+  return d;
+}
+
+bool sameStamp(const Shader::Dependency &a, const Shader::Dependency &b) {
+  return a.lastWrite == b.lastWrite && a.size == b.size;
+}
+
+const CachedInclude &loadInclude(const std::string &filename) {
+  if (!std::filesystem::exists(filename))
+    ERRT("No se ha podido cargar el fichero " + filename);
+  auto stamp = stampOf(filename);
+  auto key = cacheKey(filename);
+  auto it = includeCache.find(key);
+  if (it != includeCache.end() && sameStamp(it->second.stamp, stamp))
+    return it->second;
+
+  auto lines = std::make_shared<Strings>();
+  if (!PGUPV::loadTextFile(filename, *lines))
+    ERRT("No se ha podido cargar el fichero " + filename);
+  return includeCache[key] = CachedInclude{lines, stamp};
+}
+
+bool isVersionDirective(const std::string &line) {
+  size_t i = line.find_first_not_of(" \t");
+  return i != std::string::npos && line.compare(i, 8, "#version") == 0;
+}
+}
+
+Strings Shader::preprocessShader(const Strings &src, const std::string &filename,
+                                 std::vector<Dependency> &deps) {
+  deps.clear();
+  deps.push_back(stampOf(filename));
+  PreprocessState state(deps);
+  state.output.reserve(src.size());
+  preprocessFile(src, 0, state);
+  return std::move(state.output);
+}
+
+void Shader::preprocessFile(const Strings &src, size_t fileIndex,
+                            PreprocessState &state) {
+  state.stack.push_back(fileIndex);
+  for (size_t l = 0; l < src.size(); l++) {
+    const std::string &line = src[l];
+    if (PGUPV::starts_with(line, INCLUDE_STRING)) {
+      processInclude(line, state);
+      // Volver a numerar las líneas según el fichero actual
+      if (state.versionSeen)
+        state.output.push_back("#line " + std::to_string(l + 2) + " " +
+                               std::to_string(fileIndex));
+    } else {
+      if (!state.versionSeen && isVersionDirective(line))
+        state.versionSeen = true;
+      state.output.push_back(line);
     }
-    if (!any_include)
-      return output;
-    input = output;
   }
-  ERRT("No se permiten más de " + std::to_string(MAX_INCLUDE_LEVELS) +
-       " niveles de anidamiento en los $include");
+  state.stack.pop_back();
 }
 
-void Shader::processInclude(const std::string &line, Strings &dst) {
+void Shader::processInclude(const std::string &line, PreprocessState &state) {
   // line follows the format $include "<nombre de fichero>"
   std::string::size_type spos = line.find_first_of('\"');
-  if (spos != std::string::npos) {
-    std::string::size_type epos = line.find_last_of('\"');
-    std::string filename = line.substr(spos + 1, epos - spos - 1);
-    Strings ss;
-    if (!loadTextFile(filename, ss))
-      ERRT("No se ha podido cargar el fichero " + filename);
-    for (Strings::const_iterator i = ss.begin(); i != ss.end(); ++i) {
-      dst.push_back(*i);
-    }
-  } else
+  std::string::size_type epos = line.find_last_of('\"');
+  if (spos == std::string::npos || epos == spos)
     ERRT("Error en la directiva $include. La sintaxis es: $include "
          "\"<fichero>\"");
+  std::string filename = line.substr(spos + 1, epos - spos - 1);
+
+  if (state.stack.size() > MAX_INCLUDE_LEVELS)
+    ERRT("No se permiten más de " + std::to_string(MAX_INCLUDE_LEVELS) +
+         " niveles de anidamiento en los $include");
+
+  // Copia del puntero: el fichero podría recargarse mientras se procesa
+  CachedInclude inc = loadInclude(filename);
+
+  size_t fileIndex = 0;
+  while (fileIndex < state.deps.size() && state.deps[fileIndex].filename != filename)
+    fileIndex++;
+  if (fileIndex == state.deps.size()) {
+    state.deps.push_back(inc.stamp);
+    state.deps.back().filename = filename;
+  }
+  else if (std::find(state.stack.begin(), state.stack.end(), fileIndex) !=
+           state.stack.end())
+    ERRT("Inclusión recursiva del fichero " + filename);
+
+  if (state.versionSeen)
+    state.output.push_back("#line 1 " + std::to_string(fileIndex));
+  preprocessFile(*inc.lines, fileIndex, state);
+}
+
+bool Shader::isOutdated() const {
+  for (auto &d : dependencies) {
+    if (!std::filesystem::exists(d.filename) || !sameStamp(stampOf(d.filename), d))
+      return true;
+  }
+  return false;
+}
+
+void Shader::clearIncludeCache() {
+  includeCache.clear();
+}
+
+void Shader::clearIncludeCache(const std::vector<std::string> &files) {
+  for (auto &f : files)
+    includeCache.erase(cacheKey(f));
 }
 
 std::string Shader::getDefaultShaderExtension(ShaderType type) {
@@ -166,12 +271,17 @@ void Shader::printSrc(std::ostream &os, bool printHeader,
 }
 
 GLuint Shader::compile() {
+  startCompile();
+  return finishCompile();
+}
+
+void Shader::startCompile() {
   INFO("Compilando " + filename);
   errorMsg.clear();
 
   if (shaderId != 0) {
     INFO("El shader ya estaba compilado");
-    return shaderId;
+    return;
   }
   Strings srccopy;
   srccopy = src;
@@ -197,6 +307,14 @@ GLuint Shader::compile() {
     ERRT("Error ejecutando glShaderSource");
 
   glCompileShader(shaderId);
+  compiling = true;
+}
+
+GLuint Shader::finishCompile() {
+  if (!compiling)
+    return shaderId;
+  compiling = false;
+
   GLint compiled;
   glGetShaderiv(shaderId, GL_COMPILE_STATUS, &compiled);
 
@@ -223,6 +341,7 @@ void Shader::deleteShaderObject() {
     glDeleteShader(shaderId);
     shaderId = 0;
   }
+  compiling = false;
 }
 
 GLint Shader::toGLType(ShaderType type) {
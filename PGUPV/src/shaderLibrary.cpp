@@ -30,6 +30,43 @@ void ShaderLibrary::remove(Program *shader) {
 }
 
 
+void ShaderLibrary::compileAllAsync() {
+	static bool threadsSet = false;
+	if (!threadsSet) {
+		if (GLEW_KHR_parallel_shader_compile)
+			glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+		else if (GLEW_ARB_parallel_shader_compile)
+			glMaxShaderCompilerThreadsARB(0xFFFFFFFF);
+		threadsSet = true;
+	}
+	// Compilar un programa puede registrar otros (p.e., el de error): se recorre una copia
+	auto programs = library;
+	for (auto p : programs) {
+		if (p->getId() == 0 && !p->isCompiling() && p->getNumShaders() > 0)
+			p->compileAsync();
+	}
+}
+
+uint ShaderLibrary::pollAsync() {
+	uint pending = 0;
+	auto programs = library;
+	for (auto p : programs) {
+		if (p->isCompiling() && !p->isReady())
+			pending++;
+	}
+	return pending;
+}
+
+uint ShaderLibrary::reloadChanged() {
+	uint count = 0;
+	auto programs = library;
+	for (auto p : programs) {
+		if (p->reloadChangedShaders())
+			count++;
+	}
+	return count;
+}
+
 // Returns the number of registered programs	
 uint ShaderLibrary::size() {
 	return (uint)library.size();
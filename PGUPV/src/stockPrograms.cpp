@@ -61,8 +61,7 @@ void PGUPV::buildConstantShadingMVP(Program &program) {
 int TextureReplaceProgram::currentTexUnit;
 
 int TextureReplaceProgram::setTextureUnit(int texUnit) {
-	auto tu = StockProgram<buildReplaceTexture>::getProgram().getUniformLocation("texUnit");
-	glUniform1i(tu, texUnit);
+	StockProgram<buildReplaceTexture>::getProgram().setUniform("texUnit", texUnit);
 	int prev = TextureReplaceProgram::currentTexUnit;
 	TextureReplaceProgram::currentTexUnit = texUnit;
 	return prev;
@@ -108,9 +107,10 @@ Program *ConstantUniformColorProgram::use() {
 
 
 void ConstantUniformColorProgram::setColor(const glm::vec4 &color) {
+	auto &program = StockProgram<PGUPV::buildConstantColorUniform>::getProgram();
 	if (colorLoc == -1) 
-		colorLoc = StockProgram<PGUPV::buildConstantColorUniform>::getProgram().getUniformLocation("color");
-	glUniform4fv(colorLoc, 1, &color.x);
+		colorLoc = program.getUniformLocation("color");
+	program.setUniform(colorLoc, color);
 }
 
 
@@ -0,0 +1,154 @@
+#include <algorithm>
+#include <cstring>
+
+#include "streamingBuffer.h"
+#include "bufferObject.h"
+#include "bindingPoint.h"
+#include "indexedBindingPoint.h"
+#include "utils.h"
+#include "log.h"
+
+using PGUPV::StreamingBuffer;
+using PGUPV::BufferObject;
+
+static const GLbitfield STREAMING_FLAGS = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+// Tiempo máximo de espera de un fence antes de avisar (en nanosegundos)
+static const GLuint64 FENCE_TIMEOUT = 1000000000;
+
+static std::weak_ptr<StreamingBuffer> currentStreamingBuffer;
+
+static size_t alignUp(size_t value, size_t alignment) {
+  return (value + alignment - 1) / alignment * alignment;
+}
+
+bool StreamingBuffer::isSupported() {
+  return GLEW_VERSION_4_4 || GLEW_ARB_buffer_storage;
+}
+
+std::shared_ptr<StreamingBuffer> StreamingBuffer::build(size_t sizePerFrame, unsigned int framesInFlight) {
+  if (!isSupported())
+    ERRT("StreamingBuffer necesita OpenGL 4.4 o la extensión GL_ARB_buffer_storage");
+  if (sizePerFrame == 0 || framesInFlight == 0)
+    ERRT("El tamaño y el número de frames de un StreamingBuffer tienen que ser mayores que 0");
+  return std::shared_ptr<StreamingBuffer>(new StreamingBuffer(sizePerFrame, framesInFlight));
+}
+
+StreamingBuffer::StreamingBuffer(size_t sizePerFrame, unsigned int framesInFlight)
+  : mapped(nullptr), sizePerFrame(sizePerFrame), region(0), head(0), frame(0),
+  fences(framesInFlight, nullptr), overflow(0), warnedFull(false) {
+  GLint alignment;
+  glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+  uboAlignment = static_cast<size_t>(alignment);
+  createStorage();
+}
+
+StreamingBuffer::~StreamingBuffer() {
+  releaseStorage();
+}
+
+void StreamingBuffer::createStorage() {
+  auto total = sizePerFrame * fences.size();
+  bo = BufferObject::buildImmutable(total, STREAMING_FLAGS);
+  bo->setGlDebugLabel("Streaming buffer");
+
+  auto prev = gl_copy_write_buffer.bind(bo);
+  mapped = static_cast<unsigned char *>(glMapBufferRange(GL_COPY_WRITE_BUFFER, 0,
+    total, STREAMING_FLAGS));
+  gl_copy_write_buffer.bind(prev);
+  if (!mapped)
+    ERRT("No se ha podido mapear el streaming buffer");
+  CHECK_GL();
+}
+
+void StreamingBuffer::releaseStorage() {
+  for (auto &f : fences) {
+    if (f)
+      glDeleteSync(f);
+    f = nullptr;
+  }
+  auto prev = gl_copy_write_buffer.bind(bo);
+  glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+  gl_copy_write_buffer.bind(prev);
+  mapped = nullptr;
+  // Si la GPU todavía lo está leyendo, OpenGL lo destruirá cuando termine
+  bo.reset();
+}
+
+StreamingBuffer::Allocation StreamingBuffer::allocate(size_t size, size_t alignment) {
+  if (alignment == 0)
+    alignment = uboAlignment;
+  auto offset = alignUp(head, alignment);
+  if (offset + size > regionStart() + sizePerFrame) {
+    if (!warnedFull) {
+      WARN("El streaming buffer no tiene sitio para " + std::to_string(size) +
+        " bytes más en este frame (" + std::to_string(sizePerFrame) + " bytes por frame)");
+      warnedFull = true;
+    }
+    overflow += size + alignment;
+    return Allocation{ nullptr, 0, 0 };
+  }
+  head = offset + size;
+  return Allocation{ mapped + offset, static_cast<GLintptr>(offset), static_cast<GLsizeiptr>(size) };
+}
+
+StreamingBuffer::Allocation StreamingBuffer::write(const void *data, size_t size, size_t alignment) {
+  auto a = allocate(size, alignment);
+  if (a.valid())
+    memcpy(a.ptr, data, size);
+  return a;
+}
+
+void StreamingBuffer::bindRange(IndexedBindingPoint &bp, GLuint index, const Allocation &a,
+  std::shared_ptr<BufferObject> boundAs) {
+  assert(a.valid());
+  bp.bindBufferRange(bo, index, a.offset, a.size, boundAs);
+}
+
+void StreamingBuffer::endFrame() {
+  if (fences[region])
+    glDeleteSync(fences[region]);
+  fences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+  region = (region + 1) % fences.size();
+  head = regionStart();
+  frame++;
+
+  // Si no cabía todo, se sustituye el buffer por otro con sitio al menos para lo pedido en
+  // este frame. Los trozos que lo usan ya no valen, porque han cambiado de frame
+  if (overflow > 0) {
+    auto newSize = alignUp(std::max(sizePerFrame * 2, sizePerFrame + overflow), uboAlignment);
+    INFO("Ampliando el streaming buffer a " + std::to_string(newSize) + " bytes por frame");
+    releaseStorage();
+    sizePerFrame = newSize;
+    region = 0;
+    head = 0;
+    overflow = 0;
+    warnedFull = false;
+    createStorage();
+    return;
+  }
+
+  // Antes de escribir en la región, la GPU tiene que haber terminado de leerla
+  auto fence = fences[region];
+  if (fence) {
+    GLbitfield flags = GL_SYNC_FLUSH_COMMANDS_BIT;
+    GLenum res;
+    while ((res = glClientWaitSync(fence, flags, FENCE_TIMEOUT)) == GL_TIMEOUT_EXPIRED) {
+      WARN("Esperando a que la GPU termine de leer el streaming buffer");
+      flags = 0;
+    }
+    if (res == GL_WAIT_FAILED)
+      ERRT("Error esperando el fence del streaming buffer");
+    glDeleteSync(fence);
+    fences[region] = nullptr;
+  }
+}
+
+void StreamingBuffer::setCurrent(std::shared_ptr<StreamingBuffer> sb) {
+  currentStreamingBuffer = sb;
+}
+
+std::shared_ptr<StreamingBuffer> StreamingBuffer::getCurrent() {
+  return currentStreamingBuffer.lock();
+}
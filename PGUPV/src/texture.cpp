@@ -2,9 +2,11 @@
 #include "utils.h"
 #include "texture.h"
 #include "log.h"
+#include "glStateTracker.h"
 
 using PGUPV::Texture;
 using PGUPV::App;
+using PGUPV::GLStateTracker;
 using std::string;
 
 Texture::Texture(GLenum texture_type, GLenum minfilter, GLenum magfilter,
@@ -62,13 +64,13 @@ GLint activateScratchTextureUnit() {
 	GLint texunit;
 	glGetIntegerv(GL_ACTIVE_TEXTURE, &texunit);
 	if (texunit != (GL_TEXTURE0 + App::getScratchUnitTextureNumber()))
-		glActiveTexture(GL_TEXTURE0 + App::getScratchUnitTextureNumber());
+		GLStateTracker::activeTexture(GL_TEXTURE0 + App::getScratchUnitTextureNumber());
 	return texunit;
 }
 
 void deactivateScratchTextureUnit(GLint prevTextureUnit) {
 	if (prevTextureUnit != (GL_TEXTURE0 + App::getScratchUnitTextureNumber()))
-		glActiveTexture(GL_TEXTURE0 + App::getScratchUnitTextureNumber());
+		GLStateTracker::activeTexture(GL_TEXTURE0 + App::getScratchUnitTextureNumber());
 }
 
 Texture::TextureLevelInfo Texture::getLevelInfo(GLint level) const
@@ -104,7 +106,7 @@ void Texture::setTexParam(GLenum pname, GLint value) {
 		ERRT("No se pueden establecer parámetros de una textura si no está lista");
 
 	texunit = activateScratchTextureUnit();
-	glBindTexture(_texture_type, _texId);
+	GLStateTracker::bindTexture(_texture_type, _texId);
 	glTexParameteri(_texture_type, pname, value);
 	deactivateScratchTextureUnit(texunit);
 }
@@ -117,7 +119,7 @@ void Texture::setTexParam(GLenum pname, const GLfloat* value) {
 		ERRT("No se pueden establecer parámetros de una textura si no está lista");
 
 	texunit = activateScratchTextureUnit();
-	glBindTexture(_texture_type, _texId);
+	GLStateTracker::bindTexture(_texture_type, _texId);
 	glTexParameterfv(_texture_type, pname, value);
 	deactivateScratchTextureUnit(texunit);
 }
@@ -130,9 +132,10 @@ void Texture::generateMipmap() {
 
 	glGetIntegerv(GL_ACTIVE_TEXTURE, &texunit);
 	if (texunit != (GL_TEXTURE0 + App::getScratchUnitTextureNumber()))
-		glActiveTexture(GL_TEXTURE0 + App::getScratchUnitTextureNumber());
-	glBindTexture(_texture_type, _texId);
+		GLStateTracker::activeTexture(GL_TEXTURE0 + App::getScratchUnitTextureNumber());
+	GLStateTracker::bindTexture(_texture_type, _texId);
 	glGenerateMipmap(_texture_type);
+	updateMemoryUsage();
 	if (texunit != (GL_TEXTURE0 + App::getScratchUnitTextureNumber()))
-		glActiveTexture(GL_TEXTURE0 + App::getScratchUnitTextureNumber());
+		GLStateTracker::activeTexture(GL_TEXTURE0 + App::getScratchUnitTextureNumber());
 }
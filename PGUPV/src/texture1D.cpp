@@ -3,9 +3,11 @@
 #include "utils.h"
 #include "log.h"
 #include "image.h"
+#include "glStateTracker.h"
 
 using PGUPV::Texture1D;
 using PGUPV::Image;
+using PGUPV::GLStateTracker;
 
 Texture1D::Texture1D(GLenum texture_type, GLenum minfilter, GLenum magfilter,
 	GLenum wrap_s)
@@ -19,7 +21,7 @@ Texture1D::Texture1D(GLenum texture_type, GLenum minfilter, GLenum magfilter,
 
 // Allocates memory for a texture with the given size and format
 void Texture1D::allocate(uint width, GLint internalformat) {
-	glBindTexture(_texture_type, _texId);
+	GLStateTracker::bindTexture(_texture_type, _texId);
 	setParams();
 	if (internalformat == GL_RED || internalformat == GL_RG || internalformat == GL_RGB
 		|| internalformat == GL_RGBA)
@@ -43,6 +45,7 @@ void Texture1D::allocate(uint width, GLint internalformat) {
 
 	_width = width;
 	_ready = true;
+	updateMemoryUsage();
 }
 
 void Texture1D::setParams() {
@@ -56,7 +59,7 @@ void Texture1D::loadImageFromMemory(void *pixels, uint width,
 	GLint internalformat) {
 	_ready = false;
 	/* Create and load textures to OpenGL */
-	glBindTexture(_texture_type, this->_texId);
+	GLStateTracker::bindTexture(_texture_type, this->_texId);
 	setParams();
 
 	glTexImage1D(_texture_type, 0, internalformat, width, 0, pixels_format,
@@ -65,6 +68,7 @@ void Texture1D::loadImageFromMemory(void *pixels, uint width,
 	_width = width;
 
 	_ready = true;
+	updateMemoryUsage();
 }
 
 bool Texture1D::loadImage(const Image &image) {
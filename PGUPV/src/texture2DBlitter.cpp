@@ -14,7 +14,6 @@ void PGUPV::texture2DBlit(const glm::vec3 &pos, float height, std::shared_ptr<Te
 	auto tu = PGUPV::App::getScratchUnitTextureNumber();
 	auto prevProg = PGUPV::TextureReplaceProgram::use();
 	auto old = PGUPV::TextureReplaceProgram::setTextureUnit(tu);
-	glActiveTexture(GL_TEXTURE0 + tu);
 	texture->bind(GL_TEXTURE0 + tu);
 	auto mats = std::dynamic_pointer_cast<PGUPV::GLMatrices>(gl_uniform_buffer.getBound(UBO_GL_MATRICES_BINDING_INDEX));
 
@@ -4,15 +4,17 @@
 #include "utils.h"
 #include "log.h"
 #include "image.h"
+#include "glStateTracker.h"
 
 using PGUPV::Texture2DGeneric;
 using PGUPV::Image;
+using PGUPV::GLStateTracker;
 
 Texture2DGeneric::Texture2DGeneric(GLenum texture_type, GLenum minfilter,
 	GLenum magfilter, GLenum wrap_s,
 	GLenum wrap_t)
 	: Texture(texture_type, minfilter, magfilter, wrap_s, wrap_t), _width(0),
-	_height(0) {
+	_height(0), _sourceFormat(GL_RGB), _watchId(0), _reloadingSource(false) {
 	if (texture_type != GL_TEXTURE_2D && texture_type != GL_PROXY_TEXTURE_2D &&
 		texture_type != GL_TEXTURE_1D_ARRAY &&
 		texture_type != GL_PROXY_TEXTURE_1D_ARRAY &&
@@ -31,7 +33,7 @@ Texture2DGeneric::Texture2DGeneric(GLenum texture_type, GLenum minfilter,
 
 // Allocates memory for a texture with the given size and format
 void Texture2DGeneric::allocate(uint width, uint height, GLint internalformat) {
-	glBindTexture(_texture_type, _texId);
+	GLStateTracker::bindTexture(_texture_type, _texId);
 	setParams();
 	if (internalformat == GL_RED || internalformat == GL_RG || internalformat == GL_RGB
 		|| internalformat == GL_RGBA)
@@ -66,6 +68,7 @@ void Texture2DGeneric::allocate(uint width, uint height, GLint internalformat) {
 	_height = height;
 	_internalFormat = internalformat;
 	_ready = true;
+	updateMemoryUsage();
 }
 
 void Texture2DGeneric::setParams() {
@@ -80,9 +83,14 @@ void Texture2DGeneric::setParams() {
 void Texture2DGeneric::loadImageFromMemory(void *pixels, uint width,
 	uint height, GLenum pixels_format, GLenum pixels_type,
 	GLint internalformat) {
+	// La imagen ya no viene del fichero vigilado
+	if (!_reloadingSource) {
+		PGUPV::FileWatcher::unwatch(_watchId);
+		_watchId = 0;
+	}
 	_ready = false;
 	/* Create and load textures to OpenGL */
-	glBindTexture(_texture_type, this->_texId);
+	GLStateTracker::bindTexture(_texture_type, this->_texId);
 	setParams();
 
 	glTexImage2D(_texture_type, 0, internalformat, width, height, 0,
@@ -92,12 +100,13 @@ void Texture2DGeneric::loadImageFromMemory(void *pixels, uint width,
 	_height = height;
 	_internalFormat = internalformat;
 	_ready = true;
+	updateMemoryUsage();
 }
 
 void Texture2DGeneric::updateImageFromMemory(void *pixels, uint width, uint height, GLenum pixels_format,
 	GLenum pixels_type) {
 
-	glBindTexture(_texture_type, _texId);
+	GLStateTracker::bindTexture(_texture_type, _texId);
 	glTexSubImage2D(_texture_type, 0, 0, 0, width, height, pixels_format, pixels_type, pixels);
 
 }
@@ -124,7 +133,32 @@ void Texture2DGeneric::updateImage(const Image &image) {
 bool Texture2DGeneric::loadImage(const std::filesystem::path &filename, GLenum internalFormat) {
 	PGUPV::Image image(filename);
 	_name = filename.filename().string();
-	return loadImage(image, internalFormat);
+	if (!loadImage(image, internalFormat))
+		return false;
+	_sourceFile = filename;
+	_sourceFormat = internalFormat;
+	_watchId = PGUPV::FileWatcher::watch({ filename.string() },
+		[this](const std::vector<std::string> &) { reloadSourceFile(); });
+	return true;
+}
+
+void Texture2DGeneric::reloadSourceFile() {
+	INFO("Recargando " + _sourceFile.string());
+	PGUPV::Image image(_sourceFile);
+	// Se carga en la unidad de trabajo, para no cambiar la textura vinculada a la activa
+	GLint texunit;
+	glGetIntegerv(GL_ACTIVE_TEXTURE, &texunit);
+	GLStateTracker::activeTexture(GL_TEXTURE0 + App::getScratchUnitTextureNumber());
+	_reloadingSource = true;
+	loadImage(image, _sourceFormat);
+	_reloadingSource = false;
+	if (_minfilter != GL_NEAREST && _minfilter != GL_LINEAR)
+		generateMipmap();
+	GLStateTracker::activeTexture(texunit);
+}
+
+Texture2DGeneric::~Texture2DGeneric() {
+	PGUPV::FileWatcher::unwatch(_watchId);
 }
 
 void saveBoundTexture(const std::string &filename, uint32_t width, uint32_t height, uint32_t bpp) {
@@ -151,8 +185,8 @@ void Texture2DGeneric::save(const std::string &filename, GLuint texId, unsigned
 	if (bpp != 8 && bpp != 24 && bpp != 32) {
 		ERRT("Sólo se puede guardar imágenes de 8, 24 y 32 bpp");
 	}
-	glActiveTexture(GL_TEXTURE0 + App::getScratchUnitTextureNumber());
-	glBindTexture(GL_TEXTURE_2D, texId);
+	GLStateTracker::activeTexture(GL_TEXTURE0 + App::getScratchUnitTextureNumber());
+	GLStateTracker::bindTexture(GL_TEXTURE_2D, texId);
 	GLint width, height;
 
 	glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_WIDTH, &width);
@@ -2,9 +2,11 @@
 #include "utils.h"
 #include "log.h"
 #include "image.h"
+#include "glStateTracker.h"
 
 using PGUPV::Texture3DGeneric;
 using PGUPV::Image;
+using PGUPV::GLStateTracker;
 
 Texture3DGeneric::Texture3DGeneric(
   GLenum texture_type, GLenum minfilter, GLenum magfilter, GLenum wrap_s, GLenum wrap_t, GLenum wrap_r) :
@@ -17,7 +19,7 @@ Texture3DGeneric::Texture3DGeneric(
 
 // Allocates memory for a texture with the given size and format
 void Texture3DGeneric::allocate(uint width, uint height, uint depth, GLint internalformat) {
-  glBindTexture(_texture_type, _texId);
+  GLStateTracker::bindTexture(_texture_type, _texId);
   setParams();
   if (internalformat == GL_RED || internalformat == GL_RG || internalformat == GL_RGB
     || internalformat == GL_RGBA)
@@ -39,6 +41,7 @@ void Texture3DGeneric::allocate(uint width, uint height, uint depth, GLint inter
   _height = height;
   _depth = depth;
   _ready = true;
+  updateMemoryUsage();
 }
 
 void Texture3DGeneric::setParams() {
@@ -61,7 +64,7 @@ void Texture3DGeneric::loadSlice(void *pixels, uint width, uint height, uint sli
 
   _ready = false;
   /* Create and load textures to OpenGL */
-  glBindTexture(_texture_type, _texId);
+  GLStateTracker::bindTexture(_texture_type, _texId);
   setParams();
 
   glTexSubImage3D(_texture_type, 0, 0, 0, slice, width, height, 1, pixels_format, pixels_type,
@@ -2,6 +2,7 @@
 #include "textureCubeMap.h"
 #include "log.h"
 #include "image.h"
+#include "glStateTracker.h"
 
 #ifdef _WIN32
 #pragma warning(push)
@@ -24,6 +25,7 @@
 
 using PGUPV::TextureCubeMap;
 using PGUPV::Image;
+using PGUPV::GLStateTracker;
 
 using std::string;
 
@@ -42,7 +44,7 @@ bool TextureCubeMap::loadImage(GLenum face, const std::filesystem::path &filenam
 	if (flipV)
 		image.flipV();
 
-	glBindTexture(GL_TEXTURE_CUBE_MAP, _texId);
+	GLStateTracker::bindTexture(GL_TEXTURE_CUBE_MAP, _texId);
 	/* Create and load textures to OpenGL */
 	glTexImage2D(face, 0, image.getSuggestedGLInternalFormatType(), image.getWidth(), image.getHeight(), 0,
 		image.getGLFormatType(), image.getGLPixelBaseType(), image.getPixels());
@@ -76,6 +78,8 @@ bool TextureCubeMap::loadImage(GLenum face, const std::filesystem::path &filenam
 	}
 
 	_name = filename.filename().string();
+	if (_ready)
+		updateMemoryUsage();
 	return _ready;
 }
 
@@ -87,7 +91,7 @@ bool TextureCubeMap::loadDDS(std::string filename, std::ostream * /*error_output
 	gli::gl GL(gli::gl::PROFILE_GL33);
 	gli::gl::format const Format = GL.translate(Texture.format(), Texture.swizzles());
 
-	glBindTexture(_texture_type, _texId);
+	GLStateTracker::bindTexture(_texture_type, _texId);
 	glTexParameteri(_texture_type, GL_TEXTURE_BASE_LEVEL, 0);
 	glTexParameteri(_texture_type, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(Texture.levels() - 1));
 	glTexParameteri(_texture_type, GL_TEXTURE_SWIZZLE_R, Format.Swizzles[0]);
@@ -127,6 +131,7 @@ bool TextureCubeMap::loadDDS(std::string filename, std::ostream * /*error_output
 	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, _wrap_s);
 	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, _wrap_t);
 	_ready = true;
+	updateMemoryUsage();
 
 	return _ready;
 }
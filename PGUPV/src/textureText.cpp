@@ -6,6 +6,7 @@
 #include "textureText.h"
 #include "log.h"
 #include "app.h"
+#include "glStateTracker.h"
 
 
 #include <SDL3_ttf/SDL_ttf.h>
@@ -13,6 +14,7 @@
 using PGUPV::TextureTextBuilder;
 using PGUPV::TextureText;
 using PGUPV::Font;
+using PGUPV::GLStateTracker;
 
 
 TextureTextBuilder::TextureTextBuilder() {
@@ -50,7 +52,7 @@ TextureTextBuilder& TextureTextBuilder::backgroundColor(const glm::vec4& color)
 std::shared_ptr<TextureText> TextureTextBuilder::build() {
 
 	PGUPV::GLStateCapturer< PGUPV::ActiveTextureUnitState> restoreActiveTextureUnit;
-	glActiveTexture(GL_TEXTURE0 + PGUPV::App::getScratchUnitTextureNumber());
+	GLStateTracker::activeTexture(GL_TEXTURE0 + PGUPV::App::getScratchUnitTextureNumber());
  	auto result = std::shared_ptr<TextureText>(new TextureText(theText, theFont, theWrapWidth, fgcolor, bgcolor));
 	result->setName(theText);
 	return result;
@@ -1,19 +1,27 @@
 #include "transform.h"
 #include "nodeVisitor.h"
 #include "indexedBindingPoint.h"
+#include "nodePool.h"
+#include "renderStats.h"
 
 using PGUPV::Transform;
 using PGUPV::NodeVisitor;
 using PGUPV::Value;
+using PGUPV::BoundingBox;
+using PGUPV::BoundingSphere;
+
+uint64_t Transform::generationCounter = 0;
 
 std::shared_ptr<Transform> Transform::build(const glm::mat4 & xform) {
+  if (auto pool = PGUPV::NodePool::current())
+    return pool->make<Transform>(xform);
   auto ret = std::shared_ptr<Transform>(new Transform(xform));
   return ret;
 }
 
 void Transform::setTransform(const glm::mat4 &xform) {
+  // El listener de transf invalida los volúmenes de inclusión
   transf.setValue(xform);
-  invalidateBoundingVolumes();
 }
 
 glm::mat4 Transform::getTransform() const {
@@ -31,14 +39,17 @@ void Transform::accept(NodeVisitor & visitor) {
 }
 
 void PGUPV::Transform::render() {
-  if (!visible || !getBB().isValid()) return;
+  PGUPV::RenderStats::increment(PGUPV::RenderStats::Counter::NodesVisited);
+  // El volumen de inclusión de la transformación ya incluye transf, así que se comprueba
+  // antes de acumularla en la matriz del modelo
+  if (!visible || !getBB().isValid() || isOutsideViewVolume()) return;
   auto bo = PGUPV::gl_uniform_buffer.getBound(UBO_GL_MATRICES_BINDING_INDEX);
   auto mats = std::static_pointer_cast<GLMatrices>(bo);
 
   mats->pushMatrix(GLMatrices::MODEL_MATRIX);
   mats->multMatrix(GLMatrices::MODEL_MATRIX, transf.getValue());
 
-  Group::render();
+  renderChildren();
 
   mats->popMatrix(GLMatrices::MODEL_MATRIX);
 }
@@ -58,6 +69,90 @@ std::shared_ptr<Transform> Transform::shared_from_this()
   return std::static_pointer_cast<Transform>(Node::shared_from_this());
 }
 
-Transform::Transform(const glm::mat4 &xform) : transf(xform) {
-  transf.addListener([this](const glm::mat4&) {invalidateBoundingVolumes(); });
+const glm::mat4 &Transform::getWorldTransform() {
+  if (!worldValid) {
+    auto parent = findParentTransform();
+    worldMatrix = parent ? parent->getWorldTransform() * transf.getValue() : transf.getValue();
+    worldGeneration = ++generationCounter;
+    worldValid = true;
+  }
+  return worldMatrix;
+}
+
+namespace {
+  // Invalida la matriz del mundo de los Transform que cuelgan del nodo visitado
+  class InvalidateWorldTransforms : public NodeVisitor {
+  public:
+    InvalidateWorldTransforms() : NodeVisitor(NodeVisitor::TraversalMode::TRAVERSE_ALL_CHILDREN) {
+      setNodePathMode(NodeVisitor::NodePathMode::RAW);
+    }
+    void apply(Transform &transform) override {
+      transform.invalidateWorldTransform();
+    }
+  };
+}
+
+void Transform::invalidateWorldTransform() {
+  // Si ya no era válida, tampoco lo son las de los descendientes: sólo se calculan después
+  // de calcular la de este nodo
+  if (!worldValid)
+    return;
+  worldValid = false;
+  InvalidateWorldTransforms iwt;
+  for (const auto &c : children)
+    c->accept(iwt);
+}
+
+uint64_t Transform::getWorldGeneration() {
+  getWorldTransform();
+  return worldGeneration;
+}
+
+// Devuelve true si hay que recalcular un volumen del mundo calculado con los contadores
+// indicados, y los actualiza
+bool Transform::updateWorldBoundsStamp(uint64_t &stamp, uint64_t &boundsStamp) {
+  auto gen = getWorldGeneration();
+  // Los volúmenes del mundo dependen de los de los hijos: hay que enterarse si se invalidan
+  boundsQueried = true;
+  if (stamp == gen && boundsStamp == boundsGeneration)
+    return false;
+  stamp = gen;
+  boundsStamp = boundsGeneration;
+  return true;
+}
+
+BoundingBox Transform::getWorldBB() {
+  if (updateWorldBoundsStamp(worldBBStamp, worldBBBoundsStamp)) {
+    // Transformar la caja de cada hijo con la matriz completa da una caja más ajustada
+    // que transformar la caja del nodo
+    worldBB.reset();
+    for (const auto &c : children) {
+      auto b = c->getBB();
+      b.transform(worldMatrix);
+      worldBB.grow(b);
+    }
+  }
+  return worldBB;
+}
+
+BoundingSphere Transform::getWorldBS() {
+  if (updateWorldBoundsStamp(worldBSStamp, worldBSBoundsStamp)) {
+    worldBS.reset();
+    for (const auto &c : children) {
+      auto s = c->getBS();
+      if (!s.isValid()) continue;
+      s.transform(worldMatrix);
+      worldBS.grow(s);
+    }
+  }
+  return worldBS;
+}
+
+Transform::Transform(const glm::mat4 &xform) : transf(xform), worldGeneration(0),
+  worldValid(false), worldBBStamp(0), worldBBBoundsStamp(0), worldBSStamp(0),
+  worldBSBoundsStamp(0) {
+  transf.addListener([this](const glm::mat4&) {
+    invalidateWorldTransform();
+    invalidateBoundingVolumes();
+  });
 }
@@ -1,10 +1,13 @@
 #include "log.h"
 #include "uboBones.h"
 #include "indexedBindingPoint.h"
+#include "streamingBuffer.h"
 
+#include <cstring>
 #include <gsl/gsl>
 
 using PGUPV::UBOBones;
+using PGUPV::StreamingBuffer;
 
 const std::string UBOBones::blockName{ "Bones" };
 const Strings UBOBones::definition{
@@ -13,7 +16,8 @@ const Strings UBOBones::definition{
 	  "};"
 };
 
-UBOBones::UBOBones(unsigned long sizeInBytes) : UniformBufferObject(sizeInBytes) {
+UBOBones::UBOBones(unsigned long sizeInBytes) : UniformBufferObject(sizeInBytes),
+	streamed{ nullptr, 0, 0 }, streamedFrame(0) {
 }
 
 
@@ -39,7 +43,32 @@ std::shared_ptr<UBOBones> UBOBones::build()
 	return ubo;
 }
 
+void UBOBones::update(const glm::mat4 *b, size_t n) {
+	if (n > MAX_BONES) {
+		ERRT("El nmero mximo de huesos soportado es " + std::to_string(MAX_BONES));
+	}
+	auto sb = StreamingBuffer::getCurrent();
+	if (sb) {
+		// El bloque del shader tiene MAX_BONES matrices, as que se reserva el bloque entero
+		streamed = sb->allocate(sizeof(glm::mat4) * MAX_BONES);
+		if (streamed.valid()) {
+			memcpy(streamed.ptr, b, sizeof(glm::mat4) * n);
+			stream = sb;
+			streamedFrame = sb->getFrame();
+			return;
+		}
+	}
+	stream.reset();
+	PGUPV::gl_uniform_buffer.bindBufferBase(shared_from_this(), UBO_BONES_BINDING_INDEX);
+	PGUPV::gl_uniform_buffer.write((void *)b, gsl::narrow<uint32_t>(sizeof(glm::mat4) * n), 0);
+}
+
 void UBOBones::use() {
+	auto sb = stream.lock();
+	if (sb && sb->getFrame() == streamedFrame) {
+		sb->bindRange(PGUPV::gl_uniform_buffer, UBO_BONES_BINDING_INDEX, streamed);
+		return;
+	}
 	PGUPV::gl_uniform_buffer.bindBufferBase(shared_from_this(), UBO_BONES_BINDING_INDEX);
 }
 
@@ -369,36 +369,37 @@ std::pair<size_t, size_t> searchVariable(const std::string& line) {
 Strings PGUPV::expandText(const std::map<std::string, Strings>& transTable,
 	const Strings& org) {
 	Strings dst;
+	dst.reserve(org.size());
 
-	Strings::size_type otam = org.size();
-	for (uint i = 0; i < otam; i++) {
-		string line = org[i];
+	string var;
+	for (const auto &line : org) {
 		auto se = searchVariable(line);
 		if (se.first == std::string::npos)
 			// Not found: just copy the line
-			dst.push_back(org[i]);
+			dst.push_back(line);
 		else {
 			// Found a variable! substitute the variable with the value
-			auto var = line.substr(se.first, se.second);
+			var.assign(line, se.first, se.second);
 			auto pair = transTable.find(var);
 			if (transTable.end() == pair)
 				ERRT("No se reconoce la variable " + var);
 			const Strings& values = pair->second; // subStrings[line];
 
-			auto prefix = line.substr(0, se.first);
-			auto suffix = line.substr(se.first + se.second);
+			auto suffixPos = se.first + se.second;
 			if (values.size() <= 1) {
-				auto tmpStr = prefix;
+				// Se construye la línea directamente en el destino
+				dst.emplace_back();
+				auto &tmpStr = dst.back();
+				tmpStr.reserve(line.size() - se.second + (values.empty() ? 0 : values[0].size()));
+				tmpStr.append(line, 0, se.first);
 				if (values.size() == 1) tmpStr += values[0];
-				tmpStr += suffix;
-				dst.push_back(tmpStr);
+				tmpStr.append(line, suffixPos, string::npos);
 			}
 			else {
-				if (prefix.size() > 0) dst.push_back(prefix);
-				for (uint j = 0; j < values.size(); j++)
-					dst.push_back(values[j]);
-				if (suffix.size() > 0)
-					dst.push_back(suffix);
+				if (se.first > 0) dst.emplace_back(line, 0, se.first);
+				dst.insert(dst.end(), values.begin(), values.end());
+				if (suffixPos < line.size())
+					dst.emplace_back(line, suffixPos, string::npos);
 			}
 		}
 	}
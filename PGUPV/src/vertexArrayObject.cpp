@@ -1,6 +1,7 @@
 #include "vertexArrayObject.h"
 
 #include <GL/glew.h>
+#include "glStateTracker.h"
 
 using PGUPV::VertexArrayObject;
 
@@ -10,12 +11,13 @@ VertexArrayObject::VertexArrayObject() {
 
 VertexArrayObject::~VertexArrayObject() {
 	glDeleteVertexArrays(1, &vao);
+	PGUPV::GLStateTracker::forgetVertexArray(vao);
 }
 
 void VertexArrayObject::bind() {
-	glBindVertexArray(vao);
+	PGUPV::GLStateTracker::bindVertexArray(vao);
 }
 
 void VertexArrayObject::unbind() {
-	glBindVertexArray(0);
+	PGUPV::GLStateTracker::bindVertexArray(0);
 }
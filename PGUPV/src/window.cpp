@@ -1,5 +1,7 @@
 
 #include <stdexcept>
+#include <algorithm>
+#include <cctype>
 #include <sstream>
 
 
@@ -16,6 +18,12 @@
 #include "utils.h"
 #include "logConsole.h"
 #include "guipg.h"
+#include "renderStats.h"
+#include "streamingBuffer.h"
+#include "resourceTracker.h"
+#include "fileWatcher.h"
+#include "glStateTracker.h"
+#include "programCache.h"
 
 using PGUPV::Window;
 using PGUPV::Renderer;
@@ -23,9 +31,25 @@ using PGUPV::CameraHandler;
 using PGUPV::Image;
 using PGUPV::TextureRectangle;
 using PGUPV::GLVersion;
+using PGUPV::RenderStats;
+using PGUPV::StreamingBuffer;
+using PGUPV::ResourceTracker;
+using PGUPV::FileWatcher;
+using PGUPV::ProgramCache;
+using PGUPV::GLStateTracker;
 
 bool Window::_glewReady = false;
 
+// Llama a código de la aplicación, que puede cambiar el estado de OpenGL directamente. Si
+// GLStateTracker está eliminando las vinculaciones redundantes, su copia del estado se olvida
+// antes y después de la llamada
+template <typename F>
+static void callRenderer(F f) {
+	GLStateTracker::invalidate();
+	f();
+	GLStateTracker::invalidate();
+}
+
 
 Window::Window()
 	: _openGLReqMaj(0), _openGLReqMin(0), _openGLCompatibility(false),
@@ -49,6 +73,7 @@ Window::~Window() {
 void Window::destroy() {
 	deregisterEventHandlers();
 	renderers.clear();
+	frameStream.reset();
 	window.reset();
 }
 
@@ -155,6 +180,8 @@ bool Window::createWindow(const std::string &title, uint flags, uint posx,
 	if (window->hasDebugContext())
 		installDebugContextCallback();
 
+	ProgramCache::contextCreated();
+
 	GLint fbo;
 	glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &fbo);
 	if (fbo)
@@ -232,7 +259,7 @@ void Window::addRenderer(int order, std::shared_ptr<Renderer> r) {
 	//  ERRT("Ya hay un renderer con esa prioridad");
 
 	renderers[order] = r;
-	r->dispatchSetup();
+	callRenderer([&r]() { r->dispatchSetup(); });
 	resizeRenderer(r);
 }
 
@@ -253,15 +280,30 @@ void Window::removeRenderer(int order) {
 void Window::draw() {
 	assert(window);
 
+	if (!frameStream && StreamingBuffer::isSupported())
+		frameStream = StreamingBuffer::build(FRAME_STREAM_SIZE);
+	StreamingBuffer::setCurrent(frameStream);
+	// Cada ventana tiene su contexto
+	GLStateTracker::invalidate();
+	// Recarga los recursos cuyos ficheros han cambiado desde el último frame
+	FileWatcher::processEvents();
+	// Prepara los programas que hayan terminado de compilarse en segundo plano
+	App::getShaderLibrary().pollAsync();
+
 	glstats.beginFrame();
+	RenderStats::beginFrame();
 
 	for (auto r : renderers) {
-		r.second->preRender();
-		r.second->render();
-		r.second->postRender();
+		callRenderer([&r]() { r.second->preRender(); });
+		callRenderer([&r]() { r.second->render(); });
+		callRenderer([&r]() { r.second->postRender(); });
 	}
 
+	RenderStats::endFrame();
 	glstats.endFrame();
+	if (frameStream)
+		frameStream->endFrame();
+	ResourceTracker::endFrame();
 
 	if (!renderers.empty() && _showBuffer != Window::COLOR_BUFFER) {
 		_bufferRenderer->showBuffer();
@@ -303,7 +345,7 @@ void Window::drawGUIandStats() {
 					getWindowHW()->initGUIRender();
 					needRenderGUI = true;
 				}
-				r.second->getPanel(i)->render();
+				callRenderer([&r, i]() { r.second->getPanel(i)->render(); });
 			}
 		}
 	}
@@ -330,6 +372,8 @@ void Window::drawGUIandStats() {
 	if (needRenderGUI) {
 		GUILib::finishFrame();
 		GUILib::renderFrame();
+		// La interfaz se dibuja llamando a OpenGL directamente
+		GLStateTracker::invalidate();
 	}
 
 	if (prevDrawBuffer != -1) {
@@ -351,7 +395,7 @@ void Window::resizeRenderer(std::shared_ptr<Renderer> r) {
 	std::shared_ptr<CameraHandler> c = r->getCameraHandler();
 	if (c)
 		c->resized(_width, _height);
-	r->reshape(_width, _height);
+	callRenderer([this, &r]() { r->reshape(_width, _height); });
 }
 
 void Window::reshaped(int w, int h) {
@@ -368,6 +412,29 @@ void Window::buildStatsPanel() {
 	msPerFrameWidget = std::make_shared<LineChartWidget>("ms/frame", 100, 80, 1);
 	samplesPassedWidget = std::make_shared<LineChartWidget>("samples", 100, 80, 1);
 	primitivesGeneratedWidget = std::make_shared<LineChartWidget>("primitives", 100, 80, 1);
+	// Los contadores de la escena más básicos se ven siempre, el resto si se piden
+	auto isBasicRenderStat = [](unsigned int c) {
+		return c == PGUPV::to_underlying(RenderStats::Counter::GeodesDrawn) ||
+			c == PGUPV::to_underlying(RenderStats::Counter::NodesCulled);
+	};
+	renderStatsWidgets.clear();
+	for (unsigned int c = 0; c < RenderStats::NCounters; c++) {
+		auto name = RenderStats::getName(static_cast<RenderStats::Counter>(c));
+		std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+		auto w = std::make_shared<LineChartWidget>(name, 100, 80, 1);
+		w->setVisible(isBasicRenderStat(c));
+		renderStatsWidgets.push_back(w);
+	}
+	gpuMemoryWidget = std::make_shared<LineChartWidget>("GPU memory (MB)", 100, 80, 1);
+	gpuMemoryLabel = std::make_shared<Label>("");
+	cpuMemoryLabel = std::make_shared<Label>("");
+	auto sceneStatsCB = std::make_shared<CheckBoxWidget>("Show scene submission stats");
+	sceneStatsCB->getValue().addListener([this, isBasicRenderStat](bool set) {
+		for (unsigned int c = 0; c < RenderStats::NCounters; c++) {
+			if (!isBasicRenderStat(c))
+				renderStatsWidgets[c]->setVisible(set);
+		}
+	});
 	auto extendedStatsCB = std::make_shared<CheckBoxWidget>("Collect extended stats");
 	extendedStatsCB->getValue().addListener([&](bool set) {
 		glstats.collectExtendedStats(set);
@@ -406,6 +473,12 @@ void Window::buildStatsPanel() {
 	statspanel->addWidget(msPerFrameWidget);
 	statspanel->addWidget(samplesPassedWidget);
 	statspanel->addWidget(primitivesGeneratedWidget);
+	statspanel->addWidget(sceneStatsCB);
+	for (auto &w : renderStatsWidgets)
+		statspanel->addWidget(w);
+	statspanel->addWidget(gpuMemoryWidget);
+	statspanel->addWidget(gpuMemoryLabel);
+	statspanel->addWidget(cpuMemoryLabel);
 	statspanel->addWidget(extendedStatsCB);
 	statspanel->addWidget(verticesSubmittedWidget);
 	statspanel->addWidget(primitivesSubmittedWidget);
@@ -422,6 +495,7 @@ void Window::update(uint64_t ms) {
 	static uint64_t elapsed = 0, nframes = 0;
 	static uint64_t samplesPassedAccum = 0, primitivesGeneratedAccum = 0, verticesSubmittedAccum = 0, primitivesSubmittedAccum = 0, fragmentShaderInvAccum = 0;
 	static uint64_t clippingInAccum = 0, clippingOutAccum = 0;
+	static uint64_t renderStatsAccum[RenderStats::NCounters]{};
 	static float renderElapsed = 0.0f;
 
 	elapsed += ms;
@@ -434,6 +508,8 @@ void Window::update(uint64_t ms) {
 	fragmentShaderInvAccum += glstats.getValue(GLStats::Query::FragmentShaderInvocationsExt);
 	clippingInAccum += glstats.getValue(GLStats::Query::ClippingInputPrimitivesExt);
 	clippingOutAccum += glstats.getValue(GLStats::Query::ClippingOutputPrimitivesExt);
+	for (unsigned int c = 0; c < RenderStats::NCounters; c++)
+		renderStatsAccum[c] += RenderStats::getValue(static_cast<RenderStats::Counter>(c));
 
 	if (elapsed >= 100) {
 		float fps = nframes * elapsed / 10.0f;
@@ -452,26 +528,41 @@ void Window::update(uint64_t ms) {
 			computeShaderInvWidget->setText("Compute shader execs: " + std::to_string(glstats.getValue(GLStats::Query::ComputeShaderInvocationsExt)));
 			clippingInWidget->pushValue(static_cast<float>(clippingInAccum) / nframes);
 			clippingOutWidget->pushValue(static_cast<float>(clippingOutAccum) / nframes);
+			for (unsigned int c = 0; c < RenderStats::NCounters; c++)
+				renderStatsWidgets[c]->pushValue(static_cast<float>(renderStatsAccum[c]) / nframes);
+			auto toMB = [](size_t bytes) { return std::to_string(bytes >> 20); };
+			gpuMemoryWidget->pushValue(ResourceTracker::getTotal(ResourceTracker::Pool::GPU) / (1024.0f * 1024.0f));
+			gpuMemoryLabel->setText("Buffers: " + toMB(ResourceTracker::getTotal(ResourceTracker::Category::Buffers)) +
+				" MB, textures: " + toMB(ResourceTracker::getTotal(ResourceTracker::Category::Textures)) +
+				" MB (peak " + toMB(ResourceTracker::getPeak(ResourceTracker::Pool::GPU)) + " MB)");
+			cpuMemoryLabel->setText("CPU mirrors: " + toMB(ResourceTracker::getTotal(ResourceTracker::Category::CPUMirrors)) +
+				" MB (peak " + toMB(ResourceTracker::getPeak(ResourceTracker::Pool::CPU)) + " MB)");
 
 		}
 		elapsed = 0;
 		nframes = 0;
 		samplesPassedAccum = primitivesGeneratedAccum = verticesSubmittedAccum = primitivesSubmittedAccum = fragmentShaderInvAccum = 0;
 		clippingInAccum = clippingOutAccum = 0;
+		std::fill(renderStatsAccum, renderStatsAccum + RenderStats::NCounters, 0);
 		renderElapsed = 0.0f;
 	}
 
 	for (auto &r : renderers) {
 		r.second->update_camera(ms);
-		r.second->update(ms);
+		callRenderer([&r, ms]() { r.second->update(ms); });
 	}
 }
 
 void Window::onReload()
 {
+	// Los renderers que reconstruyen sus programas en reload() los cargan ya actualizados, así
+	// que después sólo se recompilan los programas que siguen teniendo ficheros modificados
 	for (auto& r : renderers) {
-		r.second->reload();
+		callRenderer([&r]() { r.second->reload(); });
 	}
+	uint n = App::getShaderLibrary().reloadChanged();
+	if (n > 0)
+		INFO("Recompilados " + std::to_string(n) + " programas");
 }
 
 void Window::setTitle(const std::string &title) {